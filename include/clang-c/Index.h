@@ -234,6 +234,24 @@ CINDEX_LINKAGE time_t clang_getFileTime(CXFile SFile);
 CINDEX_LINKAGE unsigned 
 clang_isFileMultipleIncludeGuarded(CXTranslationUnit tu, CXFile file);
 
+/**
+ * \brief Retrieve a hash of the token stream of the given file, as it was
+ * lexed by the last parse of the translation unit.
+ *
+ * Comments and the amount of whitespace between tokens don't affect the
+ * hash, so an edit that changes it certainly changed the file's tokens.
+ * Equal hashes don't mean the file means the same thing, though: moving
+ * tokens to other lines changes what \c __LINE__ expands to, and what the
+ * file means also depends on the macros and declarations that come before
+ * it.  Hashes are only recorded for translation units parsed with
+ * \c CXTranslationUnit_TrackFileTokenHashes.
+ *
+ * \returns non-zero, after storing the hash in \c *hash, if the file was used
+ * by the last parse and its hash was recorded; zero otherwise.
+ */
+CINDEX_LINKAGE unsigned clang_getFileTokenHash(CXTranslationUnit tu,
+                                               CXFile file, unsigned *hash);
+
 /**
  * \brief Retrieve a file handle within the given translation unit.
  *
@@ -539,6 +557,26 @@ CINDEX_LINKAGE unsigned clang_getNumDiagnostics(CXTranslationUnit Unit);
 CINDEX_LINKAGE CXDiagnostic clang_getDiagnostic(CXTranslationUnit Unit,
                                                 unsigned Index);
 
+/**
+ * \brief Determine whether a diagnostic of the given translation unit was
+ * already reported by the parse before the last one.
+ *
+ * A diagnostic is repeated if the parse before the last one reported the
+ * same diagnostic, with the same severity, at the same line and column of a
+ * file whose token stream hasn't changed in between.  Clients that show the
+ * diagnostics of each \c clang_reparseTranslationUnit() can skip these.
+ * Diagnostics without a location in a file are never repeated, and neither
+ * are any diagnostics unless the translation unit was parsed with
+ * \c CXTranslationUnit_TrackFileTokenHashes.
+ *
+ * \param Unit the translation unit to query.
+ * \param Index the zero-based diagnostic number to query.
+ *
+ * \returns non-zero if the diagnostic is repeated, zero otherwise.
+ */
+CINDEX_LINKAGE unsigned clang_isDiagnosticRepeated(CXTranslationUnit Unit,
+                                                   unsigned Index);
+
 /**
  * \brief Destroy a diagnostic.
  */
@@ -925,7 +963,48 @@ enum CXTranslationUnit_Flags {
    * value, and its semantics. This is just an alias.
    */
   CXTranslationUnit_NestedMacroInstantiations =
-    CXTranslationUnit_NestedMacroExpansions
+    CXTranslationUnit_NestedMacroExpansions,
+
+  /**
+   * \brief Used to indicate that the implicit precompiled header for the
+   * preamble should be rebuilt on a background thread.
+   *
+   * Without this flag, the reparse that finds the preamble out of date
+   * rebuilds it before parsing. With it, that reparse (and any others until
+   * the rebuild is done) parses the whole file instead, and the first
+   * reparse after the rebuild is done starts using the new preamble. This
+   * bounds how long an edit to an included header can stall
+   * \c clang_reparseTranslationUnit(). The flag only has an effect along
+   * with \c CXTranslationUnit_PrecompiledPreamble, and only when libclang
+   * was built with thread support.
+   */
+  CXTranslationUnit_AsyncPrecompiledPreamble = 0x80,
+
+  /**
+   * \brief Used to indicate that the parser should skip the bodies of C
+   * function definitions.
+   *
+   * The tokens of each body are kept, and the body is parsed if it is
+   * needed while the translation unit is being parsed. Bodies that are
+   * still skipped once parsing is done are not part of the translation
+   * unit: their functions are declarations rather than definitions, and
+   * errors within them are not reported. A body parsed later sees the
+   * declarations that follow it. This makes parsing faster for clients
+   * that only need the declarations of a file.
+   */
+  CXTranslationUnit_SkipFunctionBodies = 0x100,
+
+  /**
+   * \brief Used to indicate that each parse should record a hash of the
+   * token stream of every file it uses.
+   *
+   * The hashes are available through \c clang_getFileTokenHash(), and a
+   * reparse uses them to tell which of its diagnostics were already reported
+   * by the parse before it; see \c clang_isDiagnosticRepeated().  Every file
+   * is lexed a second time to compute its hash, so this makes parsing
+   * slower.
+   */
+  CXTranslationUnit_TrackFileTokenHashes = 0x200
 };
 
 /**
@@ -37,6 +37,7 @@
 
 namespace llvm {
   struct fltSemantics;
+  namespace sys { class MutexImpl; }
 }
 
 namespace clang {
@@ -145,6 +146,13 @@ class ASTContext : public llvm::RefCountedBase<ASTContext> {
   mutable llvm::DenseMap<const ObjCContainerDecl*, const ASTRecordLayout*>
     ObjCLayouts;
 
+  /// ConstantValues - A cache mapping integer expressions whose value depends
+  /// on nothing but their operands to that value, so that nested constant
+  /// expressions aren't folded over and over.  This is intentionally not
+  /// serialized.
+  mutable llvm::DenseMap<const Expr*, llvm::APSInt> ConstantValues;
+  mutable unsigned NumConstantValueHits, NumConstantValueMisses;
+
   /// KeyFunctions - A cache mapping from CXXRecordDecls to key functions.
   llvm::DenseMap<const CXXRecordDecl*, const CXXMethodDecl*> KeyFunctions;
   
@@ -339,6 +347,23 @@ class ASTContext : public llvm::RefCountedBase<ASTContext> {
   /// AST objects will be released when the ASTContext itself is destroyed.
   mutable llvm::BumpPtrAllocator BumpAlloc;
 
+  /// \brief The lock held while a type is created, once concurrent type
+  /// creation is enabled; null until then.
+  ///
+  /// The type getters call each other to build canonical types, so a single
+  /// recursive lock covers all of the uniquing tables.
+  llvm::sys::MutexImpl *TypeCreationLock;
+
+  /// \brief The per-thread allocators used once concurrent type creation is
+  /// enabled; null until then.
+  struct ThreadArenaSet;
+  ThreadArenaSet *ThreadArenas;
+
+  class TypeCreationGuard;
+  friend class TypeCreationGuard;
+
+  void *AllocateInThreadArena(unsigned Size, unsigned Align) const;
+
   /// \brief Allocator for partial diagnostics.
   PartialDiagnostic::StorageAllocator DiagAllocator;
 
@@ -364,6 +389,17 @@ public:
   llvm::OwningPtr<ExternalASTSource> ExternalSource;
   ASTMutationListener *Listener;
 
+  /// \brief Callback to the parser to parse a function body it skipped,
+  /// when the body is needed.  See FunctionDecl::hasSkippedBody().
+  typedef void LazyBodyParserCB(void *P, const FunctionDecl *FD);
+  LazyBodyParserCB *LazyBodyParser;
+  void *OpaqueLazyBodyParser;
+
+  void setLazyBodyParser(LazyBodyParserCB *LBP, void *P) {
+    LazyBodyParser = LBP;
+    OpaqueLazyBodyParser = P;
+  }
+
   clang::PrintingPolicy getPrintingPolicy() const { return PrintingPolicy; }
 
   void setPrintingPolicy(clang::PrintingPolicy Policy) {
@@ -373,15 +409,28 @@ public:
   SourceManager& getSourceManager() { return SourceMgr; }
   const SourceManager& getSourceManager() const { return SourceMgr; }
   void *Allocate(unsigned Size, unsigned Align = 8) const {
+    if (ThreadArenas)
+      return AllocateInThreadArena(Size, Align);
     return BumpAlloc.Allocate(Size, Align);
   }
   void Deallocate(void *Ptr) const { }
+
+  /// \brief Allow several threads to create types and allocate AST objects
+  /// in this context at the same time.
+  ///
+  /// From then on, creating a type takes a lock, and each thread allocates
+  /// from an arena of its own which the context owns.  Nothing else about
+  /// the context becomes thread-safe.  This must be called before the other
+  /// threads start, and can't be undone.
+  void enableConcurrentTypeCreation();
+
+  bool isConcurrentTypeCreationEnabled() const {
+    return TypeCreationLock != 0;
+  }
   
   /// Return the total amount of physical memory allocated for representing
   /// AST nodes and type information.
-  size_t getASTAllocatedMemory() const {
-    return BumpAlloc.getTotalMemory();
-  }
+  size_t getASTAllocatedMemory() const;
   /// Return the total memory used for various side tables.
   size_t getSideTableAllocatedMemory() const;
   
@@ -538,6 +587,17 @@ public:
   void PrintStats() const;
   const std::vector<Type*>& getTypes() const { return Types; }
 
+  /// \brief Retrieve the value of an integer expression which was evaluated
+  /// before, or null if it hasn't been.
+  const llvm::APSInt *getCachedConstantValue(const Expr *E) const;
+
+  /// \brief Remember the value of an integer expression.  Only expressions
+  /// whose value can't change later, because it refers to no declaration or
+  /// opaque value, may be cached.
+  void setCachedConstantValue(const Expr *E, const llvm::APSInt &Value) const {
+    ConstantValues[E] = Value;
+  }
+
   /// \brief Retrieve the declaration for the 128-bit signed integer type.
   TypedefDecl *getInt128Decl() const;
 
@@ -1434,6 +1434,7 @@ private:
   bool HasImplicitReturnZero : 1;
   bool IsLateTemplateParsed : 1;
   bool IsConstexpr : 1;
+  bool HasSkippedBody : 1;
 
   /// \brief End part of this FunctionDecl's source range.
   ///
@@ -1518,6 +1519,7 @@ protected:
       HasWrittenPrototype(true), IsDeleted(false), IsTrivial(false),
       IsDefaulted(false), IsExplicitlyDefaulted(false),
       HasImplicitReturnZero(false), IsLateTemplateParsed(false),
+      HasSkippedBody(false),
       IsConstexpr(isConstexprSpecified), EndRangeLoc(NameInfo.getEndLoc()),
       TemplateOrSpecialization(),
       DNLoc(NameInfo.getInfo()) {}
@@ -1605,6 +1607,8 @@ public:
   /// containing the body (if there is one).
   /// NOTE: For checking if there is a body, use hasBody() instead, to avoid
   /// unnecessary AST de-serialization of the body.
+  /// NOTE: A body the parser skipped is null unless the parser can parse it
+  /// at this point; see hasSkippedBody().
   Stmt *getBody(const FunctionDecl *&Definition) const;
 
   virtual Stmt *getBody() const {
@@ -1619,14 +1623,14 @@ public:
   /// that this returns false for a defaulted function unless that function
   /// has been implicitly defined (possibly as deleted).
   bool isThisDeclarationADefinition() const {
-    return IsDeleted || Body || IsLateTemplateParsed;
+    return IsDeleted || Body || IsLateTemplateParsed || HasSkippedBody;
   }
 
   /// doesThisDeclarationHaveABody - Returns whether this specific
   /// declaration of the function has a body - that is, if it is a non-
   /// deleted definition.
   bool doesThisDeclarationHaveABody() const {
-    return Body || IsLateTemplateParsed;
+    return Body || IsLateTemplateParsed || HasSkippedBody;
   }
 
   void setBody(Stmt *B);
@@ -1648,6 +1652,13 @@ public:
   bool isLateTemplateParsed() const { return IsLateTemplateParsed; }
   void setLateTemplateParsed(bool ILT = true) { IsLateTemplateParsed = ILT; }
 
+  /// Whether the parser skipped the body of this definition.  getBody()
+  /// asks the parser for such a body while the parser is still around; until
+  /// then, and if it can't be parsed, there is no body.  Once the parser is
+  /// gone, a body it never parsed is dropped, and this is a declaration.
+  bool hasSkippedBody() const { return HasSkippedBody; }
+  void setHasSkippedBody(bool Skipped = true) { HasSkippedBody = Skipped; }
+
   /// Whether this function is "trivial" in some specialized C++ senses.
   /// Can only be true for default constructors, copy constructors,
   /// copy assignment operators, and destructors.  Not meaningful until
@@ -21,6 +21,7 @@
 #include "llvm/ADT/PointerUnion.h"
 #include "llvm/ADT/SmallVector.h"
 #include <algorithm>
+#include <vector>
 
 namespace clang {
 
@@ -195,13 +196,59 @@ public:
   }
 };
 
-class StoredDeclsMap
-  : public llvm::DenseMap<DeclarationName, StoredDeclsList> {
-
+/// StoredDeclsMap - The lookup table of a DeclContext, mapping each name
+/// declared in the context to the declarations with that name.
+///
+/// The entries are kept in one array, in the order the names were added.
+/// A table with few entries is searched linearly; a bigger one also gets an
+/// open-addressing index of the entries, which is rebuilt as it fills up.
+/// Rebuilding the index also reserves room for every entry the new index
+/// can hold, so once a table is indexed its entries only move when the
+/// index is rebuilt.
+class StoredDeclsMap {
 public:
+  typedef std::pair<DeclarationName, StoredDeclsList> value_type;
+  typedef std::vector<value_type>::iterator iterator;
+
+  /// \brief The most entries a table holds before it gets an index.
+  static const unsigned MaxLinearEntries = 8;
+
+  StoredDeclsMap() : NumLookups(0), NumProbes(0), MaxProbes(0) {}
+
+  iterator begin() { return Entries.begin(); }
+  iterator end() { return Entries.end(); }
+  bool empty() const { return Entries.empty(); }
+  unsigned size() const { return Entries.size(); }
+
+  /// \brief Return the entry for \p Name, or end() if there is none.
+  iterator find(DeclarationName Name);
+
+  /// \brief Return the declarations named \p Name, adding an empty entry
+  /// for it if there is none.
+  StoredDeclsList &operator[](DeclarationName Name);
+
   static void DestroyAll(StoredDeclsMap *Map, bool Dependent);
 
+  /// \brief Print statistics about the tables in the chain ending with
+  /// \p Map.
+  static void PrintStats(StoredDeclsMap *Map);
+
 private:
+  /// \brief Return the slot of the index holding \p Name, or the empty slot
+  /// where it would go.
+  unsigned findSlot(DeclarationName Name);
+
+  void rebuildIndex();
+
+  std::vector<value_type> Entries;
+
+  /// \brief For each slot, one plus the position of the entry hashed to it,
+  /// or zero if the slot is empty.  Either empty or a power of two in size.
+  std::vector<unsigned> Index;
+
+  /// \brief Statistics about the searches of this table.
+  unsigned NumLookups, NumProbes, MaxProbes;
+
   friend class ASTContext; // walks the chain deleting these
   friend class DeclContext;
   llvm::PointerIntPair<StoredDeclsMap*, 1> Previous;
@@ -16,7 +16,9 @@
 #define LLVM_CLANG_BASIC_BUILTINS_H
 
 #include "clang/Basic/LLVM.h"
+#include "clang/Basic/PerfectHashIndex.h"
 #include <cstring>
+#include <vector>
 
 // VC++ defines 'alloca' as an object-like macro, which interferes with our
 // builtins.
@@ -61,6 +63,12 @@ struct Info {
 class Context {
   const Info *TSRecords;
   unsigned NumTSRecords;
+
+  /// \brief The names of the builtins enabled by InitializeBuiltins, and the
+  /// ID of each, for marking identifiers as they are created.
+  PerfectHashIndex NameIndex;
+  std::vector<unsigned> IndexedIDs;
+
 public:
   Context();
 
@@ -72,6 +80,18 @@ public:
   /// such.
   void InitializeBuiltins(IdentifierTable &Table, const LangOptions& LangOpts);
 
+  /// \brief Return the ID of the builtin enabled by InitializeBuiltins which
+  /// is spelled \p Name, or 0 if there is none.
+  unsigned getBuiltinIDForName(StringRef Name) const {
+    int Index = NameIndex.lookup(Name);
+    return Index < 0 ? 0 : IndexedIDs[Index];
+  }
+
+  /// \brief Return the names of the builtins enabled by InitializeBuiltins.
+  ArrayRef<StringRef> getEnabledBuiltinNames() const {
+    return NameIndex.getKeys();
+  }
+
   /// \brief Popular the vector with the names of all of the builtins.
   void GetBuiltinNames(SmallVectorImpl<const char *> &Names,
                        bool NoBuiltins);
@@ -17,6 +17,7 @@
 #include "clang/Basic/DiagnosticIDs.h"
 #include "clang/Basic/SourceLocation.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/OwningPtr.h"
@@ -242,12 +243,48 @@ private:
            "Previous point loc comes after or is the same as new one");
     DiagStatePoints.push_back(DiagStatePoint(State,
                                              FullSourceLoc(Loc, *SourceMgr)));
+    CachedStateFID = FileID();
   }
 
   /// \brief Finds the DiagStatePoint that contains the diagnostic state of
   /// the given source location.
   DiagStatePointsTy::iterator GetDiagStatePointForLoc(SourceLocation Loc) const;
 
+  /// \brief The offsets [CachedStateBegin, CachedStateEnd) of the file
+  /// CachedStateFID all have the diagnostic state of the DiagStatePoint at
+  /// index CachedStatePoint, so GetDiagStatePointForLoc can answer queries
+  /// for them without comparing source locations.
+  mutable FileID CachedStateFID;
+  mutable unsigned CachedStateBegin, CachedStateEnd, CachedStatePoint;
+
+  /// \brief The builtin diagnostics which are known to be ignored at every
+  /// source location, so that getDiagnosticLevel can answer for them without
+  /// looking up the diagnostic state of the location.  Filled in as levels
+  /// are computed, and cleared whenever a mapping or a setting that could
+  /// upgrade an ignored diagnostic changes.
+  mutable llvm::BitVector GloballyIgnored;
+
+  /// \brief The builtin diagnostics whose mapping may differ between
+  /// diagnostic states, because a pragma changed it or it was changed after
+  /// a pragma.  These are never marked as globally ignored.
+  llvm::BitVector MappedByPragma;
+
+  /// \brief Statistics about getDiagnosticLevel.
+  mutable unsigned NumLevelQueries, NumGloballyIgnoredQueries;
+  mutable unsigned NumStatePointCacheHits;
+
+  bool isGloballyIgnored(unsigned DiagID) const {
+    return DiagID < GloballyIgnored.size() && GloballyIgnored[DiagID];
+  }
+
+  /// \brief Record that the given diagnostic was found to be ignored
+  /// regardless of its location, unless a pragma could change that.
+  void setGloballyIgnored(unsigned DiagID) const;
+
+  /// \brief Forget what is known about the given diagnostic, whose mapping
+  /// is changing.
+  void mappingChanged(diag::kind Diag, bool IsPragma);
+
   /// ErrorOccurred / FatalErrorOccurred - This is set to true when an error or
   /// fatal error is emitted, and is sticky.
   bool ErrorOccurred;
@@ -372,13 +409,19 @@ public:
   
   /// setIgnoreAllWarnings - When set to true, any unmapped warnings are
   /// ignored.  If this and WarningsAsErrors are both set, then this one wins.
-  void setIgnoreAllWarnings(bool Val) { IgnoreAllWarnings = Val; }
+  void setIgnoreAllWarnings(bool Val) {
+    IgnoreAllWarnings = Val;
+    GloballyIgnored.reset();
+  }
   bool getIgnoreAllWarnings() const { return IgnoreAllWarnings; }
 
   /// setEnableAllWarnings - When set to true, any unmapped ignored warnings
   /// are no longer ignored.  If this and IgnoreAllWarnings are both set,
   /// then that one wins.
-  void setEnableAllWarnings(bool Val) { EnableAllWarnings = Val; }
+  void setEnableAllWarnings(bool Val) {
+    EnableAllWarnings = Val;
+    GloballyIgnored.reset();
+  }
   bool getEnableAllWarnngs() const { return EnableAllWarnings; }
   
   /// setWarningsAsErrors - When set to true, any warnings reported are issued
@@ -422,6 +465,7 @@ public:
   /// corresponds to the GCC -pedantic and -pedantic-errors option.
   void setExtensionHandlingBehavior(ExtensionHandling H) {
     ExtBehavior = H;
+    GloballyIgnored.reset();
   }
   ExtensionHandling getExtensionHandlingBehavior() const { return ExtBehavior; }
 
@@ -504,6 +548,10 @@ public:
   /// \brief Reset the state of the diagnostic object to its initial 
   /// configuration.
   void Reset();
+
+  /// \brief Print how many diagnostic level queries were answered without
+  /// looking up the diagnostic state of their location.
+  void PrintStats() const;
   
   //===--------------------------------------------------------------------===//
   // DiagnosticsEngine classification and reporting interfaces.
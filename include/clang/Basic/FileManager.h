@@ -22,6 +22,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/Mutex.h"
 // FIXME: Enhance libsystem to support inode and other fields in stat.
 #include <sys/types.h>
 
@@ -39,6 +40,7 @@ namespace sys { class Path; }
 namespace clang {
 class FileManager;
 class FileSystemStatCache;
+class MappedFileBuffer;
   
 /// DirectoryEntry - Cached information about one directory (either on
 /// the disk or in the virtual file system).
@@ -110,6 +112,9 @@ public:
 /// properties, such as uniquing files based on "inode", so that a file with two
 /// names (e.g. symlinked) will be treated as a single file.
 ///
+/// Once LLVM is in multithreaded mode, a FileManager can be shared by
+/// compiler instances running on different threads.
+///
 class FileManager : public llvm::RefCountedBase<FileManager> {
   FileSystemOptions FileSystemOpts;
 
@@ -149,6 +154,12 @@ class FileManager : public llvm::RefCountedBase<FileManager> {
   // Caching.
   llvm::OwningPtr<FileSystemStatCache> StatCache;
 
+  /// Lock - Serializes access to the maps, the stat caches and the file
+  /// descriptors of the file entries.  It is only taken when LLVM is running
+  /// multithreaded, and is recursive since lookups of files look up their
+  /// directories.
+  mutable llvm::sys::SmartMutex<true> Lock;
+
   bool getStatValue(const char *Path, struct stat &StatBuf,
                     int *FileDescriptor);
 
@@ -210,6 +221,10 @@ public:
   llvm::MemoryBuffer *getBufferForFile(StringRef Filename,
                                        std::string *ErrorStr = 0);
 
+  /// \brief Open the specified file as a read-only memory mapping, returning
+  /// null if it can't be mapped.
+  MappedFileBuffer *getMappedBufferForFile(const FileEntry *Entry);
+
   // getNoncachedStatValue - Will get the 'stat' information for the given path.
   // If the path is relative, it will be resolved against the WorkingDir of the
   // FileManager's FileSystemOptions.
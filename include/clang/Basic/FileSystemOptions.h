@@ -24,6 +24,16 @@ public:
   /// \brief If set, paths are resolved as if the working directory was
   /// set to the value of WorkingDir.
   std::string WorkingDir;
+
+  /// \brief If set, the file holding the persistent stat cache shared with
+  /// other compiler invocations.
+  std::string StatCacheFile;
+
+  /// \brief Whether source files should be read through read-only memory
+  /// mappings, whose pages are released once the file has been lexed.
+  unsigned MapSourceFiles : 1;
+
+  FileSystemOptions() : MapSourceFiles(false) {}
 };
 
 } // end namespace clang
@@ -62,6 +62,9 @@ public:
   /// ownership of this cache (and, transitively, all of the remaining caches)
   /// to the caller.
   FileSystemStatCache *takeNextStatCache() { return NextStatCache.take(); }
+
+  /// \brief Print statistics about this cache to stderr.
+  virtual void PrintStats() const {}
   
 protected:
   virtual LookupResult getStat(const char *Path, struct stat &StatBuf,
@@ -18,6 +18,7 @@
 #include "clang/Basic/OperatorKinds.h"
 #include "clang/Basic/TokenKinds.h"
 #include "clang/Basic/LLVM.h"
+#include "clang/Basic/PerfectHashIndex.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/SmallString.h"
@@ -39,6 +40,8 @@ namespace clang {
   class MultiKeywordSelector; // private class used by Selector
   class DeclarationName;      // AST class that stores declaration names
 
+  namespace Builtin { class Context; }
+
   /// IdentifierLocPair - A simple pair of identifier info and location.
   typedef std::pair<IdentifierInfo*, SourceLocation> IdentifierLocPair;
 
@@ -363,6 +366,20 @@ public:
 /// extremely performance-critical piece of the code, as each occurrence of
 /// every identifier goes through here when lexed.
 class IdentifierTable {
+public:
+  /// KeywordRecord - What the keyword tables say about one spelling, applied
+  /// to its IdentifierInfo when the identifier is first created.
+  struct KeywordRecord {
+    StringRef Name;
+    unsigned TokenID              : 9;
+    unsigned ObjCKeywordID        : 6;
+    bool SetsTokenID              : 1;
+    bool IsExtension              : 1;
+    bool IsCXX11CompatKeyword     : 1;
+    bool IsCPPOperatorKeyword     : 1;
+  };
+
+private:
   // Shark shows that using MallocAllocator is *much* slower than using this
   // BumpPtrAllocator!
   typedef llvm::StringMap<IdentifierInfo*, llvm::BumpPtrAllocator> HashTableTy;
@@ -370,6 +387,39 @@ class IdentifierTable {
 
   IdentifierInfoLookup* ExternalLookup;
 
+  /// Keywords - The keywords of the current language, indexed by KeywordIndex.
+  /// A spelling which appears more than once is described by the record at
+  /// its first position.
+  std::vector<KeywordRecord> Keywords;
+  PerfectHashIndex KeywordIndex;
+
+  /// Builtins - The builtins to mark new identifiers with, if any.
+  const Builtin::Context *Builtins;
+
+  /// CompleteVocabulary - Whether every keyword and builtin already has an
+  /// IdentifierInfo in HashTable.
+  bool CompleteVocabulary;
+
+  static void ApplyKeyword(const KeywordRecord &Record, IdentifierInfo &II);
+
+  /// InitializeIdentifier - Give a new identifier the keyword and builtin
+  /// information for its spelling.
+  void InitializeIdentifier(IdentifierInfo &II);
+
+  IdentifierInfo &
+  CreateIdentifierInfo(llvm::StringMapEntry<IdentifierInfo*> &Entry) {
+    void *Mem = getAllocator().Allocate<IdentifierInfo>();
+    IdentifierInfo *II = new (Mem) IdentifierInfo();
+    Entry.setValue(II);
+
+    // Make sure getName() knows how to find the IdentifierInfo
+    // contents.
+    II->Entry = &Entry;
+
+    InitializeIdentifier(*II);
+    return *II;
+  }
+
 public:
   /// IdentifierTable ctor - Create the identifier table, populating it with
   /// info about the language keywords for the language specified by LangOpts.
@@ -377,9 +427,7 @@ public:
                   IdentifierInfoLookup* externalLookup = 0);
 
   /// \brief Set the external identifier lookup mechanism.
-  void setExternalIdentifierLookup(IdentifierInfoLookup *IILookup) {
-    ExternalLookup = IILookup;
-  }
+  void setExternalIdentifierLookup(IdentifierInfoLookup *IILookup);
 
   /// \brief Retrieve the external identifier lookup object, if any.
   IdentifierInfoLookup *getExternalIdentifierLookup() const {
@@ -410,15 +458,7 @@ public:
     }
 
     // Lookups failed, make a new IdentifierInfo.
-    void *Mem = getAllocator().Allocate<IdentifierInfo>();
-    II = new (Mem) IdentifierInfo();
-    Entry.setValue(II);
-
-    // Make sure getName() knows how to find the IdentifierInfo
-    // contents.
-    II->Entry = &Entry;
-
-    return *II;
+    return CreateIdentifierInfo(Entry);
   }
 
   IdentifierInfo &get(StringRef Name, tok::TokenKind TokenCode) {
@@ -442,13 +482,7 @@ public:
     if (!II) {
 
       // Lookups failed, make a new IdentifierInfo.
-      void *Mem = getAllocator().Allocate<IdentifierInfo>();
-      II = new (Mem) IdentifierInfo();
-      Entry.setValue(II);
-
-      // Make sure getName() knows how to find the IdentifierInfo
-      // contents.
-      II->Entry = &Entry;
+      II = &CreateIdentifierInfo(Entry);
     }
 
     return *II;
@@ -457,6 +491,9 @@ public:
   typedef HashTableTy::const_iterator iterator;
   typedef HashTableTy::const_iterator const_iterator;
 
+  /// Note that keywords and builtins only get an entry once they are first
+  /// looked up; call AddVocabulary() before walking the table if they have
+  /// to be seen too.
   iterator begin() const { return HashTable.begin(); }
   iterator end() const   { return HashTable.end(); }
   unsigned size() const { return HashTable.size(); }
@@ -466,6 +503,14 @@ public:
   void PrintStats() const;
 
   void AddKeywords(const LangOptions &LangOpts);
+
+  /// setBuiltinInfo - Mark identifiers spelled like one of the builtins of
+  /// \p Builtins with its builtin ID, now and whenever they are created.
+  void setBuiltinInfo(const Builtin::Context *Builtins);
+
+  /// AddVocabulary - Create the identifiers of all keywords and builtins
+  /// which haven't been looked up yet.
+  void AddVocabulary();
 };
 
 /// ObjCMethodFamily - A family of Objective-C methods.  These
@@ -0,0 +1,71 @@
+//===--- MappedFileBuffer.h - Memory mapped source files --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines the MappedFileBuffer interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_MAPPEDFILEBUFFER_H
+#define LLVM_CLANG_MAPPEDFILEBUFFER_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <string>
+
+namespace clang {
+
+/// \brief A MemoryBuffer holding a read-only mapping of a whole file,
+/// whatever its size.
+///
+/// Unlike the buffers MemoryBuffer::getFile creates, small files are mapped
+/// too, so no source file is ever copied onto the heap.  Since the mapping is
+/// backed by the file, its pages can be dropped once the file has been lexed
+/// and will simply be read back in if anything looks at them again.
+class MappedFileBuffer : public llvm::MemoryBuffer {
+  std::string Name;
+  void *MapStart;
+  size_t MapSize;
+
+  MappedFileBuffer(StringRef Name, void *MapStart, size_t MapSize,
+                   size_t FileSize);
+
+public:
+  ~MappedFileBuffer();
+
+  /// \brief Map the \p FileSize bytes of the file open as \p FD.
+  ///
+  /// \returns the new buffer, or null if the file can't be mapped so that
+  /// it is followed by a nul byte (for example because its size is a multiple
+  /// of the page size) or mapping is not supported on this host.
+  static MappedFileBuffer *get(int FD, StringRef Name, uint64_t FileSize);
+
+  virtual const char *getBufferIdentifier() const { return Name.c_str(); }
+
+  virtual BufferKind getBufferKind() const { return MemoryBuffer_MMap; }
+
+  /// \brief Hint that the buffer is about to be read from start to end.
+  void adviseSequential() const;
+
+  /// \brief Drop the pages of the buffer from memory.  The contents stay
+  /// valid, and are read from the file again if they are used.
+  void releasePages() const;
+
+  /// \brief Return the number of bytes of the mapping that are currently in
+  /// memory.
+  size_t getResidentBytes() const;
+
+  /// \brief Return the number of bytes mapped, including the padding up to
+  /// the end of the last page.
+  size_t getMappedBytes() const { return MapSize; }
+};
+
+} // end namespace clang
+
+#endif
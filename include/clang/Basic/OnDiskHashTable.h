@@ -63,6 +63,17 @@ inline void Emit64(raw_ostream& Out, uint64_t V) {
   Out << (unsigned char)(V >> 56);
 }
 
+/// EmitVBR32 - Emit V in as few bytes as possible, seven bits at a time
+/// starting with the lowest ones.  The high bit of each byte is set if
+/// another byte follows.
+inline void EmitVBR32(raw_ostream& Out, uint32_t V) {
+  while (V >= 0x80) {
+    Out << (unsigned char)(V | 0x80);
+    V >>= 7;
+  }
+  Out << (unsigned char)(V);
+}
+
 inline void Pad(raw_ostream& Out, unsigned A) {
   Offset off = (Offset) Out.tell();
   uint32_t n = ((uintptr_t)(off+A-1) & ~(uintptr_t)(A-1)) - off;
@@ -99,6 +110,22 @@ inline uint64_t ReadUnalignedLE64(const unsigned char *&Data) {
   return V;
 }
 
+inline uint32_t ReadVBR32(const unsigned char *&Data) {
+  uint32_t V = *Data++;
+  if (V < 0x80)
+    return V;
+
+  V &= 0x7F;
+  unsigned Shift = 7;
+  unsigned char Byte;
+  do {
+    Byte = *Data++;
+    V |= (uint32_t)(Byte & 0x7F) << Shift;
+    Shift += 7;
+  } while (Byte & 0x80);
+  return V;
+}
+
 inline uint32_t ReadLE32(const unsigned char *&Data) {
   // Hosts that directly support little-endian 32-bit loads can just
   // use them.  Big-endian hosts need a bswap.
@@ -0,0 +1,69 @@
+//===--- PerfectHashIndex.h - Perfect hash of fixed strings -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines the PerfectHashIndex interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_BASIC_PERFECTHASHINDEX_H
+#define LLVM_CLANG_BASIC_PERFECTHASHINDEX_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include <vector>
+
+namespace clang {
+
+/// \brief Maps each string of a fixed set to its position in the set, looking
+/// at a single slot per lookup.
+///
+/// The index is built with the "hash and displace" scheme: strings are
+/// grouped into buckets by one hash, and each bucket gets a displacement
+/// which moves all of its strings into free slots of the table.  A lookup
+/// hashes the string once and compares it against the one string in its
+/// slot.  Unlike a StringMap, the index allocates nothing per string and
+/// doesn't copy the strings, which must outlive it.
+class PerfectHashIndex {
+  /// \brief The strings, in the order the index was built with.
+  std::vector<StringRef> Keys;
+
+  /// \brief The displacement of each bucket.
+  std::vector<unsigned> Displacements;
+
+  /// \brief For each slot, one plus the position of the string in it, or
+  /// zero if the slot is empty.  The size is a power of two.
+  std::vector<unsigned> Slots;
+
+  /// \brief The seed of the hash function which made every bucket fit.
+  unsigned Seed;
+
+  bool tryBuild(unsigned Seed);
+
+public:
+  PerfectHashIndex() : Seed(0) {}
+
+  /// \brief Index \p Strings, replacing anything indexed before.  A string
+  /// given more than once is found at its first position.
+  void build(ArrayRef<StringRef> Strings);
+
+  /// \brief Return the position of \p Str in the strings the index was
+  /// built from, or -1 if it isn't one of them.
+  int lookup(StringRef Str) const;
+
+  /// \brief Return the strings the index was built from, in order.
+  ArrayRef<StringRef> getKeys() const { return Keys; }
+
+  bool empty() const { return Keys.empty(); }
+  unsigned size() const { return Keys.size(); }
+};
+
+}  // end namespace clang
+
+#endif
@@ -0,0 +1,101 @@
+//===--- PersistentRecordLog.h - Shared append-only record file -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines the PersistentRecordLog interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_PERSISTENTRECORDLOG_H
+#define LLVM_CLANG_PERSISTENTRECORDLOG_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Support/DataTypes.h"
+#include <string>
+
+namespace llvm {
+class MemoryBuffer;
+}
+
+namespace clang {
+
+/// \brief An append-only file of records, shared by every compiler process
+/// that uses it.
+///
+/// The file starts with an 8 byte magic number identifying its client and a
+/// 32-bit version.  It is then a sequence of records, each made up of a
+/// 32-bit length, a 32-bit checksum of the record's data, and the data padded
+/// to a multiple of 8 bytes.  Everything is in host byte order; a file written
+/// on a host with a different byte order fails the version check.
+///
+/// The records present when the log is opened are read once.  New records are
+/// appended with a single write, so records written by concurrent processes
+/// never interleave.  A torn record left by a crash, and anything after it,
+/// is ignored when the file is read.  Clients keep the file from growing
+/// forever by rewriting it without the records they no longer need.
+class PersistentRecordLog {
+  /// \brief The path of the file.
+  std::string FileName;
+
+  /// \brief The magic number and version the file was opened with.
+  char Magic[8];
+  uint32_t Version;
+
+  /// \brief The descriptor new records are appended to, or -1.
+  int AppendFD;
+
+  /// \brief The contents of the file when it was opened.
+  llvm::OwningPtr<llvm::MemoryBuffer> Contents;
+
+  PersistentRecordLog(StringRef FileName, const char *Magic,
+                      uint32_t Version, int AppendFD);
+
+  PersistentRecordLog(const PersistentRecordLog&); // DO NOT IMPLEMENT
+  void operator=(const PersistentRecordLog&); // DO NOT IMPLEMENT
+
+public:
+  ~PersistentRecordLog();
+
+  /// \brief Open the log stored in \p FileName, creating the file if it does
+  /// not exist yet.
+  ///
+  /// \param Kind What the file holds, for error messages ("stat cache").
+  /// \param Magic The 8 byte magic number the file must start with.
+  /// \param Version The version of the record format the file must have.
+  ///
+  /// \returns the log, or null (with \p ErrorStr set) if the file could not
+  /// be created or read, or was written with a different magic number or
+  /// version.
+  static PersistentRecordLog *Open(StringRef FileName, StringRef Kind,
+                                   const char *Magic, uint32_t Version,
+                                   std::string &ErrorStr);
+
+  StringRef getFileName() const { return FileName; }
+
+  /// \brief Retrieve the data of each valid record the file held when it was
+  /// opened, oldest first.  The data stays valid as long as the log.
+  void getRecords(SmallVectorImpl<StringRef> &Records) const;
+
+  /// \brief Append a record to the file.  Returns false if the write failed,
+  /// in which case no more records are appended.
+  bool append(StringRef Data);
+
+  /// \brief Replace the file with one holding just \p Records, which may
+  /// point into the records returned by getRecords().
+  ///
+  /// The new file is renamed into place, so other processes see either the
+  /// old or the new contents.  Records they append to the old file in the
+  /// meantime are lost, which is fine for a cache.  Returns false if the file
+  /// could not be rewritten, in which case it is left alone.
+  bool rewrite(ArrayRef<StringRef> Records);
+};
+
+} // end namespace clang
+
+#endif
@@ -0,0 +1,102 @@
+//===--- PersistentStatCache.h - On-disk cache for 'stat' calls -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines the PersistentStatCache interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_PERSISTENTSTATCACHE_H
+#define LLVM_CLANG_PERSISTENTSTATCACHE_H
+
+#include "clang/Basic/FileSystemStatCache.h"
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/DataTypes.h"
+#include <string>
+
+namespace clang {
+
+class PersistentRecordLog;
+
+/// \brief A FileSystemStatCache whose contents are kept in a file and shared
+/// by every compiler invocation that uses the same file.
+///
+/// Only results which cannot be answered by opening the file anyway are
+/// cached: lookups of paths which do not exist, and directories.  Each entry
+/// records the modification time of the directory containing the path, and is
+/// only trusted while that directory's modification time is unchanged, so
+/// creating or removing a file invalidates the entries for its directory.
+///
+/// The file is a PersistentRecordLog, read once when the cache is created.
+/// Results computed afterwards are appended to it, so any number of compiler
+/// processes can add to the same file concurrently.  When the file is read,
+/// it is rewritten without the records later ones replaced if those make up
+/// most of it, and emptied if it holds too many paths.
+class PersistentStatCache : public FileSystemStatCache {
+public:
+  /// \brief The on-disk form of a cached result.
+  struct Entry {
+    enum EntryKind {
+      MissingFile = 1,   //< The path could not be opened as a file.
+      MissingDir = 2,    //< The path is not an existing directory.
+      Directory = 3      //< The path is a directory with the stat info below.
+    };
+
+    uint32_t Kind;
+    uint32_t Mode;
+    uint64_t ParentMTime;
+    uint64_t Dev;
+    uint64_t Ino;
+    uint64_t MTime;
+    uint64_t Size;
+  };
+
+private:
+  /// \brief The file holding the cache.
+  llvm::OwningPtr<PersistentRecordLog> Log;
+
+  /// \brief The cached results, keyed by the lookup kind ('f' or 'd')
+  /// followed by the path.
+  llvm::StringMap<Entry> Entries;
+
+  /// \brief The modification times of the directories seen so far in this
+  /// process; the flag is false if the directory could not be stat'ed.
+  llvm::StringMap<std::pair<bool, uint64_t> > DirMTimes;
+
+  unsigned NumHits, NumMisses, NumStale, NumRecordsLoaded, NumRecordsAdded;
+  unsigned NumRecordsDropped;
+
+  explicit PersistentStatCache(PersistentRecordLog *Log);
+
+  bool getDirMTime(StringRef Dir, uint64_t &MTime);
+  void addEntry(StringRef Key, const Entry &E);
+  void readRecords();
+
+public:
+  ~PersistentStatCache();
+
+  /// \brief Open the stat cache stored in \p FileName, creating the file if
+  /// it does not exist yet.
+  ///
+  /// \returns the new cache, or null (with \p ErrorStr set) if the file could
+  /// not be created or is not a stat cache file.
+  static PersistentStatCache *Create(StringRef FileName, std::string &ErrorStr);
+
+  StringRef getFileName() const;
+
+  virtual LookupResult getStat(const char *Path, struct stat &StatBuf,
+                               int *FileDescriptor);
+
+  virtual void PrintStats() const;
+};
+
+} // end namespace clang
+
+#endif
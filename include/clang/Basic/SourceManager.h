@@ -95,14 +95,17 @@ namespace SrcMgr {
     /// with the contents of another file.
     const FileEntry *ContentsEntry;
 
-    /// SourceLineCache - A bump pointer allocated array of offsets for each
-    /// source line.  This is lazily computed.  This is owned by the
-    /// SourceManager BumpPointerAllocator object.
-    unsigned *SourceLineCache;
+    /// SourceLineCache - The offsets of the starts of the source lines.  This
+    /// is lazily computed, and only as far into the buffer as line number
+    /// queries have needed so far.
+    std::vector<unsigned> SourceLineCache;
 
-    /// NumLines - The number of lines in this ContentCache.  This is only valid
-    /// if SourceLineCache is non-null.
-    unsigned NumLines;
+    /// LineCacheComplete - Whether SourceLineCache holds every line of the
+    /// buffer, so that its size is the number of lines.
+    bool LineCacheComplete;
+
+    /// BufferIsMapped - Whether Buffer is a MappedFileBuffer.
+    mutable bool BufferIsMapped;
 
     /// getBuffer - Returns the memory buffer for the associated content.
     ///
@@ -159,13 +162,20 @@ namespace SrcMgr {
       return (Buffer.getInt() & DoNotFreeFlag) == 0;
     }
 
+    /// \brief Determine whether SourceLineCache already covers the line
+    /// containing \p FilePos.
+    bool hasLineNumbersFor(unsigned FilePos) const {
+      return LineCacheComplete ||
+             (!SourceLineCache.empty() && SourceLineCache.back() > FilePos);
+    }
+
     ContentCache(const FileEntry *Ent = 0)
       : Buffer(0, false), OrigEntry(Ent), ContentsEntry(Ent),
-        SourceLineCache(0), NumLines(0) {}
+        LineCacheComplete(false), BufferIsMapped(false) {}
 
     ContentCache(const FileEntry *Ent, const FileEntry *contentEnt)
       : Buffer(0, false), OrigEntry(Ent), ContentsEntry(contentEnt),
-        SourceLineCache(0), NumLines(0) {}
+        LineCacheComplete(false), BufferIsMapped(false) {}
 
     ~ContentCache();
 
@@ -173,15 +183,13 @@ namespace SrcMgr {
     ///  a non-NULL Buffer or SourceLineCache.  Ownership of allocated memory
     ///  is not transferred, so this is a logical error.
     ContentCache(const ContentCache &RHS)
-      : Buffer(0, false), SourceLineCache(0)
+      : Buffer(0, false), LineCacheComplete(false), BufferIsMapped(false)
     {
       OrigEntry = RHS.OrigEntry;
       ContentsEntry = RHS.ContentsEntry;
 
-      assert (RHS.Buffer.getPointer() == 0 && RHS.SourceLineCache == 0 &&
+      assert (RHS.Buffer.getPointer() == 0 && RHS.SourceLineCache.empty() &&
               "Passed ContentCache object cannot own a buffer.");
-
-      NumLines = RHS.NumLines;
     }
 
   private:
@@ -539,6 +547,17 @@ class SourceManager : public llvm::RefCountedBase<SourceManager> {
   /// is very common to look up many tokens from the same file.
   mutable FileID LastFileIDLookup;
 
+  /// \brief For each page of the local source location address space, the
+  /// index of the local SLocEntry containing the first offset of the page.
+  ///
+  /// Local entries are only ever appended, so the index is extended lazily by
+  /// getFileIDLocal to cover the address space allocated so far, and lets it
+  /// find any local FileID by searching the few entries within one page.
+  mutable std::vector<unsigned> LocalPageIndex;
+
+  /// \brief log2 of the size of the pages in LocalPageIndex.
+  static const unsigned LocalPageBits = 12;
+
   /// LineTable - This holds information for #line directives.  It is referenced
   /// by indices from SLocEntryTable.
   LineTableInfo *LineTable;
@@ -556,8 +575,10 @@ class SourceManager : public llvm::RefCountedBase<SourceManager> {
   /// \brief The file ID for the precompiled preamble there is one.
   FileID PreambleFileID;
 
-  // Statistics for -print-stats.
+  // Statistics for -print-stats.  Local lookups go through the page index;
+  // the scans and probes are those of lookups of loaded FileIDs.
   mutable unsigned NumLinearScans, NumBinaryProbes;
+  mutable unsigned NumPageIndexLookups, NumPageIndexProbes;
 
   // Cache results for the isBeforeInTranslationUnit method.
   mutable IsBeforeInTranslationUnitCache IsBeforeInTUCache;
@@ -731,6 +752,13 @@ public:
                                                         Invalid);
   }
 
+  /// \brief Note that the file \p FID has been lexed to its end.
+  ///
+  /// If its buffer is a memory mapping, its pages are dropped from memory;
+  /// the buffer stays valid, and is read back from the file if it is used
+  /// again.
+  void releaseBufferPages(FileID FID) const;
+
   /// getFileEntryForID - Returns the FileEntry record for the provided FileID.
   const FileEntry *getFileEntryForID(FileID FID) const {
     bool MyInvalid = false;
@@ -1305,6 +1333,7 @@ private:
 
   FileID getFileIDSlow(unsigned SLocOffset) const;
   FileID getFileIDLocal(unsigned SLocOffset) const;
+  void extendLocalPageIndex() const;
   FileID getFileIDLoaded(unsigned SLocOffset) const;
 
   SourceLocation getExpansionLocSlowCase(SourceLocation Loc) const;
@@ -122,6 +122,13 @@ public:
   void PrintJob(raw_ostream &OS, const Job &J,
                 const char *Terminator, bool Quote) const;
 
+  /// EchoCommand - Print a command before it is executed, if -v, -ccc-echo or
+  /// CC_PRINT_OPTIONS asked for it.
+  ///
+  /// \param OS - The stream to use for output which goes to stderr.
+  /// \return False if the CC_PRINT_OPTIONS log file could not be opened.
+  bool EchoCommand(const Command &C, raw_ostream &OS) const;
+
   /// ExecuteCommand - Execute an actual command.
   ///
   /// \param FailingCommand - For non-zero results, this will be set to the
@@ -136,6 +143,20 @@ public:
   /// \return The accumulated result code of the job.
   int ExecuteJob(const Job &J, const Command *&FailingCommand) const;
 
+  /// ExecuteJobInParallel - Execute the commands of a job, running up to
+  /// \arg MaxJobs of them at once. A command is only started once every
+  /// command producing one of its inputs has finished.
+  ///
+  /// The output of each command is buffered and replayed in job order, and
+  /// commands after the first failing one have their results discarded, so
+  /// the visible output and result are the same as for ExecuteJob.
+  ///
+  /// \param FailingCommand - For non-zero results, this will be set to the
+  /// first Command (in job order) which failed.
+  /// \return The accumulated result code of the job.
+  int ExecuteJobInParallel(const Job &J, unsigned MaxJobs,
+                           const Command *&FailingCommand) const;
+
   /// initCompilationForDiagnostics - Remove stale state and suppress output
   /// so compilation can be reexecuted to generate additional diagnostic
   /// information (e.g., preprocessed source(s)).
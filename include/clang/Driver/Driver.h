@@ -142,6 +142,9 @@ public:
   /// Whether the driver is generating diagnostics for debugging purposes.
   unsigned CCGenDiagnostics : 1;
 
+  /// The maximum number of commands to run at once (-j).
+  unsigned MaxParallelJobs;
+
 private:
   /// Name to use when invoking gcc/g++.
   std::string CCCGenericGCCName;
@@ -68,6 +68,12 @@ class GlobalCodeCompletionAllocator
 /// \brief Utility class for loading a ASTContext from an AST file.
 ///
 class ASTUnit : public ModuleLoader {
+public:
+  /// \brief The inputs and results of building a precompiled preamble.
+  ///
+  /// Note: This is used internally by the preamble building action.
+  struct PreambleBuild;
+
 private:
   llvm::IntrusiveRefCntPtr<DiagnosticsEngine> Diagnostics;
   llvm::IntrusiveRefCntPtr<FileManager>       FileMgr;
@@ -230,6 +236,39 @@ private:
   /// the preamble must be thrown away.
   llvm::StringMap<std::pair<off_t, time_t> > FilesInPreamble;
 
+  /// \brief The token stream hash of each file entered while computing the
+  /// preamble, keyed by file name.
+  llvm::StringMap<unsigned> PreambleFileTokenHashes;
+
+  /// \brief The token stream hash of each file used by the last parse,
+  /// including the files in the preamble, keyed by file name.
+  ///
+  /// Only the spelling of the tokens and whether each one starts a line or
+  /// follows whitespace go into the hash, so edits that merely change
+  /// comments or the amount of whitespace leave it alone.
+  llvm::StringMap<unsigned> FileTokenHashes;
+
+  /// \brief The token stream hashes of the parse before the last one.
+  llvm::StringMap<unsigned> PreviousFileTokenHashes;
+
+  /// \brief Whether each parse records the token stream hash of the files it
+  /// uses.  Hashing lexes every file a second time, so it is off by default.
+  bool TrackFileTokenHashes;
+
+  /// \brief For each stored diagnostic, whether the parse before the last one
+  /// reported it too.  Only computed by reparses that track file token
+  /// hashes.
+  std::vector<bool> RepeatedDiagnostics;
+
+  /// \brief Whether the precompiled preamble should be rebuilt on a
+  /// background thread rather than by the reparse that needs it.
+  bool AsyncPreamble;
+
+  /// \brief The precompiled preamble being built on a background thread, if
+  /// any.  It is installed by the first call to
+  /// getMainBufferWithPrecompiledPreamble() after it is done.
+  PreambleBuild *PendingPreamble;
+
   /// \brief When non-NULL, this is the buffer used to store the contents of
   /// the main file when it has been padded for use with the precompiled
   /// preamble.
@@ -394,6 +433,9 @@ private:
                                const CompilerInvocation &PreambleInvocationIn,
                                                      bool AllowRebuild = true,
                                                         unsigned MaxLines = 0);
+  bool StartPreambleBuild(PreambleBuild &Build);
+  void FinishPreambleBuild(bool Install);
+  bool InstallPreamble(PreambleBuild &Build);
   void RealizeTopLevelDeclsFromPreamble();
   
   /// \brief Allows us to assert that ASTUnit is not being used concurrently,
@@ -525,6 +567,41 @@ public:
   /// Note: This is used internally by the top-level tracking action
   unsigned &getCurrentTopLevelHashValue() { return CurrentTopLevelHashValue; }
 
+  /// \brief Retrieve the token stream hashes being computed for the current
+  /// parse.
+  ///
+  /// Note: This is used internally by the file tracking callbacks.
+  llvm::StringMap<unsigned> &getCurrentFileTokenHashes() {
+    return FileTokenHashes;
+  }
+
+  /// \brief Whether each parse records the token stream hash of the files it
+  /// uses.
+  bool getTrackFileTokenHashes() const { return TrackFileTokenHashes; }
+
+  /// \brief Retrieve the hash of the token stream of the given file as it was
+  /// lexed by the last parse.
+  ///
+  /// \returns false if the file wasn't used by the last parse, or if file
+  /// token hashes aren't tracked.
+  bool getFileTokenHash(StringRef Filename, unsigned &Hash) const;
+
+  /// \brief Determine whether the token stream of the given file differs
+  /// between the last parse and the one before it.
+  ///
+  /// A file that only had comments or whitespace edited is unchanged; a file
+  /// that wasn't used by both parses counts as changed.
+  bool fileTokensChanged(StringRef Filename) const;
+
+  /// \brief Determine whether the stored diagnostic with the given index was
+  /// also reported by the parse before the last one, at the same line and
+  /// column of a file whose token stream hasn't changed.
+  ///
+  /// Always false unless file token hashes are tracked.
+  bool isRepeatedDiagnostic(unsigned Index) const {
+    return Index < RepeatedDiagnostics.size() && RepeatedDiagnostics[Index];
+  }
+
   /// \brief Get the source location for the given file:line:col triplet.
   ///
   /// The difference with SourceManager::getLocation is that this method checks
@@ -697,7 +774,9 @@ public:
                                       bool PrecompilePreamble = false,
                                       TranslationUnitKind TUKind = TU_Complete,
                                       bool CacheCodeCompletionResults = false,
-                                      bool NestedMacroExpansions = true);
+                                      bool NestedMacroExpansions = true,
+                                      bool AsyncPreamble = false,
+                                      bool TrackFileTokenHashes = false);
   
   /// \brief Reparse the source files using the same command-line options that
   /// were originally used to produce this translation unit.
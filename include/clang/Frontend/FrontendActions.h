@@ -16,6 +16,8 @@
 
 namespace clang {
 
+class DirectoryIndex;
+
 //===----------------------------------------------------------------------===//
 // Custom Consumer Actions
 //===----------------------------------------------------------------------===//
@@ -180,6 +182,32 @@ protected:
 
   virtual bool hasPCHSupport() const { return true; }
 };
+
+/// \brief Preprocess a file only to find the files it depends on, for the
+/// batch dependency scanner.
+///
+/// Dependency files requested by the dependency output options are written
+/// as usual.  The action can also collect the dependencies in memory, and
+/// can make the header search use a directory index shared with other
+/// scans.
+class ScanDependenciesAction : public PreprocessOnlyAction {
+  DirectoryIndex *SharedDirIndex;
+  std::vector<std::string> *Dependencies;
+
+protected:
+  virtual bool BeginSourceFileAction(CompilerInstance &CI,
+                                     StringRef Filename);
+
+public:
+  /// \param SharedDirIndex If non-null, the directory index the header
+  /// search should use instead of its own.
+  ///
+  /// \param Dependencies If non-null, receives the dependencies of the file
+  /// once it has been preprocessed.
+  ScanDependenciesAction(DirectoryIndex *SharedDirIndex,
+                         std::vector<std::string> *Dependencies)
+    : SharedDirIndex(SharedDirIndex), Dependencies(Dependencies) {}
+};
   
 }  // end namespace clang
 
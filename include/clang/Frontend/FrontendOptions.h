@@ -74,6 +74,9 @@ public:
                                            /// unfixable errors.
   unsigned ARCMTMigrateEmitARCErrors : 1;  /// Emit ARC errors even if the
                                            /// migrator can fix them
+  unsigned SkipFunctionBodies : 1;         ///< Skip the bodies of function
+                                           /// definitions, parsing them
+                                           /// only when they are needed.
 
   enum {
     ARCMT_None,
@@ -137,6 +140,7 @@ public:
     ShowVersion = 0;
     ARCMTAction = ARCMT_None;
     ARCMTMigrateEmitARCErrors = 0;
+    SkipFunctionBodies = 0;
   }
 
   /// getInputKindForExtension - Return the appropriate input kind for a file
@@ -104,11 +104,15 @@ public:
   /// Whether header search information should be output as for -v.
   unsigned Verbose : 1;
 
+  /// Read each search directory once and use its contents to skip looking
+  /// for files that aren't there.
+  unsigned CacheSearchDirContents : 1;
+
 public:
   HeaderSearchOptions(StringRef _Sysroot = "/")
     : Sysroot(_Sysroot), DisableModuleHash(0), UseBuiltinIncludes(true),
       UseStandardSystemIncludes(true), UseStandardCXXIncludes(true),
-      UseLibcxx(false), Verbose(false) {}
+      UseLibcxx(false), Verbose(false), CacheSearchDirContents(false) {}
 
   /// AddPath - Add the \arg Path path to the specified \arg Group list.
   void AddPath(StringRef Path, frontend::IncludeDirGroup Group,
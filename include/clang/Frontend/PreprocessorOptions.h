@@ -57,6 +57,14 @@ public:
   /// \brief Whether the detailed preprocessing record includes nested macro 
   /// expansions.
   unsigned DetailedRecordIncludesNestedMacroExpansions : 1;
+
+  /// \brief Whether repeated macro expansions should be replayed from a
+  /// cache instead of being expanded again.
+  unsigned MacroExpansionCache : 1;
+
+  /// \brief Whether the tokens formed by pasting and stringizing should be
+  /// packed into a few large scratch buffers.
+  unsigned PackScratchBuffers : 1;
   
   /// The implicit PCH included at the start of the translation unit, or empty.
   std::string ImplicitPCHInclude;
@@ -168,6 +176,8 @@ public:
   PreprocessorOptions() : UsePredefines(true), DetailedRecord(false),
                           AutoModuleImport(false),
                           DetailedRecordIncludesNestedMacroExpansions(true),
+                          MacroExpansionCache(false),
+                          PackScratchBuffers(false),
                           DisablePCHValidation(false), DisableStatCache(false),
                           DumpDeserializedPCHDecls(false),
                           PrecompiledPreambleBytes(0, true),
@@ -20,6 +20,8 @@
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/Support/raw_ostream.h"
 #include "clang/Basic/Diagnostic.h"
+#include <string>
+#include <vector>
 
 namespace llvm {
 class Triple;
@@ -77,6 +79,13 @@ void DoPrintPreprocessedInput(Preprocessor &PP, raw_ostream* OS,
 void AttachDependencyFileGen(Preprocessor &PP,
                              const DependencyOutputOptions &Opts);
 
+/// AttachDependencyCollector - Attach a callback to the given preprocessor
+/// that stores the files the main file depends on, as selected by Opts, in
+/// Files when the main file is finished.  No dependency file is written.
+void AttachDependencyCollector(Preprocessor &PP,
+                               const DependencyOutputOptions &Opts,
+                               std::vector<std::string> &Files);
+
 /// AttachHeaderIncludeGen - Create a header include list generator, and attach
 /// it to the given preprocessor.
 ///
@@ -0,0 +1,77 @@
+//===--- DirectoryIndex.h - Cached directory listings -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the DirectoryIndex interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LEX_DIRECTORYINDEX_H
+#define LLVM_CLANG_LEX_DIRECTORYINDEX_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/Mutex.h"
+
+namespace clang {
+
+/// \brief Remembers the names in each directory header search looks into, so
+/// that most lookups of files which don't exist can be answered without
+/// touching the file system.
+///
+/// Each directory is read once, the first time a lookup needs it; the index
+/// does not notice files created or removed afterwards.  Names are compared
+/// case-insensitively so that the index never rejects a file which a
+/// case-insensitive file system would find.  Anything the index can't answer
+/// (paths with "." or "..", unreadable directories, ...) is reported as
+/// possibly present, leaving the decision to the file system.
+///
+/// Once LLVM is in multithreaded mode, one index can be shared by the header
+/// searches of compiler instances running on different threads.
+class DirectoryIndex {
+  struct DirContents {
+    /// Names - The lowercased names of the entries in the directory.
+    llvm::StringSet<> Names;
+
+    /// Complete - False if the directory couldn't be read completely, in which
+    /// case Names can't be used to prove that an entry is missing.
+    bool Complete;
+  };
+
+  /// Dirs - The contents of each directory read so far, keyed by its path.
+  llvm::StringMap<DirContents *> Dirs;
+
+  /// Lock - Serializes lookups when LLVM is running multithreaded.
+  mutable llvm::sys::SmartMutex<true> Lock;
+
+  unsigned NumDirsRead, NumEntries;
+  unsigned NumNegativeLookups, NumPositiveLookups, NumUnknownLookups;
+
+  DirectoryIndex(const DirectoryIndex&); // DO NOT IMPLEMENT
+  void operator=(const DirectoryIndex&); // DO NOT IMPLEMENT
+
+  const DirContents &getContents(StringRef Dir);
+
+public:
+  DirectoryIndex();
+  ~DirectoryIndex();
+
+  /// \brief Determine whether the path \p RelPath, relative to the directory
+  /// \p Dir, may name an existing file.
+  ///
+  /// \returns false only if some component of \p RelPath is known not to
+  /// exist.
+  bool mayContain(StringRef Dir, StringRef RelPath);
+
+  void PrintStats() const;
+};
+
+}  // end namespace clang
+
+#endif
@@ -0,0 +1,80 @@
+//===--- HeaderGuardIndex.h - Persistent include guard index ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the HeaderGuardIndex interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LEX_HEADERGUARDINDEX_H
+#define LLVM_CLANG_LEX_HEADERGUARDINDEX_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringMap.h"
+#include <string>
+
+namespace clang {
+
+class FileEntry;
+class IdentifierInfo;
+class IdentifierTable;
+class PersistentRecordLog;
+
+/// \brief Remembers the controlling macros of headers across compiler runs.
+///
+/// The multiple-include optimization only learns that a header is wrapped in
+/// an include guard by lexing it once.  This index records each guard found,
+/// keyed by the identity (device and inode), size and modification time of
+/// the header, in a PersistentRecordLog shared by every compiler process
+/// using the same file.  A later compile can then skip an #include of the
+/// header without opening it when the guard macro is already defined.
+class HeaderGuardIndex {
+  /// \brief The file holding the index.
+  llvm::OwningPtr<PersistentRecordLog> Log;
+
+  /// \brief The identifiers the controlling macros are looked up in.
+  IdentifierTable &Identifiers;
+
+  /// \brief The name of the controlling macro of each header, keyed by the
+  /// header's identity, size and modification time.
+  llvm::StringMap<std::string> Guards;
+
+  unsigned NumRecordsLoaded, NumRecordsAdded, NumLookups, NumFound;
+
+  HeaderGuardIndex(PersistentRecordLog *Log, IdentifierTable &Identifiers);
+
+  HeaderGuardIndex(const HeaderGuardIndex&); // DO NOT IMPLEMENT
+  void operator=(const HeaderGuardIndex&); // DO NOT IMPLEMENT
+
+public:
+  ~HeaderGuardIndex();
+
+  /// \brief Open the index stored in \p FileName, creating the file if it
+  /// does not exist yet.
+  ///
+  /// \returns the new index, or null (with \p ErrorStr set) if the file could
+  /// not be created or is not a header guard index.
+  static HeaderGuardIndex *Create(StringRef FileName,
+                                  IdentifierTable &Identifiers,
+                                  std::string &ErrorStr);
+
+  /// \brief Return the controlling macro an earlier compile found for the
+  /// current contents of \p File, or null if none is known.
+  const IdentifierInfo *getControllingMacro(const FileEntry *File);
+
+  /// \brief Record that \p File is guarded by \p ControllingMacro.
+  void setControllingMacro(const FileEntry *File,
+                           const IdentifierInfo *ControllingMacro);
+
+  void PrintStats() const;
+};
+
+}  // end namespace clang
+
+#endif
@@ -22,9 +22,11 @@
 
 namespace clang {
 
+class DirectoryIndex;
 class ExternalIdentifierLookup;
 class FileEntry;
 class FileManager;
+class HeaderGuardIndex;
 class IdentifierInfo;
 
 /// HeaderFileInfo - The preprocessor keeps track of this information for each
@@ -159,6 +161,16 @@ class HeaderSearch {
   /// headermaps.  This vector owns the headermap.
   std::vector<std::pair<const FileEntry*, const HeaderMap*> > HeaderMaps;
 
+  /// DirIndex - If non-null, the cached listings of the search directories,
+  /// used to skip looking for files that aren't there.  Owned by HeaderSearch
+  /// unless it was shared with other header searches.
+  DirectoryIndex *DirIndex;
+  bool OwnsDirIndex;
+
+  /// GuardIndex - If non-null, the controlling macros of headers found by
+  /// earlier compiles.  Owned by HeaderSearch.
+  HeaderGuardIndex *GuardIndex;
+
   /// \brief Uniqued set of framework names, which is used to track which 
   /// headers were included as framework headers.
   llvm::StringSet<llvm::BumpPtrAllocator> FrameworkNames;
@@ -173,6 +185,7 @@ class HeaderSearch {
   // Various statistics we track for performance analysis.
   unsigned NumIncluded;
   unsigned NumMultiIncludeFileOptzn;
+  unsigned NumGuardIndexSkips;
   unsigned NumFrameworkLookups, NumSubFrameworkLookups;
 
   // HeaderSearch doesn't support default or copy construction.
@@ -199,6 +212,23 @@ public:
     //LookupFileCache.clear();
   }
 
+  /// enableDirectoryIndex - Read the contents of each directory that is
+  /// searched once, and use them to answer lookups of missing files.
+  void enableDirectoryIndex();
+
+  /// setSharedDirectoryIndex - Use Index, which is owned by the client and may
+  /// be shared with other header searches, as the directory index.
+  void setSharedDirectoryIndex(DirectoryIndex *Index);
+
+  /// setHeaderGuardIndex - Use Index to skip headers guarded by a macro that
+  /// is already defined before their first #include, and to record the guards
+  /// found in this compile.  HeaderSearch takes ownership of the index.
+  void setHeaderGuardIndex(HeaderGuardIndex *Index);
+
+  /// mayContainFile - Return false if RelPath is known not to exist in the
+  /// directory Dir.  Without a directory index, this is always true.
+  bool mayContainFile(StringRef Dir, StringRef RelPath);
+
   /// \brief Set the path to the module cache and the name of the module
   /// we're building
   void configureModules(StringRef CachePath, StringRef BuildingModule) {
@@ -278,7 +308,12 @@ public:
   /// ShouldEnterIncludeFile - Mark the specified file as a target of of a
   /// #include, #include_next, or #import directive.  Return false if #including
   /// the file will have no effect or true if we should include it.
-  bool ShouldEnterIncludeFile(const FileEntry *File, bool isImport);
+  ///
+  /// FromGuardIndex, if non-null, is set to true when the file is skipped
+  /// because the header guard index knows its guard, and to false
+  /// otherwise.  Such a file has not been entered in this translation unit.
+  bool ShouldEnterIncludeFile(const FileEntry *File, bool isImport,
+                              bool *FromGuardIndex = 0);
 
 
   /// getFileDirFlavor - Return whether the specified file is a normal header,
@@ -307,13 +342,17 @@ public:
     ++getFileInfo(File).NumIncludes;
   }
 
+  /// getIncludeCount - Return the number of times the specified FileEntry has
+  /// been entered.
+  unsigned getIncludeCount(const FileEntry *File) {
+    return getFileInfo(File).NumIncludes;
+  }
+
   /// SetFileControllingMacro - Mark the specified file as having a controlling
   /// macro.  This is used by the multiple-include optimization to eliminate
   /// no-op #includes.
   void SetFileControllingMacro(const FileEntry *File,
-                               const IdentifierInfo *ControllingMacro) {
-    getFileInfo(File).ControllingMacro = ControllingMacro;
-  }
+                               const IdentifierInfo *ControllingMacro);
 
   /// \brief Determine whether this file is intended to be safe from
   /// multiple inclusions, e.g., it has #pragma once or a controlling
@@ -87,6 +87,8 @@ private:
 
   void ParseNumberStartingWithZero(SourceLocation TokLoc);
 
+  bool GetUInt64Value(uint64_t &N);
+
   /// SkipHexDigits - Read and skip over any hex digits, up to End.
   /// Return a pointer to the first non-hex digit or End.
   const char *SkipHexDigits(const char *ptr) {
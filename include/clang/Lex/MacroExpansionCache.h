@@ -0,0 +1,165 @@
+//===--- MacroExpansionCache.h - Memoized macro expansions ------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines the MacroExpansionCache interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LEX_MACROEXPANSIONCACHE_H
+#define LLVM_CLANG_LEX_MACROEXPANSIONCACHE_H
+
+#include "clang/Lex/Token.h"
+#include "clang/Basic/LLVM.h"
+#include "clang/Basic/SourceLocation.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringMap.h"
+#include <vector>
+
+namespace clang {
+
+class IdentifierInfo;
+class SourceManager;
+
+/// \brief Remembers the fully expanded token sequences of macro expansions so
+/// that expanding the same macro again in the same context doesn't rerun the
+/// token lexers of every macro it uses.
+///
+/// The Preprocessor builds the key of an expansion from the MacroInfo being
+/// expanded, the macros disabled around the expansion and, for function-like
+/// macros, the argument tokens and their positions relative to the macro
+/// name.  The expanded tokens are recorded together with the macro
+/// SLocEntries created while producing them.  When the same key is expanded
+/// again, those SLocEntries are recreated in the same order and with the
+/// same sizes, so every token ends up with exactly the expansion location
+/// (and chain of "expanded from" locations) a real expansion would give it.
+///
+/// Any change to the macro table which could change an expansion clears the
+/// cache, since the keys refer to MacroInfo objects which may be reused.
+class MacroExpansionCache {
+public:
+  /// \brief The state of the SourceManager when an expansion starts to be
+  /// recorded.
+  struct RecordingPoint {
+    unsigned NumSLocEntries;
+    unsigned Offset;
+  };
+
+private:
+  /// \brief A macro SLocEntry created by a recorded expansion.
+  struct ExpansionRecord {
+    SourceLocation SpellingLoc;
+    SourceLocation ExpansionLocStart, ExpansionLocEnd;
+    unsigned Length;
+    bool IsMacroArgExpansion;
+  };
+
+  /// \brief A recorded expansion.
+  struct CachedExpansion {
+    /// \brief The expanded tokens, with the locations they were recorded with.
+    std::vector<Token> Tokens;
+
+    /// \brief The SLocEntries created by the expansion, in order.
+    std::vector<ExpansionRecord> SLocEntries;
+
+    /// \brief The source location address space taken by those entries.
+    unsigned WindowOffset, WindowSize;
+
+    /// \brief The location of the macro name and the distance from it to
+    /// the end of the invocation (the ')' of a function-like macro).
+    SourceLocation InvocationStart;
+    unsigned InvocationLength;
+
+    /// \brief Whether the last token is the name of a function-like macro
+    /// which has to be looked at again, since its '(' may follow the
+    /// invocation.
+    bool ReexamineLast;
+
+    /// \brief Whether this expansion is known not to be cacheable.
+    bool Uncacheable;
+  };
+
+  SourceManager &SourceMgr;
+
+  llvm::StringMap<CachedExpansion> Expansions;
+
+  /// \brief Identifiers appearing in cached expansions.  Defining one of them
+  /// as a macro changes the expansions which mention it.
+  llvm::SmallPtrSet<const IdentifierInfo *, 64> MentionedIdentifiers;
+
+  unsigned NumCachedTokens;
+
+  unsigned NumHits, NumRecorded, NumUncacheable, NumInvalidations;
+
+  bool isInWindow(const CachedExpansion &Expansion, SourceLocation Loc) const;
+  bool isReplayable(const CachedExpansion &Expansion, ArrayRef<unsigned> Args,
+                    SourceLocation Loc) const;
+  SourceLocation remapLocation(const CachedExpansion &Expansion, int Delta,
+                               SourceLocation InvocationStart,
+                               SourceLocation Loc) const;
+
+  MacroExpansionCache(const MacroExpansionCache&); // DO NOT IMPLEMENT
+  void operator=(const MacroExpansionCache&); // DO NOT IMPLEMENT
+
+public:
+  explicit MacroExpansionCache(SourceManager &SM);
+  ~MacroExpansionCache();
+
+  enum LookupResult {
+    /// \brief Nothing is known about the expansion.
+    LR_Missing,
+    /// \brief The expansion was seen before and can't be cached.
+    LR_Uncacheable,
+    /// \brief The recorded expansion was replayed.
+    LR_Replayed
+  };
+
+  /// \brief If an expansion was recorded for \p Key, recreate its
+  /// SLocEntries for an invocation starting at \p InvocationStart and append
+  /// its tokens to \p Result.  \p ReexamineLast is set to whether the last
+  /// of those tokens has to be lexed again with macro expansion enabled.
+  LookupResult lookup(StringRef Key, SourceLocation InvocationStart,
+                      SmallVectorImpl<Token> &Result, bool &ReexamineLast);
+
+  /// \brief Mark the start of an expansion which may be recorded.
+  RecordingPoint getRecordingPoint() const;
+
+  /// \brief Record the tokens produced by an expansion which started at
+  /// \p Start.
+  ///
+  /// \param ArgOffsets The offsets, relative to \p InvocationStart, of the
+  /// argument tokens of a function-like macro invocation, in order.
+  ///
+  /// \returns false if the expansion couldn't be recorded, for instance
+  /// because it refers to parts of the invocation other than its tokens.
+  bool record(StringRef Key, const RecordingPoint &Start,
+              SourceLocation InvocationStart, unsigned InvocationLength,
+              ArrayRef<unsigned> ArgOffsets, ArrayRef<Token> Tokens,
+              bool ReexamineLast);
+
+  /// \brief Remember that the expansion for \p Key can't be cached, so
+  /// that later expansions don't try to record it again.
+  void recordUncacheable(StringRef Key);
+
+  /// \brief Note an expansion which couldn't be recorded at all.
+  void noteUncacheable() { ++NumUncacheable; }
+
+  /// \brief Note that the macro definition of \p II is about to change.
+  /// \p WasDefined is whether \p II currently names a macro.
+  void macroChanged(const IdentifierInfo *II, bool WasDefined);
+
+  /// \brief Forget every cached expansion.
+  void clear();
+
+  void PrintStats() const;
+};
+
+}  // end namespace clang
+
+#endif
@@ -44,11 +44,16 @@ class PTHLexer : public PreprocessorLexer {
   ///  to process when doing quick skipping of preprocessor blocks.
   const unsigned char* CurPPCondPtr;
 
+  /// LastOffset - The file offset of the last token read.  Tokens in the
+  ///  middle of a line are stored relative to it.
+  uint32_t LastOffset;
+
   PTHLexer(const PTHLexer&);  // DO NOT IMPLEMENT
   void operator=(const PTHLexer&); // DO NOT IMPLEMENT
 
-  /// ReadToken - Used by PTHLexer to read tokens TokBuf.
-  void ReadToken(Token& T);
+  /// SkipToken - Return the start of the token after the one at Ptr,
+  ///  updating LastOffset as if the token had been read.
+  const unsigned char *SkipToken(const unsigned char *Ptr);
   
   bool LexEndOfFile(Token &Result);
 
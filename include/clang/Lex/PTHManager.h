@@ -15,6 +15,7 @@
 #define LLVM_CLANG_PTHMANAGER_H
 
 #include "clang/Lex/PTHLexer.h"
+#include "clang/Lex/Token.h"
 #include "clang/Basic/LangOptions.h"
 #include "clang/Basic/IdentifierTable.h"
 #include "clang/Basic/Diagnostic.h"
@@ -74,12 +75,22 @@ class PTHManager : public IdentifierInfoLookup {
   ///  if the file (if any) that was to used to generate the PTH cache.
   const char* OriginalSourceFile;
 
+  /// CreationTime - The time at which the PTH file started to be generated.
+  ///  A file modified at or after this time may have changed after its tokens
+  ///  were cached, even if its size and modification time still match.
+  const uint64_t CreationTime;
+
+  /// ValidatedFiles - Whether the cached tokens of each file looked at so far
+  ///  still match its contents.
+  llvm::DenseMap<const FileEntry*, bool> ValidatedFiles;
+
   /// This constructor is intended to only be called by the static 'Create'
   /// method.
   PTHManager(const llvm::MemoryBuffer* buf, void* fileLookup,
              const unsigned char* idDataTable, IdentifierInfo** perIDCache,
              void* stringIdLookup, unsigned numIds,
-             const unsigned char* spellingBase, const char *originalSourceFile);
+             const unsigned char* spellingBase, const char *originalSourceFile,
+             uint64_t creationTime);
 
   // Do not implement.
   PTHManager();
@@ -99,9 +110,26 @@ class PTHManager : public IdentifierInfoLookup {
   }
   IdentifierInfo* LazilyCreateIdentifierInfo(unsigned PersistentID);
 
+  /// isUpToDate - Return true if the tokens cached for the file FID, which
+  ///  had the given size, modification time and content hash when the PTH
+  ///  file was generated, still match the file's contents.
+  bool isUpToDate(FileID FID, const FileEntry *FE, uint64_t Size,
+                  uint64_t ModTime, uint64_t ContentHash);
+
 public:
   // The current PTH version.
-  enum { Version = 9 };
+  enum { Version = 10 };
+
+  /// getContentHash - Return the hash of a file's contents which PTH files
+  ///  record to detect stale token data.
+  static uint64_t getContentHash(StringRef Data);
+
+  /// hasAbsoluteOffset - Tokens at the start of a line and the end of file
+  ///  token record their offset in the file.  Every other token records its
+  ///  distance from the token before it.
+  static bool hasAbsoluteOffset(tok::TokenKind Kind, unsigned Flags) {
+    return (Flags & Token::StartOfLine) || Kind == tok::eof;
+  }
 
   ~PTHManager();
 
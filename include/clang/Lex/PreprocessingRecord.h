@@ -284,9 +284,139 @@ namespace clang {
     /// \brief Allocator used to store preprocessing objects.
     llvm::BumpPtrAllocator BumpAlloc;
 
-    /// \brief The set of preprocessed entities in this record, in order they
-    /// were seen.
-    std::vector<PreprocessedEntity *> PreprocessedEntities;
+    /// \brief The number of local entities each chunk holds before a new
+    /// chunk is started.
+    enum { EntityChunkSize = 64 };
+
+    /// \brief A run of consecutive local preprocessed entities, in compact
+    /// form.
+    ///
+    /// Each entity is encoded as three VBR numbers: its kind and payload,
+    /// the zigzag-encoded difference between its begin location and the
+    /// previous entity's one (or \c FirstBegin), and the zigzag-encoded
+    /// difference between its end and begin locations.  The payload of a
+    /// macro expansion indexes \c ExpansionNames and that of a directive
+    /// indexes \c Directives.  Consecutive entities are usually close to
+    /// each other, so a macro expansion typically takes four or five bytes
+    /// rather than a pointer and a heap-allocated object.
+    struct EntityChunk {
+      /// \brief The index of the first entity in this chunk.
+      unsigned FirstIndex;
+
+      /// \brief The number of entities in this chunk.
+      unsigned NumEntities;
+
+      /// \brief The begin location of the first entity.
+      SourceLocation FirstBegin;
+
+      /// \brief The begin location of the last entity, which the next one
+      /// appended is encoded relative to.
+      SourceLocation LastBegin;
+
+      /// \brief The end location of the last entity.
+      SourceLocation LastEnd;
+
+      /// \brief The encoded entities.
+      std::vector<unsigned char> Data;
+
+      EntityChunk() : FirstIndex(0), NumEntities(0) { }
+    };
+
+    /// \brief A local preprocessed entity, as decoded from its chunk.
+    struct DecodedEntity {
+      PreprocessedEntity::EntityKind Kind;
+      unsigned Payload;
+      SourceRange Range;
+    };
+
+    /// \brief The preprocessed entities introduced by the current
+    /// preprocessor, in the order they were seen.
+    std::vector<EntityChunk> EntityChunks;
+
+    /// \brief The number of entities in \c EntityChunks.
+    unsigned NumLocalEntities;
+
+    /// \brief The macro definitions, or names of builtin macros, that local
+    /// macro expansions refer to, as opaque MacroExpansion name values.
+    std::vector<void *> ExpansionNames;
+
+    /// \brief Maps the values in \c ExpansionNames to their index.
+    llvm::DenseMap<void *, unsigned> ExpansionNameIndex;
+
+    /// \brief The local preprocessing directives.  Directives are rare
+    /// compared to macro expansions, and are kept as full objects.
+    std::vector<PreprocessingDirective *> Directives;
+
+    /// \brief The local macro expansions which have been handed out as
+    /// objects, by index.  The same object is returned every time.
+    llvm::DenseMap<unsigned, PreprocessedEntity *> MaterializedExpansions;
+
+    /// \brief The index of the chunk that \c DecodedEntities holds, or ~0U.
+    mutable unsigned DecodedChunk;
+
+    /// \brief The entities of the most recently decoded chunk, so that walks
+    /// through the record decode each chunk only once.
+    mutable std::vector<DecodedEntity> DecodedEntities;
+
+    /// \brief A local preprocessed entity, as seen from the file its
+    /// expansion begins in.
+    struct FileEntity {
+      /// \brief The offset of the entity's begin within the file.
+      unsigned Begin;
+
+      /// \brief The largest end offset of this entity and the entities of
+      /// the same file before it, which makes it usable for binary search.
+      unsigned MaxEnd;
+
+      /// \brief The index of the local entity.
+      unsigned Index;
+    };
+    typedef std::vector<FileEntity> FileEntityList;
+
+    /// \brief The local entities of each file, in source order.
+    ///
+    /// The index is built the first time a range is looked up, and rebuilt
+    /// when entities were added since, so that querying the entities in a
+    /// region of a file takes two binary searches over plain offsets rather
+    /// than a search that compares source locations across the whole
+    /// translation unit.  The entities found are a contiguous run of local
+    /// entities.  As before, the run also holds the entities of any file
+    /// #included within the region, and the caller visits those too.
+    mutable llvm::DenseMap<FileID, FileEntityList> FileEntities;
+
+    /// \brief The number of local entities when \c FileEntities was built.
+    mutable unsigned NumFileIndexedEntities;
+
+    /// \brief Return the local entities whose expansion begins in the given
+    /// file, or null if there are none.
+    const FileEntityList *getFileEntities(FileID FID) const;
+
+    /// \brief Decode the given chunk into \c DecodedEntities.
+    const std::vector<DecodedEntity> &decodeChunk(unsigned Chunk) const;
+
+    /// \brief Encode \p Entities, in order, into the given chunk.
+    static void encodeChunk(EntityChunk &Chunk,
+                            const std::vector<DecodedEntity> &Entities);
+
+    /// \brief Find the chunk which holds the given local entity.
+    unsigned findChunk(unsigned Index) const;
+
+    /// \brief Record a new local entity in source order.
+    ///
+    /// \returns the index of the new entity.
+    unsigned addLocalEntity(PreprocessedEntity::EntityKind Kind,
+                            unsigned Payload, SourceRange Range);
+
+    /// \brief Record an expansion of the given macro definition or builtin
+    /// macro name, without creating an object for it.
+    ///
+    /// \returns the index of the new entity.
+    unsigned addMacroExpansion(void *NameOrDef, SourceRange Range);
+
+    /// \brief Retrieve the local preprocessed entity at the given index,
+    /// creating its object if it is a macro expansion which hasn't been
+    /// asked for before.
+    PreprocessedEntity *getLocalPreprocessedEntity(unsigned Index);
     
     /// \brief The set of preprocessed entities in this record that have been
     /// loaded from external sources.
@@ -310,6 +440,10 @@ namespace clang {
     }
 
     /// \brief Mapping from MacroInfo structures to their definitions.
+    ///
+    /// Loaded definitions are referred to by their (negative) ID and local
+    /// ones by their index in \c Directives, which, unlike their ID, doesn't
+    /// change when an entity is inserted out of order.
     llvm::DenseMap<const MacroInfo *, PPEntityID> MacroDefinitions;
 
     /// \brief External source of preprocessed entities.
@@ -481,7 +615,7 @@ namespace clang {
 
     /// \brief End iterator for all preprocessed entities.
     iterator end() {
-      return iterator(this, PreprocessedEntities.size());
+      return iterator(this, NumLocalEntities);
     }
 
     /// \brief Begin iterator for local, non-loaded, preprocessed entities.
@@ -491,7 +625,7 @@ namespace clang {
 
     /// \brief End iterator for local, non-loaded, preprocessed entities.
     iterator local_end() {
-      return iterator(this, PreprocessedEntities.size());
+      return iterator(this, NumLocalEntities);
     }
 
     /// \brief Returns a pair of [Begin, End) iterators of preprocessed entities
@@ -49,7 +49,9 @@ class PPCallbacks;
 class CodeCompletionHandler;
 class DirectoryLookup;
 class PreprocessingRecord;
+class MacroExpansionCache;
 class ModuleLoader;
+class DirectiveSkeleton;
   
 /// Preprocessor - This object engages in a tight little dance with the lexer to
 /// efficiently preprocess tokens.  Lexers know only about tokens within a
@@ -266,7 +268,7 @@ class Preprocessor : public llvm::RefCountedBase<Preprocessor> {
   unsigned NumEnteredSourceFiles, MaxIncludeStackDepth;
   unsigned NumMacroExpanded, NumFnMacroExpanded, NumBuiltinMacroExpanded;
   unsigned NumFastMacroExpanded, NumTokenPaste, NumFastTokenPaste;
-  unsigned NumSkipped;
+  unsigned NumSkipped, NumSkippedWithSkeleton;
 
   /// Predefines - This string is the predefined macros that preprocessor
   /// should use from the command line etc.
@@ -291,6 +293,28 @@ class Preprocessor : public llvm::RefCountedBase<Preprocessor> {
   /// This is an optional side structure that can be enabled with
   /// \c createPreprocessingRecord() prior to preprocessing.
   PreprocessingRecord *Record;
+
+  /// \brief Macro expansions which can be reused, or null if expansions
+  /// aren't cached.  Enabled with \c createMacroExpansionCache().
+  MacroExpansionCache *ExpansionCache;
+
+  /// DirectiveSkeletons - The conditional directives of the files which are
+  /// entered more than once, built the first time such a file skips a block
+  /// after being entered again.  Until then, files map to null.
+  llvm::DenseMap<const FileEntry *, DirectiveSkeleton *> DirectiveSkeletons;
+
+  /// \brief Whether the scratch buffer may grow very large chunks.  Set
+  /// with \c packScratchBuffers().
+  bool PackScratchBuffers;
+
+  /// \brief While an expansion is being recorded for the expansion cache,
+  /// the token stream below the macro which marks the end of its tokens.
+  TokenLexer *MacroPreExpansionSentinel;
+
+  /// \brief The number of diagnostics reported through Diag(), including
+  /// ones which end up ignored.  An expansion which reports any can't be
+  /// replayed from the expansion cache.
+  mutable unsigned NumDiagnostics;
   
 private:  // Cached tokens state.
   typedef SmallVector<Token, 1> CachedTokensTy;
@@ -506,6 +530,16 @@ public:
   /// \brief Create a new preprocessing record, which will keep track of 
   /// all macro expansions, macro definitions, etc.
   void createPreprocessingRecord(bool IncludeNestedMacroExpansions);
+
+  /// \brief Start reusing the tokens of repeated macro expansions.  Nothing
+  /// is cached while there are preprocessor callbacks, since they would miss
+  /// the macro expansions which are replayed.
+  void createMacroExpansionCache();
+
+  /// \brief Let the chunks of the scratch buffer, which holds the tokens
+  /// formed by pasting and stringizing, grow to a few megabytes, so that
+  /// they take far fewer SourceManager entries.
+  void packScratchBuffers();
   
   /// EnterMainSourceFile - Enter the specified FileID as the main source file,
   /// which implicitly adds the builtin defines etc.
@@ -754,10 +788,12 @@ public:
   /// the specified Token's location, translating the token's start
   /// position in the current buffer into a SourcePosition object for rendering.
   DiagnosticBuilder Diag(SourceLocation Loc, unsigned DiagID) const {
+    ++NumDiagnostics;
     return Diags->Report(Loc, DiagID);
   }
 
   DiagnosticBuilder Diag(const Token &Tok, unsigned DiagID) const {
+    ++NumDiagnostics;
     return Diags->Report(Tok.getLocation(), DiagID);
   }
 
@@ -1083,6 +1119,11 @@ private:
   ///  SkipExcludedConditionalBlock.
   void PTHSkipExcludedConditionalBlock();
 
+  /// getDirectiveSkeleton - Return the conditional directives of the file
+  /// being lexed, or null if SkipExcludedConditionalBlock should lex every
+  /// token of the excluded block instead.
+  DirectiveSkeleton *getDirectiveSkeleton();
+
   /// EvaluateDirectiveExpression - Evaluate an integer constant expression that
   /// may occur after a #if or #elif directive and return it as a bool.  If the
   /// expression is equivalent to "!defined(X)" return X in IfNDefMacro.
@@ -1101,6 +1142,32 @@ private:
   /// the macro should not be expanded return true, otherwise return false.
   bool HandleMacroExpandedIdentifier(Token &Tok, MacroInfo *MI);
 
+  /// \brief Compute the expansion cache key of an expansion of \p MI.
+  /// Fills in \p InvocationLength with the distance from the macro name to
+  /// the end of the invocation and \p ArgOffsets with the sorted offsets of
+  /// the argument tokens from the macro name.  Returns false if the
+  /// expansion can't be cached.
+  bool getMacroExpansionKey(const Token &Identifier, MacroInfo *MI,
+                            SourceLocation ExpansionEnd, MacroArgs *Args,
+                            SmallVectorImpl<char> &Key,
+                            unsigned &InvocationLength,
+                            SmallVectorImpl<unsigned> &ArgOffsets);
+
+  /// \brief Expand \p MI through the expansion cache, either by replaying
+  /// an earlier expansion or by expanding it up front and recording the
+  /// result.  Returns false if the macro has to be expanded normally.
+  bool ExpandMacroThroughCache(Token &Identifier, MacroInfo *MI,
+                               SourceLocation ExpansionEnd, MacroArgs *Args);
+
+  /// \brief Stop recording the current expansion for the expansion cache,
+  /// because something in it needs to see the tokens that follow it.  The
+  /// rest of the expansion proceeds normally.
+  void abortMacroPreExpansion();
+
+  /// \brief Return true if the next token lexed while recording an
+  /// expansion for the expansion cache will be the end of the expansion.
+  bool isAtEndOfMacroPreExpansion() const;
+
   /// \brief Cache macro expanded tokens for TokenLexers.
   //
   /// Works like a stack; a TokenLexer adds the macro expanded tokens that is
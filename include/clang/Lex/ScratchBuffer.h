@@ -15,6 +15,7 @@
 #define LLVM_CLANG_SCRATCHBUFFER_H
 
 #include "clang/Basic/SourceLocation.h"
+#include "llvm/Support/DataTypes.h"
 
 namespace clang {
   class SourceManager;
@@ -22,11 +23,32 @@ namespace clang {
 /// ScratchBuffer - This class exposes a simple interface for the dynamic
 /// construction of tokens.  This is used for builtin macros (e.g. __LINE__) as
 /// well as token pasting, etc.
+///
+/// Each chunk of scratch space is a FileID of its own, so chunks start small
+/// and double in size up to a limit; token-paste heavy code then creates a
+/// handful of SourceManager entries rather than one per few kilobytes.
 class ScratchBuffer {
   SourceManager &SourceMgr;
   char *CurBuffer;
   SourceLocation BufferStartLoc;
   unsigned BytesUsed;
+
+  /// CurBufferSize - The size of the current chunk.
+  unsigned CurBufferSize;
+
+  /// MaxChunkSize - The size chunks stop growing at.
+  unsigned MaxChunkSize;
+
+  // Statistics.
+  unsigned NumTokens, NumChunks;
+  uint64_t BytesAllocated;
+
+  /// NumFixedChunks, FixedBytesAllocated, FixedBytesUsed - What chunks of a
+  /// fixed size would have taken, for -print-stats.
+  unsigned NumFixedChunks;
+  uint64_t FixedBytesAllocated;
+  unsigned FixedBytesUsed;
+
 public:
   ScratchBuffer(SourceManager &SM);
 
@@ -36,6 +58,13 @@ public:
   /// token.
   SourceLocation getToken(const char *Buf, unsigned Len, const char *&DestPtr);
 
+  /// setMaxChunkSize - Let chunks grow up to the specified size.  Larger
+  /// chunks mean fewer SourceManager entries, at the cost of the unused tail
+  /// of the last chunk.
+  void setMaxChunkSize(unsigned Size) { MaxChunkSize = Size; }
+
+  void PrintStats() const;
+
 private:
   void AllocScratchBuffer(unsigned RequestLen);
 };
@@ -40,7 +40,11 @@ namespace clang {
 
   /// \brief Parse the main file known to the preprocessor, producing an 
   /// abstract syntax tree.
-  void ParseAST(Sema &S, bool PrintStats = false);
+  ///
+  /// \param SkipFunctionBodies Whether to skip the bodies of function
+  /// definitions, parsing them only when the body is asked for.
+  void ParseAST(Sema &S, bool PrintStats = false,
+                bool SkipFunctionBodies = false);
   
 }  // end namespace clang
 
@@ -179,10 +179,23 @@ class Parser : public CodeCompletionHandler {
   /// declaration is finished.
   DelayedCleanupPool TopLevelDeclCleanupPool;
 
+  /// \brief When true, the bodies of ordinary function definitions are not
+  /// parsed; their tokens are kept and parsed when the body is needed.
+  bool SkipFunctionBodies;
+
+  /// \brief The tokens of the function bodies which were skipped and haven't
+  /// been parsed yet.
+  typedef llvm::DenseMap<const FunctionDecl*, CachedTokens*> SkippedBodyMapT;
+  SkippedBodyMapT SkippedBodies;
+
+  unsigned NumSkippedBodies, NumLazilyParsedBodies;
+
 public:
-  Parser(Preprocessor &PP, Sema &Actions);
+  Parser(Preprocessor &PP, Sema &Actions, bool SkipFunctionBodies = false);
   ~Parser();
 
+  void PrintStats();
+
   const LangOptions &getLang() const { return PP.getLangOptions(); }
   const TargetInfo &getTargetInfo() const { return PP.getTargetInfo(); }
   Preprocessor &getPreprocessor() const { return PP; }
@@ -1120,6 +1133,9 @@ private:
   static void LateTemplateParserCallback(void *P, const FunctionDecl *FD);
   void LateTemplateParser(const FunctionDecl *FD);
 
+  static void LazyBodyParserCallback(void *P, const FunctionDecl *FD);
+  void ParseSkippedFunctionBody(const FunctionDecl *FD);
+
   Sema::ParsingClassState
   PushParsingClass(Decl *TagOrTemplate, bool TopLevelClass);
   void DeallocateParsedClasses(ParsingClass *Class);
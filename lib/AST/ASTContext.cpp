@@ -13,6 +13,7 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/CharUnits.h"
+#include "clang/AST/DeclContextInternals.h"
 #include "clang/AST/DeclCXX.h"
 #include "clang/AST/DeclObjC.h"
 #include "clang/AST/DeclTemplate.h"
@@ -29,6 +30,8 @@
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadLocal.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Capacity.h"
 #include "CXXABI.h"
@@ -53,6 +56,34 @@ enum FloatingRank {
   HalfRank, FloatRank, DoubleRank, LongDoubleRank
 };
 
+/// \brief The allocators of the threads allocating from a context once
+/// concurrent type creation is enabled.
+struct ASTContext::ThreadArenaSet {
+  /// \brief The allocator of the current thread, once it allocated.
+  llvm::sys::ThreadLocal<llvm::BumpPtrAllocator> Current;
+
+  /// \brief Every allocator handed out, for the context to free.
+  std::vector<llvm::BumpPtrAllocator *> All;
+};
+
+/// \brief Holds the type creation lock of a context, if it has one, while a
+/// type is looked up in or added to the uniquing tables.
+class ASTContext::TypeCreationGuard {
+  llvm::sys::MutexImpl *Lock;
+
+public:
+  explicit TypeCreationGuard(const ASTContext &Ctx)
+    : Lock(Ctx.TypeCreationLock) {
+    if (Lock)
+      Lock->acquire();
+  }
+
+  ~TypeCreationGuard() {
+    if (Lock)
+      Lock->release();
+  }
+};
+
 void 
 ASTContext::CanonicalTemplateTemplateParm::Profile(llvm::FoldingSetNodeID &ID, 
                                                TemplateTemplateParmDecl *Parm) {
@@ -94,6 +125,7 @@ ASTContext::CanonicalTemplateTemplateParm::Profile(llvm::FoldingSetNodeID &ID,
 TemplateTemplateParmDecl *
 ASTContext::getCanonicalTemplateTemplateParmDecl(
                                           TemplateTemplateParmDecl *TTP) const {
+  TypeCreationGuard Guard(*this);
   // Check if we already have a canonical template template parameter.
   llvm::FoldingSetNodeID ID;
   CanonicalTemplateTemplateParm::Profile(ID, TTP);
@@ -223,6 +255,7 @@ ASTContext::ASTContext(LangOptions& LOpts, SourceManager &SM,
     DependentTemplateSpecializationTypes(this_()),
     SubstTemplateTemplateParmPacks(this_()),
     GlobalNestedNameSpecifier(0), 
+    NumConstantValueHits(0), NumConstantValueMisses(0),
     Int128Decl(0), UInt128Decl(0),
     ObjCIdDecl(0), ObjCSelDecl(0), ObjCClassDecl(0),
     CFConstantStringTypeDecl(0), ObjCInstanceTypeDecl(0),
@@ -230,12 +263,13 @@ ASTContext::ASTContext(LangOptions& LOpts, SourceManager &SM,
     jmp_bufDecl(0), sigjmp_bufDecl(0), BlockDescriptorType(0), 
     BlockDescriptorExtendedType(0), cudaConfigureCallDecl(0),
     NullTypeSourceInfo(QualType()),
-    SourceMgr(SM), LangOpts(LOpts), 
+    SourceMgr(SM), LangOpts(LOpts), TypeCreationLock(0), ThreadArenas(0),
     AddrSpaceMap(0), Target(t), PrintingPolicy(LOpts),
     Idents(idents), Selectors(sels),
     BuiltinInfo(builtins),
     DeclarationNames(*this),
     ExternalSource(0), Listener(0),
+    LazyBodyParser(0), OpaqueLazyBodyParser(0),
     LastSDM(0, 0),
     UniqueBlockByRefTypeID(0) 
 {
@@ -283,12 +317,49 @@ ASTContext::~ASTContext() {
                                                     AEnd = DeclAttrs.end();
        A != AEnd; ++A)
     A->second->~AttrVec();
+
+  // The arenas go last: everything above may live in them.
+  if (ThreadArenas) {
+    for (unsigned I = 0, N = ThreadArenas->All.size(); I != N; ++I)
+      delete ThreadArenas->All[I];
+    delete ThreadArenas;
+  }
+  delete TypeCreationLock;
 }
 
 void ASTContext::AddDeallocation(void (*Callback)(void*), void *Data) {
   Deallocations.push_back(std::make_pair(Callback, Data));
 }
 
+void ASTContext::enableConcurrentTypeCreation() {
+  if (TypeCreationLock)
+    return;
+
+  TypeCreationLock = new llvm::sys::MutexImpl(/*recursive=*/true);
+  ThreadArenas = new ThreadArenaSet;
+}
+
+void *ASTContext::AllocateInThreadArena(unsigned Size, unsigned Align) const {
+  llvm::BumpPtrAllocator *Arena = ThreadArenas->Current.get();
+  if (!Arena) {
+    Arena = new llvm::BumpPtrAllocator;
+    ThreadArenas->Current.set(Arena);
+    TypeCreationGuard Guard(*this);
+    ThreadArenas->All.push_back(Arena);
+  }
+  return Arena->Allocate(Size, Align);
+}
+
+size_t ASTContext::getASTAllocatedMemory() const {
+  size_t Total = BumpAlloc.getTotalMemory();
+  if (ThreadArenas) {
+    TypeCreationGuard Guard(*this);
+    for (unsigned I = 0, N = ThreadArenas->All.size(); I != N; ++I)
+      Total += ThreadArenas->All[I]->getTotalMemory();
+  }
+  return Total;
+}
+
 void
 ASTContext::setExternalSource(llvm::OwningPtr<ExternalASTSource> &Source) {
   ExternalSource.reset(Source.take());
@@ -345,6 +416,12 @@ void ASTContext::PrintStats() const {
                << NumImplicitDestructors
                << " implicit destructors created\n";
 
+  llvm::errs() << ConstantValues.size() << " constant values cached, "
+               << NumConstantValueHits << " hits, "
+               << NumConstantValueMisses << " misses\n";
+
+  StoredDeclsMap::PrintStats(LastSDM.getPointer());
+
   if (ExternalSource.get()) {
     llvm::errs() << "\n";
     ExternalSource->PrintStats();
@@ -353,6 +430,17 @@ void ASTContext::PrintStats() const {
   BumpAlloc.PrintStats();
 }
 
+const llvm::APSInt *ASTContext::getCachedConstantValue(const Expr *E) const {
+  llvm::DenseMap<const Expr*, llvm::APSInt>::const_iterator
+    Known = ConstantValues.find(E);
+  if (Known == ConstantValues.end()) {
+    ++NumConstantValueMisses;
+    return 0;
+  }
+  ++NumConstantValueHits;
+  return &Known->second;
+}
+
 TypedefDecl *ASTContext::getInt128Decl() const {
   if (!Int128Decl) {
     TypeSourceInfo *TInfo = getTrivialTypeSourceInfo(Int128Ty);
@@ -1291,7 +1379,7 @@ TypeSourceInfo *ASTContext::CreateTypeSourceInfo(QualType T,
            "incorrect data size provided to CreateTypeSourceInfo!");
 
   TypeSourceInfo *TInfo =
-    (TypeSourceInfo*)BumpAlloc.Allocate(sizeof(TypeSourceInfo) + DataSize, 8);
+    (TypeSourceInfo*)Allocate(sizeof(TypeSourceInfo) + DataSize, 8);
   new (TInfo) TypeSourceInfo(T);
   return TInfo;
 }
@@ -1320,6 +1408,7 @@ ASTContext::getASTObjCImplementationLayout(
 
 QualType
 ASTContext::getExtQualType(const Type *baseType, Qualifiers quals) const {
+  TypeCreationGuard Guard(*this);
   unsigned fastQuals = quals.getFastQualifiers();
   quals.removeFastQualifiers();
 
@@ -1418,6 +1507,7 @@ const FunctionType *ASTContext::adjustFunctionType(const FunctionType *T,
 /// getComplexType - Return the uniqued reference to the type for a complex
 /// number with the specified element type.
 QualType ASTContext::getComplexType(QualType T) const {
+  TypeCreationGuard Guard(*this);
   // Unique pointers, to guarantee there is only one pointer of a particular
   // structure.
   llvm::FoldingSetNodeID ID;
@@ -1446,6 +1536,7 @@ QualType ASTContext::getComplexType(QualType T) const {
 /// getPointerType - Return the uniqued reference to the type for a pointer to
 /// the specified type.
 QualType ASTContext::getPointerType(QualType T) const {
+  TypeCreationGuard Guard(*this);
   // Unique pointers, to guarantee there is only one pointer of a particular
   // structure.
   llvm::FoldingSetNodeID ID;
@@ -1474,6 +1565,7 @@ QualType ASTContext::getPointerType(QualType T) const {
 /// getBlockPointerType - Return the uniqued reference to the type for
 /// a pointer to the specified block.
 QualType ASTContext::getBlockPointerType(QualType T) const {
+  TypeCreationGuard Guard(*this);
   assert(T->isFunctionType() && "block of function types only");
   // Unique pointers, to guarantee there is only one block of a particular
   // structure.
@@ -1507,6 +1599,7 @@ QualType ASTContext::getBlockPointerType(QualType T) const {
 /// lvalue reference to the specified type.
 QualType
 ASTContext::getLValueReferenceType(QualType T, bool SpelledAsLValue) const {
+  TypeCreationGuard Guard(*this);
   assert(getCanonicalType(T) != OverloadTy && 
          "Unresolved overloaded function type");
   
@@ -1547,6 +1640,7 @@ ASTContext::getLValueReferenceType(QualType T, bool SpelledAsLValue) const {
 /// getRValueReferenceType - Return the uniqued reference to the type for an
 /// rvalue reference to the specified type.
 QualType ASTContext::getRValueReferenceType(QualType T) const {
+  TypeCreationGuard Guard(*this);
   // Unique pointers, to guarantee there is only one pointer of a particular
   // structure.
   llvm::FoldingSetNodeID ID;
@@ -1582,6 +1676,7 @@ QualType ASTContext::getRValueReferenceType(QualType T) const {
 /// getMemberPointerType - Return the uniqued reference to the type for a
 /// member pointer to the specified type, in the specified class.
 QualType ASTContext::getMemberPointerType(QualType T, const Type *Cls) const {
+  TypeCreationGuard Guard(*this);
   // Unique pointers, to guarantee there is only one pointer of a particular
   // structure.
   llvm::FoldingSetNodeID ID;
@@ -1616,6 +1711,7 @@ QualType ASTContext::getConstantArrayType(QualType EltTy,
                                           const llvm::APInt &ArySizeIn,
                                           ArrayType::ArraySizeModifier ASM,
                                           unsigned IndexTypeQuals) const {
+  TypeCreationGuard Guard(*this);
   assert((EltTy->isDependentType() ||
           EltTy->isIncompleteType() || EltTy->isConstantSizeType()) &&
          "Constant array of VLAs is illegal!");
@@ -1795,6 +1891,7 @@ QualType ASTContext::getVariableArrayType(QualType EltTy,
                                           ArrayType::ArraySizeModifier ASM,
                                           unsigned IndexTypeQuals,
                                           SourceRange Brackets) const {
+  TypeCreationGuard Guard(*this);
   // Since we don't unique expressions, it isn't possible to unique VLA's
   // that have an expression provided for their size.
   QualType Canon;
@@ -1823,6 +1920,7 @@ QualType ASTContext::getDependentSizedArrayType(QualType elementType,
                                                 ArrayType::ArraySizeModifier ASM,
                                                 unsigned elementTypeQuals,
                                                 SourceRange brackets) const {
+  TypeCreationGuard Guard(*this);
   assert((!numElements || numElements->isTypeDependent() || 
           numElements->isValueDependent()) &&
          "Size must be type- or value-dependent!");
@@ -1888,6 +1986,7 @@ QualType ASTContext::getDependentSizedArrayType(QualType elementType,
 QualType ASTContext::getIncompleteArrayType(QualType elementType,
                                             ArrayType::ArraySizeModifier ASM,
                                             unsigned elementTypeQuals) const {
+  TypeCreationGuard Guard(*this);
   llvm::FoldingSetNodeID ID;
   IncompleteArrayType::Profile(ID, elementType, ASM, elementTypeQuals);
 
@@ -1925,6 +2024,7 @@ QualType ASTContext::getIncompleteArrayType(QualType elementType,
 /// the specified element type and size. VectorType must be a built-in type.
 QualType ASTContext::getVectorType(QualType vecType, unsigned NumElts,
                                    VectorType::VectorKind VecKind) const {
+  TypeCreationGuard Guard(*this);
   assert(vecType->isBuiltinType());
 
   // Check if we've already instantiated a vector of this type.
@@ -1956,6 +2056,7 @@ QualType ASTContext::getVectorType(QualType vecType, unsigned NumElts,
 /// the specified element type and size. VectorType must be a built-in type.
 QualType
 ASTContext::getExtVectorType(QualType vecType, unsigned NumElts) const {
+  TypeCreationGuard Guard(*this);
   assert(vecType->isBuiltinType() || vecType->isDependentType());
 
   // Check if we've already instantiated a vector of this type.
@@ -1987,6 +2088,7 @@ QualType
 ASTContext::getDependentSizedExtVectorType(QualType vecType,
                                            Expr *SizeExpr,
                                            SourceLocation AttrLoc) const {
+  TypeCreationGuard Guard(*this);
   llvm::FoldingSetNodeID ID;
   DependentSizedExtVectorType::Profile(ID, *this, getCanonicalType(vecType),
                                        SizeExpr);
@@ -2030,6 +2132,7 @@ ASTContext::getDependentSizedExtVectorType(QualType vecType,
 QualType
 ASTContext::getFunctionNoProtoType(QualType ResultTy,
                                    const FunctionType::ExtInfo &Info) const {
+  TypeCreationGuard Guard(*this);
   const CallingConv DefaultCC = Info.getCC();
   const CallingConv CallConv = (LangOpts.MRTD && DefaultCC == CC_Default) ?
                                CC_X86StdCall : DefaultCC;
@@ -2070,6 +2173,7 @@ QualType
 ASTContext::getFunctionType(QualType ResultTy,
                             const QualType *ArgArray, unsigned NumArgs,
                             const FunctionProtoType::ExtProtoInfo &EPI) const {
+  TypeCreationGuard Guard(*this);
   // Unique functions, to guarantee there is only one function of a particular
   // structure.
   llvm::FoldingSetNodeID ID;
@@ -2158,6 +2262,7 @@ static bool NeedsInjectedClassNameType(const RecordDecl *D) {
 /// injected class name type for the specified templated declaration.
 QualType ASTContext::getInjectedClassNameType(CXXRecordDecl *Decl,
                                               QualType TST) const {
+  TypeCreationGuard Guard(*this);
   assert(NeedsInjectedClassNameType(Decl));
   if (Decl->TypeForDecl) {
     assert(isa<InjectedClassNameType>(Decl->TypeForDecl));
@@ -2177,8 +2282,11 @@ QualType ASTContext::getInjectedClassNameType(CXXRecordDecl *Decl,
 /// getTypeDeclType - Return the unique reference to the type for the
 /// specified type declaration.
 QualType ASTContext::getTypeDeclTypeSlow(const TypeDecl *Decl) const {
+  TypeCreationGuard Guard(*this);
   assert(Decl && "Passed null for Decl param");
-  assert(!Decl->TypeForDecl && "TypeForDecl present in slow case");
+  // Another thread may have created the type since the caller looked.
+  if (Decl->TypeForDecl)
+    return QualType(Decl->TypeForDecl, 0);
 
   if (const TypedefNameDecl *Typedef = dyn_cast<TypedefNameDecl>(Decl))
     return getTypedefType(Typedef);
@@ -2211,6 +2319,7 @@ QualType ASTContext::getTypeDeclTypeSlow(const TypeDecl *Decl) const {
 QualType
 ASTContext::getTypedefType(const TypedefNameDecl *Decl,
                            QualType Canonical) const {
+  TypeCreationGuard Guard(*this);
   if (Decl->TypeForDecl) return QualType(Decl->TypeForDecl, 0);
 
   if (Canonical.isNull())
@@ -2223,6 +2332,7 @@ ASTContext::getTypedefType(const TypedefNameDecl *Decl,
 }
 
 QualType ASTContext::getRecordType(const RecordDecl *Decl) const {
+  TypeCreationGuard Guard(*this);
   if (Decl->TypeForDecl) return QualType(Decl->TypeForDecl, 0);
 
   if (const RecordDecl *PrevDecl = Decl->getPreviousDeclaration())
@@ -2236,6 +2346,7 @@ QualType ASTContext::getRecordType(const RecordDecl *Decl) const {
 }
 
 QualType ASTContext::getEnumType(const EnumDecl *Decl) const {
+  TypeCreationGuard Guard(*this);
   if (Decl->TypeForDecl) return QualType(Decl->TypeForDecl, 0);
 
   if (const EnumDecl *PrevDecl = Decl->getPreviousDeclaration())
@@ -2251,6 +2362,7 @@ QualType ASTContext::getEnumType(const EnumDecl *Decl) const {
 QualType ASTContext::getAttributedType(AttributedType::Kind attrKind,
                                        QualType modifiedType,
                                        QualType equivalentType) {
+  TypeCreationGuard Guard(*this);
   llvm::FoldingSetNodeID id;
   AttributedType::Profile(id, attrKind, modifiedType, equivalentType);
 
@@ -2273,6 +2385,7 @@ QualType ASTContext::getAttributedType(AttributedType::Kind attrKind,
 QualType
 ASTContext::getSubstTemplateTypeParmType(const TemplateTypeParmType *Parm,
                                          QualType Replacement) const {
+  TypeCreationGuard Guard(*this);
   assert(Replacement.isCanonical()
          && "replacement types must always be canonical");
 
@@ -2296,6 +2409,7 @@ ASTContext::getSubstTemplateTypeParmType(const TemplateTypeParmType *Parm,
 QualType ASTContext::getSubstTemplateTypeParmPackType(
                                           const TemplateTypeParmType *Parm,
                                               const TemplateArgument &ArgPack) {
+  TypeCreationGuard Guard(*this);
 #ifndef NDEBUG
   for (TemplateArgument::pack_iterator P = ArgPack.pack_begin(), 
                                     PEnd = ArgPack.pack_end();
@@ -2334,6 +2448,7 @@ QualType ASTContext::getSubstTemplateTypeParmPackType(
 QualType ASTContext::getTemplateTypeParmType(unsigned Depth, unsigned Index,
                                              bool ParameterPack,
                                              TemplateTypeParmDecl *TTPDecl) const {
+  TypeCreationGuard Guard(*this);
   llvm::FoldingSetNodeID ID;
   TemplateTypeParmType::Profile(ID, Depth, Index, ParameterPack, TTPDecl);
   void *InsertPos = 0;
@@ -2385,6 +2500,7 @@ QualType
 ASTContext::getTemplateSpecializationType(TemplateName Template,
                                           const TemplateArgumentListInfo &Args,
                                           QualType Underlying) const {
+  TypeCreationGuard Guard(*this);
   assert(!Template.getAsDependentTemplateName() && 
          "No dependent template names here!");
   
@@ -2404,6 +2520,7 @@ ASTContext::getTemplateSpecializationType(TemplateName Template,
                                           const TemplateArgument *Args,
                                           unsigned NumArgs,
                                           QualType Underlying) const {
+  TypeCreationGuard Guard(*this);
   assert(!Template.getAsDependentTemplateName() && 
          "No dependent template names here!");
   // Look through qualified template names.
@@ -2445,6 +2562,7 @@ QualType
 ASTContext::getCanonicalTemplateSpecializationType(TemplateName Template,
                                                    const TemplateArgument *Args,
                                                    unsigned NumArgs) const {
+  TypeCreationGuard Guard(*this);
   assert(!Template.getAsDependentTemplateName() && 
          "No dependent template names here!");
   assert((!Template.getAsTemplateDecl() ||
@@ -2493,6 +2611,7 @@ QualType
 ASTContext::getElaboratedType(ElaboratedTypeKeyword Keyword,
                               NestedNameSpecifier *NNS,
                               QualType NamedType) const {
+  TypeCreationGuard Guard(*this);
   llvm::FoldingSetNodeID ID;
   ElaboratedType::Profile(ID, Keyword, NNS, NamedType);
 
@@ -2517,6 +2636,7 @@ ASTContext::getElaboratedType(ElaboratedTypeKeyword Keyword,
 
 QualType
 ASTContext::getParenType(QualType InnerType) const {
+  TypeCreationGuard Guard(*this);
   llvm::FoldingSetNodeID ID;
   ParenType::Profile(ID, InnerType);
 
@@ -2543,6 +2663,7 @@ QualType ASTContext::getDependentNameType(ElaboratedTypeKeyword Keyword,
                                           NestedNameSpecifier *NNS,
                                           const IdentifierInfo *Name,
                                           QualType Canon) const {
+  TypeCreationGuard Guard(*this);
   assert(NNS->isDependent() && "nested-name-specifier must be dependent");
 
   if (Canon.isNull()) {
@@ -2576,6 +2697,7 @@ ASTContext::getDependentTemplateSpecializationType(
                                  NestedNameSpecifier *NNS,
                                  const IdentifierInfo *Name,
                                  const TemplateArgumentListInfo &Args) const {
+  TypeCreationGuard Guard(*this);
   // TODO: avoid this copy
   SmallVector<TemplateArgument, 16> ArgCopy;
   for (unsigned I = 0, E = Args.size(); I != E; ++I)
@@ -2592,6 +2714,7 @@ ASTContext::getDependentTemplateSpecializationType(
                                  const IdentifierInfo *Name,
                                  unsigned NumArgs,
                                  const TemplateArgument *Args) const {
+  TypeCreationGuard Guard(*this);
   assert((!NNS || NNS->isDependent()) && 
          "nested-name-specifier must be dependent");
 
@@ -2640,6 +2763,7 @@ ASTContext::getDependentTemplateSpecializationType(
 
 QualType ASTContext::getPackExpansionType(QualType Pattern,
                                       llvm::Optional<unsigned> NumExpansions) {
+  TypeCreationGuard Guard(*this);
   llvm::FoldingSetNodeID ID;
   PackExpansionType::Profile(ID, Pattern, NumExpansions);
 
@@ -2697,6 +2821,7 @@ static void SortAndUniqueProtocols(ObjCProtocolDecl **Protocols,
 QualType ASTContext::getObjCObjectType(QualType BaseType,
                                        ObjCProtocolDecl * const *Protocols,
                                        unsigned NumProtocols) const {
+  TypeCreationGuard Guard(*this);
   // If the base type is an interface and there aren't any protocols
   // to add, then the interface type will do just fine.
   if (!NumProtocols && isa<ObjCInterfaceType>(BaseType))
@@ -2745,6 +2870,7 @@ QualType ASTContext::getObjCObjectType(QualType BaseType,
 /// getObjCObjectPointerType - Return a ObjCObjectPointerType type for
 /// the given object type.
 QualType ASTContext::getObjCObjectPointerType(QualType ObjectT) const {
+  TypeCreationGuard Guard(*this);
   llvm::FoldingSetNodeID ID;
   ObjCObjectPointerType::Profile(ID, ObjectT);
 
@@ -2775,6 +2901,7 @@ QualType ASTContext::getObjCObjectPointerType(QualType ObjectT) const {
 /// getObjCInterfaceType - Return the unique reference to the type for the
 /// specified ObjC interface decl. The list of protocols is optional.
 QualType ASTContext::getObjCInterfaceType(const ObjCInterfaceDecl *Decl) const {
+  TypeCreationGuard Guard(*this);
   if (Decl->TypeForDecl)
     return QualType(Decl->TypeForDecl, 0);
 
@@ -2792,6 +2919,7 @@ QualType ASTContext::getObjCInterfaceType(const ObjCInterfaceDecl *Decl) const {
 /// DeclRefExpr's. This doesn't effect the type checker, since it operates
 /// on canonical type's (which are always unique).
 QualType ASTContext::getTypeOfExprType(Expr *tofExpr) const {
+  TypeCreationGuard Guard(*this);
   TypeOfExprType *toe;
   if (tofExpr->isTypeDependent()) {
     llvm::FoldingSetNodeID ID;
@@ -2826,6 +2954,7 @@ QualType ASTContext::getTypeOfExprType(Expr *tofExpr) const {
 /// an issue. This doesn't effect the type checker, since it operates
 /// on canonical type's (which are always unique).
 QualType ASTContext::getTypeOfType(QualType tofType) const {
+  TypeCreationGuard Guard(*this);
   QualType Canonical = getCanonicalType(tofType);
   TypeOfType *tot = new (*this, TypeAlignment) TypeOfType(tofType, Canonical);
   Types.push_back(tot);
@@ -2870,6 +2999,7 @@ static QualType getDecltypeForExpr(const Expr *e, const ASTContext &Context) {
 /// an issue. This doesn't effect the type checker, since it operates
 /// on canonical type's (which are always unique).
 QualType ASTContext::getDecltypeType(Expr *e) const {
+  TypeCreationGuard Guard(*this);
   DecltypeType *dt;
   
   // C++0x [temp.type]p2:
@@ -2908,6 +3038,7 @@ QualType ASTContext::getUnaryTransformType(QualType BaseType,
                                            QualType UnderlyingType,
                                            UnaryTransformType::UTTKind Kind)
     const {
+  TypeCreationGuard Guard(*this);
   UnaryTransformType *Ty =
     new (*this, TypeAlignment) UnaryTransformType (BaseType, UnderlyingType, 
                                                    Kind,
@@ -2919,6 +3050,7 @@ QualType ASTContext::getUnaryTransformType(QualType BaseType,
 
 /// getAutoType - We only unique auto types after they've been deduced.
 QualType ASTContext::getAutoType(QualType DeducedType) const {
+  TypeCreationGuard Guard(*this);
   void *InsertPos = 0;
   if (!DeducedType.isNull()) {
     // Look in the folding set for an existing type.
@@ -2938,6 +3070,7 @@ QualType ASTContext::getAutoType(QualType DeducedType) const {
 /// getAtomicType - Return the uniqued reference to the atomic type for
 /// the given value type.
 QualType ASTContext::getAtomicType(QualType T) const {
+  TypeCreationGuard Guard(*this);
   // Unique pointers, to guarantee there is only one pointer of a particular
   // structure.
   llvm::FoldingSetNodeID ID;
@@ -4834,6 +4967,7 @@ TemplateName
 ASTContext::getQualifiedTemplateName(NestedNameSpecifier *NNS,
                                      bool TemplateKeyword,
                                      TemplateDecl *Template) const {
+  TypeCreationGuard Guard(*this);
   assert(NNS && "Missing nested-name-specifier in qualified template name");
   
   // FIXME: Canonicalization?
@@ -4856,6 +4990,7 @@ ASTContext::getQualifiedTemplateName(NestedNameSpecifier *NNS,
 TemplateName
 ASTContext::getDependentTemplateName(NestedNameSpecifier *NNS,
                                      const IdentifierInfo *Name) const {
+  TypeCreationGuard Guard(*this);
   assert((!NNS || NNS->isDependent()) &&
          "Nested name specifier must be dependent");
 
@@ -4890,6 +5025,7 @@ ASTContext::getDependentTemplateName(NestedNameSpecifier *NNS,
 TemplateName 
 ASTContext::getDependentTemplateName(NestedNameSpecifier *NNS,
                                      OverloadedOperatorKind Operator) const {
+  TypeCreationGuard Guard(*this);
   assert((!NNS || NNS->isDependent()) &&
          "Nested name specifier must be dependent");
   
@@ -4923,6 +5059,7 @@ ASTContext::getDependentTemplateName(NestedNameSpecifier *NNS,
 TemplateName 
 ASTContext::getSubstTemplateTemplateParm(TemplateTemplateParmDecl *param,
                                          TemplateName replacement) const {
+  TypeCreationGuard Guard(*this);
   llvm::FoldingSetNodeID ID;
   SubstTemplateTemplateParmStorage::Profile(ID, param, replacement);
   
@@ -4941,6 +5078,7 @@ ASTContext::getSubstTemplateTemplateParm(TemplateTemplateParmDecl *param,
 TemplateName 
 ASTContext::getSubstTemplateTemplateParmPack(TemplateTemplateParmDecl *Param,
                                        const TemplateArgument &ArgPack) const {
+  TypeCreationGuard Guard(*this);
   ASTContext &Self = const_cast<ASTContext &>(*this);
   llvm::FoldingSetNodeID ID;
   SubstTemplateTemplateParmPackStorage::Profile(ID, Self, Param, ArgPack);
@@ -6578,6 +6716,7 @@ CXXABI::~CXXABI() {}
 size_t ASTContext::getSideTableAllocatedMemory() const {
   return ASTRecordLayouts.getMemorySize()
     + llvm::capacity_in_bytes(ObjCLayouts)
+    + llvm::capacity_in_bytes(ConstantValues)
     + llvm::capacity_in_bytes(KeyFunctions)
     + llvm::capacity_in_bytes(ObjCImpls)
     + llvm::capacity_in_bytes(BlockVarCopyInits)
@@ -1475,7 +1475,7 @@ bool FunctionDecl::isVariadic() const {
 
 bool FunctionDecl::hasBody(const FunctionDecl *&Definition) const {
   for (redecl_iterator I = redecls_begin(), E = redecls_end(); I != E; ++I) {
-    if (I->Body || I->IsLateTemplateParsed) {
+    if (I->Body || I->IsLateTemplateParsed || I->HasSkippedBody) {
       Definition = *I;
       return true;
     }
@@ -1500,7 +1500,8 @@ bool FunctionDecl::hasTrivialBody() const
 
 bool FunctionDecl::isDefined(const FunctionDecl *&Definition) const {
   for (redecl_iterator I = redecls_begin(), E = redecls_end(); I != E; ++I) {
-    if (I->IsDeleted || I->IsDefaulted || I->Body || I->IsLateTemplateParsed) {
+    if (I->IsDeleted || I->IsDefaulted || I->Body || I->IsLateTemplateParsed ||
+        I->HasSkippedBody) {
       Definition = I->IsDeleted ? I->getCanonicalDecl() : *I;
       return true;
     }
@@ -1517,6 +1518,15 @@ Stmt *FunctionDecl::getBody(const FunctionDecl *&Definition) const {
     } else if (I->IsLateTemplateParsed) {
       Definition = *I;
       return 0;
+    } else if (I->HasSkippedBody) {
+      // The parser only parses a skipped body between top-level declarations,
+      // so callers asking for it from anywhere else get a null body, as they
+      // do for a late-parsed template, and must cope with that.
+      Definition = *I;
+      ASTContext &Context = getASTContext();
+      if (Context.LazyBodyParser)
+        Context.LazyBodyParser(Context.OpaqueLazyBodyParser, *I);
+      return I->Body.get(Context.getExternalSource());
     }
   }
 
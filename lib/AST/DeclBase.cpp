@@ -1277,6 +1277,119 @@ void StoredDeclsMap::DestroyAll(StoredDeclsMap *Map, bool Dependent) {
   }
 }
 
+//===----------------------------------------------------------------------===//
+// StoredDeclsMap lookups.                                                    //
+//===----------------------------------------------------------------------===//
+
+unsigned StoredDeclsMap::findSlot(DeclarationName Name) {
+  unsigned Mask = Index.size() - 1;
+  unsigned Slot = llvm::DenseMapInfo<DeclarationName>::getHashValue(Name);
+  unsigned Probes = 1;
+  for (Slot &= Mask; Index[Slot] && Entries[Index[Slot] - 1].first != Name;
+       Slot = (Slot + 1) & Mask)
+    ++Probes;
+
+  NumProbes += Probes;
+  MaxProbes = std::max(MaxProbes, Probes);
+  return Slot;
+}
+
+void StoredDeclsMap::rebuildIndex() {
+  // Keep the index at most half full.
+  unsigned NumSlots = 4 * MaxLinearEntries;
+  while (NumSlots < 2 * Entries.size())
+    NumSlots <<= 1;
+
+  // Make room for every entry up to the next rebuild, so that adding one
+  // doesn't copy the others in between.
+  Entries.reserve(NumSlots / 2 + 1);
+
+  Index.assign(NumSlots, 0);
+  unsigned Mask = NumSlots - 1;
+  for (unsigned I = 0, N = Entries.size(); I != N; ++I) {
+    DeclarationName Name = Entries[I].first;
+    unsigned Slot = llvm::DenseMapInfo<DeclarationName>::getHashValue(Name);
+    for (Slot &= Mask; Index[Slot]; Slot = (Slot + 1) & Mask)
+      ;
+    Index[Slot] = I + 1;
+  }
+}
+
+StoredDeclsMap::iterator StoredDeclsMap::find(DeclarationName Name) {
+  ++NumLookups;
+  if (Index.empty()) {
+    unsigned Probes = 0;
+    iterator I = Entries.begin(), E = Entries.end();
+    for (; I != E; ++I) {
+      ++Probes;
+      if (I->first == Name)
+        break;
+    }
+    NumProbes += Probes;
+    MaxProbes = std::max(MaxProbes, Probes);
+    return I;
+  }
+
+  unsigned Slot = findSlot(Name);
+  if (!Index[Slot])
+    return Entries.end();
+  return Entries.begin() + (Index[Slot] - 1);
+}
+
+StoredDeclsList &StoredDeclsMap::operator[](DeclarationName Name) {
+  if (Index.empty()) {
+    iterator I = find(Name);
+    if (I != Entries.end())
+      return I->second;
+
+    Entries.push_back(value_type(Name, StoredDeclsList()));
+    if (Entries.size() > MaxLinearEntries)
+      rebuildIndex();
+    return Entries.back().second;
+  }
+
+  ++NumLookups;
+  unsigned Slot = findSlot(Name);
+  if (Index[Slot])
+    return Entries[Index[Slot] - 1].second;
+
+  Entries.push_back(value_type(Name, StoredDeclsList()));
+  Index[Slot] = Entries.size();
+  if (2 * Entries.size() > Index.size())
+    rebuildIndex();
+  return Entries.back().second;
+}
+
+void StoredDeclsMap::PrintStats(StoredDeclsMap *Map) {
+  unsigned NumTables = 0, NumIndexed = 0, NumEntries = 0, MaxEntries = 0;
+  unsigned NumIndexSlots = 0;
+  uint64_t NumBytes = 0, NumLookups = 0, NumProbes = 0;
+  unsigned MaxProbes = 0;
+  for (; Map; Map = Map->Previous.getPointer()) {
+    ++NumTables;
+    NumEntries += Map->Entries.size();
+    MaxEntries = std::max(MaxEntries, unsigned(Map->Entries.size()));
+    NumBytes += Map->Entries.capacity() * sizeof(value_type) +
+                Map->Index.capacity() * sizeof(unsigned);
+    if (!Map->Index.empty()) {
+      ++NumIndexed;
+      NumIndexSlots += Map->Index.size();
+    }
+    NumLookups += Map->NumLookups;
+    NumProbes += Map->NumProbes;
+    MaxProbes = std::max(MaxProbes, Map->MaxProbes);
+  }
+
+  llvm::errs() << "\n*** Lookup Table Stats:\n";
+  llvm::errs() << "  " << NumTables << " lookup tables, " << NumIndexed
+               << " of them indexed (" << NumIndexSlots << " index slots).\n";
+  llvm::errs() << "  " << NumEntries << " names, " << MaxEntries
+               << " in the largest table.\n";
+  llvm::errs() << "  " << NumBytes << " bytes in entries and indexes.\n";
+  llvm::errs() << "  " << NumLookups << " lookups, " << NumProbes
+               << " probes, at most " << MaxProbes << " for one lookup.\n";
+}
+
 DependentDiagnostic *DependentDiagnostic::Create(ASTContext &C,
                                                  DeclContext *Parent,
                                            const PartialDiagnostic &PDiag) {
@@ -57,8 +57,13 @@ namespace {
       return &i->second;
     }
 
+    /// DependsOnDecls - Set when a value read while evaluating depends on a
+    /// declaration or an opaque value, which means it may not be the same
+    /// the next time, and so mustn't be cached in the ASTContext.
+    bool DependsOnDecls;
+
     EvalInfo(const ASTContext &ctx, Expr::EvalResult &evalresult)
-      : Ctx(ctx), EvalResult(evalresult) {}
+      : Ctx(ctx), EvalResult(evalresult), DependsOnDecls(false) {}
 
     const LangOptions &getLangOpts() { return Ctx.getLangOptions(); }
   };
@@ -436,6 +441,7 @@ public:
   }
 
   RetTy VisitOpaqueValueExpr(const OpaqueValueExpr *E) {
+    Info.DependsOnDecls = true;
     const APValue *value = Info.getOpaqueValue(E);
     if (!value)
       return (E->getSourceExpr() ? StmtVisitorTy::Visit(E->getSourceExpr())
@@ -522,6 +528,7 @@ static bool EvaluateLValue(const Expr* E, LValue& Result, EvalInfo &Info) {
 }
 
 bool LValueExprEvaluator::VisitDeclRefExpr(const DeclRefExpr *E) {
+  Info.DependsOnDecls = true;
   if (isa<FunctionDecl>(E->getDecl())) {
     return Success(E);
   } else if (const VarDecl* VD = dyn_cast<VarDecl>(E->getDecl())) {
@@ -984,6 +991,8 @@ public:
   IntExprEvaluator(EvalInfo &info, APValue &result)
     : ExprEvaluatorBaseTy(info), Result(result) {}
 
+  bool Visit(const Expr *E);
+
   bool Success(const llvm::APSInt &SI, const Expr *E) {
     assert(E->getType()->isIntegralOrEnumerationType() &&
            "Invalid evaluation result.");
@@ -1113,6 +1122,48 @@ private:
 };
 } // end anonymous namespace
 
+/// isCacheableConstant - Whether the value of E may be kept in the
+/// ASTContext.  Only nodes which are always allocated in the ASTContext
+/// qualify: Sema builds some temporary casts, literals and unary operators on
+/// the stack, and another node could later take the same address.
+static bool isCacheableConstant(const Expr *E) {
+  switch (E->getStmtClass()) {
+  case Stmt::BinaryOperatorClass:
+    return !cast<BinaryOperator>(E)->isAssignmentOp();
+  case Stmt::ConditionalOperatorClass:
+  case Stmt::ParenExprClass:
+  case Stmt::CStyleCastExprClass:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool IntExprEvaluator::Visit(const Expr *E) {
+  if (!isCacheableConstant(E))
+    return StmtVisitorTy::Visit(E);
+
+  if (const APSInt *Known = Info.Ctx.getCachedConstantValue(E))
+    return Success(*Known, E);
+
+  // Evaluate E on its own, so that we can tell whether anything it read
+  // makes its value unfit for caching.
+  bool OuterDependsOnDecls = Info.DependsOnDecls;
+  bool OuterHasSideEffects = Info.EvalResult.HasSideEffects;
+  bool HadDiag = Info.EvalResult.Diag != 0;
+  Info.DependsOnDecls = false;
+  Info.EvalResult.HasSideEffects = false;
+
+  bool Ok = StmtVisitorTy::Visit(E);
+  if (Ok && Result.isInt() && !Info.DependsOnDecls &&
+      !Info.EvalResult.HasSideEffects && !HadDiag && !Info.EvalResult.Diag)
+    Info.Ctx.setCachedConstantValue(E, Result.getInt());
+
+  Info.DependsOnDecls |= OuterDependsOnDecls;
+  Info.EvalResult.HasSideEffects |= OuterHasSideEffects;
+  return Ok;
+}
+
 static bool EvaluateIntegerOrLValue(const Expr* E, APValue &Result, EvalInfo &Info) {
   assert(E->getType()->isIntegralOrEnumerationType());
   return IntExprEvaluator(Info, Result).Visit(E);
@@ -1131,6 +1182,10 @@ static bool EvaluateInteger(const Expr* E, APSInt &Result, EvalInfo &Info) {
 bool IntExprEvaluator::CheckReferencedDecl(const Expr* E, const Decl* D) {
   // Enums are integer constant exprs.
   if (const EnumConstantDecl *ECD = dyn_cast<EnumConstantDecl>(D)) {
+    // The values of the enumerators are only final once the enum is.
+    if (!cast<EnumDecl>(ECD->getDeclContext())->isCompleteDefinition())
+      Info.DependsOnDecls = true;
+
     // Check for signedness/width mismatches between E type and ECD value.
     bool SameSign = (ECD->getInitVal().isSigned()
                      == E->getType()->isSignedIntegerOrEnumerationType());
@@ -1150,6 +1205,8 @@ bool IntExprEvaluator::CheckReferencedDecl(const Expr* E, const Decl* D) {
     }
   }
 
+  Info.DependsOnDecls = true;
+
   // In C++, const, non-volatile integers initialized with ICEs are ICEs.
   // In C, they can also be folded, although they are not ICEs.
   if (Info.Ctx.getCanonicalType(E->getType()).getCVRQualifiers() 
@@ -1287,6 +1344,10 @@ bool IntExprEvaluator::TryEvaluateBuiltinObjectSize(const CallExpr *E) {
 }
 
 bool IntExprEvaluator::VisitCallExpr(const CallExpr *E) {
+  // __builtin_constant_p and __builtin_object_size look through to
+  // declarations without telling us.
+  Info.DependsOnDecls = true;
+
   switch (E->isBuiltinCall(Info.Ctx)) {
   default:
     return ExprEvaluatorBaseTy::VisitCallExpr(E);
@@ -1634,6 +1695,9 @@ CharUnits IntExprEvaluator::GetAlignOfExpr(const Expr *E) {
 
   // alignof decl is always accepted, even if it doesn't make sense: we default
   // to 1 in those cases.
+  if (isa<DeclRefExpr>(E) || isa<MemberExpr>(E))
+    Info.DependsOnDecls = true;
+
   if (const DeclRefExpr *DRE = dyn_cast<DeclRefExpr>(E))
     return Info.Ctx.getDeclAlign(DRE->getDecl(), 
                                  /*RefAsPointee*/true);
@@ -2083,6 +2147,7 @@ bool FloatExprEvaluator::VisitCallExpr(const CallExpr *E) {
 }
 
 bool FloatExprEvaluator::VisitDeclRefExpr(const DeclRefExpr *E) {
+  Info.DependsOnDecls = true;
   if (ExprEvaluatorBaseTy::VisitDeclRefExpr(E))
     return true;
 
@@ -46,20 +46,47 @@ void Builtin::Context::InitializeTarget(const TargetInfo &Target) {
 /// InitializeBuiltins - Mark the identifiers for all the builtins with their
 /// appropriate builtin ID # and mark any non-portable builtin identifiers as
 /// such.
+///
+/// Unless an external source provides identifiers, the builtins are kept in
+/// a perfect hash index and only marked on identifiers as they are created,
+/// rather than creating an identifier for each of them up front.
 void Builtin::Context::InitializeBuiltins(IdentifierTable &Table,
                                           const LangOptions& LangOpts) {
+  std::vector<StringRef> Names;
+  IndexedIDs.clear();
+
   // Step #1: mark all target-independent builtins with their ID's.
   for (unsigned i = Builtin::NotBuiltin+1; i != Builtin::FirstTSBuiltin; ++i)
     if (!LangOpts.NoBuiltin || !strchr(BuiltinInfo[i].Attributes, 'f')) {
       if (LangOpts.ObjC1 || 
-          BuiltinInfo[i].builtin_lang != clang::OBJC_LANG)
-        Table.get(BuiltinInfo[i].Name).setBuiltinID(i);
+          BuiltinInfo[i].builtin_lang != clang::OBJC_LANG) {
+        Names.push_back(BuiltinInfo[i].Name);
+        IndexedIDs.push_back(i);
+      }
     }
 
   // Step #2: Register target-specific builtins.
   for (unsigned i = 0, e = NumTSRecords; i != e; ++i)
-    if (!LangOpts.NoBuiltin || !strchr(TSRecords[i].Attributes, 'f'))
-      Table.get(TSRecords[i].Name).setBuiltinID(i+Builtin::FirstTSBuiltin);
+    if (!LangOpts.NoBuiltin || !strchr(TSRecords[i].Attributes, 'f')) {
+      Names.push_back(TSRecords[i].Name);
+      IndexedIDs.push_back(i+Builtin::FirstTSBuiltin);
+    }
+
+  // Identifiers from an external source may be created without the table
+  // seeing them, so they have to be marked now.
+  if (Table.getExternalIdentifierLookup()) {
+    for (unsigned i = 0, e = Names.size(); i != e; ++i)
+      Table.get(Names[i]).setBuiltinID(IndexedIDs[i]);
+    NameIndex.build(ArrayRef<StringRef>());
+    IndexedIDs.clear();
+    return;
+  }
+
+  // A name given twice gets the last ID, as if each had been marked in turn.
+  NameIndex.build(Names);
+  for (unsigned i = 0, e = Names.size(); i != e; ++i)
+    IndexedIDs[NameIndex.lookup(Names[i])] = IndexedIDs[i];
+  Table.setBuiltinInfo(this);
 }
 
 void
@@ -54,6 +54,9 @@ DiagnosticsEngine::DiagnosticsEngine(
   ErrorLimit = 0;
   TemplateBacktraceLimit = 0;
 
+  NumLevelQueries = NumGloballyIgnoredQueries = 0;
+  NumStatePointCacheHits = 0;
+
   Reset();
 }
 
@@ -110,6 +113,8 @@ void DiagnosticsEngine::Reset() {
   DiagStates.clear();
   DiagStatePoints.clear();
   DiagStateOnPushStack.clear();
+  GloballyIgnored.reset();
+  MappedByPragma.reset();
 
   // Create a DiagState and DiagStatePoint representing diagnostic changes
   // through command-line.
@@ -144,16 +149,83 @@ DiagnosticsEngine::GetDiagStatePointForLoc(SourceLocation L) const {
   if (Loc.isInvalid())
     return DiagStatePoints.end() - 1;
 
-  DiagStatePointsTy::iterator Pos = DiagStatePoints.end();
   FullSourceLoc LastStateChangePos = DiagStatePoints.back().Loc;
-  if (LastStateChangePos.isValid() &&
-      Loc.isBeforeInTranslationUnitThan(LastStateChangePos))
+  if (LastStateChangePos.isInvalid())
+    return DiagStatePoints.end() - 1;
+
+  std::pair<FileID, unsigned> Decomposed;
+  if (L.isFileID()) {
+    Decomposed = SourceMgr->getDecomposedLoc(L);
+    if (Decomposed.first == CachedStateFID &&
+        Decomposed.second >= CachedStateBegin &&
+        Decomposed.second < CachedStateEnd) {
+      ++NumStatePointCacheHits;
+      return DiagStatePoints.begin() + CachedStatePoint;
+    }
+  }
+
+  DiagStatePointsTy::iterator Pos = DiagStatePoints.end();
+  if (Loc.isBeforeInTranslationUnitThan(LastStateChangePos))
     Pos = std::upper_bound(DiagStatePoints.begin(), DiagStatePoints.end(),
                            DiagStatePoint(0, Loc));
   --Pos;
+
+  // The rest of this file up to the next state point, if that is in this
+  // file too, has the same state; remember that for the next query.
+  if (L.isFileID()) {
+    CachedStateFID = Decomposed.first;
+    CachedStateBegin = Decomposed.second;
+    if (Pos->Loc.isValid() && Pos->Loc.isFileID()) {
+      std::pair<FileID, unsigned> PosInfo
+        = SourceMgr->getDecomposedLoc(Pos->Loc);
+      if (PosInfo.first == Decomposed.first)
+        CachedStateBegin = PosInfo.second;
+    }
+
+    DiagStatePointsTy::iterator Next = Pos + 1;
+    CachedStateEnd = Decomposed.second + 1;
+    if (Next == DiagStatePoints.end())
+      CachedStateEnd = ~0U;
+    else if (Next->Loc.isFileID()) {
+      std::pair<FileID, unsigned> NextInfo
+        = SourceMgr->getDecomposedLoc(Next->Loc);
+      if (NextInfo.first == Decomposed.first)
+        CachedStateEnd = NextInfo.second;
+    }
+    CachedStatePoint = Pos - DiagStatePoints.begin();
+  }
   return Pos;
 }
 
+void DiagnosticsEngine::setGloballyIgnored(unsigned DiagID) const {
+  if (DiagID < MappedByPragma.size() && MappedByPragma[DiagID])
+    return;
+  if (GloballyIgnored.empty())
+    GloballyIgnored.resize(diag::DIAG_UPPER_LIMIT);
+  GloballyIgnored.set(DiagID);
+}
+
+void DiagnosticsEngine::mappingChanged(diag::kind Diag, bool IsPragma) {
+  if (Diag < GloballyIgnored.size())
+    GloballyIgnored.reset(Diag);
+
+  // Until the first pragma, every mapping change applies to all states.
+  if (IsPragma || DiagStatePoints.size() > 1) {
+    if (MappedByPragma.empty())
+      MappedByPragma.resize(diag::DIAG_UPPER_LIMIT);
+    MappedByPragma.set(Diag);
+  }
+}
+
+void DiagnosticsEngine::PrintStats() const {
+  llvm::errs() << "\n*** Diagnostic Stats:\n";
+  llvm::errs() << NumLevelQueries << " diagnostic level queries, "
+               << NumGloballyIgnoredQueries << " answered as ignored "
+               << "everywhere.\n";
+  llvm::errs() << NumStatePointCacheHits
+               << " diagnostic state lookups answered from the file cache.\n";
+}
+
 /// \brief This allows the client to specify that certain
 /// warnings are ignored.  Notes can never be mapped, errors can only be
 /// mapped to fatal, and WARNINGs and EXTENSIONs can be mapped arbitrarily.
@@ -170,6 +242,7 @@ void DiagnosticsEngine::setDiagnosticMapping(diag::kind Diag, diag::Mapping Map,
   assert(!DiagStatePoints.empty());
 
   bool isPragma = L.isValid();
+  mappingChanged(Diag, isPragma);
   FullSourceLoc Loc(L, *SourceMgr);
   FullSourceLoc LastStateChangePos = DiagStatePoints.back().Loc;
   DiagnosticMappingInfo MappingInfo = DiagnosticMappingInfo::Make(
@@ -227,6 +300,7 @@ void DiagnosticsEngine::setDiagnosticMapping(diag::kind Diag, diag::Mapping Map,
   GetCurDiagState()->setMappingInfo(Diag, MappingInfo);
   DiagStatePoints.insert(Pos+1, DiagStatePoint(NewState,
                                                FullSourceLoc(Loc, *SourceMgr)));
+  CachedStateFID = FileID();
 }
 
 bool DiagnosticsEngine::setDiagnosticGroupMapping(
@@ -261,6 +335,7 @@ bool DiagnosticsEngine::setDiagnosticGroupWarningAsError(StringRef Group,
 
   // Perform the mapping change.
   for (unsigned i = 0, e = GroupDiags.size(); i != e; ++i) {
+    mappingChanged(GroupDiags[i], /*IsPragma=*/false);
     DiagnosticMappingInfo &Info = GetCurDiagState()->getOrAddMappingInfo(
       GroupDiags[i]);
 
@@ -291,6 +366,7 @@ bool DiagnosticsEngine::setDiagnosticGroupErrorAsFatal(StringRef Group,
 
   // Perform the mapping change.
   for (unsigned i = 0, e = GroupDiags.size(); i != e; ++i) {
+    mappingChanged(GroupDiags[i], /*IsPragma=*/false);
     DiagnosticMappingInfo &Info = GetCurDiagState()->getOrAddMappingInfo(
       GroupDiags[i]);
 
@@ -521,6 +521,14 @@ DiagnosticIDs::getDiagnosticLevel(unsigned DiagID, unsigned DiagClass,
   // to error.  Errors can only be mapped to fatal.
   DiagnosticIDs::Level Result = DiagnosticIDs::Fatal;
 
+  // Most of the warnings Sema considers are off; answer for those without
+  // finding the diagnostic state of the location.
+  ++Diag.NumLevelQueries;
+  if (Diag.isGloballyIgnored(DiagID)) {
+    ++Diag.NumGloballyIgnoredQueries;
+    return DiagnosticIDs::Ignored;
+  }
+
   DiagnosticsEngine::DiagStatePointsTy::iterator
     Pos = Diag.GetDiagStatePointForLoc(Loc);
   DiagnosticsEngine::DiagState *State = Pos->State;
@@ -577,14 +585,19 @@ DiagnosticIDs::getDiagnosticLevel(unsigned DiagID, unsigned DiagClass,
     }
   }
 
-  // At this point, ignored errors can no longer be upgraded.
-  if (Result == DiagnosticIDs::Ignored)
+  // At this point, ignored errors can no longer be upgraded.  Nothing so far
+  // depended on the location except through its diagnostic state.
+  if (Result == DiagnosticIDs::Ignored) {
+    Diag.setGloballyIgnored(DiagID);
     return Result;
+  }
 
   // Honor -w, which is lower in priority than pedantic-errors, but higher than
   // -Werror.
-  if (Result == DiagnosticIDs::Warning && Diag.IgnoreAllWarnings)
+  if (Result == DiagnosticIDs::Warning && Diag.IgnoreAllWarnings) {
+    Diag.setGloballyIgnored(DiagID);
     return DiagnosticIDs::Ignored;
+  }
 
   // If -Werror is enabled, map warnings to errors unless explicitly disabled.
   if (Result == DiagnosticIDs::Warning) {
@@ -19,6 +19,7 @@
 
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/FileSystemStatCache.h"
+#include "clang/Basic/MappedFileBuffer.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/FileSystem.h"
@@ -30,6 +31,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <fcntl.h>
 
 // FIXME: This is terrible, we need this for ::close.
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
@@ -181,6 +183,7 @@ FileManager::~FileManager() {
 
 void FileManager::addStatCache(FileSystemStatCache *statCache,
                                bool AtBeginning) {
+  llvm::sys::SmartScopedLock<true> Guard(Lock);
   assert(statCache && "No stat cache provided?");
   if (AtBeginning || StatCache.get() == 0) {
     statCache->setNextStatCache(StatCache.take());
@@ -196,6 +199,7 @@ void FileManager::addStatCache(FileSystemStatCache *statCache,
 }
 
 void FileManager::removeStatCache(FileSystemStatCache *statCache) {
+  llvm::sys::SmartScopedLock<true> Guard(Lock);
   if (!statCache)
     return;
   
@@ -266,6 +270,7 @@ void FileManager::addAncestorsAsVirtualDirs(StringRef Path) {
 ///
 const DirectoryEntry *FileManager::getDirectory(StringRef DirName,
                                                 bool CacheFailure) {
+  llvm::sys::SmartScopedLock<true> Guard(Lock);
   ++NumDirLookups;
   llvm::StringMapEntry<DirectoryEntry *> &NamedDirEnt =
     SeenDirEntries.GetOrCreateValue(DirName);
@@ -315,6 +320,7 @@ const DirectoryEntry *FileManager::getDirectory(StringRef DirName,
 ///
 const FileEntry *FileManager::getFile(StringRef Filename, bool openFile,
                                       bool CacheFailure) {
+  llvm::sys::SmartScopedLock<true> Guard(Lock);
   ++NumFileLookups;
 
   // See if there is already an entry in the map.
@@ -396,6 +402,7 @@ const FileEntry *FileManager::getFile(StringRef Filename, bool openFile,
 const FileEntry *
 FileManager::getVirtualFile(StringRef Filename, off_t Size,
                             time_t ModificationTime) {
+  llvm::sys::SmartScopedLock<true> Guard(Lock);
   ++NumFileLookups;
 
   // See if there is already an entry in the map.
@@ -482,16 +489,24 @@ getBufferForFile(const FileEntry *Entry, std::string *ErrorStr) {
   llvm::OwningPtr<llvm::MemoryBuffer> Result;
   llvm::error_code ec;
 
+  // Take the descriptor the file may have been opened with, so that only one
+  // of the threads sharing this file manager reads from it.
+  int FD;
+  {
+    llvm::sys::SmartScopedLock<true> Guard(Lock);
+    FD = Entry->FD;
+    Entry->FD = -1;
+  }
+
   const char *Filename = Entry->getName();
   // If the file is already open, use the open file descriptor.
-  if (Entry->FD != -1) {
-    ec = llvm::MemoryBuffer::getOpenFile(Entry->FD, Filename, Result,
+  if (FD != -1) {
+    ec = llvm::MemoryBuffer::getOpenFile(FD, Filename, Result,
                                          Entry->getSize());
     if (ErrorStr)
       *ErrorStr = ec.message();
 
-    close(Entry->FD);
-    Entry->FD = -1;
+    close(FD);
     return Result.take();
   }
 
@@ -531,6 +546,32 @@ getBufferForFile(StringRef Filename, std::string *ErrorStr) {
   return Result.take();
 }
 
+MappedFileBuffer *FileManager::getMappedBufferForFile(const FileEntry *Entry) {
+  // If the file is already open, use the open file descriptor.
+  int FD;
+  {
+    llvm::sys::SmartScopedLock<true> Guard(Lock);
+    FD = Entry->FD;
+    Entry->FD = -1;
+  }
+  if (FD == -1) {
+    llvm::SmallString<128> FilePath(Entry->getName());
+    FixupRelativePath(FilePath);
+    int OpenFlags = O_RDONLY;
+#ifdef O_BINARY
+    OpenFlags |= O_BINARY;  // Open input file in binary mode on win32.
+#endif
+    FD = ::open(FilePath.c_str(), OpenFlags);
+    if (FD == -1)
+      return 0;
+  }
+
+  MappedFileBuffer *Result =
+    MappedFileBuffer::get(FD, Entry->getName(), Entry->getSize());
+  ::close(FD);
+  return Result;
+}
+
 /// getStatValue - Get the 'stat' information for the specified path,
 /// using the cache to accelerate it if possible.  This returns true
 /// if the path points to a virtual file or does not exist, or returns
@@ -561,6 +602,7 @@ bool FileManager::getNoncachedStatValue(StringRef Path,
 
 void FileManager::GetUniqueIDMapping(
                    SmallVectorImpl<const FileEntry *> &UIDToFiles) const {
+  llvm::sys::SmartScopedLock<true> Guard(Lock);
   UIDToFiles.clear();
   UIDToFiles.resize(NextFileUID);
   
@@ -581,6 +623,7 @@ void FileManager::GetUniqueIDMapping(
 
 
 void FileManager::PrintStats() const {
+  llvm::sys::SmartScopedLock<true> Guard(Lock);
   llvm::errs() << "\n*** File Manager Stats:\n";
   llvm::errs() << UniqueRealFiles.size() << " real files found, "
                << UniqueRealDirs.size() << " real dirs found.\n";
@@ -591,5 +634,9 @@ void FileManager::PrintStats() const {
   llvm::errs() << NumFileLookups << " file lookups, "
                << NumFileCacheMisses << " file cache misses.\n";
 
+  for (FileSystemStatCache *Cache = StatCache.get(); Cache;
+       Cache = Cache->getNextStatCache())
+    Cache->PrintStats();
+
   //llvm::errs() << PagesMapped << BytesOfPagesMapped << FSLookups;
 }
@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Basic/IdentifierTable.h"
+#include "clang/Basic/Builtins.h"
 #include "clang/Basic/LangOptions.h"
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/DenseMap.h"
@@ -69,11 +70,78 @@ ExternalIdentifierLookup::~ExternalIdentifierLookup() {}
 IdentifierTable::IdentifierTable(const LangOptions &LangOpts,
                                  IdentifierInfoLookup* externalLookup)
   : HashTable(8192), // Start with space for 8K identifiers.
-    ExternalLookup(externalLookup) {
+    ExternalLookup(externalLookup), Builtins(0), CompleteVocabulary(false) {
 
-  // Populate the identifier table with info about keywords for the current
-  // language.
+  // Describe the keywords of the current language.  Their identifiers are
+  // only created when first looked up, unless an external lookup has to see
+  // them up front.
   AddKeywords(LangOpts);
+  if (ExternalLookup)
+    AddVocabulary();
+}
+
+void IdentifierTable::setExternalIdentifierLookup(
+                                              IdentifierInfoLookup *IILookup) {
+  // External sources expect to find every keyword and builtin in the table,
+  // as they were before identifiers were created lazily.
+  if (IILookup)
+    AddVocabulary();
+  ExternalLookup = IILookup;
+}
+
+void IdentifierTable::ApplyKeyword(const KeywordRecord &Record,
+                                   IdentifierInfo &II) {
+  if (Record.SetsTokenID) {
+    II.TokenID = Record.TokenID;
+    II.setIsExtensionToken(Record.IsExtension);
+    II.setIsCXX11CompatKeyword(Record.IsCXX11CompatKeyword);
+  }
+  if (Record.IsCPPOperatorKeyword)
+    II.setIsCPlusPlusOperatorKeyword();
+  if (Record.ObjCKeywordID)
+    II.setObjCKeywordID(tok::ObjCKeywordKind(Record.ObjCKeywordID));
+}
+
+void IdentifierTable::InitializeIdentifier(IdentifierInfo &II) {
+  StringRef Name = II.getName();
+  int Keyword = KeywordIndex.lookup(Name);
+  if (Keyword >= 0)
+    ApplyKeyword(Keywords[Keyword], II);
+
+  if (Builtins)
+    if (unsigned ID = Builtins->getBuiltinIDForName(Name))
+      II.setBuiltinID(ID);
+}
+
+void IdentifierTable::setBuiltinInfo(const Builtin::Context *BuiltinInfo) {
+  Builtins = BuiltinInfo;
+  CompleteVocabulary = false;
+  if (!Builtins)
+    return;
+
+  for (HashTableTy::iterator I = HashTable.begin(), E = HashTable.end();
+       I != E; ++I)
+    if (unsigned ID = Builtins->getBuiltinIDForName(I->getKey()))
+      I->getValue()->setBuiltinID(ID);
+
+  if (ExternalLookup)
+    AddVocabulary();
+}
+
+void IdentifierTable::AddVocabulary() {
+  if (CompleteVocabulary)
+    return;
+
+  for (unsigned i = 0, e = Keywords.size(); i != e; ++i)
+    getOwn(Keywords[i].Name);
+
+  if (Builtins) {
+    ArrayRef<StringRef> Names = Builtins->getEnabledBuiltinNames();
+    for (unsigned i = 0, e = Names.size(); i != e; ++i)
+      getOwn(Names[i]);
+  }
+
+  CompleteVocabulary = true;
 }
 
 //===----------------------------------------------------------------------===//
@@ -99,6 +167,21 @@ namespace {
   };
 }
 
+typedef std::vector<IdentifierTable::KeywordRecord> KeywordRecordList;
+
+/// getKeywordRecord - Return a record for \p Name which changes nothing.
+static IdentifierTable::KeywordRecord getKeywordRecord(StringRef Name) {
+  IdentifierTable::KeywordRecord Record;
+  Record.Name = Name;
+  Record.TokenID = tok::identifier;
+  Record.ObjCKeywordID = tok::objc_not_keyword;
+  Record.SetsTokenID = false;
+  Record.IsExtension = false;
+  Record.IsCXX11CompatKeyword = false;
+  Record.IsCPPOperatorKeyword = false;
+  return Record;
+}
+
 /// AddKeyword - This method is used to associate a token ID with specific
 /// identifiers because they are language keywords.  This causes the lexer to
 /// automatically map matching identifiers to specialized token codes.
@@ -109,7 +192,8 @@ namespace {
 /// language, and set to 0 if disabled in the specified language.
 static void AddKeyword(StringRef Keyword,
                        tok::TokenKind TokenCode, unsigned Flags,
-                       const LangOptions &LangOpts, IdentifierTable &Table) {
+                       const LangOptions &LangOpts,
+                       KeywordRecordList &Records) {
   unsigned AddResult = 0;
   if (Flags == KEYALL) AddResult = 2;
   else if (LangOpts.CPlusPlus && (Flags & KEYCXX)) AddResult = 2;
@@ -129,54 +213,101 @@ static void AddKeyword(StringRef Keyword,
   // Don't add this keyword if disabled in this language.
   if (AddResult == 0) return;
 
-  IdentifierInfo &Info =
-      Table.get(Keyword, AddResult == 3 ? tok::identifier : TokenCode);
-  Info.setIsExtensionToken(AddResult == 1);
-  Info.setIsCXX11CompatKeyword(AddResult == 3);
+  IdentifierTable::KeywordRecord Record = getKeywordRecord(Keyword);
+  Record.TokenID = AddResult == 3 ? tok::identifier : TokenCode;
+  Record.SetsTokenID = true;
+  Record.IsExtension = AddResult == 1;
+  Record.IsCXX11CompatKeyword = AddResult == 3;
+  Records.push_back(Record);
 }
 
 /// AddCXXOperatorKeyword - Register a C++ operator keyword alternative
 /// representations.
 static void AddCXXOperatorKeyword(StringRef Keyword,
                                   tok::TokenKind TokenCode,
-                                  IdentifierTable &Table) {
-  IdentifierInfo &Info = Table.get(Keyword, TokenCode);
-  Info.setIsCPlusPlusOperatorKeyword();
+                                  KeywordRecordList &Records) {
+  IdentifierTable::KeywordRecord Record = getKeywordRecord(Keyword);
+  Record.TokenID = TokenCode;
+  Record.SetsTokenID = true;
+  Record.IsCPPOperatorKeyword = true;
+  Records.push_back(Record);
 }
 
 /// AddObjCKeyword - Register an Objective-C @keyword like "class" "selector" or
 /// "property".
 static void AddObjCKeyword(StringRef Name,
                            tok::ObjCKeywordKind ObjCID,
-                           IdentifierTable &Table) {
-  Table.get(Name).setObjCKeywordID(ObjCID);
+                           KeywordRecordList &Records) {
+  IdentifierTable::KeywordRecord Record = getKeywordRecord(Name);
+  Record.ObjCKeywordID = ObjCID;
+  Records.push_back(Record);
 }
 
 /// AddKeywords - Add all keywords to the symbol table.
 ///
+/// The keywords are kept in a perfect hash index which is only consulted when
+/// an identifier is created, so that the table doesn't start out with
+/// hundreds of identifiers most translation units never use.
 void IdentifierTable::AddKeywords(const LangOptions &LangOpts) {
+  KeywordRecordList Records(Keywords);
+  unsigned FirstNewRecord = Records.size();
+
   // Add keywords and tokens for the current language.
 #define KEYWORD(NAME, FLAGS) \
   AddKeyword(StringRef(#NAME), tok::kw_ ## NAME,  \
-             FLAGS, LangOpts, *this);
+             FLAGS, LangOpts, Records);
 #define ALIAS(NAME, TOK, FLAGS) \
   AddKeyword(StringRef(NAME), tok::kw_ ## TOK,  \
-             FLAGS, LangOpts, *this);
+             FLAGS, LangOpts, Records);
 #define CXX_KEYWORD_OPERATOR(NAME, ALIAS) \
   if (LangOpts.CXXOperatorNames)          \
-    AddCXXOperatorKeyword(StringRef(#NAME), tok::ALIAS, *this);
+    AddCXXOperatorKeyword(StringRef(#NAME), tok::ALIAS, Records);
 #define OBJC1_AT_KEYWORD(NAME) \
   if (LangOpts.ObjC1)          \
-    AddObjCKeyword(StringRef(#NAME), tok::objc_##NAME, *this);
+    AddObjCKeyword(StringRef(#NAME), tok::objc_##NAME, Records);
 #define OBJC2_AT_KEYWORD(NAME) \
   if (LangOpts.ObjC2)          \
-    AddObjCKeyword(StringRef(#NAME), tok::objc_##NAME, *this);
+    AddObjCKeyword(StringRef(#NAME), tok::objc_##NAME, Records);
 #define TESTING_KEYWORD(NAME, FLAGS)
 #include "clang/Basic/TokenKinds.def"
 
   if (LangOpts.ParseUnknownAnytype)
     AddKeyword("__unknown_anytype", tok::kw___unknown_anytype, KEYALL,
-               LangOpts, *this);
+               LangOpts, Records);
+
+  std::vector<StringRef> Names;
+  Names.reserve(Records.size());
+  for (unsigned i = 0, e = Records.size(); i != e; ++i)
+    Names.push_back(Records[i].Name);
+  KeywordIndex.build(Names);
+
+  // Fold the records of each spelling into the one at its first position,
+  // in order, so that later keyword tables override earlier ones.
+  Keywords.clear();
+  for (unsigned i = 0, e = Records.size(); i != e; ++i)
+    Keywords.push_back(getKeywordRecord(Records[i].Name));
+  for (unsigned i = 0, e = Records.size(); i != e; ++i) {
+    const KeywordRecord &Record = Records[i];
+    KeywordRecord &Merged = Keywords[KeywordIndex.lookup(Record.Name)];
+    if (Record.SetsTokenID) {
+      Merged.TokenID = Record.TokenID;
+      Merged.SetsTokenID = true;
+      Merged.IsExtension = Record.IsExtension;
+      Merged.IsCXX11CompatKeyword = Record.IsCXX11CompatKeyword;
+    }
+    if (Record.IsCPPOperatorKeyword)
+      Merged.IsCPPOperatorKeyword = true;
+    if (Record.ObjCKeywordID)
+      Merged.ObjCKeywordID = Record.ObjCKeywordID;
+  }
+
+  // Identifiers which already exist won't be initialized again.
+  for (unsigned i = FirstNewRecord, e = Records.size(); i != e; ++i) {
+    HashTableTy::iterator I = HashTable.find(Records[i].Name);
+    if (I != HashTable.end())
+      ApplyKeyword(Records[i], *I->getValue());
+  }
+  CompleteVocabulary = false;
 }
 
 tok::PPKeywordKind IdentifierInfo::getPPKeywordID() const {
@@ -257,6 +388,8 @@ void IdentifierTable::PrintStats() const {
   fprintf(stderr, "Ave identifier length: %f\n",
           (AverageIdentifierSize/(double)NumIdentifiers));
   fprintf(stderr, "Max identifier length: %d\n", MaxIdentifierLength);
+  fprintf(stderr, "# Keyword spellings (created on first use): %d\n",
+          KeywordIndex.size());
 
   // Compute statistics about the memory allocated for identifiers.
   HashTable.getAllocator().PrintStats();
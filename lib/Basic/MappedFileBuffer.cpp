@@ -0,0 +1,108 @@
+//===--- MappedFileBuffer.cpp - Memory mapped source files ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the MappedFileBuffer interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/MappedFileBuffer.h"
+#include <vector>
+
+#if !defined(_MSC_VER) && !defined(__MINGW32__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAVE_MAPPED_FILE_BUFFERS 1
+#endif
+using namespace clang;
+
+#ifdef HAVE_MAPPED_FILE_BUFFERS
+static size_t getPageSize() {
+  static size_t PageSize = ::sysconf(_SC_PAGESIZE);
+  return PageSize;
+}
+#endif
+
+MappedFileBuffer::MappedFileBuffer(StringRef Name, void *MapStart,
+                                   size_t MapSize, size_t FileSize)
+  : Name(Name), MapStart(MapStart), MapSize(MapSize) {
+  const char *Start = static_cast<const char *>(MapStart);
+  init(Start, Start + FileSize, /*RequiresNullTerminator=*/true);
+}
+
+MappedFileBuffer::~MappedFileBuffer() {
+#ifdef HAVE_MAPPED_FILE_BUFFERS
+  ::munmap(MapStart, MapSize);
+#endif
+}
+
+MappedFileBuffer *MappedFileBuffer::get(int FD, StringRef Name,
+                                        uint64_t FileSize) {
+#ifndef HAVE_MAPPED_FILE_BUFFERS
+  return 0;
+#else
+  // The clients of source buffers rely on a nul byte after the end of the
+  // file.  Past the end of the file, the last page of a mapping reads as
+  // zeroes; if the file fills its last page, there is nowhere to put one.
+  size_t PageSize = getPageSize();
+  if (FileSize == 0 || FileSize % PageSize == 0 || size_t(FileSize) != FileSize)
+    return 0;
+
+  // Touching a page past the end of the file faults, so make sure the file
+  // really is as large as we have been told.
+  struct stat StatBuf;
+  if (::fstat(FD, &StatBuf) != 0 || uint64_t(StatBuf.st_size) != FileSize)
+    return 0;
+
+  size_t MapSize = (FileSize + PageSize - 1) & ~(PageSize - 1);
+  void *MapStart = ::mmap(0, MapSize, PROT_READ, MAP_PRIVATE, FD, 0);
+  if (MapStart == MAP_FAILED)
+    return 0;
+
+  MappedFileBuffer *Buffer = new MappedFileBuffer(Name, MapStart, MapSize,
+                                                  FileSize);
+  Buffer->adviseSequential();
+  return Buffer;
+#endif
+}
+
+void MappedFileBuffer::adviseSequential() const {
+#ifdef HAVE_MAPPED_FILE_BUFFERS
+  ::madvise(MapStart, MapSize, MADV_SEQUENTIAL);
+#endif
+}
+
+void MappedFileBuffer::releasePages() const {
+#ifdef HAVE_MAPPED_FILE_BUFFERS
+  ::madvise(MapStart, MapSize, MADV_DONTNEED);
+#endif
+}
+
+size_t MappedFileBuffer::getResidentBytes() const {
+#ifdef HAVE_MAPPED_FILE_BUFFERS
+  size_t PageSize = getPageSize();
+  size_t NumPages = MapSize / PageSize;
+
+  // mincore takes a 'char *' on Darwin and the BSDs.
+#if defined(__linux__)
+  std::vector<unsigned char> Pages(NumPages);
+#else
+  std::vector<char> Pages(NumPages);
+#endif
+  if (::mincore(MapStart, MapSize, &Pages[0]) != 0)
+    return 0;
+
+  size_t NumResident = 0;
+  for (size_t i = 0; i != NumPages; ++i)
+    NumResident += Pages[i] & 1;
+  return NumResident * PageSize;
+#else
+  return 0;
+#endif
+}
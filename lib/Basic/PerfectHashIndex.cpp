@@ -0,0 +1,154 @@
+//===--- PerfectHashIndex.cpp - Perfect hash of fixed strings -------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the PerfectHashIndex interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/PerfectHashIndex.h"
+#include "llvm/Support/DataTypes.h"
+#include <algorithm>
+#include <cassert>
+using namespace clang;
+
+/// hashString - FNV-1a, starting from a basis derived from Seed so that every
+/// seed gives an unrelated hash function.
+static inline uint32_t hashString(StringRef Str, unsigned Seed) {
+  uint32_t Hash = 2166136261U ^ (Seed * 0x9E3779B9U);
+  for (unsigned i = 0, e = Str.size(); i != e; ++i) {
+    Hash ^= (unsigned char)Str[i];
+    Hash *= 16777619U;
+  }
+  return Hash;
+}
+
+/// getSlotHash - The hash which the displacement of a bucket is added to.
+/// The bucket comes from the low bits of Hash, so this mixes in the high
+/// ones.
+static inline uint32_t getSlotHash(uint32_t Hash) {
+  Hash ^= Hash >> 15;
+  Hash *= 0x85EBCA6BU;
+  Hash ^= Hash >> 13;
+  return Hash;
+}
+
+namespace {
+/// \brief Orders buckets from the largest to the smallest.
+struct BucketSizeGreater {
+  const std::vector<unsigned> &BucketStart;
+
+  explicit BucketSizeGreater(const std::vector<unsigned> &BucketStart)
+    : BucketStart(BucketStart) {}
+
+  bool operator()(unsigned LHS, unsigned RHS) const {
+    return BucketStart[LHS+1] - BucketStart[LHS] >
+           BucketStart[RHS+1] - BucketStart[RHS];
+  }
+};
+}
+
+void PerfectHashIndex::build(ArrayRef<StringRef> Strings) {
+  Keys.assign(Strings.begin(), Strings.end());
+  Displacements.clear();
+  Slots.clear();
+  if (Keys.empty())
+    return;
+
+  // Try hash functions until one spreads the strings out enough; for a
+  // table this sparse the first one almost always works.
+  for (Seed = 0; !tryBuild(Seed); ++Seed)
+    assert(Seed < 1000 && "Can't find a perfect hash for these strings");
+}
+
+bool PerfectHashIndex::tryBuild(unsigned Seed) {
+  unsigned NumKeys = Keys.size();
+  unsigned NumBuckets = NumKeys / 2 + 1;
+  unsigned TableSize = 1;
+  while (TableSize < NumKeys + NumKeys / 4 + 1)
+    TableSize <<= 1;
+  unsigned Mask = TableSize - 1;
+
+  std::vector<uint32_t> Hashes(NumKeys);
+  std::vector<unsigned> BucketStart(NumBuckets + 1, 0);
+  for (unsigned i = 0; i != NumKeys; ++i) {
+    Hashes[i] = hashString(Keys[i], Seed);
+    ++BucketStart[Hashes[i] % NumBuckets + 1];
+  }
+  for (unsigned b = 0; b != NumBuckets; ++b)
+    BucketStart[b+1] += BucketStart[b];
+
+  // Sort the strings by bucket, keeping only the first of equal strings.
+  std::vector<unsigned> Members(NumKeys);
+  std::vector<unsigned> Fill(BucketStart.begin(), BucketStart.end() - 1);
+  for (unsigned i = 0; i != NumKeys; ++i)
+    Members[Fill[Hashes[i] % NumBuckets]++] = i;
+
+  // Place the largest buckets first, while the table is still empty.
+  std::vector<unsigned> Order(NumBuckets);
+  for (unsigned b = 0; b != NumBuckets; ++b)
+    Order[b] = b;
+  std::sort(Order.begin(), Order.end(), BucketSizeGreater(BucketStart));
+
+  Displacements.assign(NumBuckets, 0);
+  Slots.assign(TableSize, 0);
+  std::vector<unsigned> Placed;
+  for (unsigned o = 0; o != NumBuckets; ++o) {
+    unsigned Bucket = Order[o];
+    unsigned Begin = BucketStart[Bucket], End = BucketStart[Bucket+1];
+    if (Begin == End)
+      break;
+
+    unsigned Displacement = 0;
+    for (; Displacement != TableSize; ++Displacement) {
+      Placed.clear();
+      bool Fits = true;
+      for (unsigned m = Begin; m != End && Fits; ++m) {
+        unsigned Key = Members[m];
+
+        // A duplicate string lives wherever its first occurrence does.
+        bool Duplicate = false;
+        for (unsigned p = Begin; p != m && !Duplicate; ++p)
+          Duplicate = Keys[Members[p]] == Keys[Key];
+        if (Duplicate)
+          continue;
+
+        unsigned Slot = (getSlotHash(Hashes[Key]) + Displacement) & Mask;
+        if (Slots[Slot]) {
+          Fits = false;
+          break;
+        }
+        Slots[Slot] = Key + 1;
+        Placed.push_back(Slot);
+      }
+      if (Fits)
+        break;
+      for (unsigned p = 0, e = Placed.size(); p != e; ++p)
+        Slots[Placed[p]] = 0;
+    }
+
+    if (Displacement == TableSize)
+      return false;
+    Displacements[Bucket] = Displacement;
+  }
+
+  return true;
+}
+
+int PerfectHashIndex::lookup(StringRef Str) const {
+  if (Keys.empty())
+    return -1;
+
+  uint32_t Hash = hashString(Str, Seed);
+  unsigned Displacement = Displacements[Hash % Displacements.size()];
+  unsigned Slot = (getSlotHash(Hash) + Displacement) & (Slots.size() - 1);
+  unsigned Index = Slots[Slot];
+  if (!Index || Keys[Index-1] != Str)
+    return -1;
+  return Index - 1;
+}
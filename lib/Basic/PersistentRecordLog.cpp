@@ -0,0 +1,212 @@
+//===--- PersistentRecordLog.cpp - Shared append-only record file ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the PersistentRecordLog interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/PersistentRecordLog.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/system_error.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#if !defined(_MSC_VER) && !defined(__MINGW32__)
+#include <unistd.h>
+#define HAVE_PERSISTENT_RECORD_LOG 1
+#endif
+using namespace clang;
+
+static const unsigned LogMagicSize = 8;
+static const unsigned LogHeaderSize = 12;
+static const unsigned RecordHeaderSize = 8;
+
+PersistentRecordLog::PersistentRecordLog(StringRef FileName, const char *Magic,
+                                         uint32_t Version, int AppendFD)
+  : FileName(FileName), Version(Version), AppendFD(AppendFD) {
+  memcpy(this->Magic, Magic, LogMagicSize);
+}
+
+PersistentRecordLog::~PersistentRecordLog() {
+#ifdef HAVE_PERSISTENT_RECORD_LOG
+  if (AppendFD != -1)
+    ::close(AppendFD);
+#endif
+}
+
+PersistentRecordLog *PersistentRecordLog::Open(StringRef FileName,
+                                               StringRef Kind,
+                                               const char *Magic,
+                                               uint32_t Version,
+                                               std::string &ErrorStr) {
+#ifndef HAVE_PERSISTENT_RECORD_LOG
+  ErrorStr = "a persistent " + Kind.str() + " is not supported on this host";
+  return 0;
+#else
+  std::string Name = FileName.str();
+
+  // Create the file if it doesn't exist yet.  The header is written to a
+  // temporary file which is then linked into place, so other processes never
+  // see a file without a header; if somebody else got there first the link
+  // fails and we use their file instead.
+  struct stat StatBuf;
+  if (::stat(Name.c_str(), &StatBuf) != 0) {
+    llvm::SmallString<128> TempName(FileName);
+    TempName += ".tmp";
+    TempName += llvm::utostr(::getpid());
+    int FD = ::open(TempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (FD == -1) {
+      ErrorStr = strerror(errno);
+      return 0;
+    }
+
+    char Header[LogHeaderSize];
+    memcpy(Header, Magic, LogMagicSize);
+    memcpy(Header + LogMagicSize, &Version, sizeof(Version));
+    bool Written = ::write(FD, Header, sizeof(Header)) == sizeof(Header);
+    ::close(FD);
+    if (Written && ::link(TempName.c_str(), Name.c_str()) != 0 &&
+        errno != EEXIST)
+      Written = false;
+    ::unlink(TempName.c_str());
+    if (!Written) {
+      ErrorStr = strerror(errno);
+      return 0;
+    }
+  }
+
+  int AppendFD = ::open(Name.c_str(), O_WRONLY | O_APPEND);
+  if (AppendFD == -1) {
+    ErrorStr = strerror(errno);
+    return 0;
+  }
+
+  llvm::OwningPtr<PersistentRecordLog> Log(
+    new PersistentRecordLog(FileName, Magic, Version, AppendFD));
+
+  if (llvm::error_code ec = llvm::MemoryBuffer::getFile(Name, Log->Contents)) {
+    ErrorStr = ec.message();
+    return 0;
+  }
+
+  uint32_t FileVersion;
+  StringRef Data = Log->Contents->getBuffer();
+  if (Data.size() < LogHeaderSize ||
+      memcmp(Data.data(), Magic, LogMagicSize) != 0) {
+    ErrorStr = "not a " + Kind.str() + " file";
+    return 0;
+  }
+  memcpy(&FileVersion, Data.data() + LogMagicSize, sizeof(FileVersion));
+  if (FileVersion != Version) {
+    ErrorStr = Kind.str() + " file has an unsupported version";
+    return 0;
+  }
+
+  return Log.take();
+#endif
+}
+
+static uint32_t getRecordChecksum(StringRef Data) {
+  return llvm::HashString(Data);
+}
+
+/// encodeRecord - Append the on-disk form of the record Data to Buffer.
+static void encodeRecord(StringRef Data, SmallVectorImpl<char> &Buffer) {
+  uint32_t Length = Data.size();
+  uint32_t Checksum = getRecordChecksum(Data);
+  Buffer.append((const char *)&Length, (const char *)&Length + 4);
+  Buffer.append((const char *)&Checksum, (const char *)&Checksum + 4);
+  Buffer.append(Data.begin(), Data.end());
+  Buffer.append(((Length + 7) & ~7U) - Length, '\0');
+}
+
+void
+PersistentRecordLog::getRecords(SmallVectorImpl<StringRef> &Records) const {
+  StringRef Data = Contents->getBuffer();
+  const char *Ptr = Data.data() + LogHeaderSize;
+  const char *End = Data.data() + Data.size();
+  while (unsigned(End - Ptr) >= RecordHeaderSize) {
+    uint32_t Length, Checksum;
+    memcpy(&Length, Ptr, sizeof(Length));
+    memcpy(&Checksum, Ptr + 4, sizeof(Checksum));
+
+    unsigned RecordSize = RecordHeaderSize + ((Length + 7) & ~7U);
+    if (Length == 0 || unsigned(End - Ptr) < RecordSize)
+      break;
+
+    // A record failing its checksum was torn by a concurrent writer or
+    // crash; nothing after it can be trusted to be aligned on a record.
+    StringRef Record(Ptr + RecordHeaderSize, Length);
+    if (getRecordChecksum(Record) != Checksum)
+      break;
+
+    Records.push_back(Record);
+    Ptr += RecordSize;
+  }
+}
+
+bool PersistentRecordLog::append(StringRef Data) {
+#ifdef HAVE_PERSISTENT_RECORD_LOG
+  if (AppendFD == -1)
+    return false;
+
+  llvm::SmallString<256> Record;
+  encodeRecord(Data, Record);
+
+  // A single append-mode write keeps records from different processes from
+  // interleaving.  If it fails, stop trying to extend the file.
+  if (::write(AppendFD, Record.data(), Record.size()) ==
+      ssize_t(Record.size()))
+    return true;
+
+  ::close(AppendFD);
+  AppendFD = -1;
+#endif
+  return false;
+}
+
+bool PersistentRecordLog::rewrite(ArrayRef<StringRef> Records) {
+#ifdef HAVE_PERSISTENT_RECORD_LOG
+  llvm::SmallString<4096> Buffer;
+  Buffer.append(Magic, Magic + LogMagicSize);
+  Buffer.append((const char *)&Version, (const char *)&Version + 4);
+  for (unsigned i = 0, e = Records.size(); i != e; ++i)
+    encodeRecord(Records[i], Buffer);
+
+  llvm::SmallString<128> TempName(FileName);
+  TempName += ".tmp";
+  TempName += llvm::utostr(::getpid());
+  int FD = ::open(TempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (FD == -1)
+    return false;
+
+  bool Written = ::write(FD, Buffer.data(), Buffer.size()) ==
+                 ssize_t(Buffer.size());
+  ::close(FD);
+  if (!Written || ::rename(TempName.c_str(), FileName.c_str()) != 0) {
+    ::unlink(TempName.c_str());
+    return false;
+  }
+
+  // Append to the new file from now on.
+  if (AppendFD != -1)
+    ::close(AppendFD);
+  AppendFD = ::open(FileName.c_str(), O_WRONLY | O_APPEND);
+  return true;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,227 @@
+//===--- PersistentStatCache.cpp - On-disk cache for 'stat' calls ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the PersistentStatCache interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/PersistentStatCache.h"
+#include "clang/Basic/PersistentRecordLog.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <sys/stat.h>
+using namespace clang;
+
+static const char StatCacheMagic[8] = { 'C', 'L', 'S', 'T', 'A', 'T', 'C', 0 };
+static const uint32_t StatCacheVersion = 2;
+
+/// Entries are only recorded once their directory has been left alone for this
+/// many seconds.  Directory modification times may have one second
+/// resolution, so a file created in the same second as the recorded time
+/// would otherwise never invalidate the entry.
+static const uint64_t MinDirAge = 2;
+
+/// The file is rewritten with just the live entries when it holds more than
+/// this many records, and at least twice as many records as live entries.
+static const unsigned MinRecordsToCompact = 4096;
+
+/// A file with more live entries than this is emptied instead: nothing else
+/// bounds the number of distinct paths a shared cache accumulates.
+static const unsigned MaxEntries = 1 << 18;
+
+PersistentStatCache::PersistentStatCache(PersistentRecordLog *Log)
+  : Log(Log), NumHits(0), NumMisses(0), NumStale(0), NumRecordsLoaded(0),
+    NumRecordsAdded(0), NumRecordsDropped(0) {
+}
+
+PersistentStatCache::~PersistentStatCache() {
+}
+
+PersistentStatCache *PersistentStatCache::Create(StringRef FileName,
+                                                 std::string &ErrorStr) {
+  PersistentRecordLog *Log =
+    PersistentRecordLog::Open(FileName, "stat cache", StatCacheMagic,
+                              StatCacheVersion, ErrorStr);
+  if (!Log)
+    return 0;
+
+  PersistentStatCache *Cache = new PersistentStatCache(Log);
+  Cache->readRecords();
+  return Cache;
+}
+
+StringRef PersistentStatCache::getFileName() const {
+  return Log->getFileName();
+}
+
+/// readRecords - Load every record of the cache file.  Each one is an Entry
+/// followed by the path it describes; later records for the same path replace
+/// earlier ones.  A file made up mostly of replaced records is compacted, and
+/// one which has grown too large is emptied.
+void PersistentStatCache::readRecords() {
+  SmallVector<StringRef, 256> Records;
+  Log->getRecords(Records);
+
+  // The newest record for each key.
+  llvm::StringMap<StringRef> Live;
+  for (unsigned i = 0, e = Records.size(); i != e; ++i) {
+    StringRef Record = Records[i];
+    if (Record.size() <= sizeof(Entry))
+      continue;
+
+    Entry E;
+    memcpy(&E, Record.data(), sizeof(Entry));
+    StringRef Path = Record.substr(sizeof(Entry));
+
+    if (E.Kind == Entry::MissingFile || E.Kind == Entry::MissingDir ||
+        E.Kind == Entry::Directory) {
+      llvm::SmallString<256> Key;
+      Key += E.Kind == Entry::MissingFile ? 'f' : 'd';
+      Key += Path;
+      Entries[Key] = E;
+      Live[Key] = Record;
+      ++NumRecordsLoaded;
+    }
+  }
+
+  if (Live.size() > MaxEntries) {
+    if (Log->rewrite(ArrayRef<StringRef>())) {
+      NumRecordsDropped = Records.size();
+      Entries.clear();
+    }
+    return;
+  }
+
+  if (Records.size() > MinRecordsToCompact &&
+      Records.size() > 2 * Live.size()) {
+    SmallVector<StringRef, 256> Kept;
+    Kept.reserve(Live.size());
+    for (llvm::StringMap<StringRef>::const_iterator I = Live.begin(),
+           E = Live.end(); I != E; ++I)
+      Kept.push_back(I->getValue());
+    if (Log->rewrite(Kept))
+      NumRecordsDropped = Records.size() - Kept.size();
+  }
+}
+
+/// getDirMTime - Compute (and remember) the modification time of Dir.
+/// Returns false if Dir can't be stat'ed.
+bool PersistentStatCache::getDirMTime(StringRef Dir, uint64_t &MTime) {
+  llvm::StringMapEntry<std::pair<bool, uint64_t> > &E =
+    DirMTimes.GetOrCreateValue(Dir, std::make_pair(false, uint64_t(~0ULL)));
+  if (E.getValue().second == ~0ULL) {
+    struct stat StatBuf;
+    if (::stat(E.getKeyData(), &StatBuf) == 0 && S_ISDIR(StatBuf.st_mode))
+      E.setValue(std::make_pair(true, uint64_t(StatBuf.st_mtime)));
+    else
+      E.setValue(std::make_pair(false, uint64_t(0)));
+  }
+
+  MTime = E.getValue().second;
+  return E.getValue().first;
+}
+
+/// addEntry - Remember a newly computed result, and append it to the file.
+void PersistentStatCache::addEntry(StringRef Key, const Entry &E) {
+  Entries[Key] = E;
+
+  llvm::SmallString<256> Record;
+  Record.append((const char *)&E, (const char *)&E + sizeof(Entry));
+  Record += Key.substr(1);
+  if (Log->append(Record))
+    ++NumRecordsAdded;
+}
+
+PersistentStatCache::LookupResult
+PersistentStatCache::getStat(const char *Path, struct stat &StatBuf,
+                             int *FileDescriptor) {
+  // Results for relative paths depend on the working directory.
+  if (!llvm::sys::path::is_absolute(Path))
+    return statChained(Path, StatBuf, FileDescriptor);
+
+  bool isForDir = FileDescriptor == 0;
+  llvm::SmallString<256> Key;
+  Key += isForDir ? 'd' : 'f';
+  Key += Path;
+
+  uint64_t ParentMTime = 0;
+  bool HaveParent = getDirMTime(llvm::sys::path::parent_path(Path),
+                                ParentMTime);
+
+  if (HaveParent) {
+    llvm::StringMap<Entry>::iterator I = Entries.find(Key);
+    if (I != Entries.end()) {
+      const Entry &E = I->getValue();
+      if (E.ParentMTime != ParentMTime) {
+        ++NumStale;
+      } else if (E.Kind == Entry::Directory) {
+        memset(&StatBuf, 0, sizeof(StatBuf));
+        StatBuf.st_dev = E.Dev;
+        StatBuf.st_ino = E.Ino;
+        StatBuf.st_mode = E.Mode;
+        StatBuf.st_mtime = E.MTime;
+        StatBuf.st_size = E.Size;
+        ++NumHits;
+        return CacheExists;
+      } else {
+        ++NumHits;
+        return CacheMissing;
+      }
+    }
+  }
+
+  ++NumMisses;
+
+  // A later cache in the chain may answer without touching the file system,
+  // leaving errno alone, so only trust an errno set by this lookup.
+  errno = 0;
+  LookupResult Result = statChained(Path, StatBuf, FileDescriptor);
+  int StatErrno = errno;
+  bool NotFound = Result == CacheMissing &&
+                  (StatErrno == ENOENT || StatErrno == ENOTDIR);
+
+  // Only record results whose directory we can validate later, and which
+  // can't be made stale within the mtime resolution of that directory.
+  if (!HaveParent || ParentMTime + MinDirAge > uint64_t(::time(0)))
+    return Result;
+
+  Entry E;
+  memset(&E, 0, sizeof(E));
+  E.ParentMTime = ParentMTime;
+  if (NotFound) {
+    E.Kind = isForDir ? Entry::MissingDir : Entry::MissingFile;
+    addEntry(Key, E);
+  } else if (Result == CacheExists && isForDir && S_ISDIR(StatBuf.st_mode)) {
+    E.Kind = Entry::Directory;
+    E.Dev = StatBuf.st_dev;
+    E.Ino = StatBuf.st_ino;
+    E.Mode = StatBuf.st_mode;
+    E.MTime = StatBuf.st_mtime;
+    E.Size = StatBuf.st_size;
+    addEntry(Key, E);
+  }
+
+  return Result;
+}
+
+void PersistentStatCache::PrintStats() const {
+  llvm::errs() << "\n*** Persistent Stat Cache Stats (" << getFileName()
+               << "):\n";
+  llvm::errs() << NumRecordsLoaded << " records loaded, "
+               << NumRecordsAdded << " records added, "
+               << NumRecordsDropped << " records dropped.\n";
+  llvm::errs() << NumHits << " hits, " << NumMisses << " misses, "
+               << NumStale << " stale entries.\n";
+}
@@ -15,10 +15,12 @@
 #include "clang/Basic/SourceManagerInternals.h"
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/FileManager.h"
+#include "clang/Basic/MappedFileBuffer.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Compiler.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Path.h"
@@ -28,6 +30,10 @@
 #include <cstring>
 #include <sys/stat.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 using namespace clang;
 using namespace SrcMgr;
 using llvm::MemoryBuffer;
@@ -77,6 +83,11 @@ void ContentCache::replaceBuffer(const llvm::MemoryBuffer *B,
     delete Buffer.getPointer();
   Buffer.setPointer(B);
   Buffer.setInt(DoNotFree? DoNotFreeFlag : 0);
+  BufferIsMapped = false;
+
+  // Any line numbers computed so far belong to the old buffer.
+  SourceLineCache.clear();
+  LineCacheComplete = false;
 }
 
 const llvm::MemoryBuffer *ContentCache::getBuffer(DiagnosticsEngine &Diag,
@@ -93,7 +104,16 @@ const llvm::MemoryBuffer *ContentCache::getBuffer(DiagnosticsEngine &Diag,
   }    
 
   std::string ErrorStr;
-  Buffer.setPointer(SM.getFileManager().getBufferForFile(ContentsEntry, &ErrorStr));
+  FileManager &FileMgr = SM.getFileManager();
+  if (FileMgr.getFileSystemOptions().MapSourceFiles) {
+    if (MappedFileBuffer *Mapped =
+          FileMgr.getMappedBufferForFile(ContentsEntry)) {
+      Buffer.setPointer(Mapped);
+      BufferIsMapped = true;
+    }
+  }
+  if (!Buffer.getPointer())
+    Buffer.setPointer(FileMgr.getBufferForFile(ContentsEntry, &ErrorStr));
 
   // If we were unable to open the file, then we are in an inconsistent
   // situation where the content cache referenced a file which no longer
@@ -366,7 +386,8 @@ LineTableInfo &SourceManager::getLineTable() {
 SourceManager::SourceManager(DiagnosticsEngine &Diag, FileManager &FileMgr)
   : Diag(Diag), FileMgr(FileMgr), OverridenFilesKeepOriginalName(true),
     ExternalSLocEntries(0), LineTable(0), NumLinearScans(0),
-    NumBinaryProbes(0), FakeBufferForRecovery(0) {
+    NumBinaryProbes(0), NumPageIndexLookups(0), NumPageIndexProbes(0),
+    FakeBufferForRecovery(0) {
   clearIDTables();
   Diag.setSourceManager(this);
 }
@@ -398,6 +419,7 @@ SourceManager::~SourceManager() {
 void SourceManager::clearIDTables() {
   MainFileID = FileID();
   LocalSLocEntryTable.clear();
+  LocalPageIndex.clear();
   LoadedSLocEntryTable.clear();
   SLocEntryLoaded.clear();
   LastLineNoFileIDQuery = FileID();
@@ -641,87 +663,55 @@ FileID SourceManager::getFileIDSlow(unsigned SLocOffset) const {
 FileID SourceManager::getFileIDLocal(unsigned SLocOffset) const {
   assert(SLocOffset < NextLocalOffset && "Bad function choice");
 
-  // After the first and second level caches, I see two common sorts of
-  // behavior: 1) a lot of searched FileID's are "near" the cached file
-  // location or are "near" the cached expansion location. 2) others are just
-  // completely random and may be a very long way away.
-  //
-  // To handle this, we do a linear search for up to 8 steps to catch #1 quickly
-  // then we fall back to a less cache efficient, but more scalable, binary
-  // search to find the location.
-
-  // See if this is near the file point - worst case we start scanning from the
-  // most newly created FileID.
-  std::vector<SrcMgr::SLocEntry>::const_iterator I;
-
-  if (LastFileIDLookup.ID < 0 ||
-      LocalSLocEntryTable[LastFileIDLookup.ID].getOffset() < SLocOffset) {
-    // Neither loc prunes our search.
-    I = LocalSLocEntryTable.end();
-  } else {
-    // Perhaps it is near the file point.
-    I = LocalSLocEntryTable.begin()+LastFileIDLookup.ID;
-  }
-
-  // Find the FileID that contains this.  "I" is an iterator that points to a
-  // FileID whose offset is known to be larger than SLocOffset.
-  unsigned NumProbes = 0;
-  while (1) {
-    --I;
-    if (I->getOffset() <= SLocOffset) {
-      FileID Res = FileID::get(int(I - LocalSLocEntryTable.begin()));
-
-      // If this isn't an expansion, remember it.  We have good locality across
-      // FileID lookups.
-      if (!I->isExpansion())
-        LastFileIDLookup = Res;
-      NumLinearScans += NumProbes+1;
-      return Res;
-    }
-    if (++NumProbes == 8)
-      break;
-  }
-
-  // Convert "I" back into an index.  We know that it is an entry whose index is
-  // larger than the offset we are looking for.
-  unsigned GreaterIndex = I - LocalSLocEntryTable.begin();
-  // LessIndex - This is the lower bound of the range that we're searching.
-  // We know that the offset corresponding to the FileID is is less than
-  // SLocOffset.
-  unsigned LessIndex = 0;
-  NumProbes = 0;
-  while (1) {
-    bool Invalid = false;
+  // Macro-heavy code creates huge numbers of tiny expansion entries, and the
+  // lookups that miss the one-entry cache jump all over them (diagnostics,
+  // spelling locations, the preprocessing record).  The page index narrows
+  // any lookup down to the entries overlapping a single page, which are then
+  // binary searched, so the cost doesn't grow with the size of the table.
+  unsigned Page = SLocOffset >> LocalPageBits;
+  if (Page >= LocalPageIndex.size())
+    extendLocalPageIndex();
+  assert(Page < LocalPageIndex.size() && "Page index doesn't cover offset");
+
+  // LessIndex is the entry containing the start of the page, so its offset is
+  // no larger than SLocOffset.  The entry containing the start of the next
+  // page may still start at or before SLocOffset, so it is included in the
+  // range; anything after it is known to start too late.
+  unsigned LessIndex = LocalPageIndex[Page];
+  unsigned GreaterIndex = Page + 1 < LocalPageIndex.size() ?
+    LocalPageIndex[Page + 1] + 1 : LocalSLocEntryTable.size();
+
+  ++NumPageIndexLookups;
+  while (GreaterIndex - LessIndex > 1) {
     unsigned MiddleIndex = (GreaterIndex-LessIndex)/2+LessIndex;
-    unsigned MidOffset = getLocalSLocEntry(MiddleIndex, &Invalid).getOffset();
-    if (Invalid)
-      return FileID::get(0);
-    
-    ++NumProbes;
-
-    // If the offset of the midpoint is too large, chop the high side of the
-    // range to the midpoint.
-    if (MidOffset > SLocOffset) {
+    ++NumPageIndexProbes;
+    if (LocalSLocEntryTable[MiddleIndex].getOffset() <= SLocOffset)
+      LessIndex = MiddleIndex;
+    else
       GreaterIndex = MiddleIndex;
-      continue;
-    }
-
-    // If the middle index contains the value, succeed and return.
-    // FIXME: This could be made faster by using a function that's aware of
-    // being in the local area.
-    if (isOffsetInFileID(FileID::get(MiddleIndex), SLocOffset)) {
-      FileID Res = FileID::get(MiddleIndex);
+  }
 
-      // If this isn't a macro expansion, remember it.  We have good locality
-      // across FileID lookups.
-      if (!LocalSLocEntryTable[MiddleIndex].isExpansion())
-        LastFileIDLookup = Res;
-      NumBinaryProbes += NumProbes;
-      return Res;
-    }
+  // If this isn't a macro expansion, remember it.  We have good locality
+  // across FileID lookups.
+  FileID Res = FileID::get(LessIndex);
+  if (!LocalSLocEntryTable[LessIndex].isExpansion())
+    LastFileIDLookup = Res;
+  return Res;
+}
 
-    // Otherwise, move the low-side up to the middle index.
-    LessIndex = MiddleIndex;
+/// \brief Extend LocalPageIndex to cover every page whose first offset has
+/// been allocated.
+void SourceManager::extendLocalPageIndex() const {
+  assert(NextLocalOffset && "No local entries?");
+  unsigned NumPages = ((NextLocalOffset - 1) >> LocalPageBits) + 1;
+  unsigned Index = LocalPageIndex.empty() ? 0 : LocalPageIndex.back();
+  LocalPageIndex.reserve(NumPages);
+  for (unsigned Page = LocalPageIndex.size(); Page != NumPages; ++Page) {
+    unsigned PageOffset = Page << LocalPageBits;
+    while (Index + 1 < LocalSLocEntryTable.size() &&
+           LocalSLocEntryTable[Index + 1].getOffset() <= PageOffset)
+      ++Index;
+    LocalPageIndex.push_back(Index);
   }
 }
 
@@ -988,13 +978,44 @@ unsigned SourceManager::getPresumedColumnNumber(SourceLocation Loc,
   return getPresumedLoc(Loc).getColumn();
 }
 
+/// LineScanChunkSize - Line tables are extended to the end of the chunk of
+/// this many bytes containing the queried position, so that a sequence of
+/// queries moving forward through a file doesn't resume the scan each time.
+static const unsigned LineScanChunkSize = 64 * 1024;
+
+/// findLineTerminator - Return a pointer to the first '\n', '\r' or nul at or
+/// after Ptr.  The buffer must be nul terminated at End.
+static const unsigned char *findLineTerminator(const unsigned char *Ptr,
+                                               const unsigned char *End) {
+#ifdef __SSE2__
+  const __m128i NewLines = _mm_set1_epi8('\n');
+  const __m128i Returns = _mm_set1_epi8('\r');
+  const __m128i Nuls = _mm_setzero_si128();
+  while (Ptr + 16 <= End) {
+    __m128i Block = _mm_loadu_si128((const __m128i *)Ptr);
+    __m128i Matches = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(Block, NewLines),
+                                                _mm_cmpeq_epi8(Block, Returns)),
+                                   _mm_cmpeq_epi8(Block, Nuls));
+    if (unsigned Mask = _mm_movemask_epi8(Matches))
+      return Ptr + llvm::CountTrailingZeros_32(Mask);
+    Ptr += 16;
+  }
+#endif
+  while (*Ptr != '\n' && *Ptr != '\r' && *Ptr != '\0')
+    ++Ptr;
+  return Ptr;
+}
+
+/// ComputeLineNumbers - Extend the line table of FI so that it covers the line
+/// containing FilePos and has at least MinLines lines, or until it holds every
+/// line of the buffer.
 static LLVM_ATTRIBUTE_NOINLINE void
 ComputeLineNumbers(DiagnosticsEngine &Diag, ContentCache *FI,
-                   llvm::BumpPtrAllocator &Alloc,
-                   const SourceManager &SM, bool &Invalid);
+                   const SourceManager &SM, bool &Invalid,
+                   unsigned FilePos, unsigned MinLines);
 static void ComputeLineNumbers(DiagnosticsEngine &Diag, ContentCache *FI,
-                               llvm::BumpPtrAllocator &Alloc,
-                               const SourceManager &SM, bool &Invalid) {
+                               const SourceManager &SM, bool &Invalid,
+                               unsigned FilePos, unsigned MinLines) {
   // Note that calling 'getBuffer()' may lazily page in the file.
   const MemoryBuffer *Buffer = FI->getBuffer(Diag, SM, SourceLocation(),
                                              &Invalid);
@@ -1003,42 +1024,52 @@ static void ComputeLineNumbers(DiagnosticsEngine &Diag, ContentCache *FI,
 
   // Find the file offsets of all of the *physical* source lines.  This does
   // not look at trigraphs, escaped newlines, or anything else tricky.
-  SmallVector<unsigned, 256> LineOffsets;
+  std::vector<unsigned> &LineOffsets = FI->SourceLineCache;
 
   // Line #1 starts at char 0.
-  LineOffsets.push_back(0);
+  if (LineOffsets.empty())
+    LineOffsets.push_back(0);
+
+  unsigned StopOffs = (FilePos / LineScanChunkSize + 1) * LineScanChunkSize;
 
-  const unsigned char *Buf = (const unsigned char *)Buffer->getBufferStart();
+  // Resume the scan at the start of the last line found so far.
+  const unsigned char *Start = (const unsigned char *)Buffer->getBufferStart();
   const unsigned char *End = (const unsigned char *)Buffer->getBufferEnd();
-  unsigned Offs = 0;
+  const unsigned char *Buf = Start + LineOffsets.back();
   while (1) {
     // Skip over the contents of the line.
-    // TODO: Vectorize this?  This is very performance sensitive for programs
-    // with lots of diagnostics and in -E mode.
-    const unsigned char *NextBuf = (const unsigned char *)Buf;
-    while (*NextBuf != '\n' && *NextBuf != '\r' && *NextBuf != '\0')
-      ++NextBuf;
-    Offs += NextBuf-Buf;
-    Buf = NextBuf;
+    Buf = findLineTerminator(Buf, End);
 
     if (Buf[0] == '\n' || Buf[0] == '\r') {
       // If this is \n\r or \r\n, skip both characters.
       if ((Buf[1] == '\n' || Buf[1] == '\r') && Buf[0] != Buf[1])
-        ++Offs, ++Buf;
-      ++Offs, ++Buf;
+        ++Buf;
+      ++Buf;
+      unsigned Offs = Buf - Start;
       LineOffsets.push_back(Offs);
+      if (Offs >= StopOffs && LineOffsets.size() >= MinLines)
+        return;
     } else {
       // Otherwise, this is a null.  If end of file, exit.
       if (Buf == End) break;
       // Otherwise, skip the null.
-      ++Offs, ++Buf;
+      ++Buf;
     }
   }
 
-  // Copy the offsets into the FileInfo structure.
-  FI->NumLines = LineOffsets.size();
-  FI->SourceLineCache = Alloc.Allocate<unsigned>(LineOffsets.size());
-  std::copy(LineOffsets.begin(), LineOffsets.end(), FI->SourceLineCache);
+  FI->LineCacheComplete = true;
+}
+
+void SourceManager::releaseBufferPages(FileID FID) const {
+  bool Invalid = false;
+  const SLocEntry &Entry = getSLocEntry(FID, &Invalid);
+  if (Invalid || !Entry.isFile())
+    return;
+
+  const ContentCache *Content = Entry.getFile().getContentCache();
+  if (Content->BufferIsMapped)
+    static_cast<const MappedFileBuffer *>(Content->getRawBuffer())
+      ->releasePages();
 }
 
 /// getLineNumber - Given a SourceLocation, return the spelling line number
@@ -1068,11 +1099,11 @@ unsigned SourceManager::getLineNumber(FileID FID, unsigned FilePos,
     Content = const_cast<ContentCache*>(Entry.getFile().getContentCache());
   }
   
-  // If this is the first use of line information for this buffer, compute the
-  /// SourceLineCache for it on demand.
-  if (Content->SourceLineCache == 0) {
+  // If line information for this part of the buffer hasn't been needed yet,
+  // extend the SourceLineCache for it on demand.
+  if (!Content->hasLineNumbersFor(FilePos)) {
     bool MyInvalid = false;
-    ComputeLineNumbers(Diag, Content, ContentCacheAlloc, *this, MyInvalid);
+    ComputeLineNumbers(Diag, Content, *this, MyInvalid, FilePos, 0);
     if (Invalid)
       *Invalid = MyInvalid;
     if (MyInvalid)
@@ -1082,9 +1113,12 @@ unsigned SourceManager::getLineNumber(FileID FID, unsigned FilePos,
 
   // Okay, we know we have a line number table.  Do a binary search to find the
   // line number that this character position lands on.
-  unsigned *SourceLineCache = Content->SourceLineCache;
+  // The table may stop short of the end of the file, but it is known to
+  // contain a line starting after FilePos unless it is complete.
+  unsigned NumLines = Content->SourceLineCache.size();
+  unsigned *SourceLineCache = &Content->SourceLineCache[0];
   unsigned *SourceLineCacheStart = SourceLineCache;
-  unsigned *SourceLineCacheEnd = SourceLineCache + Content->NumLines;
+  unsigned *SourceLineCacheEnd = SourceLineCache + NumLines;
 
   unsigned QueriedFilePos = FilePos+1;
 
@@ -1123,7 +1157,7 @@ unsigned SourceManager::getLineNumber(FileID FID, unsigned FilePos,
         }
       }
     } else {
-      if (LastLineNoResult < Content->NumLines)
+      if (LastLineNoResult < NumLines)
         SourceLineCacheEnd = SourceLineCache+LastLineNoResult+1;
     }
   }
@@ -1133,10 +1167,10 @@ unsigned SourceManager::getLineNumber(FileID FID, unsigned FilePos,
   // NOTE: This is currently disabled, as it does not appear to be profitable in
   // initial measurements.
   if (0 && SourceLineCacheEnd-SourceLineCache > 20) {
-    unsigned FileLen = Content->SourceLineCache[Content->NumLines-1];
+    unsigned FileLen = SourceLineCacheStart[NumLines-1];
 
     // Take a stab at guessing where it is.
-    unsigned ApproxPos = Content->NumLines*QueriedFilePos / FileLen;
+    unsigned ApproxPos = NumLines*QueriedFilePos / FileLen;
 
     // Check for -10 and +10 lines.
     unsigned LowerBound = std::max(int(ApproxPos-10), 0);
@@ -1492,16 +1526,16 @@ SourceLocation SourceManager::translateLineCol(FileID FID,
   if (!Content)
     return SourceLocation();
     
-  // If this is the first use of line information for this buffer, compute the
-  // SourceLineCache for it on demand.
-  if (Content->SourceLineCache == 0) {
+  // If line information for this part of the buffer hasn't been needed yet,
+  // extend the SourceLineCache for it on demand.
+  if (!Content->LineCacheComplete && Content->SourceLineCache.size() < Line) {
     bool MyInvalid = false;
-    ComputeLineNumbers(Diag, Content, ContentCacheAlloc, *this, MyInvalid);
+    ComputeLineNumbers(Diag, Content, *this, MyInvalid, 0, Line);
     if (MyInvalid)
       return SourceLocation();
   }
 
-  if (Line > Content->NumLines) {
+  if (Line > Content->SourceLineCache.size()) {
     unsigned Size = Content->getBuffer(Diag, *this)->getBufferSize();
     if (Size > 0)
       --Size;
@@ -1745,19 +1779,37 @@ void SourceManager::PrintStats() const {
                << MaxLoadedOffset - CurrentLoadedOffset
                << "B of Sloc address space used.\n";
   
-  unsigned NumLineNumsComputed = 0;
+  unsigned NumLineNumsComputed = 0, NumLineNumsComplete = 0;
   unsigned NumFileBytesMapped = 0;
+  unsigned NumMappedFiles = 0;
+  uint64_t NumMappedBytes = 0, NumResidentBytes = 0;
   for (fileinfo_iterator I = fileinfo_begin(), E = fileinfo_end(); I != E; ++I){
-    NumLineNumsComputed += I->second->SourceLineCache != 0;
+    NumLineNumsComputed += !I->second->SourceLineCache.empty();
+    NumLineNumsComplete += I->second->LineCacheComplete;
     NumFileBytesMapped  += I->second->getSizeBytesMapped();
+    if (I->second->BufferIsMapped) {
+      const MappedFileBuffer *Mapped =
+        static_cast<const MappedFileBuffer *>(I->second->getRawBuffer());
+      ++NumMappedFiles;
+      NumMappedBytes += Mapped->getMappedBytes();
+      NumResidentBytes += Mapped->getResidentBytes();
+    }
   }
   unsigned NumMacroArgsComputed = MacroArgsCacheMap.size();
 
   llvm::errs() << NumFileBytesMapped << " bytes of files mapped, "
-               << NumLineNumsComputed << " files with line #'s computed, "
+               << NumLineNumsComputed << " files with line #'s computed ("
+               << NumLineNumsComplete << " completely), "
                << NumMacroArgsComputed << " files with macro args computed.\n";
-  llvm::errs() << "FileID scans: " << NumLinearScans << " linear, "
+  if (NumMappedFiles)
+    llvm::errs() << NumMappedFiles << " files memory mapped, "
+                 << NumMappedBytes << " bytes mapped, "
+                 << NumResidentBytes << " bytes resident.\n";
+  llvm::errs() << "Loaded FileID scans: " << NumLinearScans << " linear, "
                << NumBinaryProbes << " binary.\n";
+  llvm::errs() << "FileID page index: " << NumPageIndexLookups
+               << " lookups, " << NumPageIndexProbes << " probes, "
+               << LocalPageIndex.size() << " pages.\n";
 }
 
 ExternalSLocEntrySource::~ExternalSLocEntrySource() { }
@@ -1785,6 +1837,7 @@ SourceManager::MemoryBufferSizes SourceManager::getMemoryBufferSizes() const {
 size_t SourceManager::getDataStructureSizes() const {
   return llvm::capacity_in_bytes(MemBufferInfos)
     + llvm::capacity_in_bytes(LocalSLocEntryTable)
+    + llvm::capacity_in_bytes(LocalPageIndex)
     + llvm::capacity_in_bytes(LoadedSLocEntryTable)
     + llvm::capacity_in_bytes(SLocEntryLoaded)
     + llvm::capacity_in_bytes(FileInfos)
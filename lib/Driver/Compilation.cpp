@@ -16,9 +16,13 @@
 #include "clang/Driver/Options.h"
 #include "clang/Driver/ToolChain.h"
 
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Program.h"
+#include <deque>
 #include <sys/stat.h>
 #include <errno.h>
 
@@ -137,17 +141,10 @@ bool Compilation::CleanupFileList(const ArgStringList &Files,
   return Success;
 }
 
-int Compilation::ExecuteCommand(const Command &C,
-                                const Command *&FailingCommand) const {
-  llvm::sys::Path Prog(C.getExecutable());
-  const char **Argv = new const char*[C.getArguments().size() + 2];
-  Argv[0] = C.getExecutable();
-  std::copy(C.getArguments().begin(), C.getArguments().end(), Argv+1);
-  Argv[C.getArguments().size() + 1] = 0;
-
+bool Compilation::EchoCommand(const Command &C, raw_ostream &Errs) const {
   if ((getDriver().CCCEcho || getDriver().CCPrintOptions ||
        getArgs().hasArg(options::OPT_v)) && !getDriver().CCGenDiagnostics) {
-    raw_ostream *OS = &llvm::errs();
+    raw_ostream *OS = &Errs;
 
     // Follow gcc implementation of CC_PRINT_OPTIONS; we could also cache the
     // output stream.
@@ -159,9 +156,8 @@ int Compilation::ExecuteCommand(const Command &C,
       if (!Error.empty()) {
         getDriver().Diag(clang::diag::err_drv_cc_print_options_failure)
           << Error;
-        FailingCommand = &C;
         delete OS;
-        return 1;
+        return false;
       }
     }
 
@@ -170,10 +166,27 @@ int Compilation::ExecuteCommand(const Command &C,
 
     PrintJob(*OS, C, "\n", /*Quote=*/getDriver().CCPrintOptions);
 
-    if (OS != &llvm::errs())
+    if (OS != &Errs)
       delete OS;
   }
 
+  return true;
+}
+
+int Compilation::ExecuteCommand(const Command &C,
+                                const Command *&FailingCommand) const {
+  llvm::sys::Path Prog(C.getExecutable());
+  const char **Argv = new const char*[C.getArguments().size() + 2];
+  Argv[0] = C.getExecutable();
+  std::copy(C.getArguments().begin(), C.getArguments().end(), Argv+1);
+  Argv[C.getArguments().size() + 1] = 0;
+
+  if (!EchoCommand(C, llvm::errs())) {
+    FailingCommand = &C;
+    delete[] Argv;
+    return 1;
+  }
+
   std::string Error;
   int Res =
     llvm::sys::Program::ExecuteAndWait(Prog, Argv,
@@ -206,6 +219,217 @@ int Compilation::ExecuteJob(const Job &J,
   }
 }
 
+namespace {
+/// ParallelCommand - The state of a single command being run by
+/// ExecuteJobInParallel.
+struct ParallelCommand {
+  enum StateKind { Pending, Running, Finished };
+
+  const Command *Cmd;
+  StateKind State;
+
+  /// Deps - The indices of the commands which must finish first.
+  SmallVector<unsigned, 4> Deps;
+
+  /// Process - The running process, while State is Running.
+  llvm::sys::Program *Process;
+
+  /// OutPath, ErrPath - The files capturing the command's stdout and stderr,
+  /// or empty if its output is not being captured.
+  llvm::sys::Path OutPath, ErrPath;
+
+  /// Echo - The -v / -ccc-echo text for this command.
+  std::string Echo;
+
+  /// Error - The error message from starting or waiting for the command.
+  std::string Error;
+
+  int Result;
+
+  explicit ParallelCommand(const Command *C)
+    : Cmd(C), State(Pending), Process(0), Result(0) {}
+};
+}
+
+/// CollectCommands - Flatten the commands of a job, in execution order.
+static void CollectCommands(const Job &J,
+                            SmallVectorImpl<const Command*> &Commands) {
+  if (const Command *C = dyn_cast<Command>(&J)) {
+    Commands.push_back(C);
+    return;
+  }
+
+  const JobList *Jobs = cast<JobList>(&J);
+  for (JobList::const_iterator
+         it = Jobs->begin(), ie = Jobs->end(); it != ie; ++it)
+    CollectCommands(**it, Commands);
+}
+
+/// CollectInputActions - Add every action that (directly or indirectly) feeds
+/// into \arg A to \arg Inputs.
+static void CollectInputActions(const Action *A,
+                                llvm::SmallPtrSet<const Action*, 16> &Inputs) {
+  for (Action::const_iterator it = A->begin(), ie = A->end(); it != ie; ++it)
+    if (Inputs.insert(*it))
+      CollectInputActions(*it, Inputs);
+}
+
+/// ReplayCapturedOutput - Copy a captured output file to \arg OS and remove
+/// it.
+static void ReplayCapturedOutput(llvm::sys::Path &P, raw_ostream &OS) {
+  if (P.empty())
+    return;
+
+  llvm::OwningPtr<llvm::MemoryBuffer> Buffer;
+  if (!llvm::MemoryBuffer::getFile(P.str(), Buffer))
+    OS << Buffer->getBuffer();
+  OS.flush();
+
+  P.eraseFromDisk(false, 0);
+  P = llvm::sys::Path();
+}
+
+int Compilation::ExecuteJobInParallel(const Job &J, unsigned MaxJobs,
+                                      const Command *&FailingCommand) const {
+  SmallVector<const Command*, 16> Commands;
+  CollectCommands(J, Commands);
+
+  std::vector<ParallelCommand> Cmds;
+  Cmds.reserve(Commands.size());
+  for (unsigned i = 0, e = Commands.size(); i != e; ++i)
+    Cmds.push_back(ParallelCommand(Commands[i]));
+
+  // A command depends on every earlier command whose source action feeds into
+  // its own. This makes link steps wait for the compiles producing their
+  // objects, while the compiles of separate inputs are independent.
+  for (unsigned i = 0, e = Cmds.size(); i != e; ++i) {
+    const Action *Source = &Cmds[i].Cmd->getSource();
+    llvm::SmallPtrSet<const Action*, 16> Inputs;
+    Inputs.insert(Source);
+    CollectInputActions(Source, Inputs);
+    for (unsigned j = 0; j != i; ++j)
+      if (Inputs.count(&Cmds[j].Cmd->getSource()))
+        Cmds[i].Deps.push_back(j);
+  }
+
+  // FirstFailure is the index of the first command (in job order) known to
+  // have failed. ExecuteJob would never have run anything after it, so no new
+  // commands after it are started and the results of those which already ran
+  // are discarded. NextToFlush is the first command whose output has not been
+  // replayed yet; every command before it has finished.
+  unsigned FirstFailure = Cmds.size();
+  unsigned NextToFlush = 0;
+  std::deque<unsigned> Running;
+
+  while (true) {
+    // Start as many ready commands as we are allowed to.
+    for (unsigned i = NextToFlush;
+         i < FirstFailure && Running.size() < MaxJobs; ++i) {
+      ParallelCommand &PC = Cmds[i];
+      if (PC.State != ParallelCommand::Pending)
+        continue;
+
+      bool Ready = true;
+      for (unsigned d = 0, de = PC.Deps.size(); d != de && Ready; ++d)
+        Ready = Cmds[PC.Deps[d]].State == ParallelCommand::Finished;
+      if (!Ready)
+        continue;
+
+      llvm::raw_string_ostream EchoOS(PC.Echo);
+      bool Echoed = EchoCommand(*PC.Cmd, EchoOS);
+      EchoOS.flush();
+      if (!Echoed) {
+        PC.State = ParallelCommand::Finished;
+        PC.Result = 1;
+        FirstFailure = i;
+        break;
+      }
+
+      // Capture the command's output so that it can be replayed in order,
+      // unless the compilation already redirects it.
+      const llvm::sys::Path **CmdRedirects = Redirects;
+      const llvm::sys::Path *CaptureRedirects[3] = { 0, 0, 0 };
+      if (!CmdRedirects) {
+        std::string OutName = getDriver().GetTemporaryPath("cc-stdout", "txt");
+        std::string ErrName = getDriver().GetTemporaryPath("cc-stderr", "txt");
+        if (!OutName.empty() && !ErrName.empty()) {
+          PC.OutPath = llvm::sys::Path(OutName);
+          PC.ErrPath = llvm::sys::Path(ErrName);
+          CaptureRedirects[1] = &PC.OutPath;
+          CaptureRedirects[2] = &PC.ErrPath;
+          CmdRedirects = CaptureRedirects;
+        }
+      }
+
+      SmallVector<const char*, 32> Argv;
+      Argv.push_back(PC.Cmd->getExecutable());
+      Argv.append(PC.Cmd->getArguments().begin(),
+                  PC.Cmd->getArguments().end());
+      Argv.push_back(0);
+
+      PC.Process = new llvm::sys::Program();
+      if (!PC.Process->Execute(llvm::sys::Path(PC.Cmd->getExecutable()),
+                               Argv.data(), /*env*/0, CmdRedirects,
+                               /*memoryLimit*/0, &PC.Error)) {
+        // Match ExecuteAndWait, which reports a command that could not be
+        // started as -1.
+        delete PC.Process;
+        PC.Process = 0;
+        PC.State = ParallelCommand::Finished;
+        PC.Result = -1;
+        FirstFailure = i;
+        break;
+      }
+
+      PC.State = ParallelCommand::Running;
+      Running.push_back(i);
+    }
+
+    // Replay the output of every finished command at the front of the job
+    // order, up to and including the first failure.
+    while (NextToFlush < Cmds.size() && NextToFlush <= FirstFailure &&
+           Cmds[NextToFlush].State == ParallelCommand::Finished) {
+      ParallelCommand &PC = Cmds[NextToFlush++];
+      llvm::errs() << PC.Echo;
+      ReplayCapturedOutput(PC.OutPath, llvm::outs());
+      ReplayCapturedOutput(PC.ErrPath, llvm::errs());
+      if (!PC.Error.empty())
+        getDriver().Diag(clang::diag::err_drv_command_failure) << PC.Error;
+    }
+
+    if (Running.empty())
+      break;
+
+    // There is no portable way to wait for whichever child finishes first, so
+    // wait for the oldest one.
+    unsigned Idx = Running.front();
+    Running.pop_front();
+
+    ParallelCommand &PC = Cmds[Idx];
+    PC.Result = PC.Process->Wait(llvm::sys::Path(PC.Cmd->getExecutable()),
+                                 /*secondsToWait*/0, &PC.Error);
+    delete PC.Process;
+    PC.Process = 0;
+    PC.State = ParallelCommand::Finished;
+    if (PC.Result && Idx < FirstFailure)
+      FirstFailure = Idx;
+  }
+
+  // Throw away the output of anything which ran after the first failure.
+  for (unsigned i = NextToFlush, e = Cmds.size(); i != e; ++i) {
+    if (!Cmds[i].OutPath.empty())
+      Cmds[i].OutPath.eraseFromDisk(false, 0);
+    if (!Cmds[i].ErrPath.empty())
+      Cmds[i].ErrPath.eraseFromDisk(false, 0);
+  }
+
+  if (FirstFailure == Cmds.size())
+    return 0;
+
+  FailingCommand = Cmds[FirstFailure].Cmd;
+  return Cmds[FirstFailure].Result;
+}
+
 void Compilation::initCompilationForDiagnostics(void) {
   // Free actions and jobs.
   DeleteContainerPointers(Actions);
@@ -60,7 +60,8 @@ Driver::Driver(StringRef ClangExecutable,
     CCLogDiagnosticsFilename(0), CCCIsCXX(false),
     CCCIsCPP(false),CCCEcho(false), CCCPrintBindings(false),
     CCPrintOptions(false), CCPrintHeaders(false), CCLogDiagnostics(false),
-    CCGenDiagnostics(false), CCCGenericGCCName(""), CheckInputsExist(true),
+    CCGenDiagnostics(false), MaxParallelJobs(1), CCCGenericGCCName(""),
+    CheckInputsExist(true),
     CCCUseClang(true), CCCUseClangCXX(true), CCCUseClangCPP(true),
     CCCUsePCH(true), SuppressMissingInputWarning(false) {
   if (IsProduction) {
@@ -319,6 +320,15 @@ Compilation *Driver::BuildCompilation(ArrayRef<const char *> ArgList) {
     SysRoot = A->getValue(*Args);
   if (Args->hasArg(options::OPT_nostdlib))
     UseStdLib = false;
+  if (const Arg *A = Args->getLastArg(options::OPT_j)) {
+    StringRef Value = A->getValue(*Args);
+    unsigned NumJobs;
+    if (Value.getAsInteger(10, NumJobs) || NumJobs == 0)
+      Diag(clang::diag::err_drv_invalid_value)
+        << A->getAsString(*Args) << Value;
+    else
+      MaxParallelJobs = NumJobs;
+  }
 
   Host = GetHostInfo(DefaultHostTriple.c_str());
 
@@ -476,7 +486,11 @@ int Driver::ExecuteCompilation(const Compilation &C,
   if (Diags.hasErrorOccurred())
     return 1;
 
-  int Res = C.ExecuteJob(C.getJobs(), FailingCommand);
+  int Res;
+  if (MaxParallelJobs > 1)
+    Res = C.ExecuteJobInParallel(C.getJobs(), MaxParallelJobs, FailingCommand);
+  else
+    Res = C.ExecuteJob(C.getJobs(), FailingCommand);
 
   // Remove temp files.
   C.CleanupFileList(C.getTempFiles());
@@ -31,6 +31,7 @@
 #include "clang/Serialization/ASTReader.h"
 #include "clang/Serialization/ASTWriter.h"
 #include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/Lexer.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Basic/TargetOptions.h"
 #include "clang/Basic/TargetInfo.h"
@@ -47,9 +48,16 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Mutex.h"
 #include "llvm/Support/CrashRecoveryContext.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Config/config.h"
 #include <cstdlib>
 #include <cstdio>
 #include <sys/stat.h>
+
+#if LLVM_MULTITHREADED && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#define HAVE_PREAMBLE_THREADS 1
+#endif
 using namespace clang;
 
 using llvm::TimeRecord;
@@ -100,7 +108,9 @@ ASTUnit::ASTUnit(bool _MainFileIsAST)
     TUKind(TU_Complete), WantTiming(getenv("LIBCLANG_TIMING")),
     OwnsRemappedFileBuffers(true),
     NumStoredDiagnosticsFromDriver(0),
-    PreambleRebuildCounter(0), SavedMainFileBuffer(0), PreambleBuffer(0),
+    PreambleRebuildCounter(0), TrackFileTokenHashes(false),
+    AsyncPreamble(false), PendingPreamble(0),
+    SavedMainFileBuffer(0), PreambleBuffer(0),
     ShouldCacheCodeCompletionResults(false),
     NestedMacroExpansions(true),
     CompletionCacheTopLevelHashValue(0),
@@ -114,6 +124,10 @@ ASTUnit::ASTUnit(bool _MainFileIsAST)
 }
 
 ASTUnit::~ASTUnit() {
+  // Wait for the preamble being built in the background, and throw it away.
+  if (PendingPreamble)
+    FinishPreambleBuild(/*Install=*/false);
+
   CleanTemporaryFiles();
   if (!PreambleFile.empty())
     llvm::sys::Path(PreambleFile).eraseFromDisk();
@@ -676,6 +690,70 @@ ASTUnit *ASTUnit::LoadFromASTFile(const std::string &Filename,
   return AST.take();
 }
 
+struct ASTUnit::PreambleBuild {
+  /// \brief The invocation that builds the preamble, which owns copies of
+  /// all of the remapped file buffers.
+  llvm::IntrusiveRefCntPtr<CompilerInvocation> Invocation;
+  llvm::IntrusiveRefCntPtr<DiagnosticsEngine> Diags;
+  std::vector<std::string> TargetFeatures;
+  std::string MainFilename;
+  std::string PCHPath;
+
+  /// \brief The text of the preamble.
+  std::string Preamble;
+  bool PreambleEndsAtStartOfLine;
+
+  /// \brief The main file as the preamble build sees it: the preamble,
+  /// padded with spaces to the reserved size.
+  llvm::MemoryBuffer *Buffer;
+  unsigned ReservedSize;
+
+  /// \brief Whether the precompiled preamble was written.
+  bool Succeeded;
+  SmallVector<StoredDiagnostic, 4> Diagnostics;
+  unsigned NumWarnings;
+  std::vector<serialization::DeclID> TopLevelDecls;
+  unsigned TopLevelHashValue;
+  llvm::StringMap<std::pair<off_t, time_t> > Files;
+  llvm::StringMap<unsigned> FileTokenHashes;
+  bool TrackFileTokenHashes;
+
+  /// \brief Whether the remapped file buffers of the invocation, other than
+  /// \c Buffer, are copies owned by the build.
+  bool OwnsRemappedFileBuffers;
+
+  /// \brief Whether the build running on a background thread is done.
+  bool Done;
+  llvm::sys::Mutex DoneLock;
+#ifdef HAVE_PREAMBLE_THREADS
+  pthread_t Thread;
+#endif
+
+  PreambleBuild()
+    : PreambleEndsAtStartOfLine(false), Buffer(0), ReservedSize(0),
+      Succeeded(false), NumWarnings(0), TopLevelHashValue(0),
+      TrackFileTokenHashes(false), OwnsRemappedFileBuffers(false),
+      Done(false) { }
+
+  ~PreambleBuild() {
+    if (OwnsRemappedFileBuffers) {
+      PreprocessorOptions &PPOpts = Invocation->getPreprocessorOpts();
+      for (PreprocessorOptions::remapped_file_buffer_iterator
+             FB = PPOpts.remapped_file_buffer_begin(),
+             FBEnd = PPOpts.remapped_file_buffer_end();
+           FB != FBEnd; ++FB)
+        if (FB->second != Buffer)
+          delete FB->second;
+    }
+    delete Buffer;
+  }
+
+  bool isDone() {
+    llvm::sys::ScopedLock L(DoneLock);
+    return Done;
+  }
+};
+
 namespace {
 
 /// \brief Preprocessor callback class that updates a hash value with the names 
@@ -691,6 +769,58 @@ public:
   }
 };
 
+/// \brief Hash the token stream of the given file.  Comments and the amount
+/// of whitespace between tokens don't affect the result.
+unsigned HashFileTokens(FileID FID, const SourceManager &SM,
+                        const LangOptions &LangOpts) {
+  Lexer RawLex(FID, SM.getBuffer(FID), SM, LangOpts);
+  unsigned Hash = 0;
+  Token Tok;
+  do {
+    RawLex.LexFromRawLexer(Tok);
+    const char *TokEnd = RawLex.getBufferLocation();
+    Hash = llvm::HashString(StringRef(TokEnd - Tok.getLength(),
+                                      Tok.getLength()), Hash);
+    // Whether a token starts a line matters to directives, and whether it
+    // follows whitespace matters to function-like macro definitions and
+    // stringization.  Indentation doesn't matter to either.
+    unsigned Spacing = Tok.isAtStartOfLine() ? 2 : Tok.hasLeadingSpace();
+    Hash = Hash * 33 + ((Tok.getKind() << 2) | Spacing);
+  } while (Tok.isNot(tok::eof));
+  return Hash;
+}
+
+/// \brief Preprocessor callback class that records the token stream hash of
+/// each file the preprocessor enters.
+class FileTokenHashTrackerPPCallbacks : public PPCallbacks {
+  const Preprocessor &PP;
+  llvm::StringMap<unsigned> &Hashes;
+  bool SkipMainFile;
+
+public:
+  FileTokenHashTrackerPPCallbacks(const Preprocessor &PP,
+                                  llvm::StringMap<unsigned> &Hashes,
+                                  bool SkipMainFile)
+    : PP(PP), Hashes(Hashes), SkipMainFile(SkipMainFile) { }
+
+  virtual void FileChanged(SourceLocation Loc, FileChangeReason Reason,
+                           SrcMgr::CharacteristicKind FileType,
+                           FileID PrevFID) {
+    if (Reason != EnterFile)
+      return;
+
+    SourceManager &SM = PP.getSourceManager();
+    FileID FID = SM.getFileID(Loc);
+    if (SkipMainFile && FID == SM.getMainFileID())
+      return;
+    const FileEntry *File = SM.getFileEntryForID(FID);
+    if (!File || Hashes.count(File->getName()))
+      return;
+
+    Hashes[File->getName()] = HashFileTokens(FID, SM, PP.getLangOptions());
+  }
+};
+
 /// \brief Add the given declaration to the hash of all top-level entities.
 void AddTopLevelDeclarationToHash(Decl *D, unsigned &Hash) {
   if (!D)
@@ -766,6 +896,11 @@ public:
                                          StringRef InFile) {
     CI.getPreprocessor().addPPCallbacks(
      new MacroDefinitionTrackerPPCallbacks(Unit.getCurrentTopLevelHashValue()));
+    if (Unit.getTrackFileTokenHashes())
+      CI.getPreprocessor().addPPCallbacks(
+        new FileTokenHashTrackerPPCallbacks(CI.getPreprocessor(),
+                                            Unit.getCurrentFileTokenHashes(),
+                                            /*SkipMainFile=*/false));
     return new TopLevelDeclTrackerConsumer(Unit, 
                                            Unit.getCurrentTopLevelHashValue());
   }
@@ -780,15 +915,16 @@ public:
 };
 
 class PrecompilePreambleConsumer : public PCHGenerator {
-  ASTUnit &Unit;
+  ASTUnit::PreambleBuild &Build;
   unsigned &Hash;                                   
   std::vector<Decl *> TopLevelDecls;
                                      
 public:
-  PrecompilePreambleConsumer(ASTUnit &Unit, const Preprocessor &PP, 
+  PrecompilePreambleConsumer(ASTUnit::PreambleBuild &Build,
+                             const Preprocessor &PP, 
                              StringRef isysroot, raw_ostream *Out)
-    : PCHGenerator(PP, "", /*IsModule=*/false, isysroot, Out), Unit(Unit),
-      Hash(Unit.getCurrentTopLevelHashValue()) {
+    : PCHGenerator(PP, "", /*IsModule=*/false, isysroot, Out), Build(Build),
+      Hash(Build.TopLevelHashValue) {
     Hash = 0;
   }
 
@@ -808,23 +944,23 @@ public:
 
   virtual void HandleTranslationUnit(ASTContext &Ctx) {
     PCHGenerator::HandleTranslationUnit(Ctx);
-    if (!Unit.getDiagnostics().hasErrorOccurred()) {
+    if (!Build.Diags->hasErrorOccurred()) {
       // Translate the top-level declarations we captured during
       // parsing into declaration IDs in the precompiled
       // preamble. This will allow us to deserialize those top-level
       // declarations when requested.
       for (unsigned I = 0, N = TopLevelDecls.size(); I != N; ++I)
-        Unit.addTopLevelDeclFromPreamble(
-                                      getWriter().getDeclID(TopLevelDecls[I]));
+        Build.TopLevelDecls.push_back(getWriter().getDeclID(TopLevelDecls[I]));
     }
   }
 };
 
 class PrecompilePreambleAction : public ASTFrontendAction {
-  ASTUnit &Unit;
+  ASTUnit::PreambleBuild &Build;
 
 public:
-  explicit PrecompilePreambleAction(ASTUnit &Unit) : Unit(Unit) {}
+  explicit PrecompilePreambleAction(ASTUnit::PreambleBuild &Build)
+    : Build(Build) {}
 
   virtual ASTConsumer *CreateASTConsumer(CompilerInstance &CI,
                                          StringRef InFile) {
@@ -840,8 +976,14 @@ public:
       Sysroot.clear();
 
     CI.getPreprocessor().addPPCallbacks(
-     new MacroDefinitionTrackerPPCallbacks(Unit.getCurrentTopLevelHashValue()));
-    return new PrecompilePreambleConsumer(Unit, CI.getPreprocessor(), Sysroot, 
+      new MacroDefinitionTrackerPPCallbacks(Build.TopLevelHashValue));
+    // The main file only holds the preamble here; it is hashed by the parse.
+    if (Build.TrackFileTokenHashes)
+      CI.getPreprocessor().addPPCallbacks(
+        new FileTokenHashTrackerPPCallbacks(CI.getPreprocessor(),
+                                            Build.FileTokenHashes,
+                                            /*SkipMainFile=*/true));
+    return new PrecompilePreambleConsumer(Build, CI.getPreprocessor(), Sysroot, 
                                           OS);
   }
 
@@ -918,6 +1060,18 @@ bool ASTUnit::Parse(llvm::MemoryBuffer *OverrideMainBuffer) {
   TopLevelDecls.clear();
   CleanTemporaryFiles();
 
+  // Files in the preamble won't be entered by this parse, so start from the
+  // token stream hashes recorded while computing it.
+  PreviousFileTokenHashes.clear();
+  PreviousFileTokenHashes.swap(FileTokenHashes);
+  if (OverrideMainBuffer) {
+    for (llvm::StringMap<unsigned>::iterator
+           H = PreambleFileTokenHashes.begin(),
+           HEnd = PreambleFileTokenHashes.end();
+         H != HEnd; ++H)
+      FileTokenHashes[H->first()] = H->second;
+  }
+
   if (!OverrideMainBuffer) {
     StoredDiagnostics.erase(
                     StoredDiagnostics.begin() + NumStoredDiagnosticsFromDriver,
@@ -1129,6 +1283,117 @@ static llvm::MemoryBuffer *CreatePaddedMainFileBuffer(llvm::MemoryBuffer *Old,
   return Result;
 }
 
+/// \brief Build a precompiled preamble as described by \p Build.
+///
+/// This only touches \p Build, so that it can run on a background thread.
+static void BuildPreamble(ASTUnit::PreambleBuild &Build) {
+  FrontendOptions &FrontendOpts = Build.Invocation->getFrontendOpts();
+
+  // Create the compiler instance to use for building the precompiled preamble.
+  llvm::OwningPtr<CompilerInstance> Clang(new CompilerInstance());
+
+  // Recover resources if we crash before exiting this method.
+  llvm::CrashRecoveryContextCleanupRegistrar<CompilerInstance>
+    CICleanup(Clang.get());
+
+  Clang->setInvocation(&*Build.Invocation);
+  Clang->setDiagnostics(&*Build.Diags);
+  
+  // Create the target instance.
+  Clang->getTargetOpts().Features = Build.TargetFeatures;
+  Clang->setTarget(TargetInfo::CreateTargetInfo(Clang->getDiagnostics(),
+                                               Clang->getTargetOpts()));
+  if (!Clang->hasTarget()) {
+    llvm::sys::Path(FrontendOpts.OutputFile).eraseFromDisk();
+    return;
+  }
+  
+  // Inform the target of the language options.
+  //
+  // FIXME: We shouldn't need to do this, the target should be immutable once
+  // created. This complexity should be lifted elsewhere.
+  Clang->getTarget().setForcedLangOptions(Clang->getLangOpts());
+  
+  assert(Clang->getFrontendOpts().Inputs.size() == 1 &&
+         "Invocation must have exactly one source file!");
+  assert(Clang->getFrontendOpts().Inputs[0].first != IK_AST &&
+         "FIXME: AST inputs not yet supported here!");
+  assert(Clang->getFrontendOpts().Inputs[0].first != IK_LLVM_IR &&
+         "IR inputs not support here!");
+  
+  // Clear out old caches and data.
+  Build.Diags->Reset();
+  ProcessWarningOptions(*Build.Diags, Clang->getDiagnosticOpts());
+  
+  // Create a file manager object to provide access to and cache the filesystem.
+  Clang->setFileManager(new FileManager(Clang->getFileSystemOpts()));
+  
+  // Create the source manager.
+  Clang->setSourceManager(new SourceManager(*Build.Diags,
+                                            Clang->getFileManager()));
+  
+  llvm::OwningPtr<PrecompilePreambleAction> Act;
+  Act.reset(new PrecompilePreambleAction(Build));
+  if (!Act->BeginSourceFile(*Clang.get(), FrontendOpts.Inputs[0].second,
+                            FrontendOpts.Inputs[0].first)) {
+    llvm::sys::Path(FrontendOpts.OutputFile).eraseFromDisk();
+    return;
+  }
+  
+  Act->Execute();
+  Act->EndSourceFile();
+
+  if (Build.Diags->hasErrorOccurred()) {
+    // There were errors parsing the preamble, so no precompiled header was
+    // generated.
+    llvm::sys::Path(FrontendOpts.OutputFile).eraseFromDisk();
+    return;
+  }
+  
+  Build.NumWarnings = Build.Diags->getNumWarnings();
+  
+  // Keep track of all of the files that the source manager knows about,
+  // so we can verify whether they have changed or not.
+  SourceManager &SourceMgr = Clang->getSourceManager();
+  const llvm::MemoryBuffer *MainFileBuffer
+    = SourceMgr.getBuffer(SourceMgr.getMainFileID());
+  for (SourceManager::fileinfo_iterator F = SourceMgr.fileinfo_begin(),
+                                     FEnd = SourceMgr.fileinfo_end();
+       F != FEnd;
+       ++F) {
+    const FileEntry *File = F->second->OrigEntry;
+    if (!File || F->second->getRawBuffer() == MainFileBuffer)
+      continue;
+    
+    Build.Files[File->getName()]
+      = std::make_pair(F->second->getSize(), File->getModificationTime());
+  }
+  
+  Build.Succeeded = true;
+}
+
+#ifdef HAVE_PREAMBLE_THREADS
+static void BuildPreambleSafely(void *UserData) {
+  BuildPreamble(*static_cast<ASTUnit::PreambleBuild *>(UserData));
+}
+
+static void *PreambleBuildThread(void *UserData) {
+  ASTUnit::PreambleBuild &Build
+    = *static_cast<ASTUnit::PreambleBuild *>(UserData);
+
+  // A crash while building the preamble just means there is no preamble.
+  llvm::CrashRecoveryContext CRC;
+  if (!CRC.RunSafely(BuildPreambleSafely, &Build)) {
+    llvm::sys::Path(Build.PCHPath).eraseFromDisk();
+    Build.Succeeded = false;
+  }
+
+  llvm::sys::ScopedLock L(Build.DoneLock);
+  Build.Done = true;
+  return 0;
+}
+#endif
+
 /// \brief Attempt to build or re-use a precompiled preamble when (re-)parsing
 /// the source file.
 ///
@@ -1153,6 +1418,15 @@ llvm::MemoryBuffer *ASTUnit::getMainBufferWithPrecompiledPreamble(
                               const CompilerInvocation &PreambleInvocationIn,
                                                            bool AllowRebuild,
                                                            unsigned MaxLines) {
+  // While a preamble is being built in the background, parse without one.
+  // Once it is done, install it and check it like any other; this is only
+  // done by a reparse, since the AST refers to the preamble it was parsed
+  // with.
+  if (PendingPreamble) {
+    if (!AllowRebuild || !PendingPreamble->isDone())
+      return 0;
+    FinishPreambleBuild(/*Install=*/true);
+  }
   
   llvm::IntrusiveRefCntPtr<CompilerInvocation>
     PreambleInvocation(new CompilerInvocation(PreambleInvocationIn));
@@ -1308,41 +1582,43 @@ llvm::MemoryBuffer *ASTUnit::getMainBufferWithPrecompiledPreamble(
   }
   
   // We did not previously compute a preamble, or it can't be reused anyway.
-  SimpleTimer PreambleTimer(WantTiming);
-  PreambleTimer.setOutput("Precompiling preamble");
-  
+  // The build holds the only reference to its invocation, since it may be
+  // used on another thread.
+  llvm::OwningPtr<PreambleBuild> Build(new PreambleBuild);
+  Build->Invocation.swap(PreambleInvocation);
+  Build->TargetFeatures = TargetFeatures;
+  Build->MainFilename = FrontendOpts.Inputs[0].second;
+  Build->PCHPath = PreamblePCHPath;
+  Build->TrackFileTokenHashes = TrackFileTokenHashes;
+
   // Create a new buffer that stores the preamble. The buffer also contains
   // extra space for the original contents of the file (which will be present
   // when we actually parse the file) along with more room in case the file
   // grows.  
-  PreambleReservedSize = NewPreamble.first->getBufferSize();
-  if (PreambleReservedSize < 4096)
-    PreambleReservedSize = 8191;
+  Build->ReservedSize = NewPreamble.first->getBufferSize();
+  if (Build->ReservedSize < 4096)
+    Build->ReservedSize = 8191;
   else
-    PreambleReservedSize *= 2;
+    Build->ReservedSize *= 2;
 
   // Save the preamble text for later; we'll need to compare against it for
   // subsequent reparses.
-  StringRef MainFilename = PreambleInvocation->getFrontendOpts().Inputs[0].second;
-  Preamble.assign(FileMgr->getFile(MainFilename),
-                  NewPreamble.first->getBufferStart(), 
-                  NewPreamble.first->getBufferStart() 
-                                                  + NewPreamble.second.first);
-  PreambleEndsAtStartOfLine = NewPreamble.second.second;
+  Build->Preamble.assign(NewPreamble.first->getBufferStart(), 
+                         NewPreamble.second.first);
+  Build->PreambleEndsAtStartOfLine = NewPreamble.second.second;
 
-  delete PreambleBuffer;
-  PreambleBuffer
-    = llvm::MemoryBuffer::getNewUninitMemBuffer(PreambleReservedSize,
+  Build->Buffer
+    = llvm::MemoryBuffer::getNewUninitMemBuffer(Build->ReservedSize,
                                                 FrontendOpts.Inputs[0].second);
-  memcpy(const_cast<char*>(PreambleBuffer->getBufferStart()), 
-         NewPreamble.first->getBufferStart(), Preamble.size());
-  memset(const_cast<char*>(PreambleBuffer->getBufferStart()) + Preamble.size(), 
-         ' ', PreambleReservedSize - Preamble.size() - 1);
-  const_cast<char*>(PreambleBuffer->getBufferEnd())[-1] = '\n';  
+  char *BufferStart = const_cast<char*>(Build->Buffer->getBufferStart());
+  memcpy(BufferStart, Build->Preamble.data(), Build->Preamble.size());
+  memset(BufferStart + Build->Preamble.size(), ' ',
+         Build->ReservedSize - Build->Preamble.size() - 1);
+  BufferStart[Build->ReservedSize - 1] = '\n';
   
   // Remap the main source file to the preamble buffer.
   llvm::sys::PathWithStatus MainFilePath(FrontendOpts.Inputs[0].second);
-  PreprocessorOpts.addRemappedFile(MainFilePath.str(), PreambleBuffer);
+  PreprocessorOpts.addRemappedFile(MainFilePath.str(), Build->Buffer);
   
   // Tell the compiler invocation to generate a temporary precompiled header.
   FrontendOpts.ProgramAction = frontend::GeneratePCH;
@@ -1350,137 +1626,157 @@ llvm::MemoryBuffer *ASTUnit::getMainBufferWithPrecompiledPreamble(
   FrontendOpts.OutputFile = PreamblePCHPath;
   PreprocessorOpts.PrecompiledPreambleBytes.first = 0;
   PreprocessorOpts.PrecompiledPreambleBytes.second = false;
-  
-  // Create the compiler instance to use for building the precompiled preamble.
-  llvm::OwningPtr<CompilerInstance> Clang(new CompilerInstance());
-
-  // Recover resources if we crash before exiting this method.
-  llvm::CrashRecoveryContextCleanupRegistrar<CompilerInstance>
-    CICleanup(Clang.get());
 
-  Clang->setInvocation(&*PreambleInvocation);
-  OriginalSourceFile = Clang->getFrontendOpts().Inputs[0].second;
-  
-  // Set up diagnostics, capturing all of the diagnostics produced.
-  Clang->setDiagnostics(&getDiagnostics());
-  
-  // Create the target instance.
-  Clang->getTargetOpts().Features = TargetFeatures;
-  Clang->setTarget(TargetInfo::CreateTargetInfo(Clang->getDiagnostics(),
-                                               Clang->getTargetOpts()));
-  if (!Clang->hasTarget()) {
-    llvm::sys::Path(FrontendOpts.OutputFile).eraseFromDisk();
-    Preamble.clear();
-    PreambleRebuildCounter = DefaultPreambleRebuildInterval;
-    PreprocessorOpts.eraseRemappedFile(
-                               PreprocessorOpts.remapped_file_buffer_end() - 1);
+  // In the asynchronous mode, build the preamble on another thread and parse
+  // without one until it is done.
+  if (AsyncPreamble && StartPreambleBuild(*Build)) {
+    PendingPreamble = Build.take();
     return 0;
   }
-  
-  // Inform the target of the language options.
-  //
-  // FIXME: We shouldn't need to do this, the target should be immutable once
-  // created. This complexity should be lifted elsewhere.
-  Clang->getTarget().setForcedLangOptions(Clang->getLangOpts());
-  
-  assert(Clang->getFrontendOpts().Inputs.size() == 1 &&
-         "Invocation must have exactly one source file!");
-  assert(Clang->getFrontendOpts().Inputs[0].first != IK_AST &&
-         "FIXME: AST inputs not yet supported here!");
-  assert(Clang->getFrontendOpts().Inputs[0].first != IK_LLVM_IR &&
-         "IR inputs not support here!");
-  
+
+  SimpleTimer PreambleTimer(WantTiming);
+  PreambleTimer.setOutput("Precompiling preamble");
+
   // Clear out old caches and data.
-  getDiagnostics().Reset();
-  ProcessWarningOptions(getDiagnostics(), Clang->getDiagnosticOpts());
   StoredDiagnostics.erase(
                     StoredDiagnostics.begin() + NumStoredDiagnosticsFromDriver,
                           StoredDiagnostics.end());
   TopLevelDecls.clear();
   TopLevelDeclsInPreamble.clear();
-  
-  // Create a file manager object to provide access to and cache the filesystem.
-  Clang->setFileManager(new FileManager(Clang->getFileSystemOpts()));
-  
-  // Create the source manager.
-  Clang->setSourceManager(new SourceManager(getDiagnostics(),
-                                            Clang->getFileManager()));
-  
-  llvm::OwningPtr<PrecompilePreambleAction> Act;
-  Act.reset(new PrecompilePreambleAction(*this));
-  if (!Act->BeginSourceFile(*Clang.get(), Clang->getFrontendOpts().Inputs[0].second,
-                            Clang->getFrontendOpts().Inputs[0].first)) {
-    llvm::sys::Path(FrontendOpts.OutputFile).eraseFromDisk();
-    Preamble.clear();
-    PreambleRebuildCounter = DefaultPreambleRebuildInterval;
-    PreprocessorOpts.eraseRemappedFile(
-                               PreprocessorOpts.remapped_file_buffer_end() - 1);
+
+  // Set up diagnostics, capturing all of the diagnostics produced.
+  Build->Diags = &getDiagnostics();
+  BuildPreamble(*Build);
+
+  // Transfer any diagnostics generated when parsing the preamble into the set
+  // of preamble diagnostics.
+  Build->Diagnostics.append(
+                   StoredDiagnostics.begin() + NumStoredDiagnosticsFromDriver,
+                            StoredDiagnostics.end());
+  StoredDiagnostics.erase(
+                    StoredDiagnostics.begin() + NumStoredDiagnosticsFromDriver,
+                          StoredDiagnostics.end());
+
+  if (!InstallPreamble(*Build))
     return 0;
-  }
-  
-  Act->Execute();
-  Act->EndSourceFile();
 
-  if (Diagnostics->hasErrorOccurred()) {
+  return CreatePaddedMainFileBuffer(NewPreamble.first, 
+                                    PreambleReservedSize,
+                                    FrontendOpts.Inputs[0].second);
+}
+
+/// \brief Start building the given preamble on a background thread.
+///
+/// \returns false if the preamble can't be built in the background, in which
+/// case it should be built right away.
+bool ASTUnit::StartPreambleBuild(PreambleBuild &Build) {
+#ifdef HAVE_PREAMBLE_THREADS
+  if (!llvm::llvm_is_multithreaded())
+    return false;
+
+  // The build gets its own diagnostics engine, and its own copies of the
+  // remapped files, which the next reparse replaces.
+  DiagnosticConsumer *Client;
+  if (CaptureDiagnostics)
+    Client = new StoredDiagnosticConsumer(Build.Diagnostics);
+  else
+    Client = new IgnoringDiagConsumer;
+  Build.Diags = new DiagnosticsEngine(
+            llvm::IntrusiveRefCntPtr<DiagnosticIDs>(new DiagnosticIDs), Client);
+
+  PreprocessorOptions &PPOpts = Build.Invocation->getPreprocessorOpts();
+  for (PreprocessorOptions::remapped_file_buffer_iterator
+         FB = PPOpts.remapped_file_buffer_begin(),
+         FBEnd = PPOpts.remapped_file_buffer_end();
+       FB != FBEnd; ++FB) {
+    if (FB->second != Build.Buffer)
+      FB->second = llvm::MemoryBuffer::getMemBufferCopy(
+                                                    FB->second->getBuffer(),
+                                         FB->second->getBufferIdentifier());
+  }
+  Build.OwnsRemappedFileBuffers = true;
+
+  if (::pthread_create(&Build.Thread, 0, PreambleBuildThread, &Build) == 0)
+    return true;
+
+  // We couldn't start the thread; the preamble will be built right away, with
+  // the ASTUnit's diagnostics.
+  Build.Diags = 0;
+  return false;
+#else
+  return false;
+#endif
+}
+
+/// \brief Wait for the preamble being built in the background, then install
+/// it or throw it away.
+void ASTUnit::FinishPreambleBuild(bool Install) {
+  assert(PendingPreamble && "No preamble is being built");
+  llvm::OwningPtr<PreambleBuild> Build(PendingPreamble);
+  PendingPreamble = 0;
+
+#ifdef HAVE_PREAMBLE_THREADS
+  ::pthread_join(Build->Thread, 0);
+#endif
+  if (Install)
+    InstallPreamble(*Build);
+  else if (Build->Succeeded)
+    llvm::sys::Path(Build->PCHPath).eraseFromDisk();
+}
+
+/// \brief Make the preamble described by \p Build the one used by later
+/// parses.
+///
+/// \returns false if building the preamble failed.
+bool ASTUnit::InstallPreamble(PreambleBuild &Build) {
+  if (!Build.Succeeded) {
     // There were errors parsing the preamble, so no precompiled header was
     // generated. Forget that we even tried.
     // FIXME: Should we leave a note for ourselves to try again?
-    llvm::sys::Path(FrontendOpts.OutputFile).eraseFromDisk();
     Preamble.clear();
     TopLevelDeclsInPreamble.clear();
     PreambleRebuildCounter = DefaultPreambleRebuildInterval;
-    PreprocessorOpts.eraseRemappedFile(
-                               PreprocessorOpts.remapped_file_buffer_end() - 1);
-    return 0;
+    return false;
   }
-  
-  // Transfer any diagnostics generated when parsing the preamble into the set
-  // of preamble diagnostics.
-  PreambleDiagnostics.clear();
-  PreambleDiagnostics.insert(PreambleDiagnostics.end(), 
-                   StoredDiagnostics.begin() + NumStoredDiagnosticsFromDriver,
-                             StoredDiagnostics.end());
-  StoredDiagnostics.erase(
-                    StoredDiagnostics.begin() + NumStoredDiagnosticsFromDriver,
-                          StoredDiagnostics.end());
-  
+
+  OriginalSourceFile = Build.MainFilename;
+  Preamble.assign(FileMgr->getFile(Build.MainFilename),
+                  Build.Preamble.data(),
+                  Build.Preamble.data() + Build.Preamble.size());
+  PreambleEndsAtStartOfLine = Build.PreambleEndsAtStartOfLine;
+  PreambleReservedSize = Build.ReservedSize;
+  delete PreambleBuffer;
+  PreambleBuffer = Build.Buffer;
+  Build.Buffer = 0;
+
   // Keep track of the preamble we precompiled.
-  PreambleFile = FrontendOpts.OutputFile;
-  NumWarningsInPreamble = getDiagnostics().getNumWarnings();
-  
-  // Keep track of all of the files that the source manager knows about,
-  // so we can verify whether they have changed or not.
+  PreambleFile = Build.PCHPath;
+  NumWarningsInPreamble = Build.NumWarnings;
+  PreambleDiagnostics.swap(Build.Diagnostics);
+  TopLevelDeclsInPreamble.swap(Build.TopLevelDecls);
+
   FilesInPreamble.clear();
-  SourceManager &SourceMgr = Clang->getSourceManager();
-  const llvm::MemoryBuffer *MainFileBuffer
-    = SourceMgr.getBuffer(SourceMgr.getMainFileID());
-  for (SourceManager::fileinfo_iterator F = SourceMgr.fileinfo_begin(),
-                                     FEnd = SourceMgr.fileinfo_end();
-       F != FEnd;
-       ++F) {
-    const FileEntry *File = F->second->OrigEntry;
-    if (!File || F->second->getRawBuffer() == MainFileBuffer)
-      continue;
-    
-    FilesInPreamble[File->getName()]
-      = std::make_pair(F->second->getSize(), File->getModificationTime());
-  }
-  
+  for (llvm::StringMap<std::pair<off_t, time_t> >::iterator
+         F = Build.Files.begin(), FEnd = Build.Files.end();
+       F != FEnd; ++F)
+    FilesInPreamble[F->first()] = F->second;
+  PreambleFileTokenHashes.clear();
+  for (llvm::StringMap<unsigned>::iterator
+         H = Build.FileTokenHashes.begin(), HEnd = Build.FileTokenHashes.end();
+       H != HEnd; ++H)
+    PreambleFileTokenHashes[H->first()] = H->second;
+
   PreambleRebuildCounter = 1;
-  PreprocessorOpts.eraseRemappedFile(
-                               PreprocessorOpts.remapped_file_buffer_end() - 1);
   
   // If the hash of top-level entities differs from the hash of the top-level
   // entities the last time we rebuilt the preamble, clear out the completion
   // cache.
+  CurrentTopLevelHashValue = Build.TopLevelHashValue;
   if (CurrentTopLevelHashValue != PreambleTopLevelHashValue) {
     CompletionCacheTopLevelHashValue = 0;
     PreambleTopLevelHashValue = CurrentTopLevelHashValue;
   }
-  
-  return CreatePaddedMainFileBuffer(NewPreamble.first, 
-                                    PreambleReservedSize,
-                                    FrontendOpts.Inputs[0].second);
+  return true;
 }
 
 void ASTUnit::RealizeTopLevelDeclsFromPreamble() {
@@ -1702,7 +1998,9 @@ ASTUnit *ASTUnit::LoadFromCommandLine(const char **ArgBegin,
                                       bool PrecompilePreamble,
                                       TranslationUnitKind TUKind,
                                       bool CacheCodeCompletionResults,
-                                      bool NestedMacroExpansions) {
+                                      bool NestedMacroExpansions,
+                                      bool AsyncPreamble,
+                                      bool TrackFileTokenHashes) {
   if (!Diags.getPtr()) {
     // No diagnostics engine was provided, so create our own diagnostics object
     // with the default options.
@@ -1760,6 +2058,8 @@ ASTUnit *ASTUnit::LoadFromCommandLine(const char **ArgBegin,
   AST->StoredDiagnostics.swap(StoredDiagnostics);
   AST->Invocation = CI;
   AST->NestedMacroExpansions = NestedMacroExpansions;
+  AST->AsyncPreamble = AsyncPreamble;
+  AST->TrackFileTokenHashes = TrackFileTokenHashes;
   
   // Recover resources if we crash before exiting this method.
   llvm::CrashRecoveryContextCleanupRegistrar<ASTUnit>
@@ -1774,6 +2074,31 @@ ASTUnit *ASTUnit::LoadFromCommandLine(const char **ArgBegin,
   return AST->LoadFromCompilerInvocation(PrecompilePreamble) ? 0 : AST.take();
 }
 
+/// \brief Describe the given stored diagnostic by its level, the line and
+/// column where it is expanded, and its message.
+///
+/// \returns the file the diagnostic is expanded in, or null if it has no
+/// location in a file.
+static const FileEntry *getStoredDiagnosticKey(const StoredDiagnostic &SD,
+                                               std::string &Key) {
+  FullSourceLoc Loc = SD.getLocation();
+  if (Loc.isInvalid())
+    return 0;
+
+  const SourceManager &SM = Loc.getManager();
+  SourceLocation ExpansionLoc = SM.getExpansionLoc(Loc);
+  const FileEntry *File = SM.getFileEntryForID(SM.getFileID(ExpansionLoc));
+  if (!File)
+    return 0;
+
+  llvm::raw_string_ostream OS(Key);
+  OS << unsigned(SD.getLevel()) << ':' << File->getName() << ':'
+     << SM.getExpansionLineNumber(ExpansionLoc) << ':'
+     << SM.getExpansionColumnNumber(ExpansionLoc) << ':' << SD.getMessage();
+  OS.flush();
+  return File;
+}
+
 bool ASTUnit::Reparse(RemappedFile *RemappedFiles, unsigned NumRemappedFiles) {
   if (!Invocation)
     return true;
@@ -1781,6 +2106,19 @@ bool ASTUnit::Reparse(RemappedFile *RemappedFiles, unsigned NumRemappedFiles) {
   SimpleTimer ParsingTimer(WantTiming);
   ParsingTimer.setOutput("Reparsing " + getMainFileName());
 
+  // Remember the diagnostics of the last parse while its source manager is
+  // still around, so that this one can tell which of its own are repeats.
+  llvm::StringSet<> PreviousDiagnostics;
+  if (TrackFileTokenHashes) {
+    for (unsigned I = NumStoredDiagnosticsFromDriver,
+                  N = StoredDiagnostics.size();
+         I != N; ++I) {
+      std::string Key;
+      if (getStoredDiagnosticKey(StoredDiagnostics[I], Key))
+        PreviousDiagnostics.insert(Key);
+    }
+  }
+
   // Remap files.
   PreprocessorOptions &PPOpts = Invocation->getPreprocessorOpts();
   PPOpts.DisableStatCache = true;
@@ -1819,6 +2157,22 @@ bool ASTUnit::Reparse(RemappedFile *RemappedFiles, unsigned NumRemappedFiles) {
   
   // Parse the sources
   bool Result = Parse(OverrideMainBuffer);
+
+  // A diagnostic is only repeated if the tokens of its file didn't change,
+  // since otherwise the same message at the same place may be about
+  // different code.
+  RepeatedDiagnostics.clear();
+  if (TrackFileTokenHashes) {
+    RepeatedDiagnostics.resize(StoredDiagnostics.size());
+    for (unsigned I = NumStoredDiagnosticsFromDriver,
+                  N = StoredDiagnostics.size();
+         I != N; ++I) {
+      std::string Key;
+      const FileEntry *File = getStoredDiagnosticKey(StoredDiagnostics[I], Key);
+      RepeatedDiagnostics[I] = File && !fileTokensChanged(File->getName()) &&
+                               PreviousDiagnostics.count(Key);
+    }
+  }
   
   // If we're caching global code-completion results, and the top-level 
   // declarations have changed, clear out the code-completion cache.
@@ -2347,6 +2701,24 @@ void ASTUnit::TranslateStoredDiagnostics(
   Result.swap(Out);
 }
 
+bool ASTUnit::getFileTokenHash(StringRef Filename, unsigned &Hash) const {
+  llvm::StringMap<unsigned>::const_iterator Known
+    = FileTokenHashes.find(Filename);
+  if (Known == FileTokenHashes.end())
+    return false;
+
+  Hash = Known->second;
+  return true;
+}
+
+bool ASTUnit::fileTokensChanged(StringRef Filename) const {
+  llvm::StringMap<unsigned>::const_iterator Previous
+    = PreviousFileTokenHashes.find(Filename);
+  unsigned Hash;
+  return Previous == PreviousFileTokenHashes.end() ||
+         !getFileTokenHash(Filename, Hash) || Previous->second != Hash;
+}
+
 SourceLocation ASTUnit::getLocation(const FileEntry *File,
                                     unsigned Line, unsigned Col) const {
   const SourceManager &SM = getSourceManager();
@@ -21,12 +21,14 @@
 #include "clang/Basic/SourceManager.h"
 #include "clang/Lex/Lexer.h"
 #include "clang/Lex/Preprocessor.h"
+#include "clang/Lex/PTHManager.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Path.h"
+#include <ctime>
 
 // FIXME: put this somewhere else?
 #ifndef S_ISDIR
@@ -43,15 +45,17 @@ using namespace clang::io;
 namespace {
 class PTHEntry {
   Offset TokenData, PPCondData;
+  uint64_t ContentHash;
 
 public:
   PTHEntry() {}
 
-  PTHEntry(Offset td, Offset ppcd)
-    : TokenData(td), PPCondData(ppcd) {}
+  PTHEntry(Offset td, Offset ppcd, uint64_t contentHash)
+    : TokenData(td), PPCondData(ppcd), ContentHash(contentHash) {}
 
   Offset getTokenOffset() const { return TokenData; }
   Offset getPPCondTableOffset() const { return PPCondData; }
+  uint64_t getContentHash() const { return ContentHash; }
 };
 
 
@@ -125,7 +129,7 @@ public:
     unsigned n = V.getString().size() + 1 + 1;
     ::Emit16(Out, n);
 
-    unsigned m = V.getRepresentationLength() + (V.isFile() ? 4 + 4 : 0);
+    unsigned m = V.getRepresentationLength() + (V.isFile() ? 4 + 4 + 8 : 0);
     ::Emit8(Out, m);
 
     return std::make_pair(n, m);
@@ -151,6 +155,10 @@ public:
 
     // Emit any other data associated with the key (i.e., stat information).
     V.EmitData(Out);
+
+    // For file entries emit the hash of the contents the tokens came from.
+    if (V.isFile())
+      ::Emit64(Out, E.getContentHash());
   }
 };
 
@@ -181,6 +189,9 @@ class PTHWriter {
   Offset CurStrOffset;
   std::vector<llvm::StringMapEntry<OffsetOpt>*> StrEntries;
 
+  /// The file offset of the last token emitted for the current file.
+  uint32_t LastTokenOffset;
+
   //// Get the persistent id for the given IdentifierInfo*.
   uint32_t ResolveID(const IdentifierInfo* II);
 
@@ -212,15 +223,15 @@ class PTHWriter {
   /// token data.
   Offset EmitFileTable() { return PM.Emit(Out); }
 
-  PTHEntry LexTokens(Lexer& L);
+  PTHEntry LexTokens(Lexer& L, uint64_t ContentHash);
   Offset EmitCachedSpellings();
 
 public:
   PTHWriter(llvm::raw_fd_ostream& out, Preprocessor& pp)
-    : Out(out), PP(pp), idcount(0), CurStrOffset(0) {}
+    : Out(out), PP(pp), idcount(0), CurStrOffset(0), LastTokenOffset(0) {}
 
   PTHMap &getPM() { return PM; }
-  void GeneratePTH(const std::string &MainFile);
+  void GeneratePTH(const std::string &MainFile, uint64_t CreationTime);
 };
 } // end anonymous namespace
 
@@ -238,12 +249,20 @@ uint32_t PTHWriter::ResolveID(const IdentifierInfo* II) {
 }
 
 void PTHWriter::EmitToken(const Token& T) {
-  // Emit the token kind, flags, and length.
-  Emit32(((uint32_t) T.getKind()) | ((((uint32_t) T.getFlags())) << 8)|
-         (((uint32_t) T.getLength()) << 16));
+  // Identifiers get their kind back from their IdentifierInfo when read, and
+  // not every keyword kind fits in the byte the kind is stored in.
+  tok::TokenKind Kind = T.getKind();
+  if (T.getIdentifierInfo())
+    Kind = tok::identifier;
+  assert(Kind < 256 && "Token kind doesn't fit in a byte");
+
+  // Emit the token kind and flags in a byte each, followed by the length.
+  Emit8(Kind);
+  Emit8(T.getFlags());
+  EmitVBR32(Out, T.getLength());
 
   if (!T.isLiteral()) {
-    Emit32(ResolveID(T.getIdentifierInfo()));
+    EmitVBR32(Out, ResolveID(T.getIdentifierInfo()));
   } else {
     // We cache *un-cleaned* spellings. This gives us 100% fidelity with the
     // source code.
@@ -260,19 +279,26 @@ void PTHWriter::EmitToken(const Token& T) {
     }
 
     // Emit the relative offset into the PTH file for the spelling string.
-    Emit32(E->getValue().getOffset());
+    EmitVBR32(Out, E->getValue().getOffset());
   }
 
   // Emit the offset into the original source file of this token so that we
-  // can reconstruct its SourceLocation.
-  Emit32(PP.getSourceManager().getFileOffset(T.getLocation()));
+  // can reconstruct its SourceLocation.  Within a line, tokens only record
+  // how far they are from the previous token, which usually fits in a byte.
+  uint32_t FileOffset = PP.getSourceManager().getFileOffset(T.getLocation());
+  if (PTHManager::hasAbsoluteOffset(Kind, T.getFlags())) {
+    EmitVBR32(Out, FileOffset);
+  } else {
+    assert(FileOffset >= LastTokenOffset && "Tokens out of order");
+    EmitVBR32(Out, FileOffset - LastTokenOffset);
+  }
+  LastTokenOffset = FileOffset;
 }
 
-PTHEntry PTHWriter::LexTokens(Lexer& L) {
-  // Pad 0's so that we emit tokens to a 4-byte alignment.
-  // This speed up reading them back in.
-  Pad(Out, 4);
+PTHEntry PTHWriter::LexTokens(Lexer& L, uint64_t ContentHash) {
+  // Tokens are variable-length, so they need no alignment.
   Offset TokenOff = (Offset) Out.tell();
+  LastTokenOffset = 0;
 
   // Keep track of matching '#if' ... '#endif'.
   typedef std::vector<std::pair<Offset, unsigned> > PPCondTable;
@@ -416,7 +442,8 @@ PTHEntry PTHWriter::LexTokens(Lexer& L) {
 
   assert(PPStartCond.empty() && "Error: imblanced preprocessor conditionals.");
 
-  // Next write out PPCond.
+  // Next write out PPCond, aligned so that it can be read in place.
+  Pad(Out, 4);
   Offset PPCondOff = (Offset) Out.tell();
 
   // Write out the size of PPCond so that clients can identifer empty tables.
@@ -431,7 +458,7 @@ PTHEntry PTHWriter::LexTokens(Lexer& L) {
     Emit32(x == i ? 0 : x);
   }
 
-  return PTHEntry(TokenOff, PPCondOff);
+  return PTHEntry(TokenOff, PPCondOff, ContentHash);
 }
 
 Offset PTHWriter::EmitCachedSpellings() {
@@ -445,9 +472,12 @@ Offset PTHWriter::EmitCachedSpellings() {
   return SpellingsOff;
 }
 
-void PTHWriter::GeneratePTH(const std::string &MainFile) {
-  // Generate the prologue.
+void PTHWriter::GeneratePTH(const std::string &MainFile,
+                            uint64_t CreationTime) {
+  // Generate the prologue.  The magic string is null-padded to 8 bytes so
+  // that the words after it are aligned.
   Out << "cfe-pth";
+  Emit8(0);
   Emit32(PTHManager::Version);
 
   // Leave 4 words for the prologue.
@@ -455,6 +485,10 @@ void PTHWriter::GeneratePTH(const std::string &MainFile) {
   for (unsigned i = 0; i < 4; ++i)
     Emit32(0);
 
+  // Record when the sources were read, so that readers know which
+  // modification times can be trusted.
+  ::Emit64(Out, CreationTime);
+
   // Write the name of the MainFile.
   if (!MainFile.empty()) {
     EmitString(MainFile);
@@ -484,16 +518,19 @@ void PTHWriter::GeneratePTH(const std::string &MainFile) {
     FileID FID = SM.createFileID(FE, SourceLocation(), SrcMgr::C_User);
     const llvm::MemoryBuffer *FromFile = SM.getBuffer(FID);
     Lexer L(FID, FromFile, SM, LOpts);
-    PM.insert(FE, LexTokens(L));
+    PM.insert(FE, LexTokens(L, PTHManager::getContentHash(B->getBuffer())));
   }
 
   // Write out the identifier table.
+  Pad(Out, 8);
   const std::pair<Offset,Offset> &IdTableOff = EmitIdentifierTable();
 
   // Write out the cached strings table.
   Offset SpellingOff = EmitCachedSpellings();
 
   // Write out the file table.
+  Pad(Out, 8);
+
   Offset FileTableOff = EmitFileTable();
 
   // Finally, write the prologue.
@@ -537,6 +574,10 @@ public:
 
 
 void clang::CacheTokens(Preprocessor &PP, llvm::raw_fd_ostream* OS) {
+  // Files modified from now on may change after their tokens are cached
+  // without their modification time showing it.
+  uint64_t CreationTime = (uint64_t) time(0);
+
   // Get the name of the main file.
   const SourceManager &SrcMgr = PP.getSourceManager();
   const FileEntry *MainFile = SrcMgr.getFileEntryForID(SrcMgr.getMainFileID());
@@ -559,7 +600,7 @@ void clang::CacheTokens(Preprocessor &PP, llvm::raw_fd_ostream* OS) {
 
   // Generate the PTH file.
   PP.getFileManager().removeStatCache(StatCache);
-  PW.GeneratePTH(MainFilePath.str());
+  PW.GeneratePTH(MainFilePath.str(), CreationTime);
 }
 
 //===----------------------------------------------------------------------===//
@@ -13,9 +13,11 @@
 #include "clang/AST/ASTContext.h"
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/FileManager.h"
+#include "clang/Basic/PersistentStatCache.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Basic/TargetInfo.h"
 #include "clang/Basic/Version.h"
+#include "clang/Lex/HeaderGuardIndex.h"
 #include "clang/Lex/HeaderSearch.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Lex/PTHManager.h"
@@ -204,6 +206,17 @@ CompilerInstance::createDiagnostics(const DiagnosticOptions &Opts,
 
 void CompilerInstance::createFileManager() {
   FileMgr = new FileManager(getFileSystemOpts());
+
+  const std::string &StatCacheFile = getFileSystemOpts().StatCacheFile;
+  if (!StatCacheFile.empty()) {
+    std::string Error;
+    if (PersistentStatCache *Cache =
+          PersistentStatCache::Create(StatCacheFile, Error))
+      FileMgr->addStatCache(Cache);
+    else
+      getDiagnostics().Report(diag::warn_fe_stat_cache_unusable)
+        << StatCacheFile << Error;
+  }
 }
 
 // Source Manager
@@ -240,8 +253,28 @@ void CompilerInstance::createPreprocessor() {
     PP->createPreprocessingRecord(
                                   PPOpts.DetailedRecordIncludesNestedMacroExpansions);
 
+  if (PPOpts.MacroExpansionCache)
+    PP->createMacroExpansionCache();
+
+  if (PPOpts.PackScratchBuffers)
+    PP->packScratchBuffers();
+
   InitializePreprocessor(*PP, PPOpts, getHeaderSearchOpts(), getFrontendOpts());
 
+  // The include guards found by earlier compiles live next to the stat cache.
+  const std::string &StatCacheFile = getFileSystemOpts().StatCacheFile;
+  if (!StatCacheFile.empty()) {
+    std::string GuardIndexFile = StatCacheFile + ".guards";
+    std::string Error;
+    if (HeaderGuardIndex *Index =
+          HeaderGuardIndex::Create(GuardIndexFile, PP->getIdentifierTable(),
+                                   Error))
+      PP->getHeaderSearchInfo().setHeaderGuardIndex(Index);
+    else
+      getDiagnostics().Report(diag::warn_fe_stat_cache_unusable)
+        << GuardIndexFile << Error;
+  }
+
   // Set up the module path, including the hash for the
   // module-creation options.
   llvm::SmallString<256> SpecificModuleCache(
@@ -412,6 +412,12 @@ static void FileSystemOptsToArgs(const FileSystemOptions &Opts,
     Res.push_back("-working-directory");
     Res.push_back(Opts.WorkingDir);
   }
+  if (!Opts.StatCacheFile.empty()) {
+    Res.push_back("-stat-cache");
+    Res.push_back(Opts.StatCacheFile);
+  }
+  if (Opts.MapSourceFiles)
+    Res.push_back("-map-source-files");
 }
 
 static void FrontendOptsToArgs(const FrontendOptions &Opts,
@@ -436,6 +442,8 @@ static void FrontendOptsToArgs(const FrontendOptions &Opts,
     Res.push_back("-version");
   if (Opts.FixWhatYouCan)
     Res.push_back("-fix-what-you-can");
+  if (Opts.SkipFunctionBodies)
+    Res.push_back("-skip-function-bodies");
   switch (Opts.ARCMTAction) {
   case FrontendOptions::ARCMT_None:
     break;
@@ -601,6 +609,8 @@ static void HeaderSearchOptsToArgs(const HeaderSearchOptions &Opts,
     Res.push_back("-stdlib=libc++");
   if (Opts.Verbose)
     Res.push_back("-v");
+  if (Opts.CacheSearchDirContents)
+    Res.push_back("-cache-search-dir-contents");
 }
 
 static void LangOptsToArgs(const LangOptions &Opts,
@@ -797,6 +807,10 @@ static void PreprocessorOptsToArgs(const PreprocessorOptions &Opts,
     Res.push_back("-undef");
   if (Opts.DetailedRecord)
     Res.push_back("-detailed-preprocessing-record");
+  if (Opts.MacroExpansionCache)
+    Res.push_back("-macro-expansion-cache");
+  if (Opts.PackScratchBuffers)
+    Res.push_back("-pack-scratch-buffers");
   if (!Opts.ImplicitPCHInclude.empty()) {
     Res.push_back("-include-pch");
     Res.push_back(Opts.ImplicitPCHInclude);
@@ -1190,6 +1204,8 @@ static void ParseDiagnosticArgs(DiagnosticOptions &Opts, ArgList &Args,
 
 static void ParseFileSystemArgs(FileSystemOptions &Opts, ArgList &Args) {
   Opts.WorkingDir = Args.getLastArgValue(OPT_working_directory);
+  Opts.StatCacheFile = Args.getLastArgValue(OPT_stat_cache);
+  Opts.MapSourceFiles = Args.hasArg(OPT_map_source_files);
 }
 
 static InputKind ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
@@ -1306,6 +1322,15 @@ static InputKind ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
   Opts.ASTMergeFiles = Args.getAllArgValues(OPT_ast_merge);
   Opts.LLVMArgs = Args.getAllArgValues(OPT_mllvm);
   Opts.FixWhatYouCan = Args.hasArg(OPT_fix_what_you_can);
+  Opts.SkipFunctionBodies = Args.hasArg(OPT_skip_function_bodies);
+  // Skipped bodies that are parsed later see the declarations that follow
+  // them, which is good enough for diagnostics but not for code.
+  if (Opts.SkipFunctionBodies &&
+      Opts.ProgramAction != frontend::ParseSyntaxOnly) {
+    Diags.Report(diag::err_drv_argument_only_allowed_with)
+      << "-skip-function-bodies" << "-fsyntax-only";
+    Opts.SkipFunctionBodies = false;
+  }
 
   Opts.ARCMTAction = FrontendOptions::ARCMT_None;
   if (const Arg *A = Args.getLastArg(OPT_arcmt_check,
@@ -1404,6 +1429,7 @@ static void ParseHeaderSearchArgs(HeaderSearchOptions &Opts, ArgList &Args) {
   Opts.UseBuiltinIncludes = !Args.hasArg(OPT_nobuiltininc);
   Opts.UseStandardSystemIncludes = !Args.hasArg(OPT_nostdsysteminc);
   Opts.UseStandardCXXIncludes = !Args.hasArg(OPT_nostdincxx);
+  Opts.CacheSearchDirContents = Args.hasArg(OPT_cache_search_dir_contents);
   if (const Arg *A = Args.getLastArg(OPT_stdlib_EQ))
     Opts.UseLibcxx = (strcmp(A->getValue(Args), "libc++") == 0);
   Opts.ResourceDir = Args.getLastArgValue(OPT_resource_dir);
@@ -1803,6 +1829,8 @@ static void ParsePreprocessorArgs(PreprocessorOptions &Opts, ArgList &Args,
     Opts.TokenCache = Opts.ImplicitPTHInclude;
   Opts.UsePredefines = !Args.hasArg(OPT_undef);
   Opts.DetailedRecord = Args.hasArg(OPT_detailed_preprocessing_record);
+  Opts.MacroExpansionCache = Args.hasArg(OPT_macro_expansion_cache);
+  Opts.PackScratchBuffers = Args.hasArg(OPT_pack_scratch_buffers);
   Opts.AutoModuleImport = Args.hasArg(OPT_fauto_module_import);
   Opts.DisablePCHValidation = Args.hasArg(OPT_fno_validate_pch);
 
@@ -36,6 +36,7 @@ class DependencyFileCallback : public PPCallbacks {
   bool IncludeSystemHeaders;
   bool PhonyTarget;
   bool AddMissingHeaderDeps;
+  std::vector<std::string> *CollectedFiles;
 private:
   bool FileMatchesDepCriteria(const char *Filename,
                               SrcMgr::CharacteristicKind FileType);
@@ -45,11 +46,13 @@ private:
 public:
   DependencyFileCallback(const Preprocessor *_PP,
                          raw_ostream *_OS,
-                         const DependencyOutputOptions &Opts)
+                         const DependencyOutputOptions &Opts,
+                         std::vector<std::string> *_CollectedFiles = 0)
     : PP(_PP), Targets(Opts.Targets), OS(_OS),
       IncludeSystemHeaders(Opts.IncludeSystemHeaders),
       PhonyTarget(Opts.UsePhonyTargets),
-      AddMissingHeaderDeps(Opts.AddMissingHeaderDeps) {}
+      AddMissingHeaderDeps(Opts.AddMissingHeaderDeps),
+      CollectedFiles(_CollectedFiles) {}
 
   virtual void FileChanged(SourceLocation Loc, FileChangeReason Reason,
                            SrcMgr::CharacteristicKind FileType,
@@ -64,9 +67,13 @@ public:
                                   StringRef RelativePath);
 
   virtual void EndOfMainFile() {
-    OutputDependencyFile();
-    delete OS;
-    OS = 0;
+    if (CollectedFiles)
+      *CollectedFiles = Files;
+    if (OS) {
+      OutputDependencyFile();
+      delete OS;
+      OS = 0;
+    }
   }
 };
 }
@@ -93,6 +100,15 @@ void clang::AttachDependencyFileGen(Preprocessor &PP,
   PP.addPPCallbacks(new DependencyFileCallback(&PP, OS, Opts));
 }
 
+void clang::AttachDependencyCollector(Preprocessor &PP,
+                                      const DependencyOutputOptions &Opts,
+                                      std::vector<std::string> &Files) {
+  if (Opts.AddMissingHeaderDeps)
+    PP.SetSuppressIncludeNotFoundError(true);
+
+  PP.addPPCallbacks(new DependencyFileCallback(&PP, 0, Opts, &Files));
+}
+
 /// FileMatchesDepCriteria - Determine whether the given Filename should be
 /// considered as a dependency.
 bool DependencyFileCallback::FileMatchesDepCriteria(const char *Filename,
@@ -9,6 +9,7 @@
 
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/AST/ASTConsumer.h"
+#include "clang/Lex/HeaderSearch.h"
 #include "clang/Lex/Pragma.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Parse/Parser.h"
@@ -160,8 +161,12 @@ void GeneratePTHAction::ExecuteAction() {
     // FIXME: Verify that we can actually seek in the given file.
     llvm::report_fatal_error("PTH requires a seekable file for output!");
   }
+  // Write to a temporary file which is renamed into place once complete, so
+  // that concurrent readers never see a partially written PTH file.
   llvm::raw_fd_ostream *OS =
-    CI.createDefaultOutputFile(true, getCurrentFile());
+    CI.createOutputFile(CI.getFrontendOpts().OutputFile, /*Binary=*/true,
+                        /*RemoveFileOnSignal=*/true, getCurrentFile(),
+                        /*Extension=*/"", /*UseTemporary=*/true);
   if (!OS) return;
 
   CacheTokens(CI.getPreprocessor(), OS);
@@ -181,6 +186,16 @@ void PreprocessOnlyAction::ExecuteAction() {
   } while (Tok.isNot(tok::eof));
 }
 
+bool ScanDependenciesAction::BeginSourceFileAction(CompilerInstance &CI,
+                                                   StringRef Filename) {
+  Preprocessor &PP = CI.getPreprocessor();
+  if (SharedDirIndex)
+    PP.getHeaderSearchInfo().setSharedDirectoryIndex(SharedDirIndex);
+  if (Dependencies)
+    AttachDependencyCollector(PP, CI.getDependencyOutputOpts(), *Dependencies);
+  return true;
+}
+
 void PrintPreprocessedAction::ExecuteAction() {
   CompilerInstance &CI = getCompilerInstance();
   // Output file may need to be set to 'Binary', to avoid converting Unix style
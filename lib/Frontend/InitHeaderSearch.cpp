@@ -665,4 +665,7 @@ void clang::ApplyHeaderSearchOptions(HeaderSearch &HS,
   Init.AddDefaultIncludePaths(Lang, Triple, HSOpts);
 
   Init.Realize(Lang);
+
+  if (HSOpts.CacheSearchDirContents)
+    HS.enableDirectoryIndex();
 }
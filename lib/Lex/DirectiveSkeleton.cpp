@@ -0,0 +1,88 @@
+//===--- DirectiveSkeleton.cpp - Conditional directives of a file ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the DirectiveSkeleton interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "DirectiveSkeleton.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/Basic/SourceManager.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <algorithm>
+using namespace clang;
+
+/// isConditionalDirective - Return true if Name is the name of a directive
+/// SkipExcludedConditionalBlock reacts to.
+static bool isConditionalDirective(StringRef Name) {
+  return Name == "if" || Name == "ifdef" || Name == "ifndef" ||
+         Name == "elif" || Name == "else" || Name == "endif";
+}
+
+DirectiveSkeleton *DirectiveSkeleton::Build(FileID FID,
+                                            const SourceManager &SM,
+                                            const LangOptions &Features) {
+  const llvm::MemoryBuffer *Buffer = SM.getBuffer(FID);
+  Lexer RawLex(FID, Buffer, SM, Features);
+  const char *BufferStart = Buffer->getBufferStart();
+
+  DirectiveSkeleton *Skeleton = new DirectiveSkeleton();
+  Token Tok;
+  RawLex.LexFromRawLexer(Tok);
+  while (Tok.isNot(tok::eof)) {
+    if (Tok.isNot(tok::hash) || !Tok.isAtStartOfLine()) {
+      RawLex.LexFromRawLexer(Tok);
+      continue;
+    }
+
+    Directive D;
+    D.HashOffset = RawLex.getBufferLocation() - BufferStart - Tok.getLength();
+
+    // The directive name has to be on the same line as the '#'.  Anything
+    // else (including a '#' on the next line) is looked at again.
+    RawLex.LexFromRawLexer(Tok);
+    if (Tok.isNot(tok::raw_identifier) || Tok.isAtStartOfLine())
+      continue;
+    D.NameOffset = RawLex.getBufferLocation() - BufferStart - Tok.getLength();
+
+    StringRef Name(Tok.getRawIdentifierData(), Tok.getLength());
+    std::string CleanName;
+    if (Tok.needsCleaning()) {
+      CleanName = Lexer::getSpelling(Tok, SM, Features);
+      Name = CleanName;
+    }
+    if (isConditionalDirective(Name))
+      Skeleton->Directives.push_back(D);
+
+    RawLex.LexFromRawLexer(Tok);
+  }
+
+  return Skeleton;
+}
+
+namespace {
+struct NameOffsetLess {
+  bool operator()(const DirectiveSkeleton::Directive &D,
+                  unsigned Offset) const {
+    return D.NameOffset < Offset;
+  }
+};
+}
+
+bool DirectiveSkeleton::findDirectiveNamedAt(unsigned Offset,
+                                             unsigned &Index) const {
+  std::vector<Directive>::const_iterator I
+    = std::lower_bound(Directives.begin(), Directives.end(), Offset,
+                       NameOffsetLess());
+  if (I == Directives.end() || I->NameOffset != Offset)
+    return false;
+  Index = I - Directives.begin();
+  return true;
+}
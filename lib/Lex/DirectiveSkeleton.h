@@ -0,0 +1,61 @@
+//===--- DirectiveSkeleton.h - Conditional directives of a file -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the DirectiveSkeleton interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_DIRECTIVESKELETON_H
+#define LLVM_CLANG_DIRECTIVESKELETON_H
+
+#include "clang/Basic/SourceLocation.h"
+
+#include <vector>
+
+namespace clang {
+  class LangOptions;
+  class SourceManager;
+
+/// DirectiveSkeleton - The positions of all of the conditional directives
+/// (#if, #ifdef, #ifndef, #elif, #else and #endif) of a file, in order.  With
+/// them, SkipExcludedConditionalBlock can jump from one conditional directive
+/// to the next instead of lexing every token in between.
+///
+/// The directives are found with a raw lexer which sees exactly the tokens
+/// SkipExcludedConditionalBlock would see, so the offsets only depend on the
+/// contents of the file and the language options.
+class DirectiveSkeleton {
+public:
+  struct Directive {
+    /// HashOffset - The offset of the '#' which starts the directive.
+    unsigned HashOffset;
+
+    /// NameOffset - The offset of the directive name, e.g. "ifdef".
+    unsigned NameOffset;
+  };
+
+private:
+  std::vector<Directive> Directives;
+
+public:
+  /// Build - Lex the given file and collect its conditional directives.
+  static DirectiveSkeleton *Build(FileID FID, const SourceManager &SM,
+                                  const LangOptions &Features);
+
+  /// findDirectiveNamedAt - If a conditional directive has its name at the
+  /// given offset, set Index to its position in the skeleton and return true.
+  bool findDirectiveNamedAt(unsigned Offset, unsigned &Index) const;
+
+  unsigned size() const { return Directives.size(); }
+  const Directive &operator[](unsigned I) const { return Directives[I]; }
+};
+
+}  // end namespace clang
+
+#endif
@@ -0,0 +1,93 @@
+//===--- DirectoryIndex.cpp - Cached directory listings -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the DirectoryIndex interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Lex/DirectoryIndex.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/system_error.h"
+#include <cstdio>
+using namespace clang;
+
+DirectoryIndex::DirectoryIndex()
+  : NumDirsRead(0), NumEntries(0), NumNegativeLookups(0),
+    NumPositiveLookups(0), NumUnknownLookups(0) {
+}
+
+DirectoryIndex::~DirectoryIndex() {
+  for (llvm::StringMap<DirContents *>::iterator I = Dirs.begin(),
+       E = Dirs.end(); I != E; ++I)
+    delete I->getValue();
+}
+
+/// getContents - Return the names in the directory Dir, reading it if this is
+/// the first time it is asked for.
+const DirectoryIndex::DirContents &DirectoryIndex::getContents(StringRef Dir) {
+  DirContents *&Contents = Dirs.GetOrCreateValue(Dir).getValue();
+  if (Contents)
+    return *Contents;
+
+  Contents = new DirContents();
+  ++NumDirsRead;
+
+  llvm::error_code EC;
+  for (llvm::sys::fs::directory_iterator I(Dir, EC), E;
+       !EC && I != E; I = I.increment(EC)) {
+    Contents->Names.insert(llvm::sys::path::filename(I->path()).lower());
+    ++NumEntries;
+  }
+  Contents->Complete = !EC;
+  return *Contents;
+}
+
+bool DirectoryIndex::mayContain(StringRef Dir, StringRef RelPath) {
+  llvm::sys::SmartScopedLock<true> Guard(Lock);
+  llvm::SmallString<256> Path(Dir);
+  while (!RelPath.empty()) {
+    std::pair<StringRef, StringRef> Split = RelPath.split('/');
+    StringRef Name = Split.first;
+
+    // Leave anything that isn't a plain name to the file system.
+    if (Name.empty() || Name == "." || Name == ".." ||
+        Name.find('\\') != StringRef::npos) {
+      ++NumUnknownLookups;
+      return true;
+    }
+
+    const DirContents &Contents = getContents(Path.str());
+    if (!Contents.Complete) {
+      ++NumUnknownLookups;
+      return true;
+    }
+    if (!Contents.Names.count(Name.lower())) {
+      ++NumNegativeLookups;
+      return false;
+    }
+
+    llvm::sys::path::append(Path, Name);
+    RelPath = Split.second;
+  }
+
+  ++NumPositiveLookups;
+  return true;
+}
+
+void DirectoryIndex::PrintStats() const {
+  llvm::sys::SmartScopedLock<true> Guard(Lock);
+  fprintf(stderr, "%u search directories indexed, %u entries.\n",
+          NumDirsRead, NumEntries);
+  fprintf(stderr, "  %u lookups answered as missing by the index.\n",
+          NumNegativeLookups);
+  fprintf(stderr, "  %u lookups passed to the file system, %u unknown.\n",
+          NumPositiveLookups + NumUnknownLookups, NumUnknownLookups);
+}
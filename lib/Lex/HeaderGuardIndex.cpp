@@ -0,0 +1,131 @@
+//===--- HeaderGuardIndex.cpp - Persistent include guard index ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the HeaderGuardIndex interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Lex/HeaderGuardIndex.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Basic/IdentifierTable.h"
+#include "clang/Basic/PersistentRecordLog.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/DataTypes.h"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+using namespace clang;
+
+static const char GuardIndexMagic[8] = { 'C', 'L', 'G', 'U', 'A', 'R', 'D', 0 };
+static const uint32_t GuardIndexVersion = 1;
+
+/// Guards are only recorded for headers which haven't been modified for this
+/// many seconds.  Modification times may have one second resolution, so a
+/// header edited in the same second as the recorded time, without changing
+/// its size, would otherwise keep its stale entry.
+static const uint64_t MinFileAge = 2;
+
+namespace {
+/// \brief The part of a record identifying the header it describes; the name
+/// of the controlling macro follows it.
+struct GuardKey {
+  uint64_t Device;
+  uint64_t Inode;
+  uint64_t Size;
+  uint64_t MTime;
+};
+}
+
+/// getGuardKey - Compute the key for File.  Returns false for virtual files,
+/// which have no identity on disk.
+static bool getGuardKey(const FileEntry *File, GuardKey &Key) {
+  memset(&Key, 0, sizeof(Key));
+  Key.Device = File->getDevice();
+  Key.Inode = File->getInode();
+  Key.Size = File->getSize();
+  Key.MTime = File->getModificationTime();
+  return Key.Device != 0 || Key.Inode != 0;
+}
+
+HeaderGuardIndex::HeaderGuardIndex(PersistentRecordLog *Log,
+                                   IdentifierTable &Identifiers)
+  : Log(Log), Identifiers(Identifiers), NumRecordsLoaded(0),
+    NumRecordsAdded(0), NumLookups(0), NumFound(0) {
+}
+
+HeaderGuardIndex::~HeaderGuardIndex() {
+}
+
+HeaderGuardIndex *HeaderGuardIndex::Create(StringRef FileName,
+                                           IdentifierTable &Identifiers,
+                                           std::string &ErrorStr) {
+  PersistentRecordLog *Log =
+    PersistentRecordLog::Open(FileName, "header guard index", GuardIndexMagic,
+                              GuardIndexVersion, ErrorStr);
+  if (!Log)
+    return 0;
+
+  HeaderGuardIndex *Index = new HeaderGuardIndex(Log, Identifiers);
+
+  // Later records for the same header replace earlier ones.
+  SmallVector<StringRef, 256> Records;
+  Log->getRecords(Records);
+  for (unsigned i = 0, e = Records.size(); i != e; ++i) {
+    if (Records[i].size() <= sizeof(GuardKey))
+      continue;
+    Index->Guards[Records[i].substr(0, sizeof(GuardKey))] =
+      Records[i].substr(sizeof(GuardKey));
+    ++Index->NumRecordsLoaded;
+  }
+
+  return Index;
+}
+
+const IdentifierInfo *
+HeaderGuardIndex::getControllingMacro(const FileEntry *File) {
+  GuardKey Key;
+  if (!getGuardKey(File, Key))
+    return 0;
+
+  ++NumLookups;
+  llvm::StringMap<std::string>::iterator I =
+    Guards.find(StringRef((const char *)&Key, sizeof(Key)));
+  if (I == Guards.end())
+    return 0;
+
+  ++NumFound;
+  return &Identifiers.get(I->getValue());
+}
+
+void HeaderGuardIndex::setControllingMacro(const FileEntry *File,
+                                      const IdentifierInfo *ControllingMacro) {
+  GuardKey Key;
+  if (!getGuardKey(File, Key) || Key.MTime + MinFileAge > uint64_t(::time(0)))
+    return;
+
+  StringRef KeyStr((const char *)&Key, sizeof(Key));
+  StringRef Name = ControllingMacro->getName();
+  std::string &Guard = Guards[KeyStr];
+  if (Guard == Name)
+    return;
+  Guard = Name;
+
+  llvm::SmallString<128> Record(KeyStr);
+  Record += Name;
+  if (Log->append(Record))
+    ++NumRecordsAdded;
+}
+
+void HeaderGuardIndex::PrintStats() const {
+  fprintf(stderr, "%u header guards loaded, %u added.\n",
+          NumRecordsLoaded, NumRecordsAdded);
+  fprintf(stderr, "  %u of %u header guard lookups found a guard.\n",
+          NumFound, NumLookups);
+}
@@ -12,6 +12,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/DirectoryIndex.h"
+#include "clang/Lex/HeaderGuardIndex.h"
 #include "clang/Lex/HeaderMap.h"
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/IdentifierTable.h"
@@ -41,11 +43,15 @@ HeaderSearch::HeaderSearch(FileManager &FM)
   AngledDirIdx = 0;
   SystemDirIdx = 0;
   NoCurDirSearch = false;
+  DirIndex = 0;
+  OwnsDirIndex = false;
+  GuardIndex = 0;
 
   ExternalLookup = 0;
   ExternalSource = 0;
   NumIncluded = 0;
   NumMultiIncludeFileOptzn = 0;
+  NumGuardIndexSkips = 0;
   NumFrameworkLookups = NumSubFrameworkLookups = 0;
 }
 
@@ -53,6 +59,9 @@ HeaderSearch::~HeaderSearch() {
   // Delete headermaps.
   for (unsigned i = 0, e = HeaderMaps.size(); i != e; ++i)
     delete HeaderMaps[i].second;
+  if (OwnsDirIndex)
+    delete DirIndex;
+  delete GuardIndex;
 }
 
 void HeaderSearch::PrintStats() {
@@ -72,9 +81,46 @@ void HeaderSearch::PrintStats() {
   fprintf(stderr, "  %d #include/#include_next/#import.\n", NumIncluded);
   fprintf(stderr, "    %d #includes skipped due to"
           " the multi-include optimization.\n", NumMultiIncludeFileOptzn);
+  fprintf(stderr, "    %d #includes skipped due to"
+          " the header guard index.\n", NumGuardIndexSkips);
 
   fprintf(stderr, "%d framework lookups.\n", NumFrameworkLookups);
   fprintf(stderr, "%d subframework lookups.\n", NumSubFrameworkLookups);
+
+  if (DirIndex)
+    DirIndex->PrintStats();
+  if (GuardIndex)
+    GuardIndex->PrintStats();
+}
+
+void HeaderSearch::setHeaderGuardIndex(HeaderGuardIndex *Index) {
+  delete GuardIndex;
+  GuardIndex = Index;
+}
+
+void HeaderSearch::SetFileControllingMacro(const FileEntry *File,
+                                      const IdentifierInfo *ControllingMacro) {
+  getFileInfo(File).ControllingMacro = ControllingMacro;
+  if (GuardIndex)
+    GuardIndex->setControllingMacro(File, ControllingMacro);
+}
+
+void HeaderSearch::enableDirectoryIndex() {
+  if (!DirIndex) {
+    DirIndex = new DirectoryIndex();
+    OwnsDirIndex = true;
+  }
+}
+
+void HeaderSearch::setSharedDirectoryIndex(DirectoryIndex *Index) {
+  if (OwnsDirIndex)
+    delete DirIndex;
+  DirIndex = Index;
+  OwnsDirIndex = false;
+}
+
+bool HeaderSearch::mayContainFile(StringRef Dir, StringRef RelPath) {
+  return !DirIndex || DirIndex->mayContain(Dir, RelPath);
 }
 
 /// CreateHeaderMap - This method returns a HeaderMap for the specified
@@ -191,6 +237,8 @@ const FileEntry *DirectoryLookup::LookupFile(
       RelativePath->clear();
       RelativePath->append(Filename.begin(), Filename.end());
     }
+    if (!HS.mayContainFile(getDir()->getName(), Filename))
+      return 0;
     return HS.getFileMgr().getFile(TmpDir.str(), /*openFile=*/true);
   }
 
@@ -249,6 +297,11 @@ const FileEntry *DirectoryLookup::DoFrameworkLookup(
   if (FrameworkName.empty() || FrameworkName.back() != '/')
     FrameworkName.push_back('/');
 
+  // The part of FrameworkName after this point is relative to the framework
+  // directory, which is what the directory index is asked about.
+  StringRef FrameworkDirName = getFrameworkDir()->getName();
+  unsigned RelFrameworkStart = FrameworkName.size();
+
   // FrameworkName = "/System/Library/Frameworks/Cocoa"
   FrameworkName.append(Filename.begin(), Filename.begin()+SlashPos);
 
@@ -262,6 +315,9 @@ const FileEntry *DirectoryLookup::DoFrameworkLookup(
 
     // If the framework dir doesn't exist, we fail.
     // FIXME: It's probably more efficient to query this with FileMgr.getDir.
+    if (!HS.mayContainFile(FrameworkDirName,
+                           StringRef(FrameworkName).substr(RelFrameworkStart)))
+      return 0;
     bool Exists;
     if (llvm::sys::fs::exists(FrameworkName.str(), Exists) || !Exists)
       return 0;
@@ -293,12 +349,14 @@ const FileEntry *DirectoryLookup::DoFrameworkLookup(
     !Filename.substr(SlashPos + 1).startswith("..");
   
   FrameworkName.append(Filename.begin()+SlashPos+1, Filename.end());
-  if (const FileEntry *FE = FileMgr.getFile(FrameworkName.str(),
-                                            /*openFile=*/!AutomaticImport)) {
-    if (AutomaticImport)
-      *SuggestedModule = StringRef(Filename.begin(), SlashPos);
-    return FE;
-  }
+  if (HS.mayContainFile(FrameworkDirName,
+                        StringRef(FrameworkName).substr(RelFrameworkStart)))
+    if (const FileEntry *FE = FileMgr.getFile(FrameworkName.str(),
+                                              /*openFile=*/!AutomaticImport)) {
+      if (AutomaticImport)
+        *SuggestedModule = StringRef(Filename.begin(), SlashPos);
+      return FE;
+    }
 
   // Check "/System/Library/Frameworks/Cocoa.framework/PrivateHeaders/file.h"
   const char *Private = "Private";
@@ -308,6 +366,9 @@ const FileEntry *DirectoryLookup::DoFrameworkLookup(
     SearchPath->insert(SearchPath->begin()+OrigSize, Private,
                        Private+strlen(Private));
 
+  if (!HS.mayContainFile(FrameworkDirName,
+                         StringRef(FrameworkName).substr(RelFrameworkStart)))
+    return 0;
   const FileEntry *FE = FileMgr.getFile(FrameworkName.str(), 
                                         /*openFile=*/!AutomaticImport);
   if (FE && AutomaticImport)
@@ -640,8 +701,11 @@ void HeaderSearch::setHeaderFileInfoForUID(HeaderFileInfo HFI, unsigned UID) {
 /// ShouldEnterIncludeFile - Mark the specified file as a target of of a
 /// #include, #include_next, or #import directive.  Return false if #including
 /// the file will have no effect or true if we should include it.
-bool HeaderSearch::ShouldEnterIncludeFile(const FileEntry *File, bool isImport){
+bool HeaderSearch::ShouldEnterIncludeFile(const FileEntry *File, bool isImport,
+                                          bool *FromGuardIndex) {
   ++NumIncluded; // Count # of attempted #includes.
+  if (FromGuardIndex)
+    *FromGuardIndex = false;
 
   // Get information about this file.
   HeaderFileInfo &FileInfo = getFileInfo(File);
@@ -670,6 +734,22 @@ bool HeaderSearch::ShouldEnterIncludeFile(const FileEntry *File, bool isImport){
       return false;
     }
 
+  // If this file hasn't been lexed yet, an earlier compile may have found its
+  // guard.  Skipping it now has the same effect as entering it and finding
+  // the guard macro defined, without even opening the file.  Later #includes
+  // of the file are then left to the multiple-include optimization.
+  if (GuardIndex && !FileInfo.NumIncludes && !FileInfo.ControllingMacro)
+    if (const IdentifierInfo *ControllingMacro =
+          GuardIndex->getControllingMacro(File))
+      if (ControllingMacro->hasMacroDefinition()) {
+        ++NumGuardIndexSkips;
+        ++FileInfo.NumIncludes;
+        FileInfo.ControllingMacro = ControllingMacro;
+        if (FromGuardIndex)
+          *FromGuardIndex = true;
+        return false;
+      }
+
   // Increment the number of times this file has been included.
   ++FileInfo.NumIncludes;
 
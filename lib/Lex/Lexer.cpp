@@ -31,8 +31,15 @@
 #include "clang/Basic/SourceManager.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/Compiler.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#elif __ALTIVEC__
+#include <altivec.h>
+#undef bool
+#endif
 using namespace clang;
 
 static void InitCharacterInfo();
@@ -931,6 +938,126 @@ static inline bool isRawStringDelimBody(unsigned char c) {
 }
 
 
+//===----------------------------------------------------------------------===//
+// Bulk character scanning.
+//===----------------------------------------------------------------------===//
+//
+// The scanners below skip runs of "uninteresting" characters 16 bytes at a
+// time when SSE2 is available.  Each one only runs its vector loop while a
+// whole 16-byte block fits before BufferEnd, then finishes with the scalar
+// loop.  Since the buffer is always nul terminated and none of the skipped
+// character classes include '\0', the scalar loop stops at the end of the
+// buffer (or at a code completion point) without an explicit bounds check.
+
+#ifdef __SSE2__
+/// getByteMask - Return a 16-bit mask with one bit set for each byte of V that
+/// equals C.
+static inline unsigned getByteMask(__m128i V, char C) {
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(V, _mm_set1_epi8(C)));
+}
+
+/// getRangeMask - Return a 16-bit mask with one bit set for each byte of V in
+/// the inclusive ASCII range [Lo, Hi].  Bytes >= 0x80 compare as negative and
+/// are never part of the range.
+static inline unsigned getRangeMask(__m128i V, char Lo, char Hi) {
+  __m128i AboveLo = _mm_cmpgt_epi8(V, _mm_set1_epi8(Lo-1));
+  __m128i BelowHi = _mm_cmplt_epi8(V, _mm_set1_epi8(Hi+1));
+  return _mm_movemask_epi8(_mm_and_si128(AboveLo, BelowHi));
+}
+
+static inline __m128i loadBlock(const char *Ptr) {
+  return _mm_loadu_si128((const __m128i*)Ptr);
+}
+#endif
+
+/// SkipIdentifierBody - Return a pointer to the first character at or after
+/// CurPtr that is not [a-zA-Z0-9_].
+static inline const char *SkipIdentifierBody(const char *CurPtr,
+                                             const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr+16 <= BufferEnd) {
+    __m128i V = loadBlock(CurPtr);
+    // Folding in 0x20 maps 'A'-'Z' onto 'a'-'z' and nothing else onto it.
+    unsigned Ident = getRangeMask(_mm_or_si128(V, _mm_set1_epi8(0x20)),
+                                  'a', 'z') |
+                     getRangeMask(V, '0', '9') | getByteMask(V, '_');
+    if (unsigned Stop = ~Ident & 0xFFFF)
+      return CurPtr + llvm::CountTrailingZeros_32(Stop);
+    CurPtr += 16;
+  }
+#endif
+  while (isIdentifierBody(*CurPtr))
+    ++CurPtr;
+  return CurPtr;
+}
+
+/// SkipHorizontalWhitespace - Return a pointer to the first character at or
+/// after CurPtr that is not ' ', '\t', '\f' or '\v'.
+static inline const char *SkipHorizontalWhitespace(const char *CurPtr,
+                                                   const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr+16 <= BufferEnd) {
+    __m128i V = loadBlock(CurPtr);
+    unsigned Space = getByteMask(V, ' ') | getByteMask(V, '\t') |
+                     getByteMask(V, '\f') | getByteMask(V, '\v');
+    if (unsigned Stop = ~Space & 0xFFFF)
+      return CurPtr + llvm::CountTrailingZeros_32(Stop);
+    CurPtr += 16;
+  }
+#endif
+  while (isHorizontalWhitespace(*CurPtr))
+    ++CurPtr;
+  return CurPtr;
+}
+
+/// FindEndOfLineCommentRun - Return a pointer to the first '\n', '\r' or nul
+/// character at or after CurPtr.
+static inline const char *FindEndOfLineCommentRun(const char *CurPtr,
+                                                  const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr+16 <= BufferEnd) {
+    __m128i V = loadBlock(CurPtr);
+    if (unsigned Stop = getByteMask(V, '\n') | getByteMask(V, '\r') |
+                        getByteMask(V, 0))
+      return CurPtr + llvm::CountTrailingZeros_32(Stop);
+    CurPtr += 16;
+  }
+#endif
+  while (*CurPtr != 0 && *CurPtr != '\n' && *CurPtr != '\r')
+    ++CurPtr;
+  return CurPtr;
+}
+
+/// FindEndOfStringRun - Return a pointer to the first character at or after
+/// CurPtr that needs attention inside the body of a string literal, character
+/// constant or angled include name: the closing Terminator ('"', '\'' or '>'),
+/// a '\\' (escape or escaped newline), a '?' (possible trigraph), a newline or
+/// a nul.  Every character skipped is known to need no cleaning.
+static inline const char *FindEndOfStringRun(const char *CurPtr,
+                                             const char *BufferEnd,
+                                             char Terminator) {
+#ifdef __SSE2__
+  while (CurPtr+16 <= BufferEnd) {
+    __m128i V = loadBlock(CurPtr);
+    if (unsigned Stop = getByteMask(V, Terminator) | getByteMask(V, '\\') |
+                        getByteMask(V, '?') | getByteMask(V, '\n') |
+                        getByteMask(V, '\r') | getByteMask(V, 0))
+      return CurPtr + llvm::CountTrailingZeros_32(Stop);
+    CurPtr += 16;
+  }
+#endif
+  for (;; ++CurPtr) {
+    switch (*CurPtr) {
+    case '\\': case '?': case '\n': case '\r': case 0:
+      return CurPtr;
+    default:
+      if (*CurPtr == Terminator)
+        return CurPtr;
+      break;
+    }
+  }
+}
+
 //===----------------------------------------------------------------------===//
 // Diagnostics forwarding code.
 //===----------------------------------------------------------------------===//
@@ -1260,11 +1387,8 @@ void Lexer::SkipBytes(unsigned Bytes, bool StartOfLine) {
 void Lexer::LexIdentifier(Token &Result, const char *CurPtr) {
   // Match [_A-Za-z0-9]*, we have already matched [_A-Za-z$]
   unsigned Size;
-  unsigned char C = *CurPtr++;
-  while (isIdentifierBody(C))
-    C = *CurPtr++;
-
-  --CurPtr;   // Back up over the skipped character.
+  CurPtr = SkipIdentifierBody(CurPtr, BufferEnd);
+  unsigned char C = *CurPtr;
 
   // Fast path, no $,\,? in identifier found.  '\' might be an escaped newline
   // or UCN, and ? might be a trigraph for '\', an escaped newline or UCN.
@@ -1379,6 +1503,10 @@ void Lexer::LexStringLiteral(Token &Result, const char *CurPtr,
        Kind == tok::utf32_string_literal))
     Diag(BufferPtr, diag::warn_cxx98_compat_unicode_literal);
 
+  // Skip over the plain characters of the string in bulk; anything that could
+  // be an escape, trigraph, newline or nul is handled one character at a time
+  // below.
+  CurPtr = FindEndOfStringRun(CurPtr, BufferEnd, '"');
   char C = getAndAdvanceChar(CurPtr, Result);
   while (C != '"') {
     // Skip escaped characters.  Escaped newlines will already be processed by
@@ -1403,6 +1531,7 @@ void Lexer::LexStringLiteral(Token &Result, const char *CurPtr,
 
       NulCharacter = CurPtr-1;
     }
+    CurPtr = FindEndOfStringRun(CurPtr, BufferEnd, '"');
     C = getAndAdvanceChar(CurPtr, Result);
   }
 
@@ -1512,6 +1641,7 @@ void Lexer::LexAngledStringLiteral(Token &Result, const char *CurPtr) {
     } else if (C == 0) {
       NulCharacter = CurPtr-1;
     }
+    CurPtr = FindEndOfStringRun(CurPtr, BufferEnd, '>');
     C = getAndAdvanceChar(CurPtr, Result);
   }
 
@@ -1565,6 +1695,7 @@ void Lexer::LexCharConstant(Token &Result, const char *CurPtr,
 
       NulCharacter = CurPtr-1;
     }
+    CurPtr = FindEndOfStringRun(CurPtr, BufferEnd, '\'');
     C = getAndAdvanceChar(CurPtr, Result);
   }
 
@@ -1588,8 +1719,10 @@ bool Lexer::SkipWhitespace(Token &Result, const char *CurPtr) {
   unsigned char Char = *CurPtr;  // Skip consequtive spaces efficiently.
   while (1) {
     // Skip horizontal whitespace very aggressively.
-    while (isHorizontalWhitespace(Char))
-      Char = *++CurPtr;
+    if (isHorizontalWhitespace(Char)) {
+      CurPtr = SkipHorizontalWhitespace(CurPtr+1, BufferEnd);
+      Char = *CurPtr;
+    }
 
     // Otherwise if we have something other than whitespace, we're done.
     if (Char != '\n' && Char != '\r')
@@ -1646,11 +1779,10 @@ bool Lexer::SkipBCPLComment(Token &Result, const char *CurPtr) {
   // them.  As such, optimize for this case with the inner loop.
   char C;
   do {
+    // Skip over characters in the fast loop, stopping at a potential EOF or
+    // a newline (or DOS-style newline).
+    CurPtr = FindEndOfLineCommentRun(CurPtr, BufferEnd);
     C = *CurPtr;
-    // Skip over characters in the fast loop.
-    while (C != 0 &&                // Potentially EOF.
-           C != '\n' && C != '\r')  // Newline or DOS-style newline.
-      C = *++CurPtr;
 
     const char *NextLine = CurPtr;
     if (C != 0) {
@@ -1853,13 +1985,6 @@ static bool isEndOfBlockCommentWithEscapedNewLine(const char *CurPtr,
   return true;
 }
 
-#ifdef __SSE2__
-#include <emmintrin.h>
-#elif __ALTIVEC__
-#include <altivec.h>
-#undef bool
-#endif
-
 /// SkipBlockComment - We have just read the /* characters from input.  Read
 /// until we find the */ characters that terminate the comment.  Note that we
 /// don't bother decoding trigraphs or escaped newlines in block comments,
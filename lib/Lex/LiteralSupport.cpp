@@ -18,6 +18,7 @@
 #include "clang/Basic/TargetInfo.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
 using namespace clang;
 
 /// HexDigitValue - Return the value of the specified hex digit, or -1 if it's
@@ -644,24 +645,70 @@ void NumericLiteralParser::ParseNumberStartingWithZero(SourceLocation TokLoc) {
 }
 
 
+/// ParseEightDecimalDigits - Return the value of the eight decimal digits
+/// starting at Digits, converting them all at once: the digits are loaded
+/// into the bytes of a uint64_t, most significant digit in the low byte, and
+/// adjacent pairs, then quads, then octets are combined with a multiply each.
+static inline uint32_t ParseEightDecimalDigits(const char *Digits) {
+  uint64_t Chunk = 0;
+  for (unsigned i = 0; i != 8; ++i)
+    Chunk |= uint64_t((unsigned char)Digits[i]) << (8*i);
+  Chunk -= 0x3030303030303030ULL;
+
+  // Each even byte now holds the value of a pair of digits...
+  Chunk = Chunk * 10 + (Chunk >> 8);
+  // ...and these multiplies shift each pair into place in the high half.
+  Chunk = ((Chunk & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)) +
+           ((Chunk >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))
+          >> 32;
+  return uint32_t(Chunk);
+}
+
+/// GetUInt64Value - Compute the value of this integer literal in a uint64_t.
+/// Return false if the value doesn't fit.
+bool NumericLiteralParser::GetUInt64Value(uint64_t &N) {
+  unsigned NumDigits = SuffixBegin - DigitsBegin;
+  N = 0;
+
+  if (radix == 10) {
+    // Nineteen decimal digits always fit, so they need no overflow checks.
+    // Convert them eight at a time.
+    if (NumDigits <= 19) {
+      s = DigitsBegin;
+      for (; SuffixBegin - s >= 8; s += 8)
+        N = N * 100000000 + ParseEightDecimalDigits(s);
+      for (; s != SuffixBegin; ++s)
+        N = N*10 + (*s - '0');
+      return true;
+    }
+  } else {
+    // The other radixes are powers of two: just count the bits.
+    unsigned BitsPerDigit = llvm::CountTrailingZeros_32(radix);
+    if (NumDigits * BitsPerDigit <= 64) {
+      for (s = DigitsBegin; s != SuffixBegin; ++s)
+        N = (N << BitsPerDigit) | HexDigitValue(*s);
+      return true;
+    }
+  }
+
+  // Leading zeros, or a twenty digit decimal number, may still fit.
+  for (s = DigitsBegin; s != SuffixBegin; ++s) {
+    unsigned C = HexDigitValue(*s);
+    if (N > (~0ULL - C) / radix)
+      return false;
+    N = N*radix + C;
+  }
+  return true;
+}
+
 /// GetIntegerValue - Convert this numeric literal value to an APInt that
 /// matches Val's input width.  If there is an overflow, set Val to the low bits
 /// of the result and return true.  Otherwise, return false.
 bool NumericLiteralParser::GetIntegerValue(llvm::APInt &Val) {
-  // Fast path: Compute a conservative bound on the maximum number of
-  // bits per digit in this radix. If we can't possibly overflow a
-  // uint64 based on that bound then do the simple conversion to
-  // integer. This avoids the expensive overflow checking below, and
-  // handles the common cases that matter (small decimal integers and
-  // hex/octal values which don't overflow).
-  unsigned MaxBitsPerDigit = 1;
-  while ((1U << MaxBitsPerDigit) < radix)
-    MaxBitsPerDigit += 1;
-  if ((SuffixBegin - DigitsBegin) * MaxBitsPerDigit <= 64) {
-    uint64_t N = 0;
-    for (s = DigitsBegin; s != SuffixBegin; ++s)
-      N = N*radix + HexDigitValue(*s);
-
+  // Fast path: almost every literal fits in a uint64_t, so compute the value
+  // in one and only fall back to APInt arithmetic when it overflows.
+  uint64_t N;
+  if (GetUInt64Value(N)) {
     // This will truncate the value to Val's input width. Simply check
     // for overflow by comparing.
     Val = N;
@@ -771,6 +818,16 @@ CharLiteralParser::CharLiteralParser(const char *begin, const char *end,
   assert(PP.getTargetInfo().getWCharWidth() <= 64 &&
          "Assumes sizeof(wchar) on target is <= 64");
 
+  // Fast path: a single unescaped character, by far the most common literal,
+  // needs no overflow detection.
+  if (begin[0] != '\\' && begin[0] != '\'' && begin[1] == '\'') {
+    Value = (unsigned char)begin[0];
+    IsMultiChar = false;
+    if (isAscii() && (Value & 128) && PP.getLangOptions().CharIsSigned)
+      Value = (signed char)Value;
+    return;
+  }
+
   // This is what we will use for overflow detection
   llvm::APInt LitVal(PP.getTargetInfo().getIntWidth(), 0);
 
@@ -0,0 +1,255 @@
+//===--- MacroExpansionCache.cpp - Memoized macro expansions --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the MacroExpansionCache interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Lex/MacroExpansionCache.h"
+#include "clang/Basic/IdentifierTable.h"
+#include "clang/Basic/SourceManager.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+using namespace clang;
+
+/// Expansions producing more tokens than this aren't worth keeping; they are
+/// rarely repeated and would quickly use up the cache.
+static const unsigned MaxExpansionTokens = 4096;
+
+/// The cache is emptied once it holds this many tokens.
+static const unsigned MaxCachedTokens = 1 << 20;
+
+MacroExpansionCache::MacroExpansionCache(SourceManager &SM)
+  : SourceMgr(SM), NumCachedTokens(0), NumHits(0), NumRecorded(0),
+    NumUncacheable(0), NumInvalidations(0) {
+}
+
+MacroExpansionCache::~MacroExpansionCache() {
+}
+
+/// isInWindow - Return true if Loc is in one of the SLocEntries created by
+/// the recorded expansion.
+bool MacroExpansionCache::isInWindow(const CachedExpansion &Expansion,
+                                     SourceLocation Loc) const {
+  return !SourceMgr.isBeforeInSLocAddrSpace(Loc, Expansion.WindowOffset) &&
+         SourceMgr.isBeforeInSLocAddrSpace(Loc, Expansion.WindowOffset +
+                                                Expansion.WindowSize);
+}
+
+/// isReplayable - Return true if Loc can be translated to a later expansion
+/// of the same macro.  Locations in the invocation must be the location of
+/// one of its tokens, since only those are guaranteed to be the same in an
+/// invocation with the same key; anything else there, such as a macro
+/// defined by a directive in the middle of the arguments, can't be replayed.
+bool MacroExpansionCache::isReplayable(const CachedExpansion &Expansion,
+                                       ArrayRef<unsigned> ArgOffsets,
+                                       SourceLocation Loc) const {
+  if (isInWindow(Expansion, Loc))
+    return true;
+
+  int Offset;
+  if (!SourceMgr.isInSameSLocAddrSpace(Expansion.InvocationStart, Loc,
+                                       &Offset) ||
+      Offset < 0 || unsigned(Offset) > Expansion.InvocationLength)
+    return true;
+
+  return Offset == 0 || unsigned(Offset) == Expansion.InvocationLength ||
+         std::binary_search(ArgOffsets.begin(), ArgOffsets.end(),
+                            unsigned(Offset));
+}
+
+/// remapLocation - Translate a location recorded with Expansion to the
+/// expansion being replayed, whose SLocEntries are Delta further into the
+/// source location address space and whose invocation starts at
+/// InvocationStart.
+SourceLocation
+MacroExpansionCache::remapLocation(const CachedExpansion &Expansion, int Delta,
+                                   SourceLocation InvocationStart,
+                                   SourceLocation Loc) const {
+  if (isInWindow(Expansion, Loc))
+    return Loc.getLocWithOffset(Delta);
+
+  int Offset;
+  if (SourceMgr.isInSameSLocAddrSpace(Expansion.InvocationStart, Loc,
+                                      &Offset) &&
+      Offset >= 0 && unsigned(Offset) <= Expansion.InvocationLength)
+    return InvocationStart.getLocWithOffset(Offset);
+
+  // Anything else is in a macro definition or the scratch buffer, which
+  // don't move.
+  return Loc;
+}
+
+MacroExpansionCache::LookupResult
+MacroExpansionCache::lookup(StringRef Key, SourceLocation InvocationStart,
+                            SmallVectorImpl<Token> &Result,
+                            bool &ReexamineLast) {
+  llvm::StringMap<CachedExpansion>::const_iterator I = Expansions.find(Key);
+  if (I == Expansions.end())
+    return LR_Missing;
+
+  const CachedExpansion &Expansion = I->getValue();
+  if (Expansion.Uncacheable) {
+    ++NumUncacheable;
+    return LR_Uncacheable;
+  }
+
+  unsigned WindowOffset = SourceMgr.getNextLocalOffset();
+  int Delta = WindowOffset - Expansion.WindowOffset;
+
+  // Recreate the SLocEntries in the order they were created in; since they
+  // have the same sizes, each one lands exactly Delta after the original.
+  for (unsigned i = 0, e = Expansion.SLocEntries.size(); i != e; ++i) {
+    const ExpansionRecord &Record = Expansion.SLocEntries[i];
+    SourceLocation SpellingLoc =
+      remapLocation(Expansion, Delta, InvocationStart, Record.SpellingLoc);
+    SourceLocation ExpansionLocStart =
+      remapLocation(Expansion, Delta, InvocationStart,
+                    Record.ExpansionLocStart);
+    if (Record.IsMacroArgExpansion) {
+      SourceMgr.createMacroArgExpansionLoc(SpellingLoc, ExpansionLocStart,
+                                           Record.Length);
+    } else {
+      SourceLocation ExpansionLocEnd =
+        remapLocation(Expansion, Delta, InvocationStart,
+                      Record.ExpansionLocEnd);
+      SourceMgr.createExpansionLoc(SpellingLoc, ExpansionLocStart,
+                                   ExpansionLocEnd, Record.Length);
+    }
+  }
+  assert(SourceMgr.getNextLocalOffset() ==
+           WindowOffset + Expansion.WindowSize &&
+         "Replayed expansion doesn't match the recorded one");
+
+  for (unsigned i = 0, e = Expansion.Tokens.size(); i != e; ++i) {
+    Result.push_back(Expansion.Tokens[i]);
+    Token &Tok = Result.back();
+    Tok.setLocation(remapLocation(Expansion, Delta, InvocationStart,
+                                  Tok.getLocation()));
+  }
+
+  ReexamineLast = Expansion.ReexamineLast;
+  ++NumHits;
+  return LR_Replayed;
+}
+
+MacroExpansionCache::RecordingPoint
+MacroExpansionCache::getRecordingPoint() const {
+  RecordingPoint Point;
+  Point.NumSLocEntries = SourceMgr.local_sloc_entry_size();
+  Point.Offset = SourceMgr.getNextLocalOffset();
+  return Point;
+}
+
+bool MacroExpansionCache::record(StringRef Key, const RecordingPoint &Start,
+                                 SourceLocation InvocationStart,
+                                 unsigned InvocationLength,
+                                 ArrayRef<unsigned> ArgOffsets,
+                                 ArrayRef<Token> Tokens, bool ReexamineLast) {
+  if (Tokens.empty() || Tokens.size() > MaxExpansionTokens) {
+    recordUncacheable(Key);
+    return false;
+  }
+
+  CachedExpansion Expansion;
+  Expansion.WindowOffset = Start.Offset;
+  Expansion.WindowSize = SourceMgr.getNextLocalOffset() - Start.Offset;
+  Expansion.InvocationStart = InvocationStart;
+  Expansion.InvocationLength = InvocationLength;
+  Expansion.ReexamineLast = ReexamineLast;
+  Expansion.Uncacheable = false;
+
+  for (unsigned i = Start.NumSLocEntries,
+                e = SourceMgr.local_sloc_entry_size(); i != e; ++i) {
+    const SrcMgr::SLocEntry &Entry = SourceMgr.getLocalSLocEntry(i);
+
+    // A new scratch buffer chunk would have to be recreated along with the
+    // expansion; just don't cache these.
+    if (!Entry.isExpansion()) {
+      recordUncacheable(Key);
+      return false;
+    }
+
+    unsigned EndOffset = i + 1 == e
+      ? SourceMgr.getNextLocalOffset()
+      : SourceMgr.getLocalSLocEntry(i+1).getOffset();
+    const SrcMgr::ExpansionInfo &Info = Entry.getExpansion();
+    ExpansionRecord Record;
+    Record.SpellingLoc = Info.getSpellingLoc();
+    Record.ExpansionLocStart = Info.getExpansionLocStart();
+    Record.ExpansionLocEnd = Info.getExpansionLocEnd();
+    Record.Length = EndOffset - Entry.getOffset() - 1;
+    Record.IsMacroArgExpansion = Info.isMacroArgExpansion();
+
+    if (!isReplayable(Expansion, ArgOffsets, Record.SpellingLoc) ||
+        !isReplayable(Expansion, ArgOffsets, Record.ExpansionLocStart) ||
+        !isReplayable(Expansion, ArgOffsets, Record.ExpansionLocEnd)) {
+      recordUncacheable(Key);
+      return false;
+    }
+    Expansion.SLocEntries.push_back(Record);
+  }
+
+  for (unsigned i = 0, e = Tokens.size(); i != e; ++i) {
+    if (!isReplayable(Expansion, ArgOffsets, Tokens[i].getLocation())) {
+      recordUncacheable(Key);
+      return false;
+    }
+  }
+
+  if (NumCachedTokens + Tokens.size() > MaxCachedTokens)
+    clear();
+
+  for (unsigned i = 0, e = Tokens.size(); i != e; ++i)
+    if (const IdentifierInfo *II = Tokens[i].getIdentifierInfo())
+      MentionedIdentifiers.insert(II);
+  Expansion.Tokens.assign(Tokens.begin(), Tokens.end());
+  NumCachedTokens += Tokens.size();
+
+  Expansions[Key] = Expansion;
+  ++NumRecorded;
+  return true;
+}
+
+void MacroExpansionCache::recordUncacheable(StringRef Key) {
+  CachedExpansion &Expansion = Expansions[Key];
+  Expansion.WindowOffset = Expansion.WindowSize = 0;
+  Expansion.InvocationLength = 0;
+  Expansion.ReexamineLast = false;
+  Expansion.Uncacheable = true;
+  ++NumUncacheable;
+}
+
+void MacroExpansionCache::macroChanged(const IdentifierInfo *II,
+                                       bool WasDefined) {
+  if (Expansions.empty())
+    return;
+
+  // Any expansion may have used the old definition.  A new macro only
+  // matters to the expansions which produced its name.
+  if (WasDefined || MentionedIdentifiers.count(II)) {
+    clear();
+    ++NumInvalidations;
+  }
+}
+
+void MacroExpansionCache::clear() {
+  Expansions.clear();
+  MentionedIdentifiers.clear();
+  NumCachedTokens = 0;
+}
+
+void MacroExpansionCache::PrintStats() const {
+  llvm::errs() << NumHits << " macro expansions reused from the expansion "
+               << "cache, " << NumRecorded << " recorded, "
+               << NumUncacheable << " uncacheable.\n";
+  llvm::errs() << "  " << NumInvalidations << " expansion cache invalidations, "
+               << Expansions.size() << " expansions ("
+               << NumCachedTokens << " tokens) cached.\n";
+}
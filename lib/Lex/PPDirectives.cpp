@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Lex/Preprocessor.h"
+#include "DirectiveSkeleton.h"
 #include "clang/Lex/LiteralSupport.h"
 #include "clang/Lex/HeaderSearch.h"
 #include "clang/Lex/MacroInfo.h"
@@ -206,12 +207,44 @@ void Preprocessor::SkipExcludedConditionalBlock(SourceLocation IfTokenLoc,
     return;
   }
 
+  // If the conditional directives of this file are known, jump from one to
+  // the next instead of lexing all of the tokens in between.  Nothing but
+  // those directives (and code completion, which turns this off) does anything
+  // in an excluded block.
+  DirectiveSkeleton *Skeleton = getDirectiveSkeleton();
+  unsigned NextDirective = 0;
+  if (Skeleton) {
+    SourceLocation BeginLoc = ElseLoc.isValid() ? ElseLoc : IfTokenLoc;
+    if (Skeleton->findDirectiveNamedAt(SourceMgr.getFileOffset(BeginLoc),
+                                       NextDirective)) {
+      ++NextDirective;
+      ++NumSkippedWithSkeleton;
+    } else {
+      Skeleton = 0;
+    }
+  }
+
   // Enter raw mode to disable identifier lookup (and thus macro expansion),
   // disabling warnings, etc.
   CurPPLexer->LexingRawMode = true;
   Token Tok;
   while (1) {
+    if (Skeleton) {
+      const char *Next = CurLexer->BufferEnd;
+      if (NextDirective != Skeleton->size())
+        Next = CurLexer->BufferStart + (*Skeleton)[NextDirective++].HashOffset;
+
+      // The skeleton can't be behind the lexer, but if it ever is, just lex
+      // the rest of the block.
+      if (Next < CurLexer->BufferPtr)
+        Skeleton = 0;
+      else
+        CurLexer->SkipBytes(Next - CurLexer->BufferPtr, /*StartOfLine=*/true);
+    }
+
     CurLexer->Lex(Tok);
+    assert((!Skeleton || Tok.is(tok::hash) || Tok.is(tok::eof)) &&
+           "Directive skeleton doesn't match the file");
 
     if (Tok.is(tok::code_completion)) {
       if (CodeComplete)
@@ -397,6 +430,22 @@ void Preprocessor::SkipExcludedConditionalBlock(SourceLocation IfTokenLoc,
   }
 }
 
+DirectiveSkeleton *Preprocessor::getDirectiveSkeleton() {
+  const FileEntry *File = CurPPLexer->getFileEntry();
+
+  // Code completion has to see the tokens of excluded blocks.
+  if (!File || File == CodeCompletionFile)
+    return 0;
+
+  // Building the skeleton lexes the whole file, which only pays off when the
+  // file is lexed again, e.g. a .def file or a header without a guard.
+  DirectiveSkeleton *&Skeleton = DirectiveSkeletons[File];
+  if (!Skeleton && HeaderInfo.getIncludeCount(File) > 1)
+    Skeleton = DirectiveSkeleton::Build(CurPPLexer->getFileID(), SourceMgr,
+                                        Features);
+  return Skeleton;
+}
+
 void Preprocessor::PTHSkipExcludedConditionalBlock() {
 
   while (1) {
@@ -1271,9 +1320,26 @@ void Preprocessor::HandleIncludeDirective(SourceLocation HashLoc,
 
   // Ask HeaderInfo if we should enter this #include file.  If not, #including
   // this file will have no effect.
-  if (!HeaderInfo.ShouldEnterIncludeFile(File, isImport)) {
-    if (Callbacks)
+  bool FromGuardIndex;
+  if (!HeaderInfo.ShouldEnterIncludeFile(File, isImport, &FromGuardIndex)) {
+    if (!Callbacks)
+      return;
+    if (!FromGuardIndex) {
       Callbacks->FileSkipped(*File, FilenameTok, FileCharacter);
+      return;
+    }
+
+    // The header guard index skipped a file that hasn't been entered yet.
+    // Entering it would have found the guard defined and skipped everything
+    // in it, so tell the client the file was entered and left again.
+    FileID FID = SourceMgr.createFileID(File, FilenameTok.getLocation(),
+                                        FileCharacter);
+    assert(!FID.isInvalid() && "Expected valid file ID");
+    Callbacks->FileChanged(SourceMgr.getLocForStartOfFile(FID),
+                           PPCallbacks::EnterFile, FileCharacter);
+    SourceLocation ExitLoc = CurPPLexer->getSourceLocation();
+    Callbacks->FileChanged(ExitLoc, PPCallbacks::ExitFile,
+                           SourceMgr.getFileCharacteristic(ExitLoc), FID);
     return;
   }
 
@@ -216,6 +216,11 @@ bool Preprocessor::HandleEndOfFile(Token &Result, bool isEndOfMacro) {
     }
   }
 
+  // Nothing is going to lex this file again soon, so let the SourceManager
+  // give back the memory holding its contents.
+  if (CurLexer && !isEndOfMacro)
+    SourceMgr.releaseBufferPages(CurLexer->getFileID());
+
   // Complain about reaching an EOF within arc_cf_code_audited.
   if (PragmaARCCFCodeAuditedLoc.isValid()) {
     Diag(PragmaARCCFCodeAuditedLoc, diag::err_pp_eof_in_arc_cf_code_audited);
@@ -359,6 +364,10 @@ void Preprocessor::HandleMicrosoftCommentPaste(Token &Tok) {
   assert(CurTokenLexer && !CurPPLexer &&
          "Pasted comment can only be formed from macro");
 
+  // The rest of the line isn't part of an expansion being recorded.
+  if (MacroPreExpansionSentinel)
+    abortMacroPreExpansion();
+
   // We handle this by scanning for the closest real lexer, switching it to
   // raw mode and preprocessor mode.  This will cause it to return \n as an
   // explicit EOD token.
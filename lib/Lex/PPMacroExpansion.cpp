@@ -22,11 +22,13 @@
 #include "clang/Lex/CodeCompletionHandler.h"
 #include "clang/Lex/ExternalPreprocessorSource.h"
 #include "clang/Lex/LiteralSupport.h"
+#include "clang/Lex/MacroExpansionCache.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Config/config.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/ErrorHandling.h"
+#include <algorithm>
 #include <cstdio>
 #include <ctime>
 using namespace clang;
@@ -48,6 +50,9 @@ MacroInfo *Preprocessor::getInfoForMacro(IdentifierInfo *II) const {
 /// setMacroInfo - Specify a macro for this identifier.
 ///
 void Preprocessor::setMacroInfo(IdentifierInfo *II, MacroInfo *MI) {
+  if (ExpansionCache)
+    ExpansionCache->macroChanged(II, Macros.count(II));
+
   if (MI) {
     Macros[II] = MI;
     II->setHasMacroDefinition(true);
@@ -188,6 +193,11 @@ bool Preprocessor::HandleMacroExpandedIdentifier(Token &Identifier,
 
   // If this is a builtin macro, like __LINE__ or _Pragma, handle it specially.
   if (MI->isBuiltinMacro()) {
+    // Builtin macros expand differently every time, and _Pragma reads the
+    // tokens after it, so an expansion using one can't be recorded.
+    if (MacroPreExpansionSentinel)
+      abortMacroPreExpansion();
+
     if (Callbacks) Callbacks->MacroExpands(Identifier, MI,
                                            Identifier.getLocation());
     ExpandBuiltinMacro(Identifier);
@@ -249,6 +259,12 @@ bool Preprocessor::HandleMacroExpandedIdentifier(Token &Identifier,
     bool HadLeadingSpace = Identifier.hasLeadingSpace();
     bool IsAtStartOfLine = Identifier.isAtStartOfLine();
 
+    // The whitespace of an empty macro at the end of an expansion being
+    // recorded belongs to the token after the expansion, which the recording
+    // can't hold.
+    if (MacroPreExpansionSentinel && isAtEndOfMacroPreExpansion())
+      abortMacroPreExpansion();
+
     Lex(Identifier);
 
     // If the identifier isn't on some OTHER line, inherit the leading
@@ -306,6 +322,11 @@ bool Preprocessor::HandleMacroExpandedIdentifier(Token &Identifier,
     return false;
   }
 
+  // Reuse an earlier expansion with the same tokens if there is one.
+  if (ExpansionCache && !Callbacks && !isCodeCompletionEnabled() &&
+      ExpandMacroThroughCache(Identifier, MI, ExpansionEnd, Args))
+    return false;
+
   // Start expanding the macro.
   EnterMacro(Identifier, ExpansionEnd, Args);
 
@@ -356,6 +377,14 @@ MacroArgs *Preprocessor::ReadFunctionLikeMacroArgs(Token &MacroName,
       // an argument value in a macro could expand to ',' or '(' or ')'.
       LexUnexpandedToken(Tok);
 
+      // The arguments continue after the end of an expansion being recorded
+      // for the expansion cache; stop recording it and keep reading.
+      if (Tok.is(tok::eof) && MacroPreExpansionSentinel &&
+          CurTokenLexer.get() == MacroPreExpansionSentinel) {
+        abortMacroPreExpansion();
+        continue;
+      }
+
       if (Tok.is(tok::eof) || Tok.is(tok::eod)) { // "#if f(<eof>" & "#if f(\n"
         Diag(MacroName, diag::err_unterm_macro_invoc);
         // Do not lose the EOF/EOD.  Return it to the client.
@@ -497,6 +526,260 @@ MacroArgs *Preprocessor::ReadFunctionLikeMacroArgs(Token &MacroName,
   return MacroArgs::create(MI, ArgTokens, isVarargsElided, *this);
 }
 
+/// addToKey - Append the bytes of Value to an expansion cache key.
+template <typename T>
+static void addToKey(SmallVectorImpl<char> &Key, const T &Value) {
+  const char *Bytes = reinterpret_cast<const char *>(&Value);
+  Key.append(Bytes, Bytes + sizeof(T));
+}
+
+bool Preprocessor::getMacroExpansionKey(const Token &Identifier, MacroInfo *MI,
+                                        SourceLocation ExpansionEnd,
+                                        MacroArgs *Args,
+                                        SmallVectorImpl<char> &Key,
+                                        unsigned &InvocationLength,
+                                        SmallVectorImpl<unsigned> &ArgOffsets) {
+  addToKey(Key, MI);
+
+  // The expansion also depends on which macros are disabled around it.  While
+  // looking for them, find the nearest real lexer: expansions in a directive
+  // can end in its eod token, which isn't something to record.
+  bool FoundPPLexer = false;
+  if (CurPPLexer) {
+    if (CurPPLexer->ParsingPreprocessorDirective)
+      return false;
+    FoundPPLexer = true;
+  }
+  if (CurTokenLexer && CurTokenLexer->Macro &&
+      !CurTokenLexer->Macro->isEnabled())
+    addToKey(Key, CurTokenLexer->Macro);
+  for (unsigned i = IncludeMacroStack.size(); i != 0; --i) {
+    const IncludeStackInfo &Entry = IncludeMacroStack[i-1];
+    if (!FoundPPLexer && Entry.ThePPLexer) {
+      if (Entry.ThePPLexer->ParsingPreprocessorDirective)
+        return false;
+      FoundPPLexer = true;
+    }
+    if (const TokenLexer *TL = Entry.TheTokenLexer)
+      if (TL->Macro && !TL->Macro->isEnabled())
+        addToKey(Key, TL->Macro);
+  }
+  addToKey(Key, (MacroInfo *)0);
+
+  InvocationLength = 0;
+  if (!Args)
+    return true;
+
+  // The arguments are identified by their tokens and by where those tokens
+  // are relative to the macro name, since the locations in a replayed
+  // expansion are computed from the macro name.
+  int Length;
+  if (!SourceMgr.isInSameSLocAddrSpace(Identifier.getLocation(), ExpansionEnd,
+                                       &Length) || Length < 0)
+    return false;
+  InvocationLength = Length;
+  addToKey(Key, InvocationLength);
+  addToKey(Key, Args->isVarargsElidedUse());
+
+  unsigned NumArgTokens = Args->getNumArguments();
+  const Token *Tok = NumArgTokens ? Args->getUnexpArgument(0) : 0;
+  for (unsigned i = 0; i != NumArgTokens; ++i, ++Tok) {
+    // Comments and unknown characters are spelled differently without
+    // looking any different here.
+    if (Tok->is(tok::comment) || Tok->is(tok::unknown))
+      return false;
+
+    int Offset;
+    if (!SourceMgr.isInSameSLocAddrSpace(Identifier.getLocation(),
+                                         Tok->getLocation(), &Offset) ||
+        Offset < 0 || unsigned(Offset) > InvocationLength)
+      return false;
+
+    addToKey(Key, unsigned(Tok->getKind()));
+    addToKey(Key, Tok->getFlags());
+    addToKey(Key, Tok->getLength());
+    addToKey(Key, Tok->getIdentifierInfo());
+    addToKey(Key, Offset);
+    if (Tok->isLiteral()) {
+      const char *Data = Tok->getLiteralData();
+      if (!Data)
+        return false;
+      Key.append(Data, Data + Tok->getLength());
+    }
+    ArgOffsets.push_back(Offset);
+  }
+  std::sort(ArgOffsets.begin(), ArgOffsets.end());
+  return true;
+}
+
+/// EnterExpandedTokens - Push the tokens of a macro expansion handled by the
+/// expansion cache.  If ReexamineLast is true, the last token is lexed again
+/// with macro expansion enabled after the others.
+static void EnterExpandedTokens(Preprocessor &PP, ArrayRef<Token> Tokens,
+                                bool ReexamineLast) {
+  unsigned NumExpanded = Tokens.size() - ReexamineLast;
+
+  if (ReexamineLast) {
+    Token *Last = new Token[1];
+    Last[0] = Tokens.back();
+    PP.EnterTokenStream(Last, 1, false, true);
+  }
+
+  if (NumExpanded) {
+    Token *Expanded = new Token[NumExpanded];
+    std::copy(Tokens.begin(), Tokens.begin() + NumExpanded, Expanded);
+    PP.EnterTokenStream(Expanded, NumExpanded, true, true);
+  }
+}
+
+bool Preprocessor::ExpandMacroThroughCache(Token &Identifier, MacroInfo *MI,
+                                           SourceLocation ExpansionEnd,
+                                           MacroArgs *Args) {
+  SmallVector<char, 128> KeyBuf;
+  SmallVector<unsigned, 32> ArgOffsets;
+  unsigned InvocationLength;
+  if (!getMacroExpansionKey(Identifier, MI, ExpansionEnd, Args, KeyBuf,
+                            InvocationLength, ArgOffsets)) {
+    ExpansionCache->noteUncacheable();
+    return false;
+  }
+  StringRef Key(KeyBuf.data(), KeyBuf.size());
+  SourceLocation InvocationStart = Identifier.getLocation();
+
+  SmallVector<Token, 64> Expanded;
+  bool ReexamineLast = false;
+  switch (ExpansionCache->lookup(Key, InvocationStart, Expanded,
+                                 ReexamineLast)) {
+  case MacroExpansionCache::LR_Uncacheable:
+    return false;
+
+  case MacroExpansionCache::LR_Replayed:
+    if (Args) Args->destroy(*this);
+
+    // The expansion takes the place of the macro name.
+    Expanded[0].setFlagValue(Token::StartOfLine, Identifier.isAtStartOfLine());
+    Expanded[0].setFlagValue(Token::LeadingSpace,
+                             Identifier.hasLeadingSpace());
+    EnterExpandedTokens(*this, Expanded, ReexamineLast);
+    Lex(Identifier);
+    return true;
+
+  case MacroExpansionCache::LR_Missing:
+    break;
+  }
+
+  // An expansion inside one being recorded is recorded as part of it.
+  if (MacroPreExpansionSentinel)
+    return false;
+
+  MacroExpansionCache::RecordingPoint Start =
+    ExpansionCache->getRecordingPoint();
+  unsigned NumDiagnosticsBefore = NumDiagnostics;
+
+  // Expand the macro on top of a token stream holding only an eof token, and
+  // lex until that eof to collect every token of the expansion.
+  Token EndTok;
+  EndTok.startToken();
+  EndTok.setKind(tok::eof);
+  EndTok.setLocation(ExpansionEnd);
+  EndTok.setLength(0);
+  EnterTokenStream(&EndTok, 1, true, false);
+  MacroPreExpansionSentinel = CurTokenLexer.get();
+
+  EnterMacro(Identifier, ExpansionEnd, Args);
+
+  bool Aborted = false;
+  Token Tok;
+  while (1) {
+    Lex(Tok);
+
+    if (!MacroPreExpansionSentinel) {
+      // Something in the expansion had to see past its end, so this token
+      // was lexed without the sentinel.  The eof ending a macro argument
+      // being pre-expanded is left for MacroArgs to find.
+      Aborted = true;
+      if (Tok.is(tok::eof) && CurTokenLexer && CurTokenLexer->CurToken &&
+          CurTokenLexer->Tokens[CurTokenLexer->CurToken-1].is(tok::eof))
+        --CurTokenLexer->CurToken;
+      else
+        Expanded.push_back(Tok);
+      break;
+    }
+
+    if (Tok.is(tok::eof) && CurTokenLexer.get() == MacroPreExpansionSentinel) {
+      RemoveTopOfLexerStack();
+      MacroPreExpansionSentinel = 0;
+
+      // A function-like macro name at the end of the expansion may still be
+      // invoked by a '(' after it.
+      if (!Expanded.empty()) {
+        const Token &Last = Expanded.back();
+        IdentifierInfo *II = Last.getIdentifierInfo();
+        ReexamineLast = II && II->hasMacroDefinition() &&
+                        !Last.isExpandDisabled();
+      }
+      break;
+    }
+
+    Expanded.push_back(Tok);
+
+    if (CurLexerKind == CLK_LexAfterModuleImport) {
+      // The tokens after __import_module__ come from after the expansion;
+      // lex the keyword again once the rest has been delivered.
+      abortMacroPreExpansion();
+      CurLexerKind = CLK_TokenLexer;
+      Aborted = true;
+      ReexamineLast = true;
+      break;
+    }
+  }
+
+  if (Aborted || NumDiagnostics != NumDiagnosticsBefore)
+    ExpansionCache->recordUncacheable(Key);
+  else
+    ExpansionCache->record(Key, Start, InvocationStart, InvocationLength,
+                           ArgOffsets, Expanded, ReexamineLast);
+
+  if (!Expanded.empty())
+    EnterExpandedTokens(*this, Expanded, ReexamineLast);
+  Lex(Identifier);
+  return true;
+}
+
+void Preprocessor::abortMacroPreExpansion() {
+  assert(MacroPreExpansionSentinel && "Not recording a macro expansion");
+
+  if (CurTokenLexer.get() == MacroPreExpansionSentinel) {
+    RemoveTopOfLexerStack();
+  } else {
+    // The sentinel is further down the stack, below the rest of the
+    // expansion; take it out from under it.
+    std::vector<IncludeStackInfo>::iterator I = IncludeMacroStack.end();
+    do {
+      assert(I != IncludeMacroStack.begin() && "Lost the sentinel");
+      --I;
+    } while (I->TheTokenLexer != MacroPreExpansionSentinel);
+    if (NumCachedTokenLexers == TokenLexerCacheSize)
+      delete I->TheTokenLexer;
+    else
+      TokenLexerCache[NumCachedTokenLexers++] = I->TheTokenLexer;
+    IncludeMacroStack.erase(I);
+  }
+
+  MacroPreExpansionSentinel = 0;
+}
+
+bool Preprocessor::isAtEndOfMacroPreExpansion() const {
+  const TokenLexer *TL = CurTokenLexer.get();
+  for (unsigned i = IncludeMacroStack.size(); TL != MacroPreExpansionSentinel;
+       --i) {
+    if (!TL || !TL->isAtEnd() || i == 0)
+      return false;
+    TL = IncludeMacroStack[i-1].TheTokenLexer;
+  }
+  return true;
+}
+
 /// \brief Keeps macro expanded tokens for TokenLexers.
 //
 /// Works like a stack; a TokenLexer adds the macro expanded tokens that is
@@ -30,8 +30,6 @@
 using namespace clang;
 using namespace clang::io;
 
-#define DISK_TOKEN_SIZE (1+1+2+4+4)
-
 //===----------------------------------------------------------------------===//
 // PTHLexer methods.
 //===----------------------------------------------------------------------===//
@@ -39,7 +37,7 @@ using namespace clang::io;
 PTHLexer::PTHLexer(Preprocessor &PP, FileID FID, const unsigned char *D,
                    const unsigned char *ppcond, PTHManager &PM)
   : PreprocessorLexer(&PP, FID), TokBuf(D), CurPtr(D), LastHashTokPtr(0),
-    PPCond(ppcond), CurPPCondPtr(ppcond), PTHMgr(PM) {
+    PPCond(ppcond), CurPPCondPtr(ppcond), LastOffset(0), PTHMgr(PM) {
 
   FileStartLoc = PP.getSourceManager().getLocForStartOfFile(FID);
 }
@@ -52,16 +50,19 @@ LexNextToken:
   //===--------------------------------------==//
 
   // Shadow CurPtr into an automatic variable.
+  const unsigned char *TokStart = CurPtr;
   const unsigned char *CurPtrShadow = CurPtr;
 
-  // Read in the data for the token.
-  unsigned Word0 = ReadLE32(CurPtrShadow);
-  uint32_t IdentifierID = ReadLE32(CurPtrShadow);
-  uint32_t FileOffset = ReadLE32(CurPtrShadow);
-
-  tok::TokenKind TKind = (tok::TokenKind) (Word0 & 0xFF);
-  Token::TokenFlags TFlags = (Token::TokenFlags) ((Word0 >> 8) & 0xFF);
-  uint32_t Len = Word0 >> 16;
+  // Read in the data for the token: the kind and flags take a byte each, and
+  // the rest is variable-length encoded.
+  tok::TokenKind TKind = (tok::TokenKind) *CurPtrShadow++;
+  Token::TokenFlags TFlags = (Token::TokenFlags) *CurPtrShadow++;
+  uint32_t Len = ReadVBR32(CurPtrShadow);
+  uint32_t IdentifierID = ReadVBR32(CurPtrShadow);
+  uint32_t FileOffset = ReadVBR32(CurPtrShadow);
+  if (!PTHManager::hasAbsoluteOffset(TKind, TFlags))
+    FileOffset += LastOffset;
+  LastOffset = FileOffset;
 
   CurPtr = CurPtrShadow;
 
@@ -115,7 +116,7 @@ LexNextToken:
   }
 
   if (TKind == tok::hash && Tok.isAtStartOfLine()) {
-    LastHashTokPtr = CurPtr - DISK_TOKEN_SIZE;
+    LastHashTokPtr = TokStart;
     assert(!LexingRawMode);
     PP->HandleDirective(Tok);
 
@@ -186,12 +187,24 @@ void PTHLexer::DiscardToEndOfLine() {
     if (y & Token::StartOfLine) break;
 
     // Skip to the next token.
-    p += DISK_TOKEN_SIZE;
+    p = SkipToken(p);
   }
 
   CurPtr = p;
 }
 
+const unsigned char *PTHLexer::SkipToken(const unsigned char *Ptr) {
+  tok::TokenKind Kind = (tok::TokenKind) Ptr[0];
+  unsigned Flags = Ptr[1];
+  Ptr += 2;
+  ReadVBR32(Ptr); // Length.
+  ReadVBR32(Ptr); // Identifier ID or spelling offset.
+  uint32_t Offset = ReadVBR32(Ptr);
+  LastOffset = PTHManager::hasAbsoluteOffset(Kind, Flags)
+               ? Offset : LastOffset + Offset;
+  return Ptr;
+}
+
 /// SkipBlock - Used by Preprocessor to skip the current conditional block.
 bool PTHLexer::SkipBlock() {
   assert(CurPPCondPtr && "No cached PP conditional information.");
@@ -262,10 +275,9 @@ bool PTHLexer::SkipBlock() {
   // already points 'elif'.  Just return.
 
   if (CurPtr > HashEntryI) {
-    assert(CurPtr == HashEntryI + DISK_TOKEN_SIZE);
     // Did we reach a #endif?  If so, go ahead and consume that token as well.
     if (isEndif)
-      CurPtr += DISK_TOKEN_SIZE*2;
+      CurPtr = SkipToken(SkipToken(CurPtr));
     else
       LastHashTokPtr = HashEntryI;
 
@@ -279,12 +291,14 @@ bool PTHLexer::SkipBlock() {
   // are skipping multiple blocks.
   LastHashTokPtr = CurPtr;
 
-  // Skip the '#' token.
+  // Skip the '#' token.  It starts a line, so LastOffset is correct again
+  // afterwards.
   assert(((tok::TokenKind)*CurPtr) == tok::hash);
-  CurPtr += DISK_TOKEN_SIZE;
+  CurPtr = SkipToken(CurPtr);
 
   // Did we reach a #endif?  If so, go ahead and consume that token as well.
-  if (isEndif) { CurPtr += DISK_TOKEN_SIZE*2; }
+  if (isEndif)
+    CurPtr = SkipToken(SkipToken(CurPtr));
 
   return isEndif;
 }
@@ -295,8 +309,10 @@ SourceLocation PTHLexer::getSourceLocation() {
   // handling a #included file.  Just read the necessary data from the token
   // data buffer to construct the SourceLocation object.
   // NOTE: This is a virtual function; hence it is defined out-of-line.
-  const unsigned char *OffsetPtr = CurPtr + (DISK_TOKEN_SIZE - 4);
-  uint32_t Offset = ReadLE32(OffsetPtr);
+  uint32_t SavedOffset = LastOffset;
+  SkipToken(CurPtr);
+  uint32_t Offset = LastOffset;
+  LastOffset = SavedOffset;
   return FileStartLoc.getLocWithOffset(Offset);
 }
 
@@ -311,12 +327,20 @@ namespace {
 class PTHFileData {
   const uint32_t TokenOff;
   const uint32_t PPCondOff;
+  const uint64_t ModTime;
+  const uint64_t Size;
+  const uint64_t ContentHash;
 public:
-  PTHFileData(uint32_t tokenOff, uint32_t ppCondOff)
-    : TokenOff(tokenOff), PPCondOff(ppCondOff) {}
+  PTHFileData(uint32_t tokenOff, uint32_t ppCondOff, uint64_t modTime,
+              uint64_t size, uint64_t contentHash)
+    : TokenOff(tokenOff), PPCondOff(ppCondOff), ModTime(modTime), Size(size),
+      ContentHash(contentHash) {}
 
   uint32_t getTokenOffset() const { return TokenOff; }
   uint32_t getPPCondOffset() const { return PPCondOff; }
+  uint64_t getModificationTime() const { return ModTime; }
+  uint64_t getSize() const { return Size; }
+  uint64_t getContentHash() const { return ContentHash; }
 };
 
 
@@ -359,7 +383,11 @@ public:
     assert(k.first == 0x1 && "Only file lookups can match!");
     uint32_t x = ::ReadUnalignedLE32(d);
     uint32_t y = ::ReadUnalignedLE32(d);
-    return PTHFileData(x, y);
+    d += 4 + 4 + 2; // Skip the inode, device and mode.
+    uint64_t ModTime = ::ReadUnalignedLE64(d);
+    uint64_t Size = ::ReadUnalignedLE64(d);
+    uint64_t ContentHash = ::ReadUnalignedLE64(d);
+    return PTHFileData(x, y, ModTime, Size, ContentHash);
   }
 };
 
@@ -418,11 +446,12 @@ PTHManager::PTHManager(const llvm::MemoryBuffer* buf, void* fileLookup,
                        IdentifierInfo** perIDCache,
                        void* stringIdLookup, unsigned numIds,
                        const unsigned char* spellingBase,
-                       const char* originalSourceFile)
+                       const char* originalSourceFile,
+                       uint64_t creationTime)
 : Buf(buf), PerIDCache(perIDCache), FileLookup(fileLookup),
   IdDataTable(idDataTable), StringIdLookup(stringIdLookup),
   NumIds(numIds), PP(0), SpellingBase(spellingBase),
-  OriginalSourceFile(originalSourceFile) {}
+  OriginalSourceFile(originalSourceFile), CreationTime(creationTime) {}
 
 PTHManager::~PTHManager() {
   delete Buf;
@@ -437,10 +466,13 @@ static void InvalidPTH(DiagnosticsEngine &Diags, const char *Msg) {
 
 PTHManager *PTHManager::Create(const std::string &file,
                                DiagnosticsEngine &Diags) {
-  // Memory map the PTH file.
+  // Memory map the PTH file.  Nothing in it relies on a null terminator, so
+  // don't ask for one; that would force a copy of files whose size is a
+  // multiple of the page size.
   llvm::OwningPtr<llvm::MemoryBuffer> File;
 
-  if (llvm::MemoryBuffer::getFile(file, File)) {
+  if (llvm::MemoryBuffer::getFile(file, File, /*FileSize=*/-1,
+                                  /*RequiresNullTerminator=*/false)) {
     // FIXME: Add ec.message() to this diag.
     Diags.Report(diag::err_invalid_pth_file) << file;
     return 0;
@@ -451,18 +483,19 @@ PTHManager *PTHManager::Create(const std::string &file,
   const unsigned char *BufBeg = (unsigned char*)File->getBufferStart();
   const unsigned char *BufEnd = (unsigned char*)File->getBufferEnd();
 
-  // Check the prologue of the file.
-  if ((BufEnd - BufBeg) < (signed)(sizeof("cfe-pth") + 3 + 4) ||
+  // Check the prologue of the file.  The magic string is padded with a null
+  // byte so that everything after it is aligned.
+  if ((BufEnd - BufBeg) < (signed)(sizeof("cfe-pth") + 4) ||
       memcmp(BufBeg, "cfe-pth", sizeof("cfe-pth") - 1) != 0) {
     Diags.Report(diag::err_invalid_pth_file) << file;
     return 0;
   }
 
   // Read the PTH version.
-  const unsigned char *p = BufBeg + (sizeof("cfe-pth") - 1);
+  const unsigned char *p = BufBeg + sizeof("cfe-pth");
   unsigned Version = ReadLE32(p);
 
-  if (Version < PTHManager::Version) {
+  if (Version != PTHManager::Version) {
     InvalidPTH(Diags,
         Version < PTHManager::Version
         ? "PTH file uses an older PTH format that is no longer supported"
@@ -541,15 +574,19 @@ PTHManager *PTHManager::Create(const std::string &file,
     }
   }
 
+  // Read the time at which the PTH file was generated.
+  const unsigned char* creationTimeOffset = PrologueOffset + sizeof(uint32_t)*4;
+  uint64_t CreationTime = ReadUnalignedLE64(creationTimeOffset);
+
   // Compute the address of the original source file.
-  const unsigned char* originalSourceBase = PrologueOffset + sizeof(uint32_t)*4;
+  const unsigned char* originalSourceBase = creationTimeOffset;
   unsigned len = ReadUnalignedLE16(originalSourceBase);
   if (!len) originalSourceBase = 0;
 
   // Create the new PTHManager.
   return new PTHManager(File.take(), FL.take(), IData, PerIDCache,
                         SL.take(), NumIds, spellingBase,
-                        (const char*) originalSourceBase);
+                        (const char*) originalSourceBase, CreationTime);
 }
 
 IdentifierInfo* PTHManager::LazilyCreateIdentifierInfo(unsigned PersistentID) {
@@ -603,6 +640,11 @@ PTHLexer *PTHManager::CreateLexer(FileID FID) {
 
   const PTHFileData& FileData = *I;
 
+  // Don't use tokens cached from an older version of the file.
+  if (!isUpToDate(FID, FE, FileData.getSize(), FileData.getModificationTime(),
+                  FileData.getContentHash()))
+    return 0;
+
   const unsigned char *BufStart = (const unsigned char *)Buf->getBufferStart();
   // Compute the offset of the token data within the buffer.
   const unsigned char* data = BufStart + FileData.getTokenOffset();
@@ -616,6 +658,43 @@ PTHLexer *PTHManager::CreateLexer(FileID FID) {
   return new PTHLexer(*PP, FID, data, ppcond, *this);
 }
 
+uint64_t PTHManager::getContentHash(StringRef Data) {
+  // 64-bit FNV-1a.
+  uint64_t Hash = 14695981039346656037ULL;
+  for (unsigned i = 0, e = Data.size(); i != e; ++i) {
+    Hash ^= (unsigned char)Data[i];
+    Hash *= 1099511628211ULL;
+  }
+  return Hash;
+}
+
+bool PTHManager::isUpToDate(FileID FID, const FileEntry *FE, uint64_t Size,
+                            uint64_t ModTime, uint64_t ContentHash) {
+  std::pair<llvm::DenseMap<const FileEntry*, bool>::iterator, bool> Known =
+    ValidatedFiles.insert(std::make_pair(FE, false));
+  if (!Known.second)
+    return Known.first->second;
+
+  bool UpToDate;
+  if ((uint64_t)FE->getSize() != Size)
+    UpToDate = false;
+  else if ((uint64_t)FE->getModificationTime() == ModTime &&
+           ModTime < CreationTime)
+    // The file was last modified before its tokens were cached.
+    UpToDate = true;
+  else {
+    // The file may have been modified without its size or modification time
+    // changing; only its contents can tell.
+    bool Invalid = false;
+    const llvm::MemoryBuffer *Buffer =
+      PP->getSourceManager().getBuffer(FID, &Invalid);
+    UpToDate = !Invalid && getContentHash(Buffer->getBuffer()) == ContentHash;
+  }
+
+  Known.first->second = UpToDate;
+  return UpToDate;
+}
+
 //===----------------------------------------------------------------------===//
 // 'stat' caching.
 //===----------------------------------------------------------------------===//
@@ -624,17 +703,19 @@ namespace {
 class PTHStatData {
 public:
   const bool hasStat;
+  const bool isFile;
   const ino_t ino;
   const dev_t dev;
   const mode_t mode;
   const time_t mtime;
   const off_t size;
 
-  PTHStatData(ino_t i, dev_t d, mode_t mo, time_t m, off_t s)
-  : hasStat(true), ino(i), dev(d), mode(mo), mtime(m), size(s) {}
+  PTHStatData(bool f, ino_t i, dev_t d, mode_t mo, time_t m, off_t s)
+  : hasStat(true), isFile(f), ino(i), dev(d), mode(mo), mtime(m), size(s) {}
 
   PTHStatData()
-    : hasStat(false), ino(0), dev(0), mode(0), mtime(0), size(0) {}
+    : hasStat(false), isFile(false), ino(0), dev(0), mode(0), mtime(0),
+      size(0) {}
 };
 
 class PTHStatLookupTrait : public PTHFileLookupCommonTrait {
@@ -662,7 +743,8 @@ public:
       dev_t dev = (dev_t) ReadUnalignedLE32(d);
       mode_t mode = (mode_t) ReadUnalignedLE16(d);
       time_t mtime = (time_t) ReadUnalignedLE64(d);
-      return data_type(ino, dev, mode, mtime, (off_t) ReadUnalignedLE64(d));
+      return data_type(k.first == 0x1, ino, dev, mode, mtime,
+                       (off_t) ReadUnalignedLE64(d));
     }
 
     // Negative stat.  Don't read anything.
@@ -695,6 +777,11 @@ public:
     if (!Data.hasStat)
       return CacheMissing;
 
+    // Files may have changed since the PTH file was generated; their real
+    // status is needed to tell whether the cached tokens are still good.
+    if (Data.isFile)
+      return statChained(Path, StatBuf, FileDescriptor);
+
     StatBuf.st_ino = Data.ino;
     StatBuf.st_dev = Data.dev;
     StatBuf.st_mtime = Data.mtime;
@@ -14,8 +14,10 @@
 #include "clang/Lex/PreprocessingRecord.h"
 #include "clang/Lex/MacroInfo.h"
 #include "clang/Lex/Token.h"
+#include "clang/Basic/OnDiskHashTable.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Capacity.h"
+#include <algorithm>
 
 using namespace clang;
 
@@ -40,6 +42,7 @@ InclusionDirective::InclusionDirective(PreprocessingRecord &PPRec,
 PreprocessingRecord::PreprocessingRecord(SourceManager &SM,
                                          bool IncludeNestedMacroExpansions)
   : SourceMgr(SM), IncludeNestedMacroExpansions(IncludeNestedMacroExpansions),
+    NumLocalEntities(0), DecodedChunk(~0U), NumFileIndexedEntities(0),
     ExternalSource(0)
 {
 }
@@ -87,41 +90,196 @@ PreprocessingRecord::findLocalPreprocessedEntitiesInRange(
     return std::make_pair(0,0);
   assert(!SourceMgr.isBeforeInTranslationUnit(Range.getEnd(),Range.getBegin()));
 
-  unsigned Begin = findBeginLocalPreprocessedEntity(Range.getBegin());
-  unsigned End = findEndLocalPreprocessedEntity(Range.getEnd());
-  return std::make_pair(Begin, End);
+  // When the range lies within one local file, which is what editors ask
+  // about, look the entities up in that file's index.
+  const FileEntityList *Entities = 0;
+  std::pair<FileID, unsigned> BeginInfo, EndInfo;
+  if (Range.getBegin().isFileID() && Range.getEnd().isFileID() &&
+      SourceMgr.isLocalSourceLocation(Range.getBegin())) {
+    BeginInfo = SourceMgr.getDecomposedLoc(Range.getBegin());
+    EndInfo = SourceMgr.getDecomposedLoc(Range.getEnd());
+    if (BeginInfo.first == EndInfo.first)
+      Entities = getFileEntities(BeginInfo.first);
+  }
+  if (!Entities) {
+    unsigned Begin = findBeginLocalPreprocessedEntity(Range.getBegin());
+    unsigned End = findEndLocalPreprocessedEntity(Range.getEnd());
+    return std::make_pair(Begin, End);
+  }
+
+  // The first entity that doesn't end before the range.  Entities of files
+  // included from this one are covered too, since they come after the
+  // inclusion directive.
+  unsigned First = 0, Count = Entities->size();
+  while (Count > 0) {
+    unsigned Half = Count/2;
+    if ((*Entities)[First + Half].MaxEnd < BeginInfo.second) {
+      First += Half + 1;
+      Count -= Half + 1;
+    } else
+      Count = Half;
+  }
+  unsigned Begin = First != Entities->size()
+                     ? (*Entities)[First].Index
+                     : findBeginLocalPreprocessedEntity(Range.getBegin());
+
+  // The first entity that begins after the range.
+  Count = Entities->size() - First;
+  while (Count > 0) {
+    unsigned Half = Count/2;
+    if ((*Entities)[First + Half].Begin <= EndInfo.second) {
+      First += Half + 1;
+      Count -= Half + 1;
+    } else
+      Count = Half;
+  }
+  unsigned End = First != Entities->size()
+                   ? (*Entities)[First].Index
+                   : findEndLocalPreprocessedEntity(Range.getEnd());
+  return std::make_pair(Begin, std::max(Begin, End));
 }
 
-namespace {
+const PreprocessingRecord::FileEntityList *
+PreprocessingRecord::getFileEntities(FileID FID) const {
+  if (NumFileIndexedEntities != NumLocalEntities) {
+    FileEntities.clear();
+    for (unsigned C = 0, NC = EntityChunks.size(); C != NC; ++C) {
+      const std::vector<DecodedEntity> &Decoded = decodeChunk(C);
+      for (unsigned I = 0, N = Decoded.size(); I != N; ++I) {
+        SourceRange Range = Decoded[I].Range;
+        if (Range.getBegin().isInvalid())
+          continue;
+
+        std::pair<FileID, unsigned> BeginInfo
+          = SourceMgr.getDecomposedExpansionLoc(Range.getBegin());
+        unsigned EndOffset = BeginInfo.second;
+        if (Range.getEnd().isValid()) {
+          std::pair<FileID, unsigned> EndInfo
+            = SourceMgr.getDecomposedLoc(
+                       SourceMgr.getExpansionRange(Range.getEnd()).second);
+          // An entity that ends in another file is assumed to reach the end
+          // of this one.
+          if (EndInfo.first != BeginInfo.first)
+            EndOffset = ~0U;
+          else if (EndInfo.second > EndOffset)
+            EndOffset = EndInfo.second;
+        }
+
+        FileEntityList &List = FileEntities[BeginInfo.first];
+        FileEntity Entity;
+        Entity.Begin = BeginInfo.second;
+        Entity.MaxEnd = List.empty() ? EndOffset
+                                     : std::max(List.back().MaxEnd, EndOffset);
+        Entity.Index = EntityChunks[C].FirstIndex + I;
+        List.push_back(Entity);
+      }
+    }
+    NumFileIndexedEntities = NumLocalEntities;
+  }
 
-template <SourceLocation (SourceRange::*getRangeLoc)() const>
-struct PPEntityComp {
-  const SourceManager &SM;
+  llvm::DenseMap<FileID, FileEntityList>::const_iterator Pos
+    = FileEntities.find(FID);
+  if (Pos == FileEntities.end())
+    return 0;
+  return &Pos->second;
+}
 
-  explicit PPEntityComp(const SourceManager &SM) : SM(SM) { }
+typedef llvm::PointerUnion<IdentifierInfo *, MacroDefinition *> MacroNameOrDef;
 
-  bool operator()(PreprocessedEntity *L, PreprocessedEntity *R) const {
-    SourceLocation LHS = getLoc(L);
-    SourceLocation RHS = getLoc(R);
-    return SM.isBeforeInTranslationUnit(LHS, RHS);
+static void EmitVBR(std::vector<unsigned char> &Data, uint32_t V) {
+  while (V >= 0x80) {
+    Data.push_back((unsigned char)(V | 0x80));
+    V >>= 7;
   }
+  Data.push_back((unsigned char)V);
+}
 
-  bool operator()(PreprocessedEntity *L, SourceLocation RHS) const {
-    SourceLocation LHS = getLoc(L);
-    return SM.isBeforeInTranslationUnit(LHS, RHS);
+/// \brief Encode the difference between two raw source locations so that
+/// small differences in either direction take few bytes.
+static uint32_t EncodeLocDelta(SourceLocation From, SourceLocation To) {
+  int32_t Delta = int32_t(To.getRawEncoding() - From.getRawEncoding());
+  return (uint32_t(Delta) << 1) ^ uint32_t(Delta >> 31);
+}
+
+static SourceLocation DecodeLocDelta(SourceLocation From, uint32_t V) {
+  uint32_t Delta = (V >> 1) ^ (0U - (V & 1));
+  return SourceLocation::getFromRawEncoding(From.getRawEncoding() + Delta);
+}
+
+static void EncodeEntity(std::vector<unsigned char> &Data,
+                         SourceLocation PrevBegin,
+                         PreprocessedEntity::EntityKind Kind, unsigned Payload,
+                         SourceRange Range) {
+  assert(Kind >= PreprocessedEntity::MacroExpansionKind &&
+         Kind - PreprocessedEntity::MacroExpansionKind < 4 &&
+         "Entity kind doesn't fit in two bits");
+  EmitVBR(Data, (Kind - PreprocessedEntity::MacroExpansionKind) |
+                (Payload << 2));
+  EmitVBR(Data, EncodeLocDelta(PrevBegin, Range.getBegin()));
+  EmitVBR(Data, EncodeLocDelta(Range.getBegin(), Range.getEnd()));
+}
+
+void PreprocessingRecord::encodeChunk(EntityChunk &Chunk,
+                                   const std::vector<DecodedEntity> &Entities) {
+  assert(!Entities.empty() && "Encoding an empty chunk");
+  Chunk.NumEntities = Entities.size();
+  Chunk.FirstBegin = Entities.front().Range.getBegin();
+  Chunk.LastBegin = Entities.back().Range.getBegin();
+  Chunk.LastEnd = Entities.back().Range.getEnd();
+  Chunk.Data.clear();
+  SourceLocation PrevBegin = Chunk.FirstBegin;
+  for (unsigned I = 0, N = Entities.size(); I != N; ++I) {
+    EncodeEntity(Chunk.Data, PrevBegin, Entities[I].Kind, Entities[I].Payload,
+                 Entities[I].Range);
+    PrevBegin = Entities[I].Range.getBegin();
   }
+}
 
-  bool operator()(SourceLocation LHS, PreprocessedEntity *R) const {
-    SourceLocation RHS = getLoc(R);
-    return SM.isBeforeInTranslationUnit(LHS, RHS);
+const std::vector<PreprocessingRecord::DecodedEntity> &
+PreprocessingRecord::decodeChunk(unsigned ChunkIdx) const {
+  if (DecodedChunk == ChunkIdx)
+    return DecodedEntities;
+
+  const EntityChunk &Chunk = EntityChunks[ChunkIdx];
+  DecodedEntities.resize(Chunk.NumEntities);
+  const unsigned char *Data = Chunk.Data.empty() ? 0 : &Chunk.Data[0];
+  SourceLocation PrevBegin = Chunk.FirstBegin;
+  for (unsigned I = 0, N = Chunk.NumEntities; I != N; ++I) {
+    DecodedEntity &Entity = DecodedEntities[I];
+    uint32_t KindAndPayload = io::ReadVBR32(Data);
+    Entity.Kind = PreprocessedEntity::EntityKind(
+               PreprocessedEntity::MacroExpansionKind + (KindAndPayload & 3));
+    Entity.Payload = KindAndPayload >> 2;
+    SourceLocation Begin = DecodeLocDelta(PrevBegin, io::ReadVBR32(Data));
+    SourceLocation End = DecodeLocDelta(Begin, io::ReadVBR32(Data));
+    Entity.Range = SourceRange(Begin, End);
+    PrevBegin = Begin;
   }
+  DecodedChunk = ChunkIdx;
+  return DecodedEntities;
+}
 
-  SourceLocation getLoc(PreprocessedEntity *PPE) const {
-    SourceRange Range = PPE->getSourceRange();
-    return (Range.*getRangeLoc)();
+unsigned PreprocessingRecord::findChunk(unsigned Index) const {
+  assert(Index < NumLocalEntities && "Out-of bounds local entity");
+  if (DecodedChunk < EntityChunks.size()) {
+    const EntityChunk &Chunk = EntityChunks[DecodedChunk];
+    if (Index >= Chunk.FirstIndex &&
+        Index - Chunk.FirstIndex < Chunk.NumEntities)
+      return DecodedChunk;
   }
-};
 
+  // Find the last chunk that starts at or before Index.
+  unsigned First = 0, Count = EntityChunks.size();
+  while (Count > 0) {
+    unsigned Half = Count/2;
+    if (EntityChunks[First + Half].FirstIndex <= Index) {
+      First += Half + 1;
+      Count -= Half + 1;
+    } else
+      Count = Half;
+  }
+  assert(First > 0 && "Entity before the first chunk");
+  return First - 1;
 }
 
 unsigned PreprocessingRecord::findBeginLocalPreprocessedEntity(
@@ -129,30 +287,38 @@ unsigned PreprocessingRecord::findBeginLocalPreprocessedEntity(
   if (SourceMgr.isLoadedSourceLocation(Loc))
     return 0;
 
-  size_t Count = PreprocessedEntities.size();
-  size_t Half;
-  std::vector<PreprocessedEntity *>::const_iterator
-    First = PreprocessedEntities.begin();
-  std::vector<PreprocessedEntity *>::const_iterator I;
-
   // Do a binary search manually instead of using std::lower_bound because
   // The end locations of entities may be unordered (when a macro expansion
   // is inside another macro argument), but for this case it is not important
   // whether we get the first macro expansion or its containing macro.
+  // Find the chunk first, then the entity within it.
+  unsigned First = 0, Count = EntityChunks.size();
   while (Count > 0) {
-    Half = Count/2;
-    I = First;
-    std::advance(I, Half);
-    if (SourceMgr.isBeforeInTranslationUnit((*I)->getSourceRange().getEnd(),
-                                            Loc)){
-      First = I;
-      ++First;
-      Count = Count - Half - 1;
+    unsigned Half = Count/2;
+    if (SourceMgr.isBeforeInTranslationUnit(EntityChunks[First+Half].LastEnd,
+                                            Loc)) {
+      First += Half + 1;
+      Count -= Half + 1;
     } else
       Count = Half;
   }
+  if (First == EntityChunks.size())
+    return NumLocalEntities;
 
-  return First - PreprocessedEntities.begin();
+  unsigned ChunkIdx = First;
+  const std::vector<DecodedEntity> &Entities = decodeChunk(ChunkIdx);
+  First = 0;
+  Count = Entities.size();
+  while (Count > 0) {
+    unsigned Half = Count/2;
+    if (SourceMgr.isBeforeInTranslationUnit(
+                                Entities[First+Half].Range.getEnd(), Loc)) {
+      First += Half + 1;
+      Count -= Half + 1;
+    } else
+      Count = Half;
+  }
+  return EntityChunks[ChunkIdx].FirstIndex + First;
 }
 
 unsigned PreprocessingRecord::findEndLocalPreprocessedEntity(
@@ -160,41 +326,132 @@ unsigned PreprocessingRecord::findEndLocalPreprocessedEntity(
   if (SourceMgr.isLoadedSourceLocation(Loc))
     return 0;
 
-  std::vector<PreprocessedEntity *>::const_iterator
-  I = std::upper_bound(PreprocessedEntities.begin(),
-                       PreprocessedEntities.end(),
-                       Loc,
-                       PPEntityComp<&SourceRange::getBegin>(SourceMgr));
-  return I - PreprocessedEntities.begin();
+  // Find the first chunk that begins after Loc; the entities we are after
+  // end in the chunk before it.
+  unsigned First = 0, Count = EntityChunks.size();
+  while (Count > 0) {
+    unsigned Half = Count/2;
+    SourceLocation ChunkBegin = EntityChunks[First+Half].FirstBegin;
+    if (!SourceMgr.isBeforeInTranslationUnit(Loc, ChunkBegin)) {
+      First += Half + 1;
+      Count -= Half + 1;
+    } else
+      Count = Half;
+  }
+  if (First == 0)
+    return 0;
+
+  unsigned ChunkIdx = First - 1;
+  const std::vector<DecodedEntity> &Entities = decodeChunk(ChunkIdx);
+  First = 0;
+  Count = Entities.size();
+  while (Count > 0) {
+    unsigned Half = Count/2;
+    if (!SourceMgr.isBeforeInTranslationUnit(Loc,
+                                      Entities[First+Half].Range.getBegin())) {
+      First += Half + 1;
+      Count -= Half + 1;
+    } else
+      Count = Half;
+  }
+  return EntityChunks[ChunkIdx].FirstIndex + First;
 }
 
-void PreprocessingRecord::addPreprocessedEntity(PreprocessedEntity *Entity) {
-  assert(Entity);
-  SourceLocation BeginLoc = Entity->getSourceRange().getBegin();
-  
+unsigned
+PreprocessingRecord::addLocalEntity(PreprocessedEntity::EntityKind Kind,
+                                    unsigned Payload, SourceRange Range) {
+  SourceLocation BeginLoc = Range.getBegin();
+
   // Check normal case, this entity begin location is after the previous one.
-  if (PreprocessedEntities.empty() ||
+  if (EntityChunks.empty() ||
       !SourceMgr.isBeforeInTranslationUnit(BeginLoc,
-                   PreprocessedEntities.back()->getSourceRange().getBegin())) {
-    PreprocessedEntities.push_back(Entity);
-    return;
+                                           EntityChunks.back().LastBegin)) {
+    if (EntityChunks.empty() ||
+        EntityChunks.back().NumEntities >= EntityChunkSize) {
+      EntityChunks.push_back(EntityChunk());
+      EntityChunks.back().FirstIndex = NumLocalEntities;
+      EntityChunks.back().FirstBegin = BeginLoc;
+      EntityChunks.back().LastBegin = BeginLoc;
+    }
+
+    EntityChunk &Chunk = EntityChunks.back();
+    EncodeEntity(Chunk.Data, Chunk.LastBegin, Kind, Payload, Range);
+    Chunk.LastBegin = BeginLoc;
+    Chunk.LastEnd = Range.getEnd();
+    ++Chunk.NumEntities;
+    if (DecodedChunk == EntityChunks.size() - 1)
+      DecodedChunk = ~0U;
+    return NumLocalEntities++;
   }
 
   // The entity's location is not after the previous one; this can happen rarely
   // e.g. with "#include MACRO".
-  // Iterate the entities vector in reverse until we find the right place to
-  // insert the new entity.
-  for (std::vector<PreprocessedEntity *>::iterator
-         RI = PreprocessedEntities.end(), Begin = PreprocessedEntities.begin();
-       RI != Begin; --RI) {
-    std::vector<PreprocessedEntity *>::iterator I = RI;
-    --I;
-    if (!SourceMgr.isBeforeInTranslationUnit(BeginLoc,
-                                           (*I)->getSourceRange().getBegin())) {
-      PreprocessedEntities.insert(RI, Entity);
-      return;
-    }
+  // Iterate the chunks in reverse until we find the one the new entity goes
+  // into, then re-encode it with the entity inserted at the right place.
+  unsigned ChunkIdx = EntityChunks.size() - 1;
+  while (ChunkIdx > 0 &&
+         SourceMgr.isBeforeInTranslationUnit(BeginLoc,
+                                             EntityChunks[ChunkIdx].FirstBegin))
+    --ChunkIdx;
+
+  std::vector<DecodedEntity> Entities = decodeChunk(ChunkIdx);
+  unsigned Pos = Entities.size();
+  while (Pos > 0 &&
+         SourceMgr.isBeforeInTranslationUnit(BeginLoc,
+                                             Entities[Pos-1].Range.getBegin()))
+    --Pos;
+
+  DecodedEntity Entity;
+  Entity.Kind = Kind;
+  Entity.Payload = Payload;
+  Entity.Range = Range;
+  Entities.insert(Entities.begin() + Pos, Entity);
+  encodeChunk(EntityChunks[ChunkIdx], Entities);
+  DecodedChunk = ~0U;
+
+  unsigned Index = EntityChunks[ChunkIdx].FirstIndex + Pos;
+  for (unsigned I = ChunkIdx + 1, N = EntityChunks.size(); I != N; ++I)
+    ++EntityChunks[I].FirstIndex;
+  ++NumLocalEntities;
+
+  // Entities after the new one moved up by one.
+  if (!MaterializedExpansions.empty()) {
+    llvm::DenseMap<unsigned, PreprocessedEntity *> Shifted;
+    for (llvm::DenseMap<unsigned, PreprocessedEntity *>::iterator
+           I = MaterializedExpansions.begin(),
+           E = MaterializedExpansions.end(); I != E; ++I)
+      Shifted[I->first >= Index ? I->first + 1 : I->first] = I->second;
+    MaterializedExpansions.swap(Shifted);
+  }
+  return Index;
+}
+
+unsigned PreprocessingRecord::addMacroExpansion(void *NameOrDef,
+                                                SourceRange Range) {
+  std::pair<llvm::DenseMap<void *, unsigned>::iterator, bool> Known
+    = ExpansionNameIndex.insert(std::make_pair(NameOrDef,
+                                               ExpansionNames.size()));
+  if (Known.second)
+    ExpansionNames.push_back(NameOrDef);
+  return addLocalEntity(PreprocessedEntity::MacroExpansionKind,
+                        Known.first->second, Range);
+}
+
+void PreprocessingRecord::addPreprocessedEntity(PreprocessedEntity *Entity) {
+  assert(Entity);
+  if (MacroExpansion *ME = dyn_cast<MacroExpansion>(Entity)) {
+    MacroNameOrDef NameOrDef = ME->isBuiltinMacro()
+      ? MacroNameOrDef(const_cast<IdentifierInfo *>(ME->getName()))
+      : MacroNameOrDef(ME->getDefinition());
+    unsigned Index = addMacroExpansion(NameOrDef.getOpaqueValue(),
+                                       ME->getSourceRange());
+    MaterializedExpansions[Index] = ME;
+    return;
   }
+
+  Directives.push_back(cast<PreprocessingDirective>(Entity));
+  addLocalEntity(Entity->getKind(), Directives.size() - 1,
+                 Entity->getSourceRange());
 }
 
 void PreprocessingRecord::SetExternalSource(
@@ -223,9 +480,35 @@ PreprocessedEntity *PreprocessingRecord::getPreprocessedEntity(PPEntityID PPID){
            "Out-of bounds loaded preprocessed entity");
     return getLoadedPreprocessedEntity(LoadedPreprocessedEntities.size()+PPID);
   }
-  assert(unsigned(PPID) < PreprocessedEntities.size() &&
+  return getLocalPreprocessedEntity(PPID);
+}
+
+PreprocessedEntity *
+PreprocessingRecord::getLocalPreprocessedEntity(unsigned Index) {
+  assert(Index < NumLocalEntities &&
          "Out-of bounds local preprocessed entity");
-  return PreprocessedEntities[PPID];
+  llvm::DenseMap<unsigned, PreprocessedEntity *>::iterator Known
+    = MaterializedExpansions.find(Index);
+  if (Known != MaterializedExpansions.end())
+    return Known->second;
+
+  unsigned ChunkIdx = findChunk(Index);
+  const DecodedEntity &Decoded
+    = decodeChunk(ChunkIdx)[Index - EntityChunks[ChunkIdx].FirstIndex];
+  if (Decoded.Kind != PreprocessedEntity::MacroExpansionKind)
+    return Directives[Decoded.Payload];
+
+  SourceRange Range = Decoded.Range;
+  MacroNameOrDef NameOrDef
+    = MacroNameOrDef::getFromOpaqueValue(ExpansionNames[Decoded.Payload]);
+  PreprocessedEntity *Entity;
+  if (MacroDefinition *Def = NameOrDef.dyn_cast<MacroDefinition *>())
+    Entity = new (*this) MacroExpansion(Def, Range);
+  else
+    Entity = new (*this) MacroExpansion(NameOrDef.get<IdentifierInfo *>(),
+                                        Range);
+  MaterializedExpansions[Index] = Entity;
+  return Entity;
 }
 
 /// \brief Retrieve the loaded preprocessed entity at the given index.
@@ -250,6 +533,9 @@ MacroDefinition *PreprocessingRecord::findMacroDefinition(const MacroInfo *MI) {
   if (Pos == MacroDefinitions.end())
     return 0;
   
+  if (Pos->second >= 0)
+    return cast<MacroDefinition>(Directives[Pos->second]);
+
   PreprocessedEntity *Entity = getPreprocessedEntity(Pos->second);
   if (Entity->isInvalid())
     return 0;
@@ -262,11 +548,10 @@ void PreprocessingRecord::MacroExpands(const Token &Id, const MacroInfo* MI,
     return;
 
   if (MI->isBuiltinMacro())
-    addPreprocessedEntity(
-                      new (*this) MacroExpansion(Id.getIdentifierInfo(),Range));
+    addMacroExpansion(MacroNameOrDef(Id.getIdentifierInfo()).getOpaqueValue(),
+                      Range);
   else if (MacroDefinition *Def = findMacroDefinition(MI))
-    addPreprocessedEntity(
-                       new (*this) MacroExpansion(Def, Range));
+    addMacroExpansion(MacroNameOrDef(Def).getOpaqueValue(), Range);
 }
 
 void PreprocessingRecord::MacroDefined(const Token &Id,
@@ -275,8 +560,7 @@ void PreprocessingRecord::MacroDefined(const Token &Id,
   MacroDefinition *Def
       = new (*this) MacroDefinition(Id.getIdentifierInfo(), R);
   addPreprocessedEntity(Def);
-  MacroDefinitions[MI] = getPPEntityID(PreprocessedEntities.size()-1,
-                                       /*isLoaded=*/false);
+  MacroDefinitions[MI] = Directives.size() - 1;
 }
 
 void PreprocessingRecord::MacroUndefined(const Token &Id,
@@ -327,8 +611,18 @@ void PreprocessingRecord::InclusionDirective(
 }
 
 size_t PreprocessingRecord::getTotalMemory() const {
+  size_t ChunkData = 0;
+  for (unsigned I = 0, N = EntityChunks.size(); I != N; ++I)
+    ChunkData += llvm::capacity_in_bytes(EntityChunks[I].Data);
+
   return BumpAlloc.getTotalMemory()
     + llvm::capacity_in_bytes(MacroDefinitions)
-    + llvm::capacity_in_bytes(PreprocessedEntities)
+    + llvm::capacity_in_bytes(EntityChunks) + ChunkData
+    + llvm::capacity_in_bytes(DecodedEntities)
+    + llvm::capacity_in_bytes(ExpansionNames)
+    + llvm::capacity_in_bytes(ExpansionNameIndex)
+    + llvm::capacity_in_bytes(Directives)
+    + llvm::capacity_in_bytes(MaterializedExpansions)
+    + llvm::capacity_in_bytes(FileEntities)
     + llvm::capacity_in_bytes(LoadedPreprocessedEntities);
 }
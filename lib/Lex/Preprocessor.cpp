@@ -27,9 +27,11 @@
 
 #include "clang/Lex/Preprocessor.h"
 #include "MacroArgs.h"
+#include "DirectiveSkeleton.h"
 #include "clang/Lex/ExternalPreprocessorSource.h"
 #include "clang/Lex/HeaderSearch.h"
 #include "clang/Lex/MacroInfo.h"
+#include "clang/Lex/MacroExpansionCache.h"
 #include "clang/Lex/Pragma.h"
 #include "clang/Lex/PreprocessingRecord.h"
 #include "clang/Lex/ScratchBuffer.h"
@@ -40,12 +42,17 @@
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/TargetInfo.h"
 #include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Capacity.h"
 using namespace clang;
 
+/// PackedScratchChunkSize - The size scratch buffer chunks grow to with
+/// packScratchBuffers().
+static const unsigned PackedScratchChunkSize = 4 * 1024 * 1024;
+
 //===----------------------------------------------------------------------===//
 ExternalPreprocessorSource::~ExternalPreprocessorSource() { }
 
@@ -56,13 +63,16 @@ Preprocessor::Preprocessor(DiagnosticsEngine &diags, LangOptions &opts,
                            bool OwnsHeaders,
                            bool DelayInitialization)
   : Diags(&diags), Features(opts), Target(target),FileMgr(Headers.getFileMgr()),
-    SourceMgr(SM), HeaderInfo(Headers), TheModuleLoader(TheModuleLoader),
+    SourceMgr(SM), ScratchBuf(0), HeaderInfo(Headers),
+    TheModuleLoader(TheModuleLoader),
     ExternalSource(0), 
     Identifiers(opts, IILookup), CodeComplete(0),
     CodeCompletionFile(0), CodeCompletionOffset(0), CodeCompletionReached(0),
     SkipMainFilePreamble(0, true), CurPPLexer(0), 
     CurDirLookup(0), CurLexerKind(CLK_Lexer), Callbacks(0), MacroArgCache(0), 
-    Record(0), MIChainHead(0), MICache(0) 
+    Record(0), ExpansionCache(0), PackScratchBuffers(false),
+    MacroPreExpansionSentinel(0),
+    NumDiagnostics(0), MIChainHead(0), MICache(0) 
 {
   OwnsHeaderSearch = OwnsHeaders;
   
@@ -102,6 +112,10 @@ Preprocessor::~Preprocessor() {
   // Delete the scratch buffer info.
   delete ScratchBuf;
 
+  delete ExpansionCache;
+
+  llvm::DeleteContainerSeconds(DirectiveSkeletons);
+
   // Delete the header search info, if we own it.
   if (OwnsHeaderSearch)
     delete &HeaderInfo;
@@ -118,6 +132,8 @@ void Preprocessor::Initialize(const TargetInfo &Target) {
   BuiltinInfo.InitializeTarget(Target);
   
   ScratchBuf = new ScratchBuffer(SourceMgr);
+  if (PackScratchBuffers)
+    ScratchBuf->setMaxChunkSize(PackedScratchChunkSize);
   CounterValue = 0; // __COUNTER__ starts at 0.
   
   // Clear stats.
@@ -127,7 +143,7 @@ void Preprocessor::Initialize(const TargetInfo &Target) {
   NumMacroExpanded = NumFnMacroExpanded = NumBuiltinMacroExpanded = 0;
   NumFastMacroExpanded = NumTokenPaste = NumFastTokenPaste = 0;
   MaxIncludeStackDepth = 0;
-  NumSkipped = 0;
+  NumSkipped = NumSkippedWithSkeleton = 0;
   
   // Default to discarding comments.
   KeepComments = false;
@@ -228,7 +244,8 @@ void Preprocessor::PrintStats() {
   llvm::errs() << "  " << NumElse << " #else/#elif.\n";
   llvm::errs() << "  " << NumEndif << " #endif.\n";
   llvm::errs() << "  " << NumPragma << " #pragma.\n";
-  llvm::errs() << NumSkipped << " #if/#ifndef#ifdef regions skipped\n";
+  llvm::errs() << NumSkipped << " #if/#ifndef#ifdef regions skipped, "
+               << NumSkippedWithSkeleton << " through a directive skeleton.\n";
 
   llvm::errs() << NumMacroExpanded << "/" << NumFnMacroExpanded << "/"
              << NumBuiltinMacroExpanded << " obj/fn/builtin macros expanded, "
@@ -236,6 +253,11 @@ void Preprocessor::PrintStats() {
   llvm::errs() << (NumFastTokenPaste+NumTokenPaste)
              << " token paste (##) operations performed, "
              << NumFastTokenPaste << " on the fast path.\n";
+
+  if (ExpansionCache)
+    ExpansionCache->PrintStats();
+  if (ScratchBuf)
+    ScratchBuf->PrintStats();
 }
 
 Preprocessor::macro_iterator
@@ -619,3 +641,14 @@ void Preprocessor::createPreprocessingRecord(
                                    IncludeNestedMacroExpansions);
   addPPCallbacks(Record);
 }
+
+void Preprocessor::createMacroExpansionCache() {
+  if (!ExpansionCache)
+    ExpansionCache = new MacroExpansionCache(getSourceManager());
+}
+
+void Preprocessor::packScratchBuffers() {
+  PackScratchBuffers = true;
+  if (ScratchBuf)
+    ScratchBuf->setMaxChunkSize(PackedScratchChunkSize);
+}
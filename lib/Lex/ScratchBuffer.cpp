@@ -14,16 +14,25 @@
 #include "clang/Lex/ScratchBuffer.h"
 #include "clang/Basic/SourceManager.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <cstring>
 using namespace clang;
 
-// ScratchBufSize - The size of each chunk of scratch memory.  Slightly less
-//than a page, almost certainly enough for anything. :)
+// ScratchBufSize - The size of the first chunk of scratch memory.  Slightly
+// less than a page, almost certainly enough for anything. :)
 static const unsigned ScratchBufSize = 4060;
 
-ScratchBuffer::ScratchBuffer(SourceManager &SM) : SourceMgr(SM), CurBuffer(0) {
+// DefaultMaxChunkSize - The size chunks stop doubling at by default.
+static const unsigned DefaultMaxChunkSize = 64 * 1024;
+
+ScratchBuffer::ScratchBuffer(SourceManager &SM)
+  : SourceMgr(SM), CurBuffer(0), CurBufferSize(0),
+    MaxChunkSize(DefaultMaxChunkSize), NumTokens(0), NumChunks(0),
+    BytesAllocated(0), NumFixedChunks(0), FixedBytesAllocated(0),
+    FixedBytesUsed(ScratchBufSize) {
   // Set BytesUsed so that the first call to getToken will require an alloc.
-  BytesUsed = ScratchBufSize;
+  BytesUsed = CurBufferSize;
 }
 
 /// getToken - Splat the specified text into a temporary MemoryBuffer and
@@ -32,9 +41,18 @@ ScratchBuffer::ScratchBuffer(SourceManager &SM) : SourceMgr(SM), CurBuffer(0) {
 /// token.
 SourceLocation ScratchBuffer::getToken(const char *Buf, unsigned Len,
                                        const char *&DestPtr) {
-  if (BytesUsed+Len+2 > ScratchBufSize)
+  if (BytesUsed+Len+2 > CurBufferSize)
     AllocScratchBuffer(Len+2);
 
+  // Keep track of what chunks of ScratchBufSize bytes would have needed.
+  ++NumTokens;
+  if (FixedBytesUsed+Len+2 > ScratchBufSize) {
+    ++NumFixedChunks;
+    FixedBytesAllocated += std::max(Len+2, ScratchBufSize);
+    FixedBytesUsed = 1;
+  }
+  FixedBytesUsed += Len+2;
+
   // Prefix the token with a \n, so that it looks like it is the first thing on
   // its own virtual line in caret diagnostics.
   CurBuffer[BytesUsed++] = '\n';
@@ -57,17 +75,37 @@ SourceLocation ScratchBuffer::getToken(const char *Buf, unsigned Len,
 }
 
 void ScratchBuffer::AllocScratchBuffer(unsigned RequestLen) {
-  // Only pay attention to the requested length if it is larger than our default
-  // page size.  If it is, we allocate an entire chunk for it.  This is to
-  // support gigantic tokens, which almost certainly won't happen. :)
-  if (RequestLen < ScratchBufSize)
-    RequestLen = ScratchBufSize;
+  // Each chunk is twice as large as the previous one, up to MaxChunkSize, so
+  // that code which pastes a lot of tokens doesn't create a FileID for every
+  // few kilobytes of them.
+  unsigned ChunkSize = ScratchBufSize;
+  if (CurBufferSize)
+    ChunkSize = std::max(std::min(CurBufferSize * 2, MaxChunkSize),
+                         ScratchBufSize);
+
+  // Only pay attention to the requested length if it is larger than the chunk
+  // size.  If it is, we allocate an entire chunk for it.  This is to support
+  // gigantic tokens, which almost certainly won't happen. :)
+  if (RequestLen < ChunkSize)
+    RequestLen = ChunkSize;
 
   llvm::MemoryBuffer *Buf =
     llvm::MemoryBuffer::getNewMemBuffer(RequestLen, "<scratch space>");
   FileID FID = SourceMgr.createFileIDForMemBuffer(Buf);
   BufferStartLoc = SourceMgr.getLocForStartOfFile(FID);
   CurBuffer = const_cast<char*>(Buf->getBufferStart());
+  CurBufferSize = RequestLen;
   BytesUsed = 1;
   CurBuffer[0] = '0';  // Start out with a \0 for cleanliness.
+
+  ++NumChunks;
+  BytesAllocated += RequestLen;
+}
+
+void ScratchBuffer::PrintStats() const {
+  llvm::errs() << NumTokens << " scratch tokens in " << NumChunks
+               << " chunks of scratch space (" << BytesAllocated
+               << " bytes); fixed-size chunks would have taken "
+               << NumFixedChunks << " (" << FixedBytesAllocated
+               << " bytes).\n";
 }
@@ -23,10 +23,12 @@
 #include "clang/AST/ASTConsumer.h"
 using namespace clang;
 
-Parser::Parser(Preprocessor &pp, Sema &actions)
+Parser::Parser(Preprocessor &pp, Sema &actions, bool skipFunctionBodies)
   : PP(pp), Actions(actions), Diags(PP.getDiagnostics()),
     GreaterThanIsOperator(true), ColonIsSacred(false), 
-    InMessageExpression(false), TemplateParameterDepth(0) {
+    InMessageExpression(false), TemplateParameterDepth(0),
+    SkipFunctionBodies(skipFunctionBodies), NumSkippedBodies(0),
+    NumLazilyParsedBodies(0) {
   Tok.setKind(tok::eof);
   Actions.CurScope = 0;
   NumCachedScopes = 0;
@@ -68,6 +70,9 @@ Parser::Parser(Preprocessor &pp, Sema &actions)
   }
       
   PP.setCodeCompletionHandler(*this);
+
+  if (SkipFunctionBodies)
+    Actions.getASTContext().setLazyBodyParser(LazyBodyParserCallback, this);
 }
 
 /// If a crash happens while the parser is active, print out a line indicating
@@ -362,6 +367,16 @@ Parser::~Parser() {
       it != LateParsedTemplateMap.end(); ++it)
     delete it->second;
 
+  // Bodies which are still skipped can't be parsed any more, so their
+  // functions become mere declarations.
+  if (SkipFunctionBodies)
+    Actions.getASTContext().setLazyBodyParser(0, 0);
+  for (SkippedBodyMapT::iterator I = SkippedBodies.begin(),
+       E = SkippedBodies.end(); I != E; ++I) {
+    const_cast<FunctionDecl*>(I->first)->setHasSkippedBody(false);
+    delete I->second;
+  }
+
   // Remove the pragma handlers we installed.
   PP.RemovePragmaHandler(AlignHandler.get());
   AlignHandler.reset();
@@ -389,6 +404,12 @@ Parser::~Parser() {
   PP.clearCodeCompletionHandler();
 }
 
+void Parser::PrintStats() {
+  llvm::errs() << "\n*** Parser Stats:\n";
+  llvm::errs() << "  " << NumSkippedBodies << " function bodies skipped, "
+               << NumLazilyParsedBodies << " of them parsed when needed.\n";
+}
+
 /// Initialize - Warm up the parser.
 ///
 void Parser::Initialize() {
@@ -472,6 +493,13 @@ bool Parser::ParseTopLevelDecl(DeclGroupPtrTy &Result) {
     if (getLang().DelayedTemplateParsing)
       Actions.SetLateTemplateParser(LateTemplateParserCallback, this);
 
+    // Uses of file scoped declarations in the bodies which are still skipped
+    // haven't been seen, so none of them can be said to be unused.
+    if (!SkippedBodies.empty())
+      Actions.UnusedFileScopedDecls.erase(
+        Actions.UnusedFileScopedDecls.begin(Actions.ExternalSource),
+        Actions.UnusedFileScopedDecls.end());
+
     Actions.ActOnEndOfTranslationUnit();
     return true;
   }
@@ -889,6 +917,42 @@ Decl *Parser::ParseFunctionDefinition(ParsingDeclarator &D,
     return DP;
   }
 
+  // When skipping function bodies, store the tokens of the body and parse
+  // them only if somebody asks for the body.  Only C functions are skipped:
+  // they are defined at file scope, where the body can be parsed later on
+  // without reentering any other scope.
+  if (SkipFunctionBodies && Tok.is(tok::l_brace) &&
+      TemplateInfo.Kind == ParsedTemplateInfo::NonTemplate &&
+      !getLang().CPlusPlus && !ObjCImpDecl && !PP.isCodeCompletionEnabled()) {
+    ParseScope BodyScope(this, Scope::FnScope|Scope::DeclScope);
+    Scope *ParentScope = getCurScope()->getParent();
+
+    D.setFunctionDefinition(true);
+    Decl *DP = Actions.HandleDeclarator(ParentScope, D,
+                                        MultiTemplateParamsArg(Actions));
+    D.complete(DP);
+    D.getMutableDeclSpec().abort();
+
+    CachedTokens *Toks = new CachedTokens;
+    Toks->push_back(Tok);
+    ConsumeBrace();
+    if (!ConsumeAndStoreUntil(tok::r_brace, *Toks, /*StopAtSemi=*/false))
+      Diag(Tok, diag::err_expected_rbrace);
+
+    FunctionDecl *FnD = dyn_cast_or_null<FunctionDecl>(DP);
+    if (!FnD) {
+      delete Toks;
+      return DP;
+    }
+
+    Actions.CheckForFunctionRedefinition(FnD);
+    FnD->setHasSkippedBody();
+    FnD->setRangeEnd(Toks->back().getLocation());
+    SkippedBodies[FnD] = Toks;
+    ++NumSkippedBodies;
+    return DP;
+  }
+
   // Enter a scope for the function body.
   ParseScope BodyScope(this, Scope::FnScope|Scope::DeclScope);
 
@@ -966,6 +1030,49 @@ Decl *Parser::ParseFunctionDefinition(ParsingDeclarator &D,
   return ParseFunctionStatementBody(Res, BodyScope);
 }
 
+void Parser::LazyBodyParserCallback(void *P, const FunctionDecl *FD) {
+  ((Parser*)P)->ParseSkippedFunctionBody(FD);
+}
+
+/// \brief Parse the body of a function skipped by ParseFunctionDefinition,
+/// from the tokens stored for it.
+void Parser::ParseSkippedFunctionBody(const FunctionDecl *FD) {
+  // The body can only be parsed between top-level declarations, where the
+  // translation unit is the only scope.  Anywhere else the caller of
+  // getBody() gets a null body and has to do without it.
+  if (getCurScope() != Actions.TUScope)
+    return;
+
+  SkippedBodyMapT::iterator Pos = SkippedBodies.find(FD);
+  if (Pos == SkippedBodies.end())
+    return;
+
+  // Forget the tokens first: parsing the body may ask for it again.
+  llvm::OwningPtr<CachedTokens> Toks(Pos->second);
+  SkippedBodies.erase(Pos);
+  assert(!Toks->empty() && Toks->front().is(tok::l_brace) &&
+         "Skipped body not starting with '{'");
+
+  // Append the current token at the end of the new token stream so that it
+  // doesn't get lost.  The preprocessor owns the copy of the tokens.
+  Token *Buffer = new Token[Toks->size() + 1];
+  std::copy(Toks->begin(), Toks->end(), Buffer);
+  Buffer[Toks->size()] = Tok;
+  PP.EnterTokenStream(Buffer, Toks->size() + 1, true, /*OwnsTokens=*/true);
+
+  // Consume the previously pushed token.
+  ConsumeAnyToken();
+
+  FunctionDecl *Fn = const_cast<FunctionDecl*>(FD);
+  ParseScope BodyScope(this, Scope::FnScope|Scope::DeclScope);
+  Sema::ContextRAII SavedContext(Actions, Actions.getContainingDC(Fn));
+
+  Actions.ActOnStartOfFunctionDef(getCurScope(), Fn);
+  ParseFunctionStatementBody(Fn, BodyScope);
+  Fn->setHasSkippedBody(false);
+  ++NumLazilyParsedBodies;
+}
+
 /// ParseKNRParamDeclarations - Parse 'declaration-list[opt]' which provides
 /// types for a function with a K&R-style identifier list for arguments.
 void Parser::ParseKNRParamDeclarations(Declarator &D) {
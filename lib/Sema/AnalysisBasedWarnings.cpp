@@ -345,6 +345,14 @@ static void CheckFallThroughForBody(Sema &S, const Decl *D, const Stmt *Body,
 
   // FIXME: Function try block
   if (const CompoundStmt *Compound = dyn_cast<CompoundStmt>(Body)) {
+    // Control can only reach the end of a body which ends in a return through
+    // that return, so the body never falls through.  The only diagnostic left
+    // is the suggestion to mark a void function noreturn.  Most functions
+    // end this way, and the check shouldn't be the one to build their CFG.
+    const Stmt *Last = Compound->body_back();
+    if ((!ReturnsVoid || HasNoReturn) && Last && isa<ReturnStmt>(Last))
+      return;
+
     switch (CheckFallThrough(AC)) {
       case UnknownFallThrough:
         break;
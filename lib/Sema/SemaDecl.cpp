@@ -6931,7 +6931,7 @@ Decl *Sema::ActOnStartOfFunctionDef(Scope *FnBodyScope, Decl *D) {
   PushFunctionScope();
 
   // See if this is a redefinition.
-  if (!FD->isLateTemplateParsed())
+  if (!FD->isLateTemplateParsed() && !FD->hasSkippedBody())
     CheckForFunctionRedefinition(FD);
 
   // Builtin functions cannot be defined.
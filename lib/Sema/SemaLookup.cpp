@@ -3606,7 +3606,8 @@ TypoCorrection Sema::CorrectTypo(const DeclarationNameInfo &TypoName,
         return TypoCorrection();
 
       // For unqualified lookup, look through all of the names that we have
-      // seen in this translation unit.
+      // seen in this translation unit, along with the builtins.
+      Context.Idents.AddVocabulary();
       for (IdentifierTable::iterator I = Context.Idents.begin(),
                                   IEnd = Context.Idents.end();
            I != IEnd; ++I)
@@ -136,9 +136,13 @@ void ASTDeclWriter::Visit(Decl *D) {
   // Handle FunctionDecl's body here and write it after all other Stmts/Exprs
   // have been written. We want it last because we will not read it back when
   // retrieving it from the AST, we'll just lazily set the offset. 
+  // A body the parser skipped is written as no body at all, rather than
+  // having the parser produce it in the middle of writing the AST.
   if (FunctionDecl *FD = dyn_cast<FunctionDecl>(D)) {
-    Record.push_back(FD->doesThisDeclarationHaveABody());
-    if (FD->doesThisDeclarationHaveABody())
+    bool HasBody = FD->doesThisDeclarationHaveABody() &&
+                   !FD->hasSkippedBody();
+    Record.push_back(HasBody);
+    if (HasBody)
       Writer.AddStmt(FD->getBody());
   }
 }
@@ -0,0 +1 @@
+int a_missing_return() {}
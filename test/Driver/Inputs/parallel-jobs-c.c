@@ -0,0 +1 @@
+int c = undeclared_c;
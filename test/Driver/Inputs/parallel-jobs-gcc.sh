@@ -0,0 +1,18 @@
+#!/bin/sh
+
+# Stands in for gcc in parallel-jobs-concurrent.c.  Each instance announces
+# itself in $PARALLEL_JOBS_DIR and waits for another instance to do the same,
+# so it only succeeds when the driver runs more than one command at a time.
+
+touch "$PARALLEL_JOBS_DIR/started.$$"
+i=0
+while [ $i -lt 60 ]; do
+  if [ `ls "$PARALLEL_JOBS_DIR" | wc -l` -ge 2 ]; then
+    echo "parallel-jobs-gcc: saw another command running"
+    exit 0
+  fi
+  sleep 1
+  i=`expr $i + 1`
+done
+echo "parallel-jobs-gcc: no other command was running" >&2
+exit 1
@@ -0,0 +1,14 @@
+// REQUIRES: shell
+
+// With -j 2 the two compiles run at the same time.  The stand-in gcc only
+// succeeds once it has seen another instance start, so running the commands
+// one after the other would fail after a minute.
+
+// RUN: rm -rf %t.dir && mkdir %t.dir
+// RUN: env PARALLEL_JOBS_DIR=%t.dir %clang -ccc-no-clang \
+// RUN:   -ccc-host-triple i386-unknown-unknown \
+// RUN:   -ccc-gcc-name %S/Inputs/parallel-jobs-gcc.sh -j 2 -fsyntax-only \
+// RUN:   %S/Inputs/parallel-jobs-a.c %S/Inputs/parallel-jobs-c.c > %t.out
+// RUN: FileCheck %s < %t.out
+// CHECK: parallel-jobs-gcc: saw another command running
+// CHECK: parallel-jobs-gcc: saw another command running
@@ -0,0 +1,24 @@
+// Commands run with -j are replayed in job order, and nothing after the first
+// failing command is reported, just as when they are run one at a time.
+
+// RUN: not %clang -j 3 -fsyntax-only %S/Inputs/parallel-jobs-a.c \
+// RUN:   %S/Inputs/parallel-jobs-b.c %S/Inputs/parallel-jobs-c.c 2> %t
+// RUN: FileCheck %s < %t
+// CHECK: parallel-jobs-a.c:1:25: warning: control reaches end of non-void function
+// CHECK: parallel-jobs-b.c:1:9: error: use of undeclared identifier 'undeclared_b'
+// CHECK-NOT: undeclared_c
+
+// RUN: %clang -j 2 -E %s %s -DVALUE=42 | FileCheck -check-prefix=PP %s
+// PP: int first = 42;
+// PP: int second = 42;
+// PP: int first = 42;
+// PP: int second = 42;
+int first = VALUE;
+int second = VALUE;
+
+// RUN: not %clang -j 0 -fsyntax-only %s -DVALUE=0 2>&1 | \
+// RUN:   FileCheck -check-prefix=ZERO %s
+// ZERO: invalid value '0' in '-j 0'
+// RUN: not %clang -j foo -fsyntax-only %s -DVALUE=0 2>&1 | \
+// RUN:   FileCheck -check-prefix=INVALID %s
+// INVALID: invalid value 'foo' in '-j foo'
@@ -0,0 +1 @@
+#include "batch-scan.h"
@@ -0,0 +1,2 @@
+#include <batch-scan.h>
+#include "batch-scan-a.c"
@@ -0,0 +1,4 @@
+#ifndef BATCH_SCAN_H
+#define BATCH_SCAN_H
+int batch_scan;
+#endif
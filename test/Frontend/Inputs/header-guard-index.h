@@ -0,0 +1,6 @@
+#ifndef HEADER_GUARD_INDEX_H
+#define HEADER_GUARD_INDEX_H
+
+int header_guard_index;
+
+#endif
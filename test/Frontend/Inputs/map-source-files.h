@@ -0,0 +1 @@
+void takes_int(int x);
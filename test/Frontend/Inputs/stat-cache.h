@@ -0,0 +1 @@
+#define STAT_CACHE_HEADER 1
@@ -0,0 +1,31 @@
+// RUN: rm -rf %t.dir && mkdir -p %t.dir
+// RUN: %clang -cc1scan -j 4 -scan-deps-dir %t.dir -I %S/Inputs %s %S/Inputs/batch-scan-a.c %S/Inputs/batch-scan-b.c
+// RUN: FileCheck -check-prefix=MAIN %s < %t.dir/batch-scan.d
+// MAIN: batch-scan.o:
+// MAIN: batch-scan.h
+// RUN: FileCheck -check-prefix=B %s < %t.dir/batch-scan-b.d
+// B: batch-scan-b.o:
+// B: batch-scan.h
+// B: batch-scan-a.c
+
+// RUN: echo %S/Inputs/batch-scan-a.c > %t.list
+// RUN: echo %S/Inputs/batch-scan-b.c >> %t.list
+// RUN: %clang -cc1scan -j 2 -scan-deps-json %t.json -scan-inputs %t.list -I %S/Inputs %s -print-stats 2> %t.stats
+// RUN: FileCheck -check-prefix=JSON %s < %t.json
+// JSON: "translation-units": [
+// JSON: "input": "{{.*}}batch-scan.c",
+// JSON-NEXT: "target": "batch-scan.o",
+// JSON-NEXT: "success": true,
+// JSON: "{{.*}}batch-scan.h"
+// JSON: "input": "{{.*}}batch-scan-a.c",
+// JSON: "input": "{{.*}}batch-scan-b.c",
+// RUN: FileCheck -check-prefix=STATS %s < %t.stats
+// STATS: *** Search Directory Index Stats:
+// STATS: search directories indexed
+
+// RUN: not %clang -cc1scan %s 2>&1 | FileCheck -check-prefix=NO-OUTPUT %s
+// NO-OUTPUT: error: -cc1scan requires -scan-deps-dir or -scan-deps-json
+// RUN: not %clang -cc1scan -scan-deps-dir %t.dir %s %s 2>&1 | FileCheck -check-prefix=DUP %s
+// DUP: error: inputs '{{.*}}batch-scan.c' and '{{.*}}batch-scan.c' would both write dependencies for
+
+#include "batch-scan.h"
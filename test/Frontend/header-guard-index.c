@@ -0,0 +1,23 @@
+// RUN: rm -f %t.statcache %t.statcache.guards
+// RUN: %clang_cc1 -stat-cache %t.statcache -I %S/Inputs -fsyntax-only -verify %s
+// RUN: %clang_cc1 -stat-cache %t.statcache -I %S/Inputs -fsyntax-only -verify %s -DHEADER_GUARD_INDEX_H -DSKIPPED -print-stats 2>&1 | FileCheck %s
+// CHECK: 1 #includes skipped due to the header guard index.
+// CHECK: {{[1-9][0-9]*}} header guards loaded
+
+// Headers skipped through the index are still dependencies.
+// RUN: %clang_cc1 -stat-cache %t.statcache -I %S/Inputs -fsyntax-only %s -DHEADER_GUARD_INDEX_H -DSKIPPED -MT %s.o -dependency-file %t.d
+// RUN: FileCheck -check-prefix=DEPS %s < %t.d
+// DEPS: header-guard-index.h
+
+// -H lists them once, as it lists a header whose guard is found by lexing it.
+// RUN: %clang_cc1 -stat-cache %t.statcache -I %S/Inputs -fsyntax-only %s -DHEADER_GUARD_INDEX_H -DSKIPPED -H 2> %t.h
+// RUN: FileCheck -check-prefix=HEADERS %s < %t.h
+// HEADERS: . {{.*}}header-guard-index.h
+// HEADERS-NOT: header-guard-index.h
+
+#include <header-guard-index.h>
+#include <header-guard-index.h>
+
+#ifndef SKIPPED
+int *p = &header_guard_index;
+#endif
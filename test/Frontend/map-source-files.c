@@ -0,0 +1,14 @@
+// RUN: not %clang_cc1 -map-source-files -I %S/Inputs -fsyntax-only %s -print-stats 2>&1 | FileCheck %s
+
+#include <map-source-files.h>
+
+void f() {
+  takes_int();
+}
+
+// The note points into the header, whose pages were released once it had
+// been lexed.
+// CHECK: map-source-files.c:6:14: error: too few arguments to function call
+// CHECK: map-source-files.h:1:6: note: 'takes_int' declared here
+// CHECK-NEXT: void takes_int(int x);
+// CHECK: {{[1-9][0-9]*}} files memory mapped
@@ -0,0 +1,11 @@
+// RUN: not %clang_cc1 -emit-llvm -skip-function-bodies %s -o /dev/null 2>&1 \
+// RUN:   | FileCheck %s
+// RUN: not %clang_cc1 -ast-print -skip-function-bodies %s 2>&1 | FileCheck %s
+
+// Bodies parsed out of order see the declarations which follow them, so
+// skipping them is only allowed when no code is generated from them.
+int f(void) {
+  return 0;
+}
+
+// CHECK: '-skip-function-bodies' only allowed with '-fsyntax-only'
@@ -0,0 +1,16 @@
+// RUN: rm -f %t.statcache
+// RUN: %clang_cc1 -stat-cache %t.statcache -I %S -I %S/Inputs -fsyntax-only -verify %s
+// RUN: %clang_cc1 -stat-cache %t.statcache -I %S -I %S/Inputs -fsyntax-only -verify %s -print-stats 2>&1 | FileCheck %s
+// CHECK: *** Persistent Stat Cache Stats
+// CHECK: {{[1-9][0-9]*}} records loaded
+// CHECK: {{[1-9][0-9]*}} hits
+
+// RUN: echo "not a stat cache" > %t.bad
+// RUN: %clang_cc1 -stat-cache %t.bad -I %S/Inputs -fsyntax-only %s 2>&1 | FileCheck -check-prefix=BAD %s
+// BAD: warning: unable to use stat cache '{{.*}}.bad': not a stat cache file
+
+#include <stat-cache.h>
+
+#if !STAT_CACHE_HEADER
+#error header not found through the cache
+#endif
@@ -0,0 +1,2 @@
+#define A(x) ((x) + 1)
+int a_func(int[3]);
@@ -0,0 +1,5 @@
+/* Same tokens as file-token-hashes-a.h, with different comments, blank
+   lines and amounts of whitespace. */
+#define   A(x)   ((x)   +   1)  // Add one.
+
+    int     a_func(int[3]);
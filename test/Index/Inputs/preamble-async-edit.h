@@ -0,0 +1,6 @@
+inline int baz(int i) {
+  float *ptr1;
+  int *ptr = 0;
+  ptr = ptr1;
+  return i;
+}
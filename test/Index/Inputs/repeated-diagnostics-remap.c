@@ -0,0 +1,3 @@
+#include "Inputs/repeated-diagnostics.h"
+#warning in the main file
+#warning added to the main file
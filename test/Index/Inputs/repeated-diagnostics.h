@@ -0,0 +1 @@
+#warning in the header
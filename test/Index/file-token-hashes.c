@@ -0,0 +1,25 @@
+#include "Inputs/file-token-hashes-a.h"
+#undef A
+#include "Inputs/file-token-hashes-b.h"
+#undef A
+
+// RUN: env CINDEXTEST_FILE_TOKEN_HASHES=1 \
+// RUN:   c-index-test -test-file-token-hashes-source %s | FileCheck %s
+// RUN: env CINDEXTEST_FILE_TOKEN_HASHES=1 \
+// RUN:   c-index-test -test-file-token-hashes-source \
+// RUN:     -include %S/Inputs/file-token-hashes-c.h %s \
+// RUN:   | FileCheck -check-prefix=CHECK-SPACE %s
+// RUN: c-index-test -test-file-token-hashes-source %s \
+// RUN:   | FileCheck -check-prefix=CHECK-OFF %s
+
+// CHECK: file: {{.*}}file-token-hashes.c tokens: {{[0-9]+}}
+// CHECK: file: {{.*}}file-token-hashes-a.h tokens: [[HASH:[0-9]+]]
+// CHECK: file: {{.*}}file-token-hashes-b.h tokens: [[HASH]]
+
+// The space after the macro name makes A object-like in
+// file-token-hashes-c.h, so its hash differs from the others.
+// CHECK-SPACE: file: {{.*}}file-token-hashes-c.h tokens: [[HASH:[0-9]+]]
+// CHECK-SPACE-NOT: tokens: [[HASH]]
+
+// Hashes are only recorded when asked for.
+// CHECK-OFF: file: {{.*}}file-token-hashes-a.h tokens: unknown
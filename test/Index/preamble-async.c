@@ -0,0 +1,41 @@
+#include "prefix.h"
+#include "preamble.h"
+int wibble(int);
+
+void f(int x) {
+  
+}
+// RUN: c-index-test -write-pch %t.pch -x c-header %S/Inputs/prefix.h
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_ASYNC_PREAMBLE=1 c-index-test -test-load-source-reparse 5 local -I %S/Inputs -include %t %s 2> %t.stderr.txt | FileCheck %s
+// RUN: FileCheck -check-prefix CHECK-DIAG %s < %t.stderr.txt
+// CHECK: preamble.h:1:12: FunctionDecl=bar:1:12 (Definition) Extent=[1:1 - 6:2]
+// CHECK: preamble.h:4:3: BinaryOperator= Extent=[4:3 - 4:13]
+// CHECK: preamble.h:5:10: IntegerLiteral= Extent=[5:10 - 5:11]
+// CHECK: preamble-async.c:3:5: FunctionDecl=wibble:3:5 Extent=[3:1 - 3:16]
+// CHECK: preamble-async.c:3:15: ParmDecl=:3:15 (Definition) Extent=[3:12 - 3:16]
+// CHECK-DIAG: preamble.h:4:7:{4:9-4:13}: warning: incompatible pointer types assigning to 'int *' from 'float *'
+
+// Change a header in the preamble after the second reparse, so that the
+// preamble is rebuilt while the following reparses go on.
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_ASYNC_PREAMBLE=1 CINDEXTEST_REMAP_AFTER_TRIAL=2 c-index-test -test-reparse-timing 5 "-remap-file=%S/Inputs/preamble.h;%S/Inputs/prefix.h" -I %S/Inputs -include %t %s | FileCheck -check-prefix CHECK-TIMING %s
+// CHECK-TIMING: reparse 1: {{[0-9.]+}} ms
+// CHECK-TIMING: reparse 3: {{[0-9.]+}} ms
+// CHECK-TIMING: reparse 5: {{[0-9.]+}} ms
+// CHECK-TIMING: longest reparse: {{[0-9.]+}} ms
+
+// Change a header in the preamble before the last reparse.  That reparse
+// starts rebuilding the preamble and parses without one, so it must already
+// see the new header.
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_ASYNC_PREAMBLE=1 CINDEXTEST_REMAP_AFTER_TRIAL=4 c-index-test -test-load-source-reparse 5 local "-remap-file=%S/Inputs/preamble.h;%S/Inputs/preamble-async-edit.h" -I %S/Inputs -include %t %s 2> %t.stderr.txt | FileCheck -check-prefix CHECK-EDIT %s
+// RUN: FileCheck -check-prefix CHECK-EDIT-DIAG %s < %t.stderr.txt
+
+// Change it after the second reparse instead, so that the later reparses
+// install the rebuilt preamble and parse with it.
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_ASYNC_PREAMBLE=1 CINDEXTEST_REMAP_AFTER_TRIAL=2 c-index-test -test-load-source-reparse 10 local "-remap-file=%S/Inputs/preamble.h;%S/Inputs/preamble-async-edit.h" -I %S/Inputs -include %t %s 2> %t.stderr.txt | FileCheck -check-prefix CHECK-EDIT %s
+// RUN: FileCheck -check-prefix CHECK-EDIT-DIAG %s < %t.stderr.txt
+// CHECK-EDIT-NOT: FunctionDecl=bar
+// CHECK-EDIT: preamble.h:1:12: FunctionDecl=baz:1:12 (Definition) Extent=[1:1 - 6:2]
+// CHECK-EDIT: preamble.h:4:3: BinaryOperator= Extent=[4:3 - 4:13]
+// CHECK-EDIT: preamble-async.c:3:5: FunctionDecl=wibble:3:5 Extent=[3:1 - 3:16]
+// CHECK-EDIT-NOT: FunctionDecl=bar
+// CHECK-EDIT-DIAG: preamble.h:4:7:{4:9-4:13}: warning: incompatible pointer types assigning to 'int *' from 'float *'
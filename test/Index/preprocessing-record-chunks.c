@@ -0,0 +1,39 @@
+#define ONE 1
+#define HEADER "a.h"
+
+int values[] = {
+  ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE,
+  ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE,
+  ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE,
+  ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE,
+  ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE,
+  ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE,
+  ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE,
+  ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE, ONE,
+};
+
+#include HEADER
+
+int last = ONE;
+
+// Enough macro expansions to fill several chunks of the preprocessing record,
+// then an inclusion directive recorded after the expansion within it.
+// RUN: c-index-test -cursor-at=%s:5:3 -I%S/Inputs %s | FileCheck -check-prefix=CHECK-FIRST %s
+// CHECK-FIRST: macro expansion=ONE:1:9
+// RUN: c-index-test -cursor-at=%s:11:38 -I%S/Inputs %s | FileCheck -check-prefix=CHECK-LATE %s
+// CHECK-LATE: macro expansion=ONE:1:9
+// RUN: c-index-test -cursor-at=%s:15:2 -I%S/Inputs %s | FileCheck -check-prefix=CHECK-INCLUDE %s
+// CHECK-INCLUDE: inclusion directive=a.h
+// RUN: c-index-test -cursor-at=%s:15:10 -I%S/Inputs %s | FileCheck -check-prefix=CHECK-HEADER %s
+// CHECK-HEADER: macro expansion=HEADER:2:9
+// RUN: c-index-test -cursor-at=%s:17:12 -I%S/Inputs %s | FileCheck -check-prefix=CHECK-LAST %s
+// CHECK-LAST: macro expansion=ONE:1:9
+
+// RUN: c-index-test -test-annotate-tokens=%s:12:33:17:16 -I%S/Inputs %s | FileCheck -check-prefix=CHECK-TOKENS %s
+// CHECK-TOKENS: Identifier: "ONE" [12:33 - 12:36] macro expansion=ONE:1:9
+// CHECK-TOKENS: Identifier: "ONE" [12:38 - 12:41] macro expansion=ONE:1:9
+// CHECK-TOKENS: Punctuation: "#" [15:1 - 15:2] inclusion directive=a.h
+// CHECK-TOKENS: Identifier: "ONE" [17:12 - 17:15] macro expansion=ONE:1:9
+
+// RUN: env CINDEXTEST_ANNOTATE_REPEATS=3 c-index-test -test-annotate-tokens-timing=%s:12:33:17:16 -I%S/Inputs %s | FileCheck -check-prefix=CHECK-TIMING %s
+// CHECK-TIMING: Annotated {{[0-9]+}} tokens 3 times: {{.*}} ms per run
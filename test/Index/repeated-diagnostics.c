@@ -0,0 +1,27 @@
+#include "Inputs/repeated-diagnostics.h"
+#warning in the main file
+
+// Only the main file is edited, so the warning from the header is the only
+// one the reparse repeats.
+// RUN: env CINDEXTEST_FILE_TOKEN_HASHES=1 \
+// RUN:   c-index-test -test-load-source-reparse 1 none \
+// RUN:   -remap-file="%s;%S/Inputs/repeated-diagnostics-remap.c" \
+// RUN:   %s 2>&1 | FileCheck %s
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_FILE_TOKEN_HASHES=1 \
+// RUN:   c-index-test -test-load-source-reparse 2 none \
+// RUN:   -remap-file="%s;%S/Inputs/repeated-diagnostics-remap.c" \
+// RUN:   %s 2>&1 | FileCheck -check-prefix=CHECK-TWICE %s
+// RUN: c-index-test -test-load-source-reparse 1 none \
+// RUN:   -remap-file="%s;%S/Inputs/repeated-diagnostics-remap.c" \
+// RUN:   %s 2>&1 | FileCheck -check-prefix=CHECK-ALL %s
+
+// CHECK-NOT: warning: in the header
+// CHECK: repeated-diagnostics.c:2:2: warning: in the main file
+// CHECK: repeated-diagnostics.c:3:2: warning: added to the main file
+
+// Nothing changes between the second and the third parse.
+// CHECK-TWICE-NOT: warning:
+
+// CHECK-ALL: repeated-diagnostics.h:1:2: warning: in the header
+// CHECK-ALL: repeated-diagnostics.c:2:2: warning: in the main file
+// CHECK-ALL: repeated-diagnostics.c:3:2: warning: added to the main file
@@ -0,0 +1,17 @@
+int callee(int x) {
+  return x + 1;
+}
+
+int caller(void) {
+  return callee(1);
+}
+
+// Once parsing is done, functions whose bodies were never parsed are mere
+// declarations, without bodies to visit.
+// RUN: env CINDEXTEST_SKIP_FUNCTION_BODIES=1 \
+// RUN:   c-index-test -test-load-source all %s | FileCheck %s
+// CHECK: skip-function-bodies.c:1:5: FunctionDecl=callee:1:5 Extent=[1:1 - 3:2]
+// CHECK: skip-function-bodies.c:1:16: ParmDecl=x:1:16 (Definition)
+// CHECK: skip-function-bodies.c:5:5: FunctionDecl=caller:5:5 Extent=[5:1 - 7:2]
+// CHECK-NOT: CompoundStmt
+// CHECK-NOT: CallExpr
@@ -0,0 +1 @@
+int from_angled_include = 6;
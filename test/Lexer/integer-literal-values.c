@@ -0,0 +1,22 @@
+// RUN: %clang_cc1 -fsyntax-only -verify -triple x86_64-unknown-unknown %s
+
+// Decimal literals are converted eight digits at a time; hex literals give
+// the expected values.
+int a[12345678 == 0xBC614E ? 1 : -1];
+int b[98765432109876543 == 0x15EE2A320FF453F ? 1 : -1];
+int c[1234567890123456789 == 0x112210F47DE98115 ? 1 : -1];
+int d[9999999999999999999U == 0x8AC7230489E7FFFF ? 1 : -1];
+
+// Twenty digits may or may not fit.
+int e[18446744073709551615U == 0xFFFFFFFFFFFFFFFF ? 1 : -1];
+int f = 18446744073709551616; // expected-error {{too large}}
+int g[000000000000000000000000000001 == 1 ? 1 : -1];
+int h = 0x10000000000000000; // expected-error {{too large}}
+
+#if 12345678901234567 != 0x2BDC545D6B4B87
+#error bad value
+#endif
+
+int i[' ' == 32 ? 1 : -1];
+int j['\xff' == -1 ? 1 : -1];
+int k['ab' == 0x6162 ? 1 : -1]; // expected-warning {{multi-character}}
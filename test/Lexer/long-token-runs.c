@@ -0,0 +1,45 @@
+// RUN: %clang_cc1 -E -trigraphs -I %S/Inputs %s | FileCheck -strict-whitespace %s
+// RUN: %clang_cc1 -fsyntax-only -trigraphs -I %S/Inputs -verify %s
+
+// The lexer skips identifier, whitespace, comment, string, character constant
+// and include name runs in 16 byte blocks; make sure the characters that stop
+// a run are still found when they sit in the middle or at the edges of a long
+// run.
+
+int an_identifier_that_is_much_longer_than_sixteen_bytes_0123456789 = 1;
+// CHECK: int an_identifier_that_is_much_longer_than_sixteen_bytes_0123456789 = 1;
+
+int and_another_one_that_is_long_enough_$dollar = 2;
+// CHECK: int and_another_one_that_is_long_enough_$dollar = 2;
+
+int split_across_an_escaped_new\
+line_in_a_long_identifier = 3;
+// CHECK: int split_across_an_escaped_newline_in_a_long_identifier
+
+const char *s1 = "a string literal body that is longer than one block\"quote";
+// CHECK: const char *s1 = "a string literal body that is longer than one block\"quote";
+
+const char *s2 = "a long string literal body with a trigraph ??/" in it"; // expected-warning {{trigraph converted to '\' character}}
+
+const char *s3 = "a long string literal body with an escaped \
+newline in it";
+
+int after_whitespace =                                                      4;
+// CHECK: int after_whitespace = 4;
+
+// A line comment that is long enough to span several sixteen byte blocks \
+int continued_comment;
+int after_comment = 5;
+// CHECK-NOT: continued_comment
+// CHECK: int after_comment = 5;
+
+// Character constants and angled include names end at their own terminator,
+// not at the next '"'.
+char c1 = 'a'; const char *after_char = "a string after a character constant";
+// CHECK: char c1 = 'a'; const char *after_char = "a string after a character constant";
+
+int c2 = '\''; int c3 = '?'; int c4 = '"'; int c5 = '>'; int c6 = '\\';
+// CHECK: int c2 = '\''; int c3 = '?'; int c4 = '"'; int c5 = '>'; int c6 = '\\';
+
+#include <a-header-whose-name-spans-several-blocks.h> // and a "comment"
+// CHECK: int from_angled_include = 6;
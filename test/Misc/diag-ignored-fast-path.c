@@ -0,0 +1,22 @@
+// RUN: %clang_cc1 -fsyntax-only -verify %s
+// RUN: %clang_cc1 -fsyntax-only -print-stats %s 2>&1 | FileCheck %s
+// CHECK: *** Diagnostic Stats:
+// CHECK: diagnostic level queries, {{[1-9][0-9]*}} answered as ignored
+// CHECK: {{[0-9]+}} diagnostic state lookups answered from the file cache.
+
+// -Wunused-variable is off by default; once it has been found ignored, it is
+// answered without looking at the diagnostic state.
+void f1() { int a; }
+void f2() { int b; }
+
+// A pragma that turns it on must still take effect, and so must the pop.
+#pragma clang diagnostic push
+#pragma clang diagnostic warning "-Wunused-variable"
+void g() { int c; } // expected-warning {{unused variable 'c'}}
+#pragma clang diagnostic pop
+void h() { int d; }
+
+#pragma clang diagnostic warning "-Wunused-variable"
+void i() { int e; } // expected-warning {{unused variable 'e'}}
+#pragma clang diagnostic ignored "-Wunused-variable"
+void j() { int f; }
@@ -0,0 +1,16 @@
+// RUN: %clang_cc1 -fsyntax-only -verify %s
+// RUN: not %clang_cc1 -fsyntax-only %s -print-stats 2>&1 | FileCheck %s
+// CHECK: Loaded FileID scans: 0 linear, 0 binary.
+// CHECK: FileID page index: {{[1-9][0-9]*}} lookups
+
+// Lots of small expansions, with diagnostics pointing back into them.
+#define ONE(x) x,
+#define TWO(x) ONE(x) ONE(x)
+#define FOUR(x) TWO(x) TWO(x)
+#define SIXTEEN(x) FOUR(FOUR(x))
+#define MANY(x) SIXTEEN(SIXTEEN(x))
+
+int values[] = { MANY(1) 0 };
+
+#define BAD(x) x + undeclared_##x
+int first = BAD(0); // expected-error {{use of undeclared identifier 'undeclared_0'}}
@@ -0,0 +1,23 @@
+// RUN: %clang_cc1 -fsyntax-only -skip-function-bodies -Wunused-function \
+// RUN:   -Wunused-variable -verify %s
+// RUN: %clang_cc1 -fsyntax-only -Wunused-function -Wunused-variable \
+// RUN:   %s 2>&1 | FileCheck -check-prefix=NOSKIP %s
+
+// Uses in the skipped bodies aren't seen, so nothing is said to be unused.
+static int helper(void) {
+  return 1;
+}
+
+static int counter;
+
+static int unused(void) {
+  return 0;
+}
+
+int uses_them(void) {
+  return helper() + counter++;
+}
+
+// NOSKIP-NOT: unused function 'helper'
+// NOSKIP: unused function 'unused'
+// NOSKIP-NOT: warning:
@@ -0,0 +1,30 @@
+// RUN: %clang_cc1 -fsyntax-only -skip-function-bodies -verify %s
+// RUN: %clang_cc1 -fsyntax-only -skip-function-bodies -print-stats %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=STATS %s
+
+// Nothing asks for the bodies, so errors within them are never reported.
+int f(int x) {
+  return undeclared_identifier + x;
+}
+
+void nested(void) {
+  { { int y = 0; } }
+  no_such_function(1, );
+}
+
+// Errors in the declarations are still reported.
+int g(void) { return 0; } // expected-note {{previous definition is here}}
+int g(void) { return 1; } // expected-error {{redefinition of 'g'}}
+
+int knr(a, b)
+  int a;
+  float b;
+{
+  return a + b;
+}
+
+int main(void) {
+  return f(1) + g() + knr(1, 2.0f);
+}
+
+// STATS: 6 function bodies skipped, 0 of them parsed when needed.
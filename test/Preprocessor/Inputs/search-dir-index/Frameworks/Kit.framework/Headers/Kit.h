@@ -0,0 +1 @@
+#define KIT_FOUND 1
@@ -0,0 +1 @@
+#define A_FOUND 1
@@ -0,0 +1 @@
+#define B_FOUND 1
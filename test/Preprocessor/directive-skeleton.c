@@ -0,0 +1,57 @@
+// RUN: %clang_cc1 -fsyntax-only -verify -I %S/Inputs %s
+// RUN: %clang_cc1 -E -I %S/Inputs %s | FileCheck %s
+// RUN: %clang_cc1 -fsyntax-only -I %S/Inputs %s -print-stats 2>&1 | FileCheck -check-prefix=STATS %s
+// STATS: regions skipped, {{[1-9][0-9]*}} through a directive skeleton.
+
+// Skipping the excluded blocks of a file entered more than once jumps over
+// them with the positions of its conditional directives.  Each use must
+// still see exactly the blocks it selects.
+
+enum First {
+#define COLOR(name, value) first_##name = value,
+#include "directive-skeleton.def"
+};
+// CHECK: first_red = 1,
+// CHECK-NOT: first_
+// CHECK: first_none = 5,
+// CHECK-NOT: first_
+// CHECK: first_black = 6,
+
+#define WITH_GREEN
+enum Second {
+#define COLOR(name, value) second_##name = value,
+#include "directive-skeleton.def"
+};
+// CHECK: second_red = 1,
+// CHECK-NOT: second_
+// CHECK: second_green = 2,
+// CHECK-NOT: second_
+// CHECK: second_black = 6,
+
+#define WITH_DARK_GREEN
+enum Third {
+#define COLOR(name, value) third_##name = value,
+#include "directive-skeleton.def"
+};
+// CHECK: third_red = 1,
+// CHECK-NOT: third_
+// CHECK: third_green = 2,
+// CHECK-NOT: third_
+// CHECK: third_dark_green = 3,
+// CHECK-NOT: third_
+// CHECK: third_black = 6,
+
+#undef WITH_GREEN
+#define WITH_BLUE
+enum Fourth {
+#define COLOR(name, value) fourth_##name = value,
+#include "directive-skeleton.def"
+};
+// CHECK: fourth_red = 1,
+// CHECK-NOT: fourth_
+// CHECK: fourth_blue = 4,
+// CHECK-NOT: fourth_
+// CHECK: fourth_black = 6,
+
+int check[first_none + second_green + third_dark_green + fourth_blue == 14 ?
+          1 : -1];
@@ -0,0 +1,50 @@
+// RUN: %clang_cc1 -macro-expansion-cache -fsyntax-only -verify %s
+// RUN: %clang_cc1 -macro-expansion-cache -fsyntax-only %s -print-stats 2>&1 | FileCheck %s
+// CHECK: {{[1-9][0-9]*}} macro expansions reused from the expansion cache
+// CHECK: {{[1-9][0-9]*}} expansion cache invalidations
+
+#define TWICE(x) ((x) + (x))
+#define SIZE TWICE(2)
+
+int a[SIZE == 4 ? 1 : -1];
+int b[SIZE == 4 ? 1 : -1];
+int c[TWICE(3) == 6 ? 1 : -1];
+int d[TWICE(3) == 6 ? 1 : -1];
+int e[TWICE( 3 ) == 6 ? 1 : -1];
+
+// A redefinition must not replay the old expansion.
+#undef TWICE
+#define TWICE(x) ((x) * 3)
+int f[SIZE == 6 ? 1 : -1];
+int g[SIZE == 6 ? 1 : -1];
+
+// Nor may defining a macro named by a cached expansion.
+enum { value = 1 };
+#define NAME (value)
+int h[NAME == 1 ? 1 : -1];
+int i[NAME == 1 ? 1 : -1];
+#define value 2
+int j[NAME == 2 ? 1 : -1];
+
+// A function-like macro at the end of an expansion can take its arguments
+// from the tokens after it.
+#define ID(x) x
+#define CALL ID
+int k[CALL(2) == 2 ? 1 : -1];
+int l[CALL(2) == 2 ? 1 : -1];
+
+// Builtin macros expand differently every time.
+#define LINE (__LINE__)
+int m[LINE == 38 ? 1 : -1];
+int n[LINE == 39 ? 1 : -1];
+
+// An empty macro at the end of an expansion still marks the token after it.
+#define NOTHING
+#define LOG NOTHING
+void o(int v) {
+  if (v)
+    LOG;
+  if (v)
+    LOG;
+  if (v) ; // expected-warning {{if statement has empty body}}
+}
@@ -0,0 +1,19 @@
+// RUN: rm -rf %t
+// RUN: mkdir %t
+// RUN: echo 'int stale_declaration;' > %t/header.h
+// RUN: %clang_cc1 -emit-pth %t/header.h -o %t/header.pth
+// RUN: %clang_cc1 -include-pth %t/header.pth %s -E | FileCheck -check-prefix=CACHED %s
+
+// Tokens cached for a header which has changed since must not be used, even
+// if its size and modification time are the same.
+// RUN: echo 'int fresh_declaration;' > %t/header.h
+// RUN: %clang_cc1 -include-pth %t/header.pth %s -E | FileCheck -check-prefix=CHANGED %s
+
+// CACHED: int stale_declaration;
+// CHANGED-NOT: stale_declaration
+// CHANGED: int fresh_declaration;
+// CHANGED-NOT: stale_declaration
+
+#if defined(__STDC__)
+int after_header;
+#endif
@@ -0,0 +1,20 @@
+// RUN: %clang_cc1 -fsyntax-only -verify %s
+// RUN: %clang_cc1 -pack-scratch-buffers -fsyntax-only -verify %s
+// RUN: %clang_cc1 -fsyntax-only %s -print-stats 2>&1 | FileCheck %s
+// RUN: %clang_cc1 -pack-scratch-buffers -fsyntax-only %s -print-stats 2>&1 | FileCheck %s
+// CHECK: {{[1-9][0-9]*}} scratch tokens in {{[1-9]}} chunks of scratch space ({{[0-9]+}} bytes); fixed-size chunks would have taken {{[1-9][0-9]}} ({{[0-9]+}} bytes).
+
+// Paste enough tokens to fill a few dozen kilobytes of scratch space.
+#define CAT(a, b) a##b
+#define D(p) int CAT(a_fairly_long_pasted_identifier_, p);
+#define D10(p) D(p##0) D(p##1) D(p##2) D(p##3) D(p##4) \
+               D(p##5) D(p##6) D(p##7) D(p##8) D(p##9)
+#define D100(p) D10(p##0) D10(p##1) D10(p##2) D10(p##3) D10(p##4) \
+                D10(p##5) D10(p##6) D10(p##7) D10(p##8) D10(p##9)
+
+D100(1) D100(2) D100(3) D100(4) D100(5) D100(6) D100(7) D100(8) D100(9)
+
+int check[sizeof(a_fairly_long_pasted_identifier_100) ==
+          sizeof(a_fairly_long_pasted_identifier_999) ? 1 : -1];
+int a_fairly_long_pasted_identifier_555; // expected-note {{previous}}
+float a_fairly_long_pasted_identifier_555; // expected-error {{redefinition of 'a_fairly_long_pasted_identifier_555' with a different type}}
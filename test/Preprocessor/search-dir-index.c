@@ -0,0 +1,13 @@
+// RUN: %clang_cc1 -cache-search-dir-contents -I %S/Inputs/search-dir-index/a -I %S/Inputs/search-dir-index/b -F %S/Inputs/search-dir-index/Frameworks -fsyntax-only -verify %s
+// RUN: not %clang_cc1 -cache-search-dir-contents -I %S/Inputs/search-dir-index/a -I %S/Inputs/search-dir-index/b -F %S/Inputs/search-dir-index/Frameworks -fsyntax-only %s -print-stats 2>&1 | FileCheck %s
+// CHECK: search directories indexed
+// CHECK: {{[1-9][0-9]*}} lookups answered as missing by the index
+
+#include <sub/nested.h>
+#include <only-in-b.h>
+#include <Kit/Kit.h>
+#include <missing-everywhere.h> // expected-error {{file not found}}
+
+#if !A_FOUND || !B_FOUND || !KIT_FOUND
+#error headers not found through the directory index
+#endif
@@ -0,0 +1,24 @@
+// RUN: %clang_cc1 -fsyntax-only -pedantic -verify %s
+// RUN: %clang_cc1 -fsyntax-only -print-stats %s 2>&1 | FileCheck %s
+
+// The condition is folded once to check the bound and once more for its
+// value; the second time it comes from the cache.
+int cond[(1 + 1) ? 2 : 3];
+int check_cond[sizeof(cond) == 2 * sizeof(int) ? 1 : -1];
+
+int nested[((((64 / (1 + 1)) / (1 + 1)) / (1 + 1)) / (1 + 1))];
+int check_nested[sizeof(nested) == 4 * sizeof(int) ? 1 : -1];
+
+// Enumerators may still change while their enum is being defined, so
+// expressions using them aren't cached until it is complete.
+enum E { A = 1, B = (A + 1) * 2, C = (B + A) ? B : 0 };
+int check_enum[(C == 4 && (A + B) == 5) ? 1 : -1];
+
+// Nor are expressions that read variables.
+const int N = 3;
+int fold[(N + 1)]; // expected-warning {{variable length array folded to constant array as an extension}}
+int check_fold[sizeof(fold) == 4 * sizeof(int) ? 1 : -1];
+
+int bad[(1 + 1) - 3]; // expected-error {{'bad' declared as an array with a negative size}}
+
+// CHECK: {{[1-9][0-9]*}} constant values cached, {{[1-9][0-9]*}} hits, {{[0-9]+}} misses
@@ -0,0 +1,25 @@
+// RUN: %clang_cc1 -fsyntax-only -verify %s
+// RUN: %clang_cc1 -fsyntax-only -print-stats %s 2>&1 | FileCheck %s
+
+// Lookups into a struct with more fields than a table searches linearly go
+// through the table's index.
+struct big {
+  int f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15;
+  int f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29;
+};
+
+struct small {
+  int a, b;
+};
+
+int use(struct big *B, struct small *S) {
+  return B->f0 + B->f17 + B->f29 + S->a + S->b +
+         B->f30 + // expected-error {{no member named 'f30' in 'struct big'}}
+         S->c; // expected-error {{no member named 'c' in 'struct small'}}
+}
+
+// CHECK: *** Lookup Table Stats:
+// CHECK: {{[0-9]+}} lookup tables, {{[1-9][0-9]*}} of them indexed
+// CHECK: {{[0-9]+}} names, {{[0-9]+}} in the largest table.
+// CHECK: {{[1-9][0-9]*}} bytes in entries and indexes.
+// CHECK: {{[0-9]+}} lookups, {{[0-9]+}} probes, at most {{[0-9]+}} for one lookup.
@@ -0,0 +1,31 @@
+// RUN: %clang_cc1 -fsyntax-only -verify %s
+// RUN: %clang_cc1 -fsyntax-only -print-stats %s 2>&1 | FileCheck %s
+
+// A body ending in a return can't fall off its end; no CFG is built to check.
+int ends_in_return(int x) {
+  if (x)
+    return 1;
+  return 0;
+}
+
+int falls_off(int x) {
+  if (x)
+    return 1;
+} // expected-warning {{control may reach end of non-void function}}
+
+int label_at_end(int x) {
+  if (x)
+    goto out;
+  return 0;
+out:
+  ;
+} // expected-warning {{control may reach end of non-void function}}
+
+void does_not_return(void) __attribute__((noreturn));
+
+void noreturn_ends_in_call(void) __attribute__((noreturn));
+void noreturn_ends_in_call(void) {
+  does_not_return();
+}
+
+// CHECK: 3 functions analyzed (0 w/o CFGs).
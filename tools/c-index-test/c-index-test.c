@@ -6,6 +6,10 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
 
 /******************************************************************************/
 /* Utility functions.                                                         */
@@ -39,10 +43,29 @@ static unsigned getDefaultParsingOptions() {
     options |= CXTranslationUnit_CacheCompletionResults;
   if (getenv("CINDEXTEST_NESTED_MACROS"))
     options |= CXTranslationUnit_NestedMacroExpansions;
+  if (getenv("CINDEXTEST_ASYNC_PREAMBLE"))
+    options |= CXTranslationUnit_AsyncPrecompiledPreamble;
+  if (getenv("CINDEXTEST_SKIP_FUNCTION_BODIES"))
+    options |= CXTranslationUnit_SkipFunctionBodies;
+  if (getenv("CINDEXTEST_FILE_TOKEN_HASHES"))
+    options |= CXTranslationUnit_TrackFileTokenHashes;
   
   return options;
 }
 
+/** \brief Return the elapsed wall-clock time in seconds, counted from an
+ * arbitrary point. Unlike clock(), this doesn't count the time spent by
+ * libclang's background threads. */
+static double getWallTime() {
+#ifdef _WIN32
+  return (double)clock() / CLOCKS_PER_SEC;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+#endif
+}
+
 static void PrintExtent(FILE *out, unsigned begin_line, unsigned begin_column,
                         unsigned end_line, unsigned end_column) {
   fprintf(out, "[%d:%d - %d:%d]", begin_line, begin_column,
@@ -417,7 +440,11 @@ void PrintDiagnostic(CXDiagnostic Diagnostic) {
 void PrintDiagnostics(CXTranslationUnit TU) {
   int i, n = clang_getNumDiagnostics(TU);
   for (i = 0; i != n; ++i) {
-    CXDiagnostic Diag = clang_getDiagnostic(TU, i);
+    CXDiagnostic Diag;
+    /* Like an editor, only show what the last reparse didn't already. */
+    if (clang_isDiagnosticRepeated(TU, i))
+      continue;
+    Diag = clang_getDiagnostic(TU, i);
     PrintDiagnostic(Diag);
     clang_disposeDiagnostic(Diag);
   }
@@ -588,6 +615,28 @@ void PrintInclusionStack(CXTranslationUnit TU) {
   clang_getInclusions(TU, InclusionVisitor, NULL);
 }
 
+/******************************************************************************/
+/* Token hash testing.                                                        */
+/******************************************************************************/
+
+void TokenHashVisitor(CXFile includedFile, CXSourceLocation *includeStack,
+                      unsigned includeStackLen, CXClientData data) {
+  CXTranslationUnit TU = (CXTranslationUnit)data;
+  CXString fname;
+  unsigned hash;
+
+  fname = clang_getFileName(includedFile);
+  if (clang_getFileTokenHash(TU, includedFile, &hash))
+    printf("file: %s tokens: %u\n", clang_getCString(fname), hash);
+  else
+    printf("file: %s tokens: unknown\n", clang_getCString(fname));
+  clang_disposeString(fname);
+}
+
+void PrintFileTokenHashes(CXTranslationUnit TU) {
+  clang_getInclusions(TU, TokenHashVisitor, TU);
+}
+
 /******************************************************************************/
 /* Linkage testing.                                                           */
 /******************************************************************************/
@@ -824,6 +873,68 @@ int perform_test_reparse_source(int argc, const char **argv, int trials,
   return result;
 }
 
+/* Reparse the translation unit the given number of times, reporting how long
+ * each reparse took. With CINDEXTEST_REMAP_AFTER_TRIAL, this shows how long
+ * a change to the preamble stalls the reparse that sees it. */
+static int perform_test_reparse_timing(int argc, const char **argv,
+                                       int trials) {
+  CXIndex Idx;
+  CXTranslationUnit TU;
+  struct CXUnsavedFile *unsaved_files = 0;
+  int num_unsaved_files = 0;
+  int result = 0;
+  int trial;
+  int remap_after_trial = 0;
+  double longest = 0;
+
+  Idx = clang_createIndex(/* excludeDeclsFromPCH */0,
+                          /* displayDiagnosics=*/0);
+
+  if (parse_remapped_files(argc, argv, 0, &unsaved_files, &num_unsaved_files)) {
+    clang_disposeIndex(Idx);
+    return -1;
+  }
+
+  TU = clang_parseTranslationUnit(Idx, 0,
+                                  argv + num_unsaved_files,
+                                  argc - num_unsaved_files,
+                                  0, 0, getDefaultParsingOptions());
+  if (!TU) {
+    fprintf(stderr, "Unable to load translation unit!\n");
+    free_remapped_files(unsaved_files, num_unsaved_files);
+    clang_disposeIndex(Idx);
+    return 1;
+  }
+
+  if (getenv("CINDEXTEST_REMAP_AFTER_TRIAL"))
+    remap_after_trial = atoi(getenv("CINDEXTEST_REMAP_AFTER_TRIAL"));
+
+  for (trial = 0; trial < trials; ++trial) {
+    double start = getWallTime();
+    double elapsed;
+    if (clang_reparseTranslationUnit(TU,
+                             trial >= remap_after_trial ? num_unsaved_files : 0,
+                             trial >= remap_after_trial ? unsaved_files : 0,
+                                     clang_defaultReparseOptions(TU))) {
+      fprintf(stderr, "Unable to reparse translation unit!\n");
+      result = -1;
+      break;
+    }
+    elapsed = (getWallTime() - start) * 1000.0;
+    if (elapsed > longest)
+      longest = elapsed;
+    printf("reparse %d: %.3f ms\n", trial + 1, elapsed);
+  }
+
+  if (result == 0)
+    printf("longest reparse: %.3f ms\n", longest);
+
+  clang_disposeTranslationUnit(TU);
+  free_remapped_files(unsaved_files, num_unsaved_files);
+  clang_disposeIndex(Idx);
+  return result;
+}
+
 /******************************************************************************/
 /* Logic for testing clang_getCursor().                                       */
 /******************************************************************************/
@@ -1480,7 +1591,7 @@ static int find_file_refs_at(int argc, const char **argv) {
   return 0;
 }
 
-int perform_token_annotation(int argc, const char **argv) {
+int perform_token_annotation(int argc, const char **argv, int timing_only) {
   const char *input = argv[1];
   char *filename = 0;
   unsigned line, second_line;
@@ -1496,9 +1607,18 @@ int perform_token_annotation(int argc, const char **argv) {
   CXSourceLocation startLoc, endLoc;
   CXFile file = 0;
   CXCursor *cursors = 0;
-  unsigned i;
-
-  input += strlen("-test-annotate-tokens=");
+  unsigned i, repeats = 1;
+  clock_t start;
+
+  if (timing_only) {
+    input += strlen("-test-annotate-tokens-timing=");
+    repeats = 100;
+    if (getenv("CINDEXTEST_ANNOTATE_REPEATS"))
+      repeats = atoi(getenv("CINDEXTEST_ANNOTATE_REPEATS"));
+    if (repeats == 0)
+      repeats = 1;
+  } else
+    input += strlen("-test-annotate-tokens=");
   if ((errorCode = parse_file_line_column(input, &filename, &line, &column,
                                           &second_line, &second_column)))
     return errorCode;
@@ -1559,8 +1679,15 @@ int perform_token_annotation(int argc, const char **argv) {
   range = clang_getRange(startLoc, endLoc);
   clang_tokenize(TU, range, &tokens, &num_tokens);
   cursors = (CXCursor *)malloc(num_tokens * sizeof(CXCursor));
-  clang_annotateTokens(TU, tokens, num_tokens, cursors);
-  for (i = 0; i != num_tokens; ++i) {
+  start = clock();
+  for (i = 0; i != repeats; ++i)
+    clang_annotateTokens(TU, tokens, num_tokens, cursors);
+  if (timing_only) {
+    double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("Annotated %u tokens %u times: %.3f ms per run\n", num_tokens,
+           repeats, elapsed * 1000.0 / repeats);
+  }
+  for (i = 0; i != num_tokens && !timing_only; ++i) {
     const char *kind = "<unknown>";
     CXString spelling = clang_getTokenSpelling(TU, tokens[i]);
     CXSourceRange extent = clang_getTokenExtent(TU, tokens[i]);
@@ -1861,12 +1988,15 @@ static void print_usage(void) {
     "<symbol filter> {<args>}*\n"
     "       c-index-test -test-load-source-reparse <trials> <symbol filter> "
     "          {<args>}*\n"
+    "       c-index-test -test-reparse-timing <trials> {<args>}*\n"
     "       c-index-test -test-load-source-usrs <symbol filter> {<args>}*\n"
     "       c-index-test -test-load-source-usrs-memory-usage "
           "<symbol filter> {<args>}*\n"
     "       c-index-test -test-annotate-tokens=<range> {<args>}*\n"
+    "       c-index-test -test-annotate-tokens-timing=<range> {<args>}*\n"
     "       c-index-test -test-inclusion-stack-source {<args>}*\n"
-    "       c-index-test -test-inclusion-stack-tu <AST file>\n");
+    "       c-index-test -test-inclusion-stack-tu <AST file>\n"
+    "       c-index-test -test-file-token-hashes-source {<args>}*\n");
   fprintf(stderr,
     "       c-index-test -test-print-linkage-source {<args>}*\n"
     "       c-index-test -test-print-typekind {<args>}*\n"
@@ -1911,6 +2041,8 @@ int cindextest_main(int argc, const char **argv) {
                                          NULL);
     }
   }
+  else if (argc >= 4 && strcmp(argv[1], "-test-reparse-timing") == 0)
+    return perform_test_reparse_timing(argc - 3, argv + 3, atoi(argv[2]));
   else if (argc >= 4 && strncmp(argv[1], "-test-load-source", 17) == 0) {
     CXCursorVisitor I = GetVisitor(argv[1] + 17);
     
@@ -1926,13 +2058,19 @@ int cindextest_main(int argc, const char **argv) {
     return perform_file_scan(argv[2], argv[3],
                              argc >= 5 ? argv[4] : 0);
   else if (argc > 2 && strstr(argv[1], "-test-annotate-tokens=") == argv[1])
-    return perform_token_annotation(argc, argv);
+    return perform_token_annotation(argc, argv, 0);
+  else if (argc > 2 &&
+           strstr(argv[1], "-test-annotate-tokens-timing=") == argv[1])
+    return perform_token_annotation(argc, argv, 1);
   else if (argc > 2 && strcmp(argv[1], "-test-inclusion-stack-source") == 0)
     return perform_test_load_source(argc - 2, argv + 2, "all", NULL,
                                     PrintInclusionStack);
   else if (argc > 2 && strcmp(argv[1], "-test-inclusion-stack-tu") == 0)
     return perform_test_load_tu(argv[2], "all", NULL, NULL,
                                 PrintInclusionStack);
+  else if (argc > 2 && strcmp(argv[1], "-test-file-token-hashes-source") == 0)
+    return perform_test_load_source(argc - 2, argv + 2, "all", NULL,
+                                    PrintFileTokenHashes);
   else if (argc > 2 && strcmp(argv[1], "-test-print-linkage-source") == 0)
     return perform_test_load_source(argc - 2, argv + 2, "all", PrintLinkage,
                                     NULL);
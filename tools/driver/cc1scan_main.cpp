@@ -0,0 +1,423 @@
+//===-- cc1scan_main.cpp - Clang Batch Dependency Scanner -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This is the entry point to the clang -cc1scan functionality, which finds the
+// dependencies of a batch of translation units on a pool of threads.
+//
+// All translation units are preprocessed with the same -cc1 options.  The
+// threads share one file manager (with its stat caches) and one header search
+// directory index, so each file and search directory is looked at once for
+// the whole batch rather than once per translation unit.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Basic/TargetInfo.h"
+#include "clang/Driver/DriverDiagnostic.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/FrontendActions.h"
+#include "clang/Frontend/FrontendDiagnostic.h"
+#include "clang/Frontend/TextDiagnosticBuffer.h"
+#include "clang/Frontend/TextDiagnosticPrinter.h"
+#include "clang/Lex/DirectoryIndex.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include "llvm/Config/config.h"
+#include <cstdlib>
+#include <vector>
+
+#if LLVM_MULTITHREADED && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#define HAVE_SCAN_THREADS 1
+#endif
+using namespace clang;
+
+namespace {
+
+/// \brief The options of -cc1scan itself; everything else is a -cc1 option
+/// applying to every translation unit.
+struct ScanOptions {
+  /// The number of threads to scan with.
+  unsigned NumThreads;
+
+  /// If non-empty, the directory to write a make-style dependency file for
+  /// each translation unit to.
+  std::string DepsDir;
+
+  /// If non-empty, the file to write the dependencies of all translation
+  /// units to, as JSON.
+  std::string DepsJSON;
+
+  /// If non-empty, a file listing more inputs, one per line.
+  std::string InputList;
+
+  ScanOptions() : NumThreads(1) {}
+};
+
+/// \brief What scanning one translation unit produced.
+struct ScanResult {
+  /// The input file.
+  std::string Input;
+
+  /// The target of the dependency rule, which names the object file.
+  std::string Target;
+
+  /// The dependency file to write, if dependency files were requested.
+  std::string DepFile;
+
+  /// The files the input depends on, if JSON output was requested.
+  std::vector<std::string> Dependencies;
+
+  /// The text of the diagnostics issued while scanning.
+  std::string Diagnostics;
+
+  bool Success;
+
+  ScanResult() : Success(false) {}
+};
+
+/// \brief The state shared by the scanning threads.
+struct ScanState {
+  CompilerInvocation *BaseInvocation;
+  FileManager *FileMgr;
+  DirectoryIndex *DirIndex;
+  bool CollectDependencies;
+
+  std::vector<InputKind> InputKinds;
+  std::vector<ScanResult> Results;
+
+  /// Guards NextInput, and the reference counts of the shared file manager.
+  llvm::sys::Mutex Lock;
+  unsigned NextInput;
+};
+
+}
+
+/// ParseScanArgs - Split the -cc1scan options off the argument list, leaving
+/// the -cc1 options in CC1Args.
+static bool ParseScanArgs(const char **ArgBegin, const char **ArgEnd,
+                          ScanOptions &Opts,
+                          SmallVectorImpl<const char *> &CC1Args,
+                          DiagnosticsEngine &Diags) {
+  for (const char **I = ArgBegin; I != ArgEnd; ++I) {
+    StringRef Arg = *I;
+    std::string *Value = 0;
+    if (Arg == "-scan-deps-dir")
+      Value = &Opts.DepsDir;
+    else if (Arg == "-scan-deps-json")
+      Value = &Opts.DepsJSON;
+    else if (Arg == "-scan-inputs")
+      Value = &Opts.InputList;
+    else if (Arg != "-j") {
+      CC1Args.push_back(*I);
+      continue;
+    }
+
+    if (I + 1 == ArgEnd) {
+      Diags.Report(diag::err_drv_missing_argument) << Arg << 1;
+      return false;
+    }
+    ++I;
+    if (Value) {
+      *Value = *I;
+      continue;
+    }
+
+    if (StringRef(*I).getAsInteger(10, Opts.NumThreads) ||
+        Opts.NumThreads == 0) {
+      Diags.Report(diag::err_drv_invalid_int_value) << Arg << *I;
+      return false;
+    }
+  }
+
+  if (Opts.DepsDir.empty() && Opts.DepsJSON.empty()) {
+    Diags.Report(diag::err_fe_scan_requires_output);
+    return false;
+  }
+  return true;
+}
+
+/// AddInputsFromList - Add the files named in the input list, one per line.
+static bool AddInputsFromList(StringRef ListFile, FrontendOptions &FEOpts,
+                              DiagnosticsEngine &Diags) {
+  llvm::OwningPtr<llvm::MemoryBuffer> Buffer;
+  if (llvm::error_code ec = llvm::MemoryBuffer::getFile(ListFile, Buffer)) {
+    Diags.Report(diag::err_fe_error_opening) << ListFile << ec.message();
+    return false;
+  }
+
+  StringRef Remaining = Buffer->getBuffer();
+  while (!Remaining.empty()) {
+    std::pair<StringRef, StringRef> Split = Remaining.split('\n');
+    StringRef Name = Split.first.trim();
+    Remaining = Split.second;
+    if (Name.empty())
+      continue;
+
+    StringRef Ext = llvm::sys::path::extension(Name);
+    InputKind IK = FrontendOptions::getInputKindForExtension(
+                     Ext.empty() ? Ext : Ext.substr(1));
+    if (IK == IK_None)
+      IK = IK_C;
+    FEOpts.Inputs.push_back(std::make_pair(IK, Name.str()));
+  }
+  return true;
+}
+
+/// ScanTranslationUnit - Preprocess the input with the given index, recording
+/// its dependencies and diagnostics in its result.
+static void ScanTranslationUnit(ScanState &State, unsigned Index) {
+  ScanResult &Result = State.Results[Index];
+
+  CompilerInstance Clang;
+  CompilerInvocation *Invocation =
+    new CompilerInvocation(*State.BaseInvocation);
+  Clang.setInvocation(Invocation);
+
+  // Statistics of separate instances would be interleaved; those of the
+  // shared caches are printed once the batch is done.  Leaking the instance
+  // would leave references to the shared file manager behind.
+  FrontendOptions &FEOpts = Invocation->getFrontendOpts();
+  FEOpts.Inputs.clear();
+  FEOpts.Inputs.push_back(std::make_pair(State.InputKinds[Index],
+                                         Result.Input));
+  FEOpts.ShowStats = false;
+  FEOpts.DisableFree = false;
+
+  DependencyOutputOptions &DepOpts = Invocation->getDependencyOutputOpts();
+  DepOpts.Targets.assign(1, Result.Target);
+  DepOpts.OutputFile = Result.DepFile;
+
+  llvm::raw_string_ostream DiagOS(Result.Diagnostics);
+  Clang.createDiagnostics(0, 0,
+                          new TextDiagnosticPrinter(DiagOS,
+                                                    Clang.getDiagnosticOpts()),
+                          /*ShouldOwnClient=*/true,
+                          /*ShouldCloneClient=*/false);
+
+  {
+    llvm::sys::ScopedLock Guard(State.Lock);
+    Clang.setFileManager(State.FileMgr);
+  }
+
+  Clang.setTarget(TargetInfo::CreateTargetInfo(Clang.getDiagnostics(),
+                                               Clang.getTargetOpts()));
+  if (Clang.hasTarget()) {
+    Clang.getTarget().setForcedLangOptions(Clang.getLangOpts());
+
+    ScanDependenciesAction Act(State.DirIndex,
+                               State.CollectDependencies ?
+                                 &Result.Dependencies : 0);
+    if (Act.BeginSourceFile(Clang, Result.Input, State.InputKinds[Index])) {
+      Act.Execute();
+      Act.EndSourceFile();
+    }
+  }
+
+  Result.Success = !Clang.getDiagnostics().hasErrorOccurred();
+  DiagOS.flush();
+
+  // Drop everything referring to the shared file manager before letting go
+  // of it.
+  Clang.setPreprocessor(0);
+  Clang.setSourceManager(0);
+  llvm::sys::ScopedLock Guard(State.Lock);
+  Clang.setFileManager(0);
+}
+
+/// ScanThread - Scan inputs until there are none left.
+static void *ScanThread(void *Arg) {
+  ScanState &State = *static_cast<ScanState *>(Arg);
+  while (true) {
+    unsigned Index;
+    {
+      llvm::sys::ScopedLock Guard(State.Lock);
+      if (State.NextInput == State.Results.size())
+        break;
+      Index = State.NextInput++;
+    }
+    ScanTranslationUnit(State, Index);
+  }
+  return 0;
+}
+
+/// RunScanThreads - Scan all inputs on up to NumThreads threads, including the
+/// calling one.
+static void RunScanThreads(ScanState &State, unsigned NumThreads) {
+  State.NextInput = 0;
+  if (NumThreads > State.Results.size())
+    NumThreads = State.Results.size();
+
+#ifdef HAVE_SCAN_THREADS
+  if (NumThreads > 1 && llvm::llvm_start_multithreaded()) {
+    std::vector<pthread_t> Threads;
+    for (unsigned i = 1; i != NumThreads; ++i) {
+      pthread_t Thread;
+      if (::pthread_create(&Thread, 0, ScanThread, &State) != 0)
+        break;
+      Threads.push_back(Thread);
+    }
+
+    ScanThread(&State);
+
+    for (unsigned i = 0, e = Threads.size(); i != e; ++i)
+      ::pthread_join(Threads[i], 0);
+    llvm::llvm_stop_multithreaded();
+    return;
+  }
+#endif
+
+  ScanThread(&State);
+}
+
+static void PrintJSONString(raw_ostream &OS, StringRef Str) {
+  OS << '"';
+  for (unsigned i = 0, e = Str.size(); i != e; ++i) {
+    unsigned char C = Str[i];
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if (C < 0x20)
+      OS << llvm::format("\\u%04x", C);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+/// WriteDependencyGraph - Write the dependencies of every translation unit to
+/// OS as JSON.
+static void WriteDependencyGraph(raw_ostream &OS,
+                                 const std::vector<ScanResult> &Results) {
+  OS << "{\n  \"translation-units\": [";
+  for (unsigned i = 0, e = Results.size(); i != e; ++i) {
+    const ScanResult &Result = Results[i];
+    OS << (i ? ",\n" : "\n") << "    {\n      \"input\": ";
+    PrintJSONString(OS, Result.Input);
+    OS << ",\n      \"target\": ";
+    PrintJSONString(OS, Result.Target);
+    OS << ",\n      \"success\": " << (Result.Success ? "true" : "false");
+    OS << ",\n      \"dependencies\": [";
+    for (unsigned j = 0, je = Result.Dependencies.size(); j != je; ++j) {
+      OS << (j ? ",\n" : "\n") << "        ";
+      PrintJSONString(OS, Result.Dependencies[j]);
+    }
+    OS << (Result.Dependencies.empty() ? "]" : "\n      ]") << "\n    }";
+  }
+  OS << (Results.empty() ? "]" : "\n  ]") << "\n}\n";
+}
+
+int cc1scan_main(const char **ArgBegin, const char **ArgEnd,
+                 const char *Argv0, void *MainAddr) {
+  CompilerInstance Base;
+  llvm::IntrusiveRefCntPtr<DiagnosticIDs> DiagID(new DiagnosticIDs());
+
+  // Buffer diagnostics from argument parsing so that we can output them using a
+  // well formed diagnostic object.
+  TextDiagnosticBuffer *DiagsBuffer = new TextDiagnosticBuffer;
+  DiagnosticsEngine Diags(DiagID, DiagsBuffer);
+  ScanOptions Opts;
+  SmallVector<const char *, 256> CC1Args;
+  bool Success = ParseScanArgs(ArgBegin, ArgEnd, Opts, CC1Args, Diags);
+  CompilerInvocation::CreateFromArgs(Base.getInvocation(), CC1Args.begin(),
+                                     CC1Args.end(), Diags);
+  FrontendOptions &FEOpts = Base.getFrontendOpts();
+  if (Success && !Opts.InputList.empty())
+    Success = AddInputsFromList(Opts.InputList, FEOpts, Diags);
+
+  // Infer the builtin include path if unspecified.
+  if (Base.getHeaderSearchOpts().UseBuiltinIncludes &&
+      Base.getHeaderSearchOpts().ResourceDir.empty())
+    Base.getHeaderSearchOpts().ResourceDir =
+      CompilerInvocation::GetResourcesPath(Argv0, MainAddr);
+
+  Base.createDiagnostics(ArgEnd - ArgBegin, const_cast<char **>(ArgBegin));
+  if (!Base.hasDiagnostics())
+    return 1;
+  DiagsBuffer->FlushDiagnostics(Base.getDiagnostics());
+  if (!Success || Base.getDiagnostics().hasErrorOccurred())
+    return 1;
+
+  ScanState State;
+  State.BaseInvocation = &Base.getInvocation();
+  State.CollectDependencies = !Opts.DepsJSON.empty();
+
+  // Work out the rule target and dependency file of each input.
+  llvm::StringMap<unsigned> DepFiles;
+  State.Results.resize(FEOpts.Inputs.size());
+  for (unsigned i = 0, e = FEOpts.Inputs.size(); i != e; ++i) {
+    ScanResult &Result = State.Results[i];
+    State.InputKinds.push_back(FEOpts.Inputs[i].first);
+    Result.Input = FEOpts.Inputs[i].second;
+
+    StringRef Stem = llvm::sys::path::stem(Result.Input);
+    Result.Target = Stem.str() + ".o";
+    if (Opts.DepsDir.empty())
+      continue;
+
+    llvm::SmallString<256> DepFile(Opts.DepsDir);
+    llvm::sys::path::append(DepFile, Stem.str() + ".d");
+    Result.DepFile = DepFile.str();
+
+    unsigned &Prev = DepFiles.GetOrCreateValue(Result.DepFile, ~0U).getValue();
+    if (Prev != ~0U) {
+      Base.getDiagnostics().Report(diag::err_fe_scan_duplicate_output)
+        << State.Results[Prev].Input << Result.Input << Result.DepFile;
+      return 1;
+    }
+    Prev = i;
+  }
+
+  // The shared caches.  The directory index doesn't notice files created
+  // while the batch runs, which is fine since scanning creates none.
+  Base.createFileManager();
+  State.FileMgr = &Base.getFileManager();
+  DirectoryIndex DirIndex;
+  State.DirIndex = &DirIndex;
+
+  RunScanThreads(State, Opts.NumThreads);
+
+  // Report diagnostics in input order, whichever thread produced them.
+  for (unsigned i = 0, e = State.Results.size(); i != e; ++i) {
+    llvm::errs() << State.Results[i].Diagnostics;
+    if (!State.Results[i].Success)
+      Success = false;
+  }
+
+  if (!Opts.DepsJSON.empty()) {
+    std::string Error;
+    llvm::raw_fd_ostream OS(Opts.DepsJSON.c_str(), Error);
+    if (!Error.empty()) {
+      Base.getDiagnostics().Report(diag::err_fe_error_opening)
+        << Opts.DepsJSON << Error;
+      return 1;
+    }
+    WriteDependencyGraph(OS, State.Results);
+  }
+
+  if (FEOpts.ShowStats) {
+    State.FileMgr->PrintStats();
+    llvm::errs() << "\n*** Search Directory Index Stats:\n";
+    DirIndex.PrintStats();
+  }
+
+  llvm::llvm_shutdown();
+
+  return !Success;
+}
@@ -2426,6 +2426,8 @@ static void clang_parseTranslationUnit_Impl(void *UserData) {
     = (options & CXTranslationUnit_Incomplete)? TU_Prefix : TU_Complete;
   bool CacheCodeCompetionResults
     = options & CXTranslationUnit_CacheCompletionResults;
+  bool AsyncPreamble = options & CXTranslationUnit_AsyncPrecompiledPreamble;
+  bool TrackFileTokenHashes = options & CXTranslationUnit_TrackFileTokenHashes;
   
   // Configure the diagnostics.
   DiagnosticOptions DiagOpts;
@@ -2495,6 +2497,11 @@ static void clang_parseTranslationUnit_Impl(void *UserData) {
     NestedMacroExpansions
       = (options & CXTranslationUnit_NestedMacroExpansions);
   }
+
+  if (options & CXTranslationUnit_SkipFunctionBodies) {
+    Args->push_back("-Xclang");
+    Args->push_back("-skip-function-bodies");
+  }
   
   unsigned NumErrors = Diags->getClient()->getNumErrors();
   llvm::OwningPtr<ASTUnit> Unit(
@@ -2511,7 +2518,9 @@ static void clang_parseTranslationUnit_Impl(void *UserData) {
                                  PrecompilePreamble,
                                  TUKind,
                                  CacheCodeCompetionResults,
-                                 NestedMacroExpansions));
+                                 NestedMacroExpansions,
+                                 AsyncPreamble,
+                                 TrackFileTokenHashes));
 
   if (NumErrors != Diags->getClient()->getNumErrors()) {
     // Make sure to check that 'Unit' is non-NULL.
@@ -2954,6 +2963,16 @@ unsigned clang_isFileMultipleIncludeGuarded(CXTranslationUnit tu, CXFile file) {
                                           .isFileMultipleIncludeGuarded(FEnt);
 }
 
+unsigned clang_getFileTokenHash(CXTranslationUnit tu, CXFile file,
+                                unsigned *hash) {
+  if (!tu || !file || !hash)
+    return 0;
+
+  ASTUnit *CXXUnit = static_cast<ASTUnit *>(tu->TUData);
+  FileEntry *FEnt = static_cast<FileEntry *>(file);
+  return CXXUnit->getFileTokenHash(FEnt->getName(), *hash);
+}
+
 } // end: extern "C"
 
 //===----------------------------------------------------------------------===//
@@ -47,6 +47,11 @@ CXDiagnostic clang_getDiagnostic(CXTranslationUnit Unit, unsigned Index) {
                                 CXXUnit->getASTContext().getLangOptions());
 }
 
+unsigned clang_isDiagnosticRepeated(CXTranslationUnit Unit, unsigned Index) {
+  ASTUnit *CXXUnit = static_cast<ASTUnit *>(Unit->TUData);
+  return CXXUnit && CXXUnit->isRepeatedDiagnostic(Index);
+}
+
 void clang_disposeDiagnostic(CXDiagnostic Diagnostic) {
   CXStoredDiagnostic *Stored = static_cast<CXStoredDiagnostic *>(Diagnostic);
   delete Stored;
@@ -0,0 +1,152 @@
+//===- unittests/AST/ConcurrentTypeCreationTest.cpp - Type creation tests -===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Decl.h"
+#include "clang/Basic/Builtins.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Basic/FileSystemOptions.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Basic/TargetInfo.h"
+#include "clang/Basic/TargetOptions.h"
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Config/config.h"
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#if LLVM_MULTITHREADED && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#define HAVE_TYPE_CREATION_THREADS 1
+#endif
+
+using namespace llvm;
+using namespace clang;
+
+namespace {
+
+class ConcurrentTypeCreationTest : public ::testing::Test {
+protected:
+  ConcurrentTypeCreationTest()
+    : FileMgr(FileMgrOpts),
+      DiagIDs(new DiagnosticIDs),
+      Diags(DiagIDs, new IgnoringDiagConsumer),
+      SourceMgr(Diags, FileMgr),
+      Idents(LangOpts) {
+    TargetOpts.Triple = "x86_64-apple-darwin10";
+    Target.reset(TargetInfo::CreateTargetInfo(Diags, TargetOpts));
+    Ctx.reset(new ASTContext(LangOpts, SourceMgr, Target.get(), Idents,
+                             Selectors, Builtins, 0));
+  }
+
+  FileSystemOptions FileMgrOpts;
+  FileManager FileMgr;
+  IntrusiveRefCntPtr<DiagnosticIDs> DiagIDs;
+  DiagnosticsEngine Diags;
+  SourceManager SourceMgr;
+  LangOptions LangOpts;
+  TargetOptions TargetOpts;
+  OwningPtr<TargetInfo> Target;
+  IdentifierTable Idents;
+  SelectorTable Selectors;
+  Builtin::Context Builtins;
+  OwningPtr<ASTContext> Ctx;
+};
+
+/// \brief A thread creating the same sequence of types as all the others.
+struct Worker {
+  ASTContext *Ctx;
+  unsigned NumRounds;
+  std::vector<QualType> Types;
+};
+
+void *createTypes(void *Arg) {
+  Worker &W = *static_cast<Worker *>(Arg);
+  ASTContext &Ctx = *W.Ctx;
+  CanQualType Bases[] = {
+    Ctx.VoidTy, Ctx.CharTy, Ctx.IntTy, Ctx.LongTy, Ctx.FloatTy, Ctx.DoubleTy
+  };
+  FunctionProtoType::ExtProtoInfo EPI;
+
+  for (unsigned Round = 0; Round != W.NumRounds; ++Round) {
+    for (unsigned B = 0; B != sizeof(Bases) / sizeof(Bases[0]); ++B) {
+      QualType T = Bases[B];
+      for (unsigned Depth = 0; Depth != 4; ++Depth) {
+        T = Ctx.getPointerType(T);
+        W.Types.push_back(T);
+        W.Types.push_back(Ctx.getVolatileType(T));
+        W.Types.push_back(Ctx.getConstantArrayType(T, APInt(32, Round + 1),
+                                                   ArrayType::Normal, 0));
+        QualType Args[] = { T, Ctx.getVolatileType(T) };
+        W.Types.push_back(Ctx.getFunctionType(Bases[B], Args, 2, EPI));
+        // Type source info comes from the same arenas as the types.
+        TypeSourceInfo *TInfo = Ctx.getTrivialTypeSourceInfo(W.Types.back());
+        EXPECT_EQ(W.Types.back().getAsOpaquePtr(),
+                  TInfo->getType().getAsOpaquePtr());
+      }
+    }
+  }
+  return 0;
+}
+
+void runWorkers(std::vector<Worker> &Workers) {
+#ifdef HAVE_TYPE_CREATION_THREADS
+  std::vector<pthread_t> Threads(Workers.size());
+  for (unsigned I = 0, N = Workers.size(); I != N; ++I)
+    ASSERT_EQ(0, pthread_create(&Threads[I], 0, createTypes, &Workers[I]));
+  for (unsigned I = 0, N = Workers.size(); I != N; ++I)
+    pthread_join(Threads[I], 0);
+#else
+  for (unsigned I = 0, N = Workers.size(); I != N; ++I)
+    createTypes(&Workers[I]);
+#endif
+}
+
+TEST_F(ConcurrentTypeCreationTest, TypesAreUniqueAcrossThreads) {
+  Ctx->enableConcurrentTypeCreation();
+  EXPECT_TRUE(Ctx->isConcurrentTypeCreationEnabled());
+
+  std::vector<Worker> Workers(8);
+  for (unsigned I = 0, N = Workers.size(); I != N; ++I) {
+    Workers[I].Ctx = Ctx.get();
+    Workers[I].NumRounds = 200;
+  }
+  runWorkers(Workers);
+
+  // Creating the types again on this thread finds the same nodes.
+  Worker Expected;
+  Expected.Ctx = Ctx.get();
+  Expected.NumRounds = 200;
+  createTypes(&Expected);
+
+  for (unsigned I = 0, N = Workers.size(); I != N; ++I) {
+    ASSERT_EQ(Expected.Types.size(), Workers[I].Types.size());
+    for (unsigned J = 0, M = Expected.Types.size(); J != M; ++J)
+      ASSERT_EQ(Expected.Types[J].getAsOpaquePtr(),
+                Workers[I].Types[J].getAsOpaquePtr());
+  }
+}
+
+TEST_F(ConcurrentTypeCreationTest, ThreadArenasAreCounted) {
+  size_t Before = Ctx->getASTAllocatedMemory();
+  Ctx->enableConcurrentTypeCreation();
+
+  std::vector<Worker> Workers(2);
+  for (unsigned I = 0, N = Workers.size(); I != N; ++I) {
+    Workers[I].Ctx = Ctx.get();
+    Workers[I].NumRounds = 10;
+  }
+  runWorkers(Workers);
+  EXPECT_LT(Before, Ctx->getASTAllocatedMemory());
+}
+
+} // anonymous namespace
@@ -0,0 +1,96 @@
+//===- unittests/Basic/PerfectHashIndexTest.cpp - PerfectHashIndex tests --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/PerfectHashIndex.h"
+#include "clang/Basic/Builtins.h"
+#include "clang/Basic/IdentifierTable.h"
+#include "clang/Basic/LangOptions.h"
+
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace clang;
+
+namespace {
+
+TEST(PerfectHashIndexTest, EmptyIndexFindsNothing) {
+  PerfectHashIndex Index;
+  EXPECT_TRUE(Index.empty());
+  EXPECT_EQ(-1, Index.lookup("int"));
+  EXPECT_EQ(-1, Index.lookup(""));
+}
+
+TEST(PerfectHashIndexTest, FindsEveryString) {
+  std::vector<std::string> Storage;
+  for (unsigned i = 0; i != 2000; ++i)
+    Storage.push_back("__builtin_" + std::string(1, 'a' + i % 26) +
+                      std::string(i / 26 + 1, 'x'));
+
+  std::vector<StringRef> Strings(Storage.begin(), Storage.end());
+  PerfectHashIndex Index;
+  Index.build(Strings);
+  ASSERT_EQ(2000U, Index.size());
+  for (unsigned i = 0; i != 2000; ++i)
+    EXPECT_EQ(int(i), Index.lookup(Strings[i]));
+
+  EXPECT_EQ(-1, Index.lookup("__builtin_"));
+  EXPECT_EQ(-1, Index.lookup("__builtin_ax_"));
+  EXPECT_EQ(-1, Index.lookup(""));
+}
+
+TEST(PerfectHashIndexTest, DuplicatesFindFirstPosition) {
+  StringRef Strings[] = { "and", "or", "and", "not", "or" };
+  PerfectHashIndex Index;
+  Index.build(Strings);
+  EXPECT_EQ(0, Index.lookup("and"));
+  EXPECT_EQ(1, Index.lookup("or"));
+  EXPECT_EQ(3, Index.lookup("not"));
+  EXPECT_EQ(-1, Index.lookup("xor"));
+}
+
+TEST(PerfectHashIndexTest, KeywordsAreInitializedOnFirstUse) {
+  LangOptions LangOpts;
+  LangOpts.CPlusPlus = 1;
+  LangOpts.CXXOperatorNames = 1;
+  LangOpts.GNUKeywords = 1;
+  IdentifierTable Table(LangOpts);
+  EXPECT_EQ(0U, Table.size());
+
+  EXPECT_EQ(tok::kw_class, Table.get("class").getTokenID());
+  EXPECT_EQ(tok::ampamp, Table.get("and").getTokenID());
+  EXPECT_TRUE(Table.get("and").isCPlusPlusOperatorKeyword());
+  EXPECT_TRUE(Table.get("typeof").isExtensionToken());
+  EXPECT_TRUE(Table.get("constexpr").isCXX11CompatKeyword());
+  EXPECT_EQ(tok::identifier, Table.get("constexpr").getTokenID());
+  EXPECT_EQ(tok::identifier, Table.get("classy").getTokenID());
+  EXPECT_EQ(5U, Table.size());
+
+  Table.AddVocabulary();
+  EXPECT_EQ(tok::kw_while, Table.get("while").getTokenID());
+  EXPECT_LT(5U, Table.size());
+}
+
+TEST(PerfectHashIndexTest, BuiltinsAreInitializedOnFirstUse) {
+  LangOptions LangOpts;
+  IdentifierTable Table(LangOpts);
+  IdentifierInfo &Existing = Table.get("__builtin_abs");
+
+  Builtin::Context Builtins;
+  Builtins.InitializeBuiltins(Table, LangOpts);
+  EXPECT_EQ(unsigned(Builtin::BI__builtin_abs), Existing.getBuiltinID());
+  EXPECT_EQ(unsigned(Builtin::BI__builtin_expect),
+            Table.get("__builtin_expect").getBuiltinID());
+  EXPECT_EQ(unsigned(Builtin::BImalloc), Table.get("malloc").getBuiltinID());
+  EXPECT_EQ(0U, Table.get("mallocx").getBuiltinID());
+}
+
+} // anonymous namespace
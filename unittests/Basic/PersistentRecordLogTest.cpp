@@ -0,0 +1,125 @@
+//===- unittests/Basic/PersistentRecordLogTest.cpp - Record log tests -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/PersistentRecordLog.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Path.h"
+
+#include "gtest/gtest.h"
+
+#include <string>
+
+#if !defined(_MSC_VER) && !defined(__MINGW32__)
+#define HAVE_PERSISTENT_RECORD_LOG 1
+#endif
+
+using namespace llvm;
+using namespace clang;
+
+namespace {
+
+#ifdef HAVE_PERSISTENT_RECORD_LOG
+
+static const char TestMagic[8] = { 'T', 'E', 'S', 'T', 'L', 'O', 'G', 0 };
+
+class PersistentRecordLogTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    std::string ErrMsg;
+    Dir = sys::Path::GetTemporaryDirectory(&ErrMsg);
+    ASSERT_TRUE(ErrMsg.empty()) << ErrMsg;
+    sys::Path File(Dir);
+    File.appendComponent("records.log");
+    FileName = File.str();
+  }
+
+  virtual void TearDown() {
+    Dir.eraseFromDisk(true);
+  }
+
+  PersistentRecordLog *open() {
+    std::string ErrMsg;
+    PersistentRecordLog *Log =
+      PersistentRecordLog::Open(FileName, "test log", TestMagic, 1, ErrMsg);
+    EXPECT_TRUE(Log != 0) << ErrMsg;
+    return Log;
+  }
+
+  sys::Path Dir;
+  std::string FileName;
+};
+
+TEST_F(PersistentRecordLogTest, AppendedRecordsAreReadBack) {
+  {
+    OwningPtr<PersistentRecordLog> Log(open());
+    ASSERT_TRUE(Log);
+    EXPECT_TRUE(Log->append("first"));
+    EXPECT_TRUE(Log->append("a second, longer record"));
+  }
+
+  OwningPtr<PersistentRecordLog> Log(open());
+  ASSERT_TRUE(Log);
+  SmallVector<StringRef, 4> Records;
+  Log->getRecords(Records);
+  ASSERT_EQ(2U, Records.size());
+  EXPECT_EQ("first", Records[0].str());
+  EXPECT_EQ("a second, longer record", Records[1].str());
+}
+
+TEST_F(PersistentRecordLogTest, RewriteKeepsOnlyTheGivenRecords) {
+  {
+    OwningPtr<PersistentRecordLog> Log(open());
+    ASSERT_TRUE(Log);
+    for (unsigned i = 0; i != 100; ++i)
+      EXPECT_TRUE(Log->append(i % 2 ? "odd" : "even"));
+  }
+
+  {
+    OwningPtr<PersistentRecordLog> Log(open());
+    ASSERT_TRUE(Log);
+    SmallVector<StringRef, 128> Records;
+    Log->getRecords(Records);
+    ASSERT_EQ(100U, Records.size());
+
+    // Keep the newest record of each kind, then keep appending.
+    StringRef Kept[] = { Records[98], Records[99] };
+    EXPECT_TRUE(Log->rewrite(Kept));
+    EXPECT_TRUE(Log->append("after"));
+  }
+
+  OwningPtr<PersistentRecordLog> Log(open());
+  ASSERT_TRUE(Log);
+  SmallVector<StringRef, 4> Records;
+  Log->getRecords(Records);
+  ASSERT_EQ(3U, Records.size());
+  EXPECT_EQ("even", Records[0].str());
+  EXPECT_EQ("odd", Records[1].str());
+  EXPECT_EQ("after", Records[2].str());
+}
+
+TEST_F(PersistentRecordLogTest, RewriteWithNothingEmptiesTheFile) {
+  {
+    OwningPtr<PersistentRecordLog> Log(open());
+    ASSERT_TRUE(Log);
+    EXPECT_TRUE(Log->append("record"));
+    EXPECT_TRUE(Log->rewrite(ArrayRef<StringRef>()));
+  }
+
+  OwningPtr<PersistentRecordLog> Log(open());
+  ASSERT_TRUE(Log);
+  SmallVector<StringRef, 4> Records;
+  Log->getRecords(Records);
+  EXPECT_TRUE(Records.empty());
+}
+
+#endif
+
+} // anonymous namespace
@@ -0,0 +1,120 @@
+//===- unittests/Basic/SourceManagerTest.cpp - SourceManager tests --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/SourceManager.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Basic/FileSystemOptions.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace clang;
+
+namespace {
+
+/// The size of the chunks the line table is extended by.
+static const unsigned ChunkSize = 64 * 1024;
+
+class SourceManagerTest : public ::testing::Test {
+protected:
+  SourceManagerTest()
+    : FileMgr(FileMgrOpts),
+      DiagIDs(new DiagnosticIDs),
+      Diags(DiagIDs, new IgnoringDiagConsumer),
+      SourceMgr(Diags, FileMgr) {
+    buildSource();
+    FID = SourceMgr.createMainFileIDForMemBuffer(
+        MemoryBuffer::getMemBufferCopy(Source, "lines.c"));
+  }
+
+  /// \brief Build a file of three chunks of 16 byte lines, with one line
+  /// ended by a "\r\n" pair that straddles the first chunk boundary.
+  void buildSource() {
+    while (Source.size() < 3 * ChunkSize) {
+      LineStarts.push_back(Source.size());
+      if (Source.size() < ChunkSize - 1 && Source.size() + 16 > ChunkSize - 1) {
+        Source.append(ChunkSize - 1 - Source.size(), 'x');
+        Source += "\r\n";
+        continue;
+      }
+      Source += "int line_xxxxx;\n";
+    }
+  }
+
+  /// \brief The line number of the character at Offset.
+  unsigned expectedLine(unsigned Offset) const {
+    return std::upper_bound(LineStarts.begin(), LineStarts.end(), Offset) -
+           LineStarts.begin();
+  }
+
+  const SrcMgr::ContentCache *getContentCache() const {
+    return SourceMgr.getSLocEntry(FID).getFile().getContentCache();
+  }
+
+  FileSystemOptions FileMgrOpts;
+  FileManager FileMgr;
+  IntrusiveRefCntPtr<DiagnosticIDs> DiagIDs;
+  DiagnosticsEngine Diags;
+  SourceManager SourceMgr;
+  std::string Source;
+  std::vector<unsigned> LineStarts;
+  FileID FID;
+};
+
+TEST_F(SourceManagerTest, NearQueryThenFarQuery) {
+  EXPECT_EQ(1U, SourceMgr.getLineNumber(FID, 10));
+  EXPECT_FALSE(getContentCache()->LineCacheComplete);
+
+  unsigned Last = Source.size() - 2;
+  EXPECT_EQ(expectedLine(Last), SourceMgr.getLineNumber(FID, Last));
+  EXPECT_TRUE(getContentCache()->LineCacheComplete);
+
+  // Going back to a position inside the first chunk still works.
+  EXPECT_EQ(expectedLine(ChunkSize / 2),
+            SourceMgr.getLineNumber(FID, ChunkSize / 2));
+}
+
+TEST_F(SourceManagerTest, TranslateLineColAfterPartialScan) {
+  EXPECT_EQ(1U, SourceMgr.getLineNumber(FID, 10));
+  EXPECT_FALSE(getContentCache()->LineCacheComplete);
+
+  unsigned Line = LineStarts.size() - 1;
+  SourceLocation Loc = SourceMgr.translateLineCol(FID, Line, 3);
+  ASSERT_TRUE(Loc.isValid());
+  EXPECT_EQ(LineStarts[Line - 1] + 2, SourceMgr.getFileOffset(Loc));
+  EXPECT_EQ(Line, SourceMgr.getSpellingLineNumber(Loc));
+}
+
+TEST_F(SourceManagerTest, CRLFAcrossChunkBoundary) {
+  unsigned Line = expectedLine(ChunkSize - 1);
+  ASSERT_EQ('\r', Source[ChunkSize - 1]);
+  ASSERT_EQ('\n', Source[ChunkSize]);
+
+  // The first scan ends just past the pair, at the first line that starts
+  // in the next chunk.
+  EXPECT_EQ(Line, SourceMgr.getLineNumber(FID, ChunkSize - 2));
+  EXPECT_FALSE(getContentCache()->LineCacheComplete);
+  EXPECT_EQ(Line, SourceMgr.getLineNumber(FID, ChunkSize));
+  EXPECT_EQ(Line + 1, SourceMgr.getLineNumber(FID, ChunkSize + 1));
+
+  // The pair ends a single line, so later lines are not shifted.
+  unsigned Last = Source.size() - 2;
+  EXPECT_EQ(expectedLine(Last), SourceMgr.getLineNumber(FID, Last));
+
+  SourceLocation Loc = SourceMgr.translateLineCol(FID, Line + 1, 1);
+  EXPECT_EQ(ChunkSize + 1, SourceMgr.getFileOffset(Loc));
+}
+
+} // anonymous namespace
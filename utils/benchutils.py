@@ -0,0 +1,60 @@
+"""
+benchutils - Helpers shared by the benchmark scripts in this directory.
+
+Each benchmark generates or picks its own inputs, then uses these helpers to
+time 'clang -cc1' over them, keeping the best of several runs.
+"""
+
+import os
+import shutil
+import subprocess
+import tempfile
+import time
+from contextlib import contextmanager
+
+def runQuietly(cmd):
+    """Run cmd with its output discarded and return its exit status."""
+    devnull = open(os.devnull, 'w')
+    try:
+        return subprocess.call(cmd, stdout=devnull, stderr=devnull)
+    finally:
+        devnull.close()
+
+def timeOneRun(clang, args, path):
+    """Return how long 'clang -cc1 ARGS PATH' took, or None if it failed."""
+    start = time.time()
+    res = runQuietly([clang, '-cc1'] + args + [path])
+    elapsed = time.time() - start
+    if res != 0:
+        return None
+    return elapsed
+
+def bestOf(numRuns, clang, args, path):
+    """Return the best time of numRuns runs, or None if every run failed."""
+    best = None
+    for i in range(numRuns):
+        elapsed = timeOneRun(clang, args, path)
+        if elapsed is not None and (best is None or elapsed < best):
+            best = elapsed
+    return best
+
+def addCommonOptions(parser, runsOf):
+    """Add the --clang, -n and -X options to an OptionParser.
+
+    runsOf says what each set of timed runs is for, e.g. 'per input'."""
+    parser.add_option("", "--clang", dest="clang", default="clang",
+                      help="Path to the clang binary [%default]")
+    parser.add_option("-n", "", dest="numRuns", type=int, default=5,
+                      help="Number of timed runs %s, best is kept "
+                           "[%%default]" % runsOf)
+    parser.add_option("-X", "", dest="extraArgs", action="append", default=[],
+                      help="Extra argument to pass to clang -cc1")
+
+@contextmanager
+def temporaryDirectory():
+    """Create a directory for generated inputs, removed with its contents."""
+    path = tempfile.mkdtemp()
+    try:
+        yield path
+    finally:
+        shutil.rmtree(path)
@@ -0,0 +1,71 @@
+#!/usr/bin/env python
+
+"""
+const-expr-bench - Measure how fast clang folds deeply nested constants.
+
+Generates a C file of array declarations whose bounds are deeply nested
+integer constant expressions, the way macro-heavy configuration headers look,
+and reports the best of several 'clang -cc1 -fsyntax-only' runs over it.
+Checking that such a bound is an integer constant expression folds its
+operands again at every level, which the constant value cache in the
+ASTContext turns from quadratic into linear work; pass -X -print-stats to see
+its hits and misses.  The shape of the expressions can be chosen with --kind:
+chains of '||' or '&&', and conditionals nested in their own conditions.
+"""
+
+from __future__ import print_function
+
+import os
+
+import benchutils
+
+def generateExpression(kind, depth):
+    if kind == 'or':
+        return '(1' + ' || 0' * depth + ')'
+    if kind == 'and':
+        return '(1' + ' && 1' * depth + ')'
+    if kind == 'cond':
+        return '(' * depth + '1' + ' ? 1 : 0)' * depth
+    raise ValueError(kind)
+
+def writeSource(path, kind, count, depth):
+    f = open(path, 'w')
+    try:
+        for i in range(count):
+            bound = generateExpression(kind, depth)
+            f.write('int array%d[%s + %d];\n' % (i, bound, i))
+    finally:
+        f.close()
+
+def main():
+    from optparse import OptionParser
+    parser = OptionParser("usage: %prog [options]")
+    benchutils.addCommonOptions(parser, "per kind")
+    parser.add_option("", "--kind", dest="kinds", action="append",
+                      choices=['or', 'and', 'cond'], default=[],
+                      help="Shape of the nested expressions, may be given "
+                           "more than once [all of them]")
+    parser.add_option("-c", "--count", dest="count", type=int, default=100,
+                      help="Number of array declarations [%default]")
+    parser.add_option("-d", "--depth", dest="depth", type=int, default=2000,
+                      help="Nesting depth of each bound [%default]")
+    opts, args = parser.parse_args()
+    if args:
+        parser.error("unexpected arguments")
+
+    kinds = opts.kinds or ['or', 'and', 'cond']
+    with benchutils.temporaryDirectory() as outputDir:
+        for kind in kinds:
+            path = os.path.join(outputDir, 'constants-%s.c' % kind)
+            writeSource(path, kind, opts.count, opts.depth)
+
+            best = benchutils.bestOf(opts.numRuns, opts.clang,
+                                     ['-fsyntax-only'] + opts.extraArgs, path)
+            if best is None:
+                print('%-6s  (clang failed)' % kind)
+                continue
+            print('%-6s %8d bounds of depth %6d %8.4fs' % (
+                    kind, opts.count, opts.depth, best))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,111 @@
+#!/usr/bin/env python
+
+"""
+lexer-bench - Measure lexer throughput in MB/s.
+
+Runs 'clang -cc1' over a set of inputs (by default every file in INPUTS/) and
+reports how many megabytes of source were lexed per second.  In the default
+'-Eonly' mode the byte count comes from the SourceManager statistics printed by
+-print-stats, so headers pulled in by the input are counted as well.  In
+'-dump-raw-tokens' mode only the input file itself is lexed.
+
+With --pth, each input is first cached with -emit-pth and then preprocessed
+with the cache as -token-cache, so that the cached tokens of the input and its
+headers are used instead of the lexer.  The byte count is the same as without
+--pth, so the two throughputs can be compared directly.
+"""
+
+from __future__ import print_function
+
+import os
+import re
+import subprocess
+
+import benchutils
+
+kBytesMappedRE = re.compile(r'^(\d+) bytes of files mapped', re.M)
+
+def getBytesLexed(clang, mode, path, extraArgs):
+    if mode != '-Eonly':
+        return os.path.getsize(path)
+
+    p = subprocess.Popen([clang, '-cc1', mode, '-print-stats'] + extraArgs +
+                         [path],
+                         stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    _, err = p.communicate()
+    m = kBytesMappedRE.search(err.decode('utf-8', 'replace'))
+    if p.returncode != 0 or not m:
+        return None
+    return int(m.group(1))
+
+def buildTokenCache(clang, path, extraArgs, outputDir):
+    output = os.path.join(outputDir, os.path.basename(path) + '.pth')
+    res = benchutils.runQuietly([clang, '-cc1', '-emit-pth', '-o', output] +
+                                extraArgs + [path])
+    if res != 0:
+        return None
+    return output
+
+def runInputs(opts, args, cacheDir):
+    totalBytes = 0
+    totalTime = 0.0
+    for path in args:
+        numBytes = getBytesLexed(opts.clang, opts.mode, path, opts.extraArgs)
+        if numBytes is None:
+            print('%-32s  (skipped, clang failed)' % os.path.basename(path))
+            continue
+
+        runArgs = opts.extraArgs
+        if opts.pth:
+            cache = buildTokenCache(opts.clang, path, opts.extraArgs, cacheDir)
+            if cache is None:
+                print('%-32s  (skipped, -emit-pth failed)' %
+                      os.path.basename(path))
+                continue
+            runArgs = runArgs + ['-token-cache', cache]
+
+        best = benchutils.bestOf(opts.numRuns, opts.clang,
+                                 [opts.mode] + runArgs, path)
+        if best is None:
+            print('%-32s  (skipped, clang failed)' % os.path.basename(path))
+            continue
+
+        totalBytes += numBytes
+        totalTime += best
+        print('%-32s %10d bytes %8.4fs %8.2f MB/s' % (
+                os.path.basename(path), numBytes, best,
+                numBytes / best / (1024 * 1024)))
+    return totalBytes, totalTime
+
+def main():
+    from optparse import OptionParser
+    parser = OptionParser("usage: %prog [options] [inputs...]")
+    benchutils.addCommonOptions(parser, "per input")
+    parser.add_option("", "--raw", dest="mode", action="store_const",
+                      const="-dump-raw-tokens", default="-Eonly",
+                      help="Raw lex the input files instead of preprocessing")
+    parser.add_option("", "--pth", dest="pth", action="store_true",
+                      default=False,
+                      help="Preprocess through a PTH token cache of each input")
+    opts, args = parser.parse_args()
+    if opts.pth and opts.mode != '-Eonly':
+        parser.error("--pth can't be used with --raw")
+
+    if not args:
+        inputsDir = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                 os.pardir, 'INPUTS')
+        args = sorted(os.path.join(inputsDir, name)
+                      for name in os.listdir(inputsDir))
+
+    # PTH only caches files named by absolute paths.
+    args = [os.path.abspath(path) for path in args]
+    with benchutils.temporaryDirectory() as cacheDir:
+        totalBytes, totalTime = runInputs(opts, args, cacheDir)
+
+    if totalTime:
+        print('%-32s %10d bytes %8.4fs %8.2f MB/s' % (
+                'TOTAL', totalBytes, totalTime,
+                totalBytes / totalTime / (1024 * 1024)))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,75 @@
+#!/usr/bin/env python
+
+"""
+literal-bench - Measure how fast clang parses large literal tables.
+
+Generates an array initializer with a million (by default) integer literals,
+the way generated lookup tables and firmware blobs look, and reports the best
+of several 'clang -cc1 -fsyntax-only' runs over it.  The mix of literals can be
+chosen with --kind: small and large decimal numbers, hex numbers and
+character constants.
+"""
+
+from __future__ import print_function
+
+import os
+import random
+
+import benchutils
+
+def generateLiteral(kind, rand):
+    if kind == 'small':
+        return str(rand.randint(0, 255))
+    if kind == 'large':
+        return '%dULL' % rand.randint(0, 2**64 - 1)
+    if kind == 'hex':
+        return '0x%08X' % rand.randint(0, 2**32 - 1)
+    if kind == 'char':
+        return "'%s'" % chr(rand.randint(ord('a'), ord('z')))
+    raise ValueError(kind)
+
+def writeTable(path, kind, count):
+    rand = random.Random(count)
+    elementType = 'unsigned long long' if kind == 'large' else 'unsigned'
+    f = open(path, 'w')
+    try:
+        f.write('const %s table[] = {\n' % elementType)
+        for i in range(0, count, 16):
+            literals = [generateLiteral(kind, rand)
+                        for j in range(min(16, count - i))]
+            f.write('  %s,\n' % ', '.join(literals))
+        f.write('};\n')
+    finally:
+        f.close()
+
+def main():
+    from optparse import OptionParser
+    parser = OptionParser("usage: %prog [options]")
+    benchutils.addCommonOptions(parser, "per table")
+    parser.add_option("", "--kind", dest="kinds", action="append",
+                      choices=['small', 'large', 'hex', 'char'], default=[],
+                      help="Kind of literal to fill the table with, may be "
+                           "given more than once [all of them]")
+    parser.add_option("-c", "--count", dest="count", type=int,
+                      default=1000000,
+                      help="Number of literals in the table [%default]")
+    opts, args = parser.parse_args()
+    if args:
+        parser.error("unexpected arguments")
+
+    kinds = opts.kinds or ['small', 'large', 'hex', 'char']
+    with benchutils.temporaryDirectory() as outputDir:
+        for kind in kinds:
+            path = os.path.join(outputDir, 'literals-%s.c' % kind)
+            writeTable(path, kind, opts.count)
+
+            best = benchutils.bestOf(opts.numRuns, opts.clang,
+                                     ['-fsyntax-only'] + opts.extraArgs, path)
+            if best is None:
+                print('%-8s  (clang failed)' % kind)
+                continue
+            print('%-8s %10d literals %8.4fs %8.2f M literals/s' % (
+                    kind, opts.count, best, opts.count / best / 1e6))
+
+if __name__ == '__main__':
+    main()
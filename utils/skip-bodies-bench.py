@@ -0,0 +1,76 @@
+#!/usr/bin/env python
+
+"""
+skip-bodies-bench - Measure how much -skip-function-bodies saves.
+
+Generates a large C file made of many functions with sizeable bodies, the way
+amalgamated sources and generated code look, and reports the best of several
+'clang -cc1 -fsyntax-only' runs over it, with and without
+-skip-function-bodies.
+"""
+
+from __future__ import print_function
+
+import os
+
+import benchutils
+
+def writeSource(path, numFunctions, numStatements):
+    f = open(path, 'w')
+    try:
+        f.write('struct point { int x, y; };\n\n')
+        for i in range(numFunctions):
+            f.write('int func%d(struct point *p, int n) {\n' % i)
+            f.write('  int sum = 0, i;\n')
+            for j in range(numStatements):
+                f.write('  for (i = 0; i < n; ++i) {\n')
+                f.write('    if (p[i].x > %d)\n' % j)
+                f.write('      sum += p[i].x * %d - p[i].y;\n' % (j + 1))
+                f.write('    else\n')
+                f.write('      sum ^= (p[i].y << %d) | %d;\n' % (j % 8, i))
+                f.write('  }\n')
+            if i:
+                f.write('  return sum + func%d(p, n - 1);\n' % (i - 1))
+            else:
+                f.write('  return sum;\n')
+            f.write('}\n\n')
+    finally:
+        f.close()
+
+def main():
+    from optparse import OptionParser
+    parser = OptionParser("usage: %prog [options]")
+    benchutils.addCommonOptions(parser, "per mode")
+    parser.add_option("-f", "--functions", dest="numFunctions", type=int,
+                      default=20000,
+                      help="Number of functions in the file [%default]")
+    parser.add_option("-s", "--statements", dest="numStatements", type=int,
+                      default=10,
+                      help="Number of loops in each function [%default]")
+    opts, args = parser.parse_args()
+    if args:
+        parser.error("unexpected arguments")
+
+    with benchutils.temporaryDirectory() as outputDir:
+        path = os.path.join(outputDir, 'functions.c')
+        writeSource(path, opts.numFunctions, opts.numStatements)
+        size = os.path.getsize(path)
+
+        results = []
+        for name, args in (('full', []),
+                           ('skip', ['-skip-function-bodies'])):
+            best = benchutils.bestOf(opts.numRuns, opts.clang,
+                                     ['-fsyntax-only'] + opts.extraArgs + args,
+                                     path)
+            if best is None:
+                print('%-6s (clang failed)' % name)
+                continue
+            results.append(best)
+            print('%-6s %8d functions %8.2f MB %8.4fs %8.2f MB/s' % (
+                    name, opts.numFunctions, size / 1e6, best,
+                    size / best / 1e6))
+        if len(results) == 2:
+            print('speedup %.2fx' % (results[0] / results[1]))
+
+if __name__ == '__main__':
+    main()